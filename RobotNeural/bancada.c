@@ -0,0 +1,350 @@
+//************************************************************************************************
+//* UNIVERSIDADE FEDERAL DO RIO GRANDE DO SUL (UFRGS) - Campus do Vale                          **
+//* Doutorado em Ciencia da Computacao - PPGC                                                   **
+//* Doutorando: Milton Roberto Heinen - 00145752                                                **
+//* Orientador: Paulo Martins Engel                                                             **
+//* Simulador de redes neurais com o algoritmo backpropagation padrao (sem momentum)            **
+//************************************************************************************************
+// Bancada de medicao do stlfn (make bancada):
+//   bancada <pesos> [-j <threads>] [-e <database>] [-r <pesos de referencia>]
+//     ns por registro da ativacao registro a registro (AtivarAnnContexto) e em lote (AtivarAnnBatchContexto)
+//     com N = 1, 16, 1024 e 1M, a maior diferenca entre os dois caminhos e, com -r, o tempo e o erro da rede
+//     em relacao a referencia (ex.: rede.wtsq do tlfn -z contra a rede.wts original, com -e <base>.tst)
+//   bancada -g <base> <entradas> <saidas> <registros> [semente]
+//     grava <base>.lrn e <base>.tst sinteticos, para medir o treinamento (amostras por segundo do tlfn,
+//     make all e make all SIMPLES=1) e a quantizacao (tlfn <base> -z <base>.lrn) em redes largas
+// As entradas medidas sao as do database (.lrn/.tst em texto, repetidas ate o tamanho do lote) ou aleatorias em
+// [-1, 1]; os tempos sao de parede, a melhor de varias repeticoes
+
+//*************************************** Includes ***********************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "stlfn.h"
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+
+//************************************** Constantes **********************************************
+#define NUM_TAMANHOS 4
+#define MAX_VALORES_LOTE (32 * 1024 * 1024)
+#define TEMPO_MINIMO 0.2
+#define NUM_REPETICOES 3
+
+
+//************************************** Prototipos **********************************************
+double TempoReal();
+double Aleatorio();
+int LerEntradas(const char *szNomeArquivo, double *pdEntradas, const int iNumEntradas, const int iNumRegistros);
+int GerarDatabase(const char *szNomeArquivo, const int iNumEntradas, const int iNumSaidas, const int iNumRegistros,
+    const double *pdPesos);
+int GerarDatabases(const char *szBase, const int iNumEntradas, const int iNumSaidas, const int iNumRegistros);
+double MedirRegistros(const TAnn *ptAnn, TContextoAnn *ptContexto, const double *pdEntradas, double *pdSaidas,
+    const int iNumRegistros);
+double MedirLote(const TAnn *ptAnn, TContextoAnn *ptContexto, const double *pdEntradas, double *pdSaidas,
+    const int iNumRegistros, const int iNumThreads);
+double MaiorDiferenca(const double *pdA, const double *pdB, const int iN, double *pdRms);
+
+
+//************************************* Funcao main **********************************************
+int main(int argc, char* argv[])
+{
+  static const int viTamanhos[NUM_TAMANHOS] = {1, 16, 1024, 1024 * 1024};
+  int i, iNumThreads = 1, iNumEntradas, iNumSaidas, iMaxRegistros = 0;
+  const char *szReferencia = NULL, *szDatabase = NULL;
+  double *pdEntradas, *pdSaidas, *pdSaidasLote, *pdSaidasReferencia;
+  double dTempoRegistros, dTempoLote, dTempoReferencia, dDiferenca, dRms;
+  TAnn *ptAnn, *ptReferencia = NULL;
+  TContextoAnn *ptContexto, *ptContextoReferencia = NULL;
+
+  // Verifica os parametros
+  if (argc >= 6 && !strcmp(argv[1], "-g")) {
+    srand(argc > 6 ? atoi(argv[6]) : 1);
+    return !GerarDatabases(argv[2], atoi(argv[3]), atoi(argv[4]), atoi(argv[5]));
+  }
+  if (argc < 2) {
+    printf("USO: %s <pesos> [-j <threads>] [-e <database>] [-r <pesos de referencia>]\n", argv[0]);
+    printf("     %s -g <base> <entradas> <saidas> <registros> [semente]\n", argv[0]);
+    return 1;
+  }
+  for (i = 2; i < argc; i++)
+    if (!strcmp(argv[i], "-j") && i + 1 < argc)
+      iNumThreads = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "-e") && i + 1 < argc)
+      szDatabase = argv[++i];
+    else if (!strcmp(argv[i], "-r") && i + 1 < argc)
+      szReferencia = argv[++i];
+    else {
+      fprintf(stderr, "ERRO: Parametro invalido: %s\n", argv[i]);
+      return 1;
+    }
+  if (iNumThreads < 1)
+    iNumThreads = 1;
+
+  // Carrega a rede (e a de referencia, que deve ter as mesmas entradas e saidas)
+  if ((ptAnn = CriarAnn()) == NULL || !CarregarAnn(ptAnn, argv[1]) ||
+      (ptContexto = CriarContextoAnn(ptAnn)) == NULL)
+    return 1;
+  iNumEntradas = NumeroEntradasAnn(ptAnn);
+  iNumSaidas = NumeroSaidasAnn(ptAnn);
+  if (szReferencia != NULL) {
+    if ((ptReferencia = CriarAnn()) == NULL || !CarregarAnn(ptReferencia, szReferencia) ||
+        (ptContextoReferencia = CriarContextoAnn(ptReferencia)) == NULL)
+      return 1;
+    if (NumeroEntradasAnn(ptReferencia) != iNumEntradas || NumeroSaidasAnn(ptReferencia) != iNumSaidas) {
+      fprintf(stderr, "ERRO: A rede de referencia tem outro numero de entradas ou saidas\n");
+      return 1;
+    }
+  }
+
+  // Entradas do maior lote que cabe no limite de memoria
+  for (i = 0; i < NUM_TAMANHOS; i++)
+    if ((double) viTamanhos[i] * (iNumEntradas + iNumSaidas) <= MAX_VALORES_LOTE)
+      iMaxRegistros = viTamanhos[i];
+  pdEntradas = (double*) malloc(sizeof(double) * iMaxRegistros * iNumEntradas);
+  pdSaidas = (double*) malloc(sizeof(double) * iMaxRegistros * iNumSaidas);
+  pdSaidasLote = (double*) malloc(sizeof(double) * iMaxRegistros * iNumSaidas);
+  pdSaidasReferencia = (double*) malloc(sizeof(double) * iMaxRegistros * iNumSaidas);
+  if (pdEntradas == NULL || pdSaidas == NULL || pdSaidasLote == NULL || pdSaidasReferencia == NULL) {
+    fprintf(stderr, "ERRO: Memoria insuficiente para as entradas\n");
+    return 1;
+  }
+  if (szDatabase != NULL) {
+    if (!LerEntradas(szDatabase, pdEntradas, iNumEntradas, iMaxRegistros))
+      return 1;
+  }
+  else {
+    srand(1);
+    for (i = 0; i < iMaxRegistros * iNumEntradas; i++)
+      pdEntradas[i] = 2.0 * Aleatorio() - 1.0;
+  }
+
+  // Registro a registro contra o lote, em ns por registro
+  printf("Rede %s: %d entradas, %d saidas, %d threads no lote\n", argv[1], iNumEntradas, iNumSaidas, iNumThreads);
+  printf("%10s %12s %12s %8s %12s\n", "N", "registros", "lote", "ganho", "diferenca");
+  for (i = 0; i < NUM_TAMANHOS && viTamanhos[i] <= iMaxRegistros; i++) {
+    dTempoRegistros = MedirRegistros(ptAnn, ptContexto, pdEntradas, pdSaidas, viTamanhos[i]);
+    dTempoLote = MedirLote(ptAnn, ptContexto, pdEntradas, pdSaidasLote, viTamanhos[i], iNumThreads);
+    dDiferenca = MaiorDiferenca(pdSaidas, pdSaidasLote, viTamanhos[i] * iNumSaidas, &dRms);
+    printf("%10d %12.1f %12.1f %7.2fx %12.3g\n", viTamanhos[i], dTempoRegistros, dTempoLote,
+        dTempoRegistros / dTempoLote, dDiferenca);
+  }
+  if (iMaxRegistros < viTamanhos[NUM_TAMANHOS - 1])
+    fprintf(stderr, "AVISO: Lotes com mais de %d registros excedem o limite de memoria da bancada\n", iMaxRegistros);
+
+  // Tempo e erro contra a rede de referencia, registro a registro, sobre as mesmas entradas
+  if (ptReferencia != NULL) {
+    dTempoRegistros = MedirRegistros(ptAnn, ptContexto, pdEntradas, pdSaidas, iMaxRegistros);
+    dTempoReferencia = MedirRegistros(ptReferencia, ptContextoReferencia, pdEntradas, pdSaidasReferencia,
+        iMaxRegistros);
+    dDiferenca = MaiorDiferenca(pdSaidas, pdSaidasReferencia, iMaxRegistros * iNumSaidas, &dRms);
+    printf("Referencia %s: %.1f ns, rede %.1f ns (%.2fx); erro maximo %.3g, RMS %.3g\n", szReferencia,
+        dTempoReferencia, dTempoRegistros, dTempoReferencia / dTempoRegistros, dDiferenca, dRms);
+    LiberarContextoAnn(ptContextoReferencia);
+    LiberarAnn(ptReferencia);
+  }
+
+  free(pdEntradas);
+  free(pdSaidas);
+  free(pdSaidasLote);
+  free(pdSaidasReferencia);
+  LiberarContextoAnn(ptContexto);
+  LiberarAnn(ptAnn);
+  return 0;
+}
+
+
+//*************************************** Funcoes ************************************************
+double TempoReal()
+{
+#ifdef _WIN32
+  LARGE_INTEGER liContador, liFrequencia;
+
+  QueryPerformanceCounter(&liContador);
+  QueryPerformanceFrequency(&liFrequencia);
+  return (double) liContador.QuadPart / (double) liFrequencia.QuadPart;
+#else
+  struct timespec tsAgora;
+
+  // Tempo de parede (o lote pode ser dividido entre threads)
+  clock_gettime(CLOCK_MONOTONIC, &tsAgora);
+  return tsAgora.tv_sec + tsAgora.tv_nsec * 1.0e-9;
+#endif
+}
+
+
+double Aleatorio()
+{
+  return (double) rand() / ((double) RAND_MAX + 1.0);
+}
+
+
+int LerEntradas(const char *szNomeArquivo, double *pdEntradas, const int iNumEntradas, const int iNumRegistros)
+{
+  int r, i, iEntradas, iSaidas, iRegistros, iValido;
+  double dSaida;
+  FILE *fp;
+
+  if ((fp = fopen(szNomeArquivo, "r")) == NULL) {
+    fprintf(stderr, "ERRO: Nao foi possivel abrir o arquivo %s\n", szNomeArquivo);
+    return 0;
+  }
+  if (fscanf(fp, "%d %d %d", &iEntradas, &iSaidas, &iRegistros) != 3 || iEntradas != iNumEntradas ||
+      iRegistros < 1) {
+    fprintf(stderr, "ERRO: O database %s nao tem as %d entradas da rede\n", szNomeArquivo, iNumEntradas);
+    fclose(fp);
+    return 0;
+  }
+
+  // Os registros do arquivo (sem as saidas) se repetem ate preencher o lote
+  for (r = 0; r < iRegistros && r < iNumRegistros; r++) {
+    for (iValido = 1, i = 0; i < iNumEntradas + iSaidas; i++)
+      iValido &= fscanf(fp, "%lf", (i < iNumEntradas ? &pdEntradas[(size_t) r * iNumEntradas + i] : &dSaida)) == 1;
+    if (!iValido) {
+      fprintf(stderr, "ERRO: Registro %d invalido no database %s\n", r + 1, szNomeArquivo);
+      fclose(fp);
+      return 0;
+    }
+  }
+  fclose(fp);
+  for (; r < iNumRegistros; r++)
+    memcpy(pdEntradas + (size_t) r * iNumEntradas, pdEntradas + (size_t) (r % iRegistros) * iNumEntradas,
+        sizeof(double) * iNumEntradas);
+  return 1;
+}
+
+
+int GerarDatabase(const char *szNomeArquivo, const int iNumEntradas, const int iNumSaidas, const int iNumRegistros,
+    const double *pdPesos)
+{
+  int r, i, j;
+  double dSoma, *pdEntrada;
+  FILE *fp;
+
+  if ((fp = fopen(szNomeArquivo, "w")) == NULL) {
+    fprintf(stderr, "ERRO: Nao foi possivel criar o arquivo %s\n", szNomeArquivo);
+    return 0;
+  }
+  pdEntrada = (double*) malloc(sizeof(double) * iNumEntradas);
+  if (pdEntrada == NULL) {
+    fprintf(stderr, "ERRO: Memoria insuficiente para o database\n");
+    fclose(fp);
+    return 0;
+  }
+
+  // Cada saida e uma funcao suave e limitada de uma combinacao das entradas (alcancavel pela tanh)
+  fprintf(fp, "%d %d %d\n", iNumEntradas, iNumSaidas, iNumRegistros);
+  for (r = 0; r < iNumRegistros; r++) {
+    for (i = 0; i < iNumEntradas; i++) {
+      pdEntrada[i] = 2.0 * Aleatorio() - 1.0;
+      fprintf(fp, "%.4f ", pdEntrada[i]);
+    }
+    for (j = 0; j < iNumSaidas; j++) {
+      for (dSoma = 0.0, i = 0; i < iNumEntradas; i++)
+        dSoma += pdPesos[j * iNumEntradas + i] * pdEntrada[i];
+      fprintf(fp, (j + 1 < iNumSaidas ? "%.4f " : "%.4f\n"), 0.8 * (j % 2 ? sin(dSoma) : tanh(dSoma)));
+    }
+  }
+  free(pdEntrada);
+  if (fclose(fp)) {
+    fprintf(stderr, "ERRO: Nao foi possivel gravar o arquivo %s\n", szNomeArquivo);
+    return 0;
+  }
+  return 1;
+}
+
+
+int GerarDatabases(const char *szBase, const int iNumEntradas, const int iNumSaidas, const int iNumRegistros)
+{
+  int i, iOk;
+  char *szNomeArquivo;
+  double *pdPesos;
+
+  if (iNumEntradas < 1 || iNumSaidas < 1 || iNumRegistros < 1) {
+    fprintf(stderr, "ERRO: Numero de entradas, saidas e registros devem ser positivos\n");
+    return 0;
+  }
+  szNomeArquivo = (char*) malloc(strlen(szBase) + 5);
+  pdPesos = (double*) malloc(sizeof(double) * iNumEntradas * iNumSaidas);
+  if (szNomeArquivo == NULL || pdPesos == NULL) {
+    fprintf(stderr, "ERRO: Memoria insuficiente para o database\n");
+    free(szNomeArquivo);
+    free(pdPesos);
+    return 0;
+  }
+
+  // A mesma funcao alvo nos dois arquivos, com pesos de variancia 1 / entradas
+  for (i = 0; i < iNumEntradas * iNumSaidas; i++)
+    pdPesos[i] = (2.0 * Aleatorio() - 1.0) * sqrt(3.0 / iNumEntradas);
+  sprintf(szNomeArquivo, "%s.lrn", szBase);
+  iOk = GerarDatabase(szNomeArquivo, iNumEntradas, iNumSaidas, iNumRegistros, pdPesos);
+  sprintf(szNomeArquivo, "%s.tst", szBase);
+  iOk = iOk && GerarDatabase(szNomeArquivo, iNumEntradas, iNumSaidas, iNumRegistros, pdPesos);
+  free(szNomeArquivo);
+  free(pdPesos);
+  return iOk;
+}
+
+
+double MedirRegistros(const TAnn *ptAnn, TContextoAnn *ptContexto, const double *pdEntradas, double *pdSaidas,
+    const int iNumRegistros)
+{
+  int r, k, iVoltas;
+  int iNumEntradas = NumeroEntradasAnn(ptAnn), iNumSaidas = NumeroSaidasAnn(ptAnn);
+  double dInicio, dTempo, dMelhor = 0.0;
+
+  // Repete o lote inteiro ate TEMPO_MINIMO segundos; fica com a melhor de NUM_REPETICOES medicoes
+  for (k = 0; k < NUM_REPETICOES; k++) {
+    iVoltas = 0;
+    dInicio = TempoReal();
+    do {
+      for (r = 0; r < iNumRegistros; r++)
+        AtivarAnnContexto(ptAnn, ptContexto, pdEntradas + (size_t) r * iNumEntradas,
+            pdSaidas + (size_t) r * iNumSaidas);
+      iVoltas++;
+    } while ((dTempo = TempoReal() - dInicio) < TEMPO_MINIMO);
+    dTempo = dTempo * 1.0e9 / ((double) iVoltas * iNumRegistros);
+    if (!k || dTempo < dMelhor)
+      dMelhor = dTempo;
+  }
+  return dMelhor;
+}
+
+
+double MedirLote(const TAnn *ptAnn, TContextoAnn *ptContexto, const double *pdEntradas, double *pdSaidas,
+    const int iNumRegistros, const int iNumThreads)
+{
+  int k, iVoltas;
+  double dInicio, dTempo, dMelhor = 0.0;
+
+  for (k = 0; k < NUM_REPETICOES; k++) {
+    iVoltas = 0;
+    dInicio = TempoReal();
+    do {
+      AtivarAnnBatchContexto(ptAnn, ptContexto, pdEntradas, pdSaidas, iNumRegistros, iNumThreads);
+      iVoltas++;
+    } while ((dTempo = TempoReal() - dInicio) < TEMPO_MINIMO);
+    dTempo = dTempo * 1.0e9 / ((double) iVoltas * iNumRegistros);
+    if (!k || dTempo < dMelhor)
+      dMelhor = dTempo;
+  }
+  return dMelhor;
+}
+
+
+double MaiorDiferenca(const double *pdA, const double *pdB, const int iN, double *pdRms)
+{
+  int i;
+  double dMaior = 0.0, dSoma = 0.0;
+
+  for (i = 0; i < iN; i++) {
+    dSoma += (pdA[i] - pdB[i]) * (pdA[i] - pdB[i]);
+    if (fabs(pdA[i] - pdB[i]) > dMaior)
+      dMaior = fabs(pdA[i] - pdB[i]);
+  }
+  *pdRms = sqrt(dSoma / (iN > 0 ? iN : 1));
+  return dMaior;
+}
@@ -0,0 +1,136 @@
+//************************************************************************************************
+//* UNIVERSIDADE FEDERAL DO RIO GRANDE DO SUL (UFRGS) - Campus do Vale                          **
+//* Doutorado em Ciencia da Computacao - PPGC                                                   **
+//* Doutorando: Milton Roberto Heinen - 00145752                                                **
+//* Orientador: Paulo Martins Engel                                                             **
+//* MLP com uma camada oculta e topologia fixa em tempo de compilacao (template header-only)    **
+//************************************************************************************************
+#ifndef MLP_H
+#define MLP_H
+
+#include <array>
+#include <stdio.h>
+#include "vetorial.h"
+#include "rede.h"
+#include "redecompilada.h"
+
+
+//*************************************** Classes ************************************************
+// Rede iNumEntradas-iNumOcultos-iNumSaidas com os pesos de cada camada transpostos em std::array (uma linha
+// por entrada e o bias na ultima; os neuronios com padding zerado ate ALINHAMENTO bytes), carregados de
+// qualquer arquivo aceito por CarregarRede (.wts texto ou .wtsb binario); a ativacao usa apenas buffers
+// na pilha e nao altera o objeto, entao varias threads podem ativar a mesma rede sem contexto (objetos
+// no heap devem vir de AlocarAlinhado, pois o alinhamento dos membros passa do garantido pelo new)
+template <int iNumEntradas, int iNumOcultos, int iNumSaidas, class T = double>
+class Mlp {
+public:
+  static constexpr int LARGURA_OCULTA = ((iNumOcultos * (int) sizeof(T) + ALINHAMENTO - 1) / ALINHAMENTO) *
+      (ALINHAMENTO / (int) sizeof(T));
+  static constexpr int LARGURA_SAIDA = ((iNumSaidas * (int) sizeof(T) + ALINHAMENTO - 1) / ALINHAMENTO) *
+      (ALINHAMENTO / (int) sizeof(T));
+
+  Mlp() : iAtivacaoOculta(ATIVACAO_TANH), iAtivacaoSaida(ATIVACAO_LINEAR)
+  {
+    for (int k = 0; k <= iNumEntradas; k++)
+      vvPesoOculta[k].fill((T) 0);
+    for (int k = 0; k <= iNumOcultos; k++)
+      vvPesoSaida[k].fill((T) 0);
+  }
+
+  // Verdadeiro se a rede dinamica tem exatamente esta topologia
+  static bool Compativel(const TRede &tRede)
+  {
+    return (tRede.iNumCamadas == 2 && tRede.iNumEntradas == iNumEntradas &&
+        tRede.vtCamadas[0].iNumNeuronios == iNumOcultos && tRede.vtCamadas[1].iNumNeuronios == iNumSaidas);
+  }
+
+  // Copia os pesos e as ativacoes de uma rede carregada com CarregarRede
+  bool Copiar(const TRede &tRede)
+  {
+    if (!Compativel(tRede))
+      return false;
+    CopiarCamada<iNumEntradas, iNumOcultos, LARGURA_OCULTA>(tRede.vtCamadas[0], vvPesoOculta);
+    CopiarCamada<iNumOcultos, iNumSaidas, LARGURA_SAIDA>(tRede.vtCamadas[1], vvPesoSaida);
+    iAtivacaoOculta = tRede.vtCamadas[0].iAtivacao;
+    iAtivacaoSaida = tRede.vtCamadas[1].iAtivacao;
+    return true;
+  }
+
+  bool Carregar(const char *szNomeArquivo)
+  {
+    TRede tRede;
+    bool bCopiada;
+
+    if (!CarregarRede(&tRede, szNomeArquivo))
+      return false;
+    if (!(bCopiada = Copiar(tRede)))
+      fprintf(stderr, "ERRO: A rede de %s nao tem a topologia %d-%d-%d\n", szNomeArquivo, iNumEntradas,
+          iNumOcultos, iNumSaidas);
+    DestruirRede(&tRede);
+    return bCopiada;
+  }
+
+  // Propaga iNumEntradas entradas ate as iNumSaidas saidas (TEntrada e TSaida sao convertidos para T)
+  template <class TEntrada, class TSaida>
+  void Ativar(const TEntrada *pdEntrada, TSaida *pdSaida) const
+  {
+    alignas(ALINHAMENTO) std::array<T, LARGURA_OCULTA> vOculta;
+    alignas(ALINHAMENTO) std::array<T, LARGURA_SAIDA> vSaida;
+
+    Propagar<iNumEntradas, iNumOcultos, LARGURA_OCULTA>(vvPesoOculta, pdEntrada, vOculta.data(), iAtivacaoOculta);
+    Propagar<iNumOcultos, iNumSaidas, LARGURA_SAIDA>(vvPesoSaida, vOculta.data(), vSaida.data(), iAtivacaoSaida);
+    for (int j = 0; j < iNumSaidas; j++)
+      pdSaida[j] = (TSaida) vSaida[j];
+  }
+
+private:
+  template <int iN, int iNumNeuronios, int iLargura>
+  static void CopiarCamada(const TCamada &tCamada, std::array<std::array<T, iLargura>, iN + 1> &vvPeso)
+  {
+    for (int i = 0; i < iNumNeuronios; i++) {
+      for (int k = 0; k <= iN; k++)
+        vvPeso[k][i] = (T) tCamada.pdPeso[i * tCamada.iStride + k];
+    }
+  }
+
+  // Bias seguido das entradas em ordem crescente para cada neuronio, como em AtivarRede; os lacos tem
+  // tamanho fixo e os neuronios sao independentes, entao o compilador os desenrola e vetoriza
+  template <int iN, int iNumNeuronios, int iLargura, class TX>
+  static void Propagar(const std::array<std::array<T, iLargura>, iN + 1> &vvPeso, const TX *pdX, T *pdY,
+      const int iAtivacao)
+  {
+    for (int i = 0; i < iNumNeuronios; i++)
+      pdY[i] = vvPeso[iN][i];
+    for (int k = 0; k < iN; k++) {
+      for (int i = 0; i < iNumNeuronios; i++)
+        pdY[i] += vvPeso[k][i] * (T) pdX[k];
+    }
+    Ativacao(iAtivacao, pdY, iNumNeuronios);
+  }
+
+  // Na precisao da rede usa os kernels vetoriais ativos (as mesmas saidas de AtivarRede)
+  static void Ativacao(const int iAtivacao, TReal *pdY, const int iN)
+  {
+    AplicarAtivacao(iAtivacao, pdY, iN);
+  }
+
+  template <class TOutro>
+  static void Ativacao(const int iAtivacao, TOutro *pdY, const int iN)
+  {
+    if (iAtivacao == ATIVACAO_TANH) {
+      for (int i = 0; i < iN; i++)
+        pdY[i] = (TOutro) TanhCompilada((double) pdY[i]);
+    }
+    else if (iAtivacao == ATIVACAO_TANH_RAPIDA) {
+      for (int i = 0; i < iN; i++)
+        pdY[i] = (TOutro) TanhRapidaCompilada((double) pdY[i]);
+    }
+  }
+
+  alignas(ALINHAMENTO) std::array<std::array<T, LARGURA_OCULTA>, iNumEntradas + 1> vvPesoOculta;
+  alignas(ALINHAMENTO) std::array<std::array<T, LARGURA_SAIDA>, iNumOcultos + 1> vvPesoSaida;
+  int iAtivacaoOculta;
+  int iAtivacaoSaida;
+};
+
+#endif
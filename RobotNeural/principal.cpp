@@ -12,6 +12,11 @@
 #include <stdlib.h>
 #include <math.h>
 #include "stlfn.h"
+// Controlador compilado (gerado com tlfn <base> -d <cabecalho>): compilar com -DCABECALHO_REDE='"<cabecalho>"'
+// (C++11, de preferencia com -O3 e os flags da CPU do robo) para usar a rede fixa no lugar do arquivo de pesos
+#ifdef CABECALHO_REDE
+#include CABECALHO_REDE
+#endif
 
 
 //********************************** Variaveis globais *******************************************
@@ -25,14 +30,27 @@ int main(int argc, char* argv[])
   int i;
   
   // Verifica os parametros
+#ifdef REDE_COMPILADA
+  if (argc < 3) {
+    printf("USO: %s <server_address> <port_number>\n", argv[0]);
+#else
   if (argc < 4) {
     printf("USO: %s <server_address> <port_number> <file_weights.wts>\n", argv[0]);    
+#endif
     getchar();
     return 0;
   }  
   
-  // Carrega a rede neural, as entradas e as saidas
+  // Carrega a rede neural (ou confere a compilada com as saidas gravadas pelo tlfn), as entradas e as saidas
+#ifdef REDE_COMPILADA
+  if (VerificarCompilada<REDE_COMPILADA>() > REDE_COMPILADA::TOLERANCIA) {
+    printf("The compiled network does not match its reference outputs...\n");
+    getchar();
+    return 0;
+  }
+#else
   InicializarAnn(argv[3]);
+#endif
   pdEntrada = (double*) malloc(sizeof(double) * 8);
   pdSaidaObtida = (double*) malloc(sizeof(double) * 2);
   pdSaidaObtida[0] = pdSaidaObtida[1] = 0.0;
@@ -57,7 +75,11 @@ int main(int argc, char* argv[])
     pdEntrada[6] = pdSaidaObtida[0]; 
     pdEntrada[7] = pdSaidaObtida[1];
     // Ativa a rede neural
+#ifdef REDE_COMPILADA
+    AtivarCompilada<REDE_COMPILADA>(pdEntrada, pdSaidaObtida);
+#else
     AtivarAnn(pdEntrada, pdSaidaObtida);
+#endif
     // Transmite ao do rob ao ambiente
     if (!environment.act(pdSaidaObtida[0], pdSaidaObtida[1])) {
       break;
@@ -65,7 +87,9 @@ int main(int argc, char* argv[])
   }
   
   // Finaliza
+#ifndef REDE_COMPILADA
   FinalizarAnn();
+#endif
   if (pdSaidaObtida != NULL) 
     free(pdSaidaObtida);
   if (pdEntrada != NULL) 
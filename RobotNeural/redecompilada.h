@@ -0,0 +1,152 @@
+//************************************************************************************************
+//* UNIVERSIDADE FEDERAL DO RIO GRANDE DO SUL (UFRGS) - Campus do Vale                          **
+//* Doutorado em Ciencia da Computacao - PPGC                                                   **
+//* Doutorando: Milton Roberto Heinen - 00145752                                                **
+//* Orientador: Paulo Martins Engel                                                             **
+//* Redes com topologia e pesos fixos em tempo de compilacao (cabecalhos gerados com tlfn -d)   **
+//************************************************************************************************
+#ifndef REDECOMPILADA_H
+#define REDECOMPILADA_H
+
+#include <cmath>
+#include <cstring>
+#include "vetorial.h"
+#include "rede.h"
+
+
+//************************************** Constantes **********************************************
+// 1.5 * 2^52: somado a 0 <= x < 2^51, arredonda x para o inteiro mais proximo nos bits baixos da mantissa
+#define ARREDONDAMENTO_COMPILADA 6755399441055744.0
+
+
+//*************************************** Funcoes ************************************************
+// Especializados pelo cabecalho gerado para o tipo da rede (ex.: TRedeFutebol): AtivarCompilada propaga
+// NUM_ENTRADAS entradas ate as NUM_SAIDAS saidas sem alocacao nem lacos sobre a topologia e
+// VerificarCompilada retorna a maior diferenca para as saidas calculadas pelo tlfn
+template <class TControlador> void AtivarCompilada(const double *pdEntrada, double *pdSaida);
+template <class TControlador> double VerificarCompilada();
+
+
+// Mesmo algoritmo de TangenteHiperbolicaVetorAvx2 (vetorial.c) sem intrinsics nem chamadas a libm, para
+// que o compilador vetorize a ativacao da camada inteira
+inline double TanhCompilada(double dX)
+{
+  double dY, dK, dR, dQ, dExpm1, dPot;
+  unsigned long long ulBits;
+
+  // Reducao do argumento: 2|x| = k * ln2 + r
+  dY = 2.0 * std::fabs(dX);
+  dY = (dY < TANH_LIMITE ? dY : TANH_LIMITE);
+  dK = dY * INV_LN2 + ARREDONDAMENTO_COMPILADA;
+  std::memcpy(&ulBits, &dK, sizeof(double));
+  dK -= ARREDONDAMENTO_COMPILADA;
+  dR = dY - dK * LN2_HI;
+  dR = dR - dK * LN2_LO;
+
+  // expm1(r) por Horner
+  dQ = 1.0 / 6227020800.0;
+  dQ = dQ * dR + 1.0 / 479001600.0;
+  dQ = dQ * dR + 1.0 / 39916800.0;
+  dQ = dQ * dR + 1.0 / 3628800.0;
+  dQ = dQ * dR + 1.0 / 362880.0;
+  dQ = dQ * dR + 1.0 / 40320.0;
+  dQ = dQ * dR + 1.0 / 5040.0;
+  dQ = dQ * dR + 1.0 / 720.0;
+  dQ = dQ * dR + 1.0 / 120.0;
+  dQ = dQ * dR + 1.0 / 24.0;
+  dQ = dQ * dR + 1.0 / 6.0;
+  dQ = dQ * dR + 0.5;
+  dExpm1 = dR * dR * dQ + dR;
+
+  // Reconstrucao: 2^k montado no expoente a partir dos bits baixos de k (o deslocamento descarta os demais)
+  ulBits = (ulBits + 1023) << 52;
+  std::memcpy(&dPot, &ulBits, sizeof(double));
+  dExpm1 = dPot * dExpm1 + (dPot - 1.0);
+
+  // Quociente e restauracao do sinal
+  dY = dExpm1 / (dExpm1 + 2.0);
+  return (dX < 0.0 ? -dY : dY);
+}
+
+
+// Mesma aproximacao racional de TangenteHiperbolicaRapida (vetorial.c), em double
+inline double TanhRapidaCompilada(double dX)
+{
+  double dX2, dP, dQ;
+
+  dX = (dX < TANH_RAPIDA_LIMITE ? dX : TANH_RAPIDA_LIMITE);
+  dX = (dX > -TANH_RAPIDA_LIMITE ? dX : -TANH_RAPIDA_LIMITE);
+  dX2 = dX * dX;
+  dP = TANH_RAPIDA_P13;
+  dP = dP * dX2 + TANH_RAPIDA_P11;
+  dP = dP * dX2 + TANH_RAPIDA_P9;
+  dP = dP * dX2 + TANH_RAPIDA_P7;
+  dP = dP * dX2 + TANH_RAPIDA_P5;
+  dP = dP * dX2 + TANH_RAPIDA_P3;
+  dP = dP * dX2 + TANH_RAPIDA_P1;
+  dQ = TANH_RAPIDA_Q6;
+  dQ = dQ * dX2 + TANH_RAPIDA_Q4;
+  dQ = dQ * dX2 + TANH_RAPIDA_Q2;
+  dQ = dQ * dX2 + TANH_RAPIDA_Q0;
+  return dP * dX / dQ;
+}
+
+
+// Funcao de ativacao de uma camada, escolhida em tempo de compilacao pelo codigo de rede.h
+template <int iAtivacao> inline double AtivacaoCompilada(double dX);
+
+template <>
+inline double AtivacaoCompilada<ATIVACAO_LINEAR>(double dX)
+{
+  return dX;
+}
+
+template <>
+inline double AtivacaoCompilada<ATIVACAO_TANH>(double dX)
+{
+  return TanhCompilada(dX);
+}
+
+template <>
+inline double AtivacaoCompilada<ATIVACAO_TANH_RAPIDA>(double dX)
+{
+  return TanhRapidaCompilada(dX);
+}
+
+
+// pdY[i] = ativacao(vdPeso[iNumEntradas][i] + soma(vdPeso[k][i] * pdX[k])) para as iLargura colunas da
+// matriz transposta (bias na ultima linha, colunas de padding zeradas): cada neuronio acumula o bias e as
+// entradas em ordem crescente, como AtivarRede, e os neuronios sao independentes entre si, entao os lacos
+// de tamanho fixo sao desenrolados e vetorizados pelo compilador
+template <int iNumEntradas, int iLargura, int iAtivacao>
+inline void PropagarCompilada(const double (&vdPeso)[iNumEntradas + 1][iLargura], const double *pdX, double *pdY)
+{
+  for (int i = 0; i < iLargura; i++)
+    pdY[i] = vdPeso[iNumEntradas][i];
+  for (int k = 0; k < iNumEntradas; k++) {
+    for (int i = 0; i < iLargura; i++)
+      pdY[i] += vdPeso[k][i] * pdX[k];
+  }
+  for (int i = 0; i < iLargura; i++)
+    pdY[i] = AtivacaoCompilada<iAtivacao>(pdY[i]);
+}
+
+
+// Maior diferenca absoluta entre as saidas de AtivarCompilada e as saidas de referencia
+template <class TControlador, int iNumRegistros>
+double CompararCompilada(const double (&vdEntradas)[iNumRegistros][TControlador::NUM_ENTRADAS],
+    const double (&vdSaidas)[iNumRegistros][TControlador::NUM_SAIDAS])
+{
+  double vdSaida[TControlador::NUM_SAIDAS], dErro = 0.0;
+
+  for (int r = 0; r < iNumRegistros; r++) {
+    AtivarCompilada<TControlador>(vdEntradas[r], vdSaida);
+    for (int j = 0; j < TControlador::NUM_SAIDAS; j++) {
+      if (std::fabs(vdSaida[j] - vdSaidas[r][j]) > dErro)
+        dErro = std::fabs(vdSaida[j] - vdSaidas[r][j]);
+    }
+  }
+  return dErro;
+}
+
+#endif
@@ -10,143 +10,308 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <math.h>
+#include <pthread.h>
 #include "stlfn.h"
+#include "vetorial.h"
+#include "rede.h"
+#include "quantizada.h"
+// Topologias fixas (ver mlp.h): compilar com -DTOPOLOGIAS_FIXAS e ligar stlfnfixa.cpp (C++11)
+#ifdef TOPOLOGIAS_FIXAS
+#include "stlfnfixa.h"
+#endif
 
 
 //************************************** Constantes **********************************************
-#define MAX_LINHA 1024
+#define MIN_BLOCOS_THREAD 4
+
+
+//************************************ Tipos de dados ********************************************
+// Rede em ponto flutuante ou quantizada em int8 (.wtsq), conforme iQuantizada; ptFixa (TOPOLOGIAS_FIXAS) e a
+// copia da rede em ponto flutuante em um Mlp pre-instanciado, se houver um com a mesma topologia
+struct TAnn {
+  TRede tRede;
+#ifdef TOPOLOGIAS_FIXAS
+  TMlpFixa *ptFixa;
+#endif
+  TRedeQuantizada tQuantizada;
+  int iQuantizada;
+  int iCarregada;
+};
+
+// Entradas convertidas para a precisao da rede, saidas de cada uma das iNumCamadas camadas e area de
+// trabalho da ativacao em lote (ou das entradas int8 e somas inteiras da rede quantizada)
+struct TContextoAnn {
+  int iNumCamadas;
+  TReal *pdEntrada;
+  TReal **ppdSaida;
+  TReal *pdTrabalho;
+};
+
+// Faixa de registros de um lote atribuida a uma thread
+typedef struct {
+  const TRede *ptRede;
+  const double *pdEntradas;
+  double *pdSaidas;
+  int iNumRegistros;
+  TReal *pdTrabalho;
+  int iCriada;
+  pthread_t tThread;
+} TFaixaLote;
 
 
 //********************************** Variaveis globais *******************************************
-static int iNumeroEntradas = 0;
-static int iNumeroOcultos = 0;
-static int iNumeroSaidas = 0;
-static double **ppdPesoOculto = NULL;
-static double *pdCampoOculto = NULL;
-static double **ppdPesoSaida = NULL;
+static pthread_once_t tVetorialIniciado = PTHREAD_ONCE_INIT;
+static TAnn *ptAnnGlobal = NULL;
+static TContextoAnn *ptContextoGlobal = NULL;
 
 
 //*************************************** Funcoes ************************************************
-int InicializarAnn(const char *szArqPesos)
+static void IniciarVetorialAnn()
 {
-  char vcLinha[MAX_LINHA + 1];
-  char *szPalavra = NULL;
-  FILE* fp = NULL;
-  int i, j;
+  InicializarVetorial(VETORIAL_AVX512);
+}
 
-  // Salva os pesos
-  if ((fp = fopen(szArqPesos, "r")) == NULL)
-    return 0;
 
-  // Busca o numero de entradas, ocultos e saidas
-  fgets(vcLinha, MAX_LINHA, fp);
-  szPalavra = strtok(vcLinha, " ");
-  iNumeroEntradas = atoi(szPalavra);
-  szPalavra = strtok('\0', " ");
-  iNumeroOcultos = atoi(szPalavra);
-  szPalavra = strtok('\0', " ");
-  iNumeroSaidas = atoi(szPalavra);
-  if (!iNumeroEntradas || !iNumeroOcultos || !iNumeroSaidas)
-    return 0;
-  
-  // Aloca memoria para a camada oculta
-  ppdPesoOculto = (double**) malloc(sizeof(double*) * iNumeroOcultos);
-  for (i = 0; i < iNumeroOcultos; i++)
-    ppdPesoOculto[i] = (double*) malloc(sizeof(double) * (iNumeroEntradas + 1));
-  pdCampoOculto = (double*) malloc(sizeof(double) * iNumeroOcultos);
-
-  // Aloca memoria para a camada de saida
-  ppdPesoSaida = (double**) malloc(sizeof(double*) * iNumeroSaidas);
-  for (i = 0; i < iNumeroSaidas; i++)
-    ppdPesoSaida[i] = (double*) malloc(sizeof(double) * (iNumeroOcultos + 1));
-
-  // Carrega os pesos da camada oculta
-  for (i = 0; i < iNumeroOcultos && !feof(fp); i++) {
-    fgets(vcLinha, MAX_LINHA, fp);
-    szPalavra = strtok(vcLinha, " ");
-    for (j = 0; j <= iNumeroEntradas && szPalavra; j++) {
-      ppdPesoOculto[i][j] = atof(szPalavra);
-      szPalavra = strtok('\0', " ");
-    }
-    if (j <= iNumeroEntradas) {
-      fclose(fp);
-      return 0;
-    } 
+TAnn *CriarAnn()
+{
+  TAnn *ptAnn;
+
+  // Seleciona os kernels vetoriais suportados pela CPU uma vez por processo (threads que criam as suas
+  // primeiras redes ao mesmo tempo esperam a selecao, sem alterar os ponteiros dos kernels em uso)
+  pthread_once(&tVetorialIniciado, IniciarVetorialAnn);
+  ptAnn = (TAnn*) calloc(1, sizeof(TAnn));
+  if (ptAnn == NULL)
+    fprintf(stderr, "ERRO: Memoria insuficiente para a rede\n");
+  return ptAnn;
+}
+
+
+int CarregarAnn(TAnn *ptAnn, const char *szArqPesos)
+{
+  // Carrega a topologia e os pesos: o arquivo binario (.wtsb) e mapeado somente leitura, com as paginas
+  // compartilhadas entre os robos do mesmo host; o texto aceita o cabecalho versionado ou o antigo e o
+  // arquivo quantizado (.wtsq, gerado pelo tlfn -z) e reconhecido pela assinatura
+  if (ptAnn->iCarregada) {
+    if (ptAnn->iQuantizada)
+      DestruirRedeQuantizada(&ptAnn->tQuantizada);
+    else
+      DestruirRede(&ptAnn->tRede);
+#ifdef TOPOLOGIAS_FIXAS
+    LiberarMlpFixa(ptAnn->ptFixa);
+    ptAnn->ptFixa = NULL;
+#endif
+    ptAnn->iCarregada = 0;
   }
-  if (i < iNumeroOcultos) {
-    fclose(fp);
+  ptAnn->iQuantizada = ArquivoQuantizado(szArqPesos);
+  if (ptAnn->iQuantizada ? !CarregarRedeQuantizada(&ptAnn->tQuantizada, szArqPesos) :
+      !CarregarRede(&ptAnn->tRede, szArqPesos))
     return 0;
-  } 
-
-  // Carrega os pesos da camada de saida
-  for (i = 0; i < iNumeroSaidas && !feof(fp); i++) {
-    fgets(vcLinha, MAX_LINHA, fp);
-    szPalavra = strtok(vcLinha, " ");
-    for (j = 0; j <= iNumeroOcultos && szPalavra; j++) {
-      ppdPesoSaida[i][j] = atof(szPalavra);
-      szPalavra = strtok('\0', " ");
-    }
-    if (j <= iNumeroOcultos) {
-      fclose(fp);
-      return 0;
-    }
-  }
-  fclose(fp);
-  return (i < iNumeroSaidas ? 0 : 1);
+
+#ifdef TOPOLOGIAS_FIXAS
+  // As topologias comuns (ex.: 8-5-2) sao ativadas pelo Mlp com dimensoes fixas; as demais pela rede dinamica
+  if (!ptAnn->iQuantizada)
+    ptAnn->ptFixa = CriarMlpFixa(&ptAnn->tRede);
+#endif
+  ptAnn->iCarregada = 1;
+  return 1;
 }
 
 
-void AtivarAnn(const double *pdEntrada, double *pdSaidaObtida)
+int NumeroEntradasAnn(const TAnn *ptAnn)
+{
+  return ptAnn->iQuantizada ? ptAnn->tQuantizada.iNumEntradas : ptAnn->tRede.iNumEntradas;
+}
+
+
+int NumeroSaidasAnn(const TAnn *ptAnn)
 {
-  register int i, j;
-
-  // Ativa a camada oculta
-  for (i = 0; i < iNumeroOcultos; i++) {
-    pdCampoOculto[i] = ppdPesoOculto[i][iNumeroEntradas];
-    for (j = 0; j < iNumeroEntradas; j++)
-      pdCampoOculto[i] += pdEntrada[j] * ppdPesoOculto[i][j];
-    pdCampoOculto[i] = tanh(pdCampoOculto[i]);
+  return ptAnn->iQuantizada ? ptAnn->tQuantizada.iNumSaidas : ptAnn->tRede.iNumSaidas;
+}
+
+
+TContextoAnn *CriarContextoAnn(const TAnn *ptAnn)
+{
+  TContextoAnn *ptContexto;
+
+  // Buffers de ativacao para a topologia da rede (servem para qualquer rede com a mesma topologia)
+  if (!ptAnn->iCarregada || (ptContexto = (TContextoAnn*) calloc(1, sizeof(TContextoAnn))) == NULL)
+    return NULL;
+  if (ptAnn->iQuantizada) {
+    ptContexto->iNumCamadas = ptAnn->tQuantizada.iNumCamadas;
+    ptContexto->pdEntrada = (TReal*) AlocarAlinhado(sizeof(TReal) * ptAnn->tQuantizada.iNumEntradas);
+    ptContexto->ppdSaida = AlocarSaidasQuantizada(&ptAnn->tQuantizada);
+    ptContexto->pdTrabalho = (TReal*) AlocarAlinhado(TamanhoTrabalhoQuantizado(&ptAnn->tQuantizada));
+  }
+  else {
+    ptContexto->iNumCamadas = ptAnn->tRede.iNumCamadas;
+    ptContexto->pdEntrada = (TReal*) AlocarAlinhado(sizeof(TReal) * ptAnn->tRede.iNumEntradas);
+    ptContexto->ppdSaida = AlocarSaidasRede(&ptAnn->tRede);
+    ptContexto->pdTrabalho = (TReal*) AlocarAlinhado(sizeof(TReal) * TamanhoTrabalhoLote(&ptAnn->tRede));
   }
+  if (ptContexto->pdEntrada == NULL || ptContexto->ppdSaida == NULL || ptContexto->pdTrabalho == NULL) {
+    LiberarContextoAnn(ptContexto);
+    return NULL;
+  }
+  return ptContexto;
+}
+
+
+void AtivarAnnContexto(const TAnn *ptAnn, TContextoAnn *ptContexto, const double *pdEntrada, double *pdSaidaObtida)
+{
+  register int i;
+  const TReal *pdSaida = ptContexto->ppdSaida[ptContexto->iNumCamadas - 1];
 
-  // Ativa as saidas lineares
-  for (i = 0; i < iNumeroSaidas; i++) {
-    pdSaidaObtida[i] = ppdPesoSaida[i][iNumeroOcultos];
-    for (j = 0; j < iNumeroOcultos; j++)
-      pdSaidaObtida[i] += pdCampoOculto[j] * ppdPesoSaida[i][j];
+  // Converte as entradas para a precisao da rede, propaga e copia as saidas da ultima camada (a rede
+  // apenas e lida, entao threads com contextos distintos podem ativar a mesma rede ao mesmo tempo); o Mlp
+  // fixo so usa buffers na pilha
+#ifdef TOPOLOGIAS_FIXAS
+  if (ptAnn->ptFixa != NULL) {
+    AtivarMlpFixa(ptAnn->ptFixa, pdEntrada, pdSaidaObtida);
+    return;
   }
+#endif
+  for (i = 0; i < NumeroEntradasAnn(ptAnn); i++)
+    ptContexto->pdEntrada[i] = (TReal) pdEntrada[i];
+  if (ptAnn->iQuantizada)
+    AtivarRedeQuantizada(&ptAnn->tQuantizada, ptContexto->pdEntrada, (signed char*) ptContexto->pdTrabalho,
+        ptContexto->ppdSaida);
+  else
+    AtivarRede(&ptAnn->tRede, ptContexto->pdEntrada, ptContexto->ppdSaida);
+  for (i = 0; i < NumeroSaidasAnn(ptAnn); i++)
+    pdSaidaObtida[i] = pdSaida[i];
 }
 
 
-void FinalizarAnn()
+static void *AtivarFaixaLote(void *pArg)
+{
+  TFaixaLote *ptFaixa = (TFaixaLote*) pArg;
+
+  AtivarRedeLote(ptFaixa->ptRede, ptFaixa->pdEntradas, ptFaixa->pdSaidas, ptFaixa->iNumRegistros,
+      ptFaixa->pdTrabalho);
+  return NULL;
+}
+
+
+void AtivarAnnBatchContexto(const TAnn *ptAnn, TContextoAnn *ptContexto, const double *pdEntradas, double *pdSaidas,
+    int iNumRegistros, int iNumThreads)
 {
-  int i;
+  int t, iInicio, iFim;
+  const TRede *ptRede = &ptAnn->tRede;
+  TFaixaLote *ptFaixas;
 
-  // Desaloca a memoria da camada oculta
-  if (pdCampoOculto != NULL) {
-    free(pdCampoOculto);
-    pdCampoOculto = NULL;
+  // A rede quantizada ativa um registro por vez com o contexto do chamador
+  if (ptAnn->iQuantizada) {
+    for (t = 0; t < iNumRegistros; t++)
+      AtivarAnnContexto(ptAnn, ptContexto, &pdEntradas[(size_t) t * ptAnn->tQuantizada.iNumEntradas],
+          &pdSaidas[(size_t) t * ptAnn->tQuantizada.iNumSaidas]);
+    return;
   }
-  if (ppdPesoOculto != NULL) {
-    for (i = 0; i < iNumeroOcultos; i++) {
-      if (ppdPesoOculto[i] != NULL) {
-        free(ppdPesoOculto[i]);
-        ppdPesoOculto[i] = NULL;
-      }
-    }
-    free(ppdPesoOculto);
-    ppdPesoOculto = NULL;
+
+  // Lotes pequenos (ou sem threads extras) usam apenas a area de trabalho do contexto
+  if (iNumThreads > iNumRegistros / (MIN_BLOCOS_THREAD * BLOCO_ATIVACAO_LOTE))
+    iNumThreads = iNumRegistros / (MIN_BLOCOS_THREAD * BLOCO_ATIVACAO_LOTE);
+  if (iNumThreads <= 1 || (ptFaixas = (TFaixaLote*) calloc(iNumThreads, sizeof(TFaixaLote))) == NULL) {
+    AtivarRedeLote(ptRede, pdEntradas, pdSaidas, iNumRegistros, ptContexto->pdTrabalho);
+    return;
+  }
+
+  // Divide os registros em faixas contiguas; a thread chamadora ativa a faixa 0 com o contexto e as
+  // demais threads recebem areas de trabalho proprias (o resultado nao depende do numero de threads)
+  for (t = 0; t < iNumThreads; t++) {
+    iInicio = (int) ((long long) iNumRegistros * t / iNumThreads);
+    iFim = (int) ((long long) iNumRegistros * (t + 1) / iNumThreads);
+    ptFaixas[t].ptRede = ptRede;
+    ptFaixas[t].pdEntradas = &pdEntradas[(size_t) iInicio * ptRede->iNumEntradas];
+    ptFaixas[t].pdSaidas = &pdSaidas[(size_t) iInicio * ptRede->iNumSaidas];
+    ptFaixas[t].iNumRegistros = iFim - iInicio;
   }
+  ptFaixas[0].pdTrabalho = ptContexto->pdTrabalho;
+  for (t = 1; t < iNumThreads; t++) {
+    ptFaixas[t].pdTrabalho = (TReal*) AlocarAlinhado(sizeof(TReal) * TamanhoTrabalhoLote(ptRede));
+    ptFaixas[t].iCriada = (ptFaixas[t].pdTrabalho != NULL &&
+        !pthread_create(&ptFaixas[t].tThread, NULL, AtivarFaixaLote, &ptFaixas[t]));
+  }
+  AtivarFaixaLote(&ptFaixas[0]);
+
+  // Aguarda as threads; as faixas sem thread (falta de recursos) sao ativadas pela thread chamadora
+  for (t = 1; t < iNumThreads; t++) {
+    if (ptFaixas[t].iCriada)
+      pthread_join(ptFaixas[t].tThread, NULL);
+    else
+      AtivarRedeLote(ptRede, ptFaixas[t].pdEntradas, ptFaixas[t].pdSaidas, ptFaixas[t].iNumRegistros,
+          ptContexto->pdTrabalho);
+    if (ptFaixas[t].pdTrabalho != NULL)
+      LiberarAlinhado(ptFaixas[t].pdTrabalho);
+  }
+  free(ptFaixas);
+}
+
+
+void LiberarContextoAnn(TContextoAnn *ptContexto)
+{
+  TRede tTopologia;
+
+  // O contexto pode ser liberado depois da rede: LiberarSaidasRede so usa o numero de camadas (e libera
+  // igualmente as saidas alocadas por AlocarSaidasQuantizada)
+  if (ptContexto == NULL)
+    return;
+  if (ptContexto->pdEntrada != NULL)
+    LiberarAlinhado(ptContexto->pdEntrada);
+  if (ptContexto->pdTrabalho != NULL)
+    LiberarAlinhado(ptContexto->pdTrabalho);
+  memset(&tTopologia, 0, sizeof(TRede));
+  tTopologia.iNumCamadas = ptContexto->iNumCamadas;
+  LiberarSaidasRede(&tTopologia, ptContexto->ppdSaida);
+  free(ptContexto);
+}
+
+
+void LiberarAnn(TAnn *ptAnn)
+{
+  // Desaloca as camadas (os contextos criados para a rede sao liberados pelo chamador)
+  if (ptAnn == NULL)
+    return;
+  if (ptAnn->iCarregada && ptAnn->iQuantizada)
+    DestruirRedeQuantizada(&ptAnn->tQuantizada);
+  else if (ptAnn->iCarregada)
+    DestruirRede(&ptAnn->tRede);
+#ifdef TOPOLOGIAS_FIXAS
+  LiberarMlpFixa(ptAnn->ptFixa);
+#endif
+  free(ptAnn);
+}
 
-  // Desaloca a memoria da camada de saida
-  if (ppdPesoSaida != NULL) {
-    for (i = 0; i < iNumeroSaidas; i++) {
-      if (ppdPesoSaida[i] != NULL) {
-        free(ppdPesoSaida[i]);
-        ppdPesoSaida[i] = NULL;
-      }
-    }
-    free(ppdPesoSaida);
-    ppdPesoSaida = NULL;
+
+int InicializarAnn(const char *szArqPesos)
+{
+  // Rede e contexto globais, para os controladores com uma unica rede
+  FinalizarAnn();
+  if ((ptAnnGlobal = CriarAnn()) == NULL || !CarregarAnn(ptAnnGlobal, szArqPesos) ||
+      (ptContextoGlobal = CriarContextoAnn(ptAnnGlobal)) == NULL) {
+    FinalizarAnn();
+    return 0;
   }
+  return 1;
+}
+
+
+void AtivarAnn(const double *pdEntrada, double *pdSaidaObtida)
+{
+  AtivarAnnContexto(ptAnnGlobal, ptContextoGlobal, pdEntrada, pdSaidaObtida);
+}
+
+
+void AtivarAnnBatch(const double *pdEntradas, double *pdSaidas, int iNumRegistros, int iNumThreads)
+{
+  AtivarAnnBatchContexto(ptAnnGlobal, ptContextoGlobal, pdEntradas, pdSaidas, iNumRegistros, iNumThreads);
+}
+
+
+void FinalizarAnn()
+{
+  // Desaloca o contexto e a rede globais
+  LiberarContextoAnn(ptContextoGlobal);
+  LiberarAnn(ptAnnGlobal);
+  ptContextoGlobal = NULL;
+  ptAnnGlobal = NULL;
 }
@@ -9,9 +9,32 @@
 #define STLFN_H
 
 
+//************************************ Tipos de dados ********************************************
+// Rede carregada (somente leitura durante a ativacao, compartilhavel entre threads) e area de trabalho
+// da ativacao (do chamador: uma por thread que ativa a rede ao mesmo tempo)
+typedef struct TAnn TAnn;
+typedef struct TContextoAnn TContextoAnn;
+
+
 //************************************** Prototipos **********************************************
+// Interface reentrante: varias redes e threads no mesmo processo
+TAnn *CriarAnn();
+int CarregarAnn(TAnn *ptAnn, const char *szArqPesos);
+int NumeroEntradasAnn(const TAnn *ptAnn);
+int NumeroSaidasAnn(const TAnn *ptAnn);
+TContextoAnn *CriarContextoAnn(const TAnn *ptAnn);
+void AtivarAnnContexto(const TAnn *ptAnn, TContextoAnn *ptContexto, const double *pdEntrada, double *pdSaidaObtida);
+// iNumRegistros linhas contiguas de entradas -> iNumRegistros linhas contiguas de saidas, em blocos; lotes
+// grandes podem ser divididos entre ate iNumThreads threads
+void AtivarAnnBatchContexto(const TAnn *ptAnn, TContextoAnn *ptContexto, const double *pdEntradas, double *pdSaidas,
+    int iNumRegistros, int iNumThreads);
+void LiberarContextoAnn(TContextoAnn *ptContexto);
+void LiberarAnn(TAnn *ptAnn);
+
+// Interface original com uma unica rede global (sobre a interface reentrante)
 int InicializarAnn(const char *szArqPesos);
 void AtivarAnn(const double *pdEntrada, double *pdSaidaObtida);
+void AtivarAnnBatch(const double *pdEntradas, double *pdSaidas, int iNumRegistros, int iNumThreads);
 void FinalizarAnn();
 
 #endif
@@ -0,0 +1,120 @@
+//************************************************************************************************
+//* UNIVERSIDADE FEDERAL DO RIO GRANDE DO SUL (UFRGS) - Campus do Vale                          **
+//* Doutorado em Ciencia da Computacao - PPGC                                                   **
+//* Doutorando: Milton Roberto Heinen - 00145752                                                **
+//* Orientador: Paulo Martins Engel                                                             **
+//* Topologias pre-instanciadas do template Mlp usadas pelo stlfn                               **
+//************************************************************************************************
+
+//*************************************** Includes ***********************************************
+#include <stdlib.h>
+#include <new>
+#include "stlfnfixa.h"
+#include "mlp.h"
+
+
+//************************************ Tipos de dados ********************************************
+// Instancia de uma topologia e a funcao de ativacao correspondente
+struct TMlpFixa {
+  void *pMlp;
+  void (*Ativar)(const void *pMlp, const double *pdEntrada, double *pdSaida);
+  void (*Liberar)(void *pMlp);
+};
+
+typedef struct {
+  int iNumEntradas;
+  int iNumOcultos;
+  int iNumSaidas;
+  void *(*Criar)(const TRede *ptRede);
+  void (*Ativar)(const void *pMlp, const double *pdEntrada, double *pdSaida);
+  void (*Liberar)(void *pMlp);
+} TTopologiaFixa;
+
+
+//************************************** Prototipos **********************************************
+template <int iNumEntradas, int iNumOcultos, int iNumSaidas> static void *CriarFixa(const TRede *ptRede);
+template <int iNumEntradas, int iNumOcultos, int iNumSaidas>
+static void AtivarFixa(const void *pMlp, const double *pdEntrada, double *pdSaida);
+template <int iNumEntradas, int iNumOcultos, int iNumSaidas> static void LiberarFixa(void *pMlp);
+
+
+//********************************** Variaveis globais *******************************************
+// Topologias instanciadas em tempo de compilacao (as demais redes usam a propagacao dinamica de rede.c)
+static const TTopologiaFixa vtTopologiasFixas[] = {
+  { 8, 5, 2, CriarFixa<8, 5, 2>, AtivarFixa<8, 5, 2>, LiberarFixa<8, 5, 2> },
+};
+
+
+//*************************************** Funcoes ************************************************
+TMlpFixa *CriarMlpFixa(const TRede *ptRede)
+{
+  const TTopologiaFixa *ptTopologia;
+  TMlpFixa *ptMlp;
+  size_t t;
+
+  // Procura a topologia da rede entre as pre-instanciadas
+  if (ptRede->iNumCamadas != 2)
+    return NULL;
+  for (t = 0; t < sizeof(vtTopologiasFixas) / sizeof(TTopologiaFixa); t++) {
+    ptTopologia = &vtTopologiasFixas[t];
+    if (ptTopologia->iNumEntradas != ptRede->iNumEntradas ||
+        ptTopologia->iNumOcultos != ptRede->vtCamadas[0].iNumNeuronios ||
+        ptTopologia->iNumSaidas != ptRede->vtCamadas[1].iNumNeuronios)
+      continue;
+    if ((ptMlp = (TMlpFixa*) calloc(1, sizeof(TMlpFixa))) == NULL)
+      return NULL;
+    if ((ptMlp->pMlp = ptTopologia->Criar(ptRede)) == NULL) {
+      free(ptMlp);
+      return NULL;
+    }
+    ptMlp->Ativar = ptTopologia->Ativar;
+    ptMlp->Liberar = ptTopologia->Liberar;
+    return ptMlp;
+  }
+  return NULL;
+}
+
+
+void AtivarMlpFixa(const TMlpFixa *ptMlp, const double *pdEntrada, double *pdSaida)
+{
+  ptMlp->Ativar(ptMlp->pMlp, pdEntrada, pdSaida);
+}
+
+
+void LiberarMlpFixa(TMlpFixa *ptMlp)
+{
+  if (ptMlp == NULL)
+    return;
+  ptMlp->Liberar(ptMlp->pMlp);
+  free(ptMlp);
+}
+
+
+// Mlp na precisao da rede, em memoria alinhada (o new do C++11 nao garante o alinhamento dos membros)
+template <int iNumEntradas, int iNumOcultos, int iNumSaidas>
+static void *CriarFixa(const TRede *ptRede)
+{
+  typedef Mlp<iNumEntradas, iNumOcultos, iNumSaidas, TReal> TMlp;
+  void *pMemoria = AlocarAlinhado(sizeof(TMlp));
+
+  if (pMemoria == NULL)
+    return NULL;
+  TMlp *pMlp = new (pMemoria) TMlp();
+  pMlp->Copiar(*ptRede);
+  return pMlp;
+}
+
+
+template <int iNumEntradas, int iNumOcultos, int iNumSaidas>
+static void AtivarFixa(const void *pMlp, const double *pdEntrada, double *pdSaida)
+{
+  static_cast<const Mlp<iNumEntradas, iNumOcultos, iNumSaidas, TReal>*>(pMlp)->Ativar(pdEntrada, pdSaida);
+}
+
+
+template <int iNumEntradas, int iNumOcultos, int iNumSaidas>
+static void LiberarFixa(void *pMlp)
+{
+  static_cast<Mlp<iNumEntradas, iNumOcultos, iNumSaidas, TReal>*>(pMlp)->~Mlp();
+  LiberarAlinhado(pMlp);
+}
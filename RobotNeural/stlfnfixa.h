@@ -0,0 +1,24 @@
+//************************************************************************************************
+//* UNIVERSIDADE FEDERAL DO RIO GRANDE DO SUL (UFRGS) - Campus do Vale                          **
+//* Doutorado em Ciencia da Computacao - PPGC                                                   **
+//* Doutorando: Milton Roberto Heinen - 00145752                                                **
+//* Orientador: Paulo Martins Engel                                                             **
+//* Topologias pre-instanciadas do template Mlp usadas pelo stlfn                               **
+//************************************************************************************************
+#ifndef STLFNFIXA_H
+#define STLFNFIXA_H
+
+#include "rede.h"
+
+
+//************************************ Tipos de dados ********************************************
+typedef struct TMlpFixa TMlpFixa;
+
+
+//************************************** Prototipos **********************************************
+// Copia da rede em um Mlp pre-instanciado com a mesma topologia (NULL se nenhum corresponde a ela)
+TMlpFixa *CriarMlpFixa(const TRede *ptRede);
+void AtivarMlpFixa(const TMlpFixa *ptMlp, const double *pdEntrada, double *pdSaida);
+void LiberarMlpFixa(TMlpFixa *ptMlp);
+
+#endif
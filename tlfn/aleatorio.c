@@ -0,0 +1,87 @@
+//************************************************************************************************
+//* UNIVERSIDADE FEDERAL DO RIO GRANDE DO SUL (UFRGS) - Campus do Vale                          **
+//* Doutorado em Ciencia da Computacao - PPGC                                                   **
+//* Doutorando: Milton Roberto Heinen - 00145752                                                **
+//* Orientador: Paulo Martins Engel                                                             **
+//* Gerador aleatorio baseado em contador (SplitMix64) e permutacoes reproduziveis              **
+//************************************************************************************************
+
+//*************************************** Includes ***********************************************
+#include "aleatorio.h"
+
+
+//************************************** Constantes **********************************************
+#define INCREMENTO_DOURADO 0x9e3779b97f4a7c15ULL
+
+
+//************************************** Prototipos **********************************************
+static unsigned long long Misturar(unsigned long long ulValor);
+
+
+//************************************** Demais funcoes ******************************************
+static unsigned long long Misturar(unsigned long long ulValor)
+{
+  // Finalizador do SplitMix64 (bijetor, com boa avalanche)
+  ulValor = (ulValor ^ (ulValor >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  ulValor = (ulValor ^ (ulValor >> 27)) * 0x94d049bb133111ebULL;
+  return ulValor ^ (ulValor >> 31);
+}
+
+
+void IniciarGerador(TGerador *ptGerador, unsigned long long ulSemente, int iUso, int iEpoca, int iSubfluxo)
+{
+  // Cada componente e misturado na chave, de modo que fluxos vizinhos nao se correlacionam
+  ptGerador->ulChave = Misturar(ulSemente + INCREMENTO_DOURADO);
+  ptGerador->ulChave = Misturar(ptGerador->ulChave ^ ((unsigned long long) (unsigned int) iUso + INCREMENTO_DOURADO));
+  ptGerador->ulChave = Misturar(ptGerador->ulChave ^ ((unsigned long long) (unsigned int) iEpoca + INCREMENTO_DOURADO));
+  ptGerador->ulChave = Misturar(ptGerador->ulChave ^
+      ((unsigned long long) (unsigned int) iSubfluxo + INCREMENTO_DOURADO));
+  ptGerador->ulContador = 0;
+}
+
+
+unsigned long long GerarAleatorio(TGerador *ptGerador)
+{
+  // SplitMix64 na forma de contador: o n-esimo valor e Misturar(chave + n * incremento)
+  ptGerador->ulContador++;
+  return Misturar(ptGerador->ulChave + ptGerador->ulContador * INCREMENTO_DOURADO);
+}
+
+
+double SortearReal(TGerador *ptGerador)
+{
+  // Real uniforme em [0, 1) com os 53 bits mais significativos
+  return (double) (GerarAleatorio(ptGerador) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+
+int SortearInteiro(TGerador *ptGerador, int iLimite)
+{
+  unsigned int uiLimite = (unsigned int) iLimite, uiMinimo;
+  unsigned long long ulProduto;
+
+  // Inteiro uniforme em [0, iLimite) por multiplicacao, rejeitando a fatia que causaria vies (Lemire)
+  ulProduto = (GerarAleatorio(ptGerador) >> 32) * uiLimite;
+  if ((unsigned int) ulProduto < uiLimite) {
+    uiMinimo = (0U - uiLimite) % uiLimite;
+    while ((unsigned int) ulProduto < uiMinimo)
+      ulProduto = (GerarAleatorio(ptGerador) >> 32) * uiLimite;
+  }
+  return (int) (ulProduto >> 32);
+}
+
+
+void GerarPermutacao(TGerador *ptGerador, int *piOrdem, int iNum)
+{
+  int i, iPosicao, iAux;
+
+  // Fisher-Yates a partir da identidade: a permutacao depende apenas do fluxo
+  for (i = 0; i < iNum; i++)
+    piOrdem[i] = i;
+  for (i = iNum - 1; i > 0; i--) {
+    iPosicao = SortearInteiro(ptGerador, i + 1);
+    iAux = piOrdem[i];
+    piOrdem[i] = piOrdem[iPosicao];
+    piOrdem[iPosicao] = iAux;
+  }
+}
@@ -0,0 +1,37 @@
+//************************************************************************************************
+//* UNIVERSIDADE FEDERAL DO RIO GRANDE DO SUL (UFRGS) - Campus do Vale                          **
+//* Doutorado em Ciencia da Computacao - PPGC                                                   **
+//* Doutorando: Milton Roberto Heinen - 00145752                                                **
+//* Orientador: Paulo Martins Engel                                                             **
+//* Gerador aleatorio baseado em contador (SplitMix64) e permutacoes reproduziveis              **
+//************************************************************************************************
+#ifndef ALEATORIO_H
+#define ALEATORIO_H
+
+
+//************************************** Constantes **********************************************
+// Usos do gerador: cada um tem fluxos proprios, derivados do random seed
+#define FLUXO_PESOS 0
+#define FLUXO_REGISTROS 1
+#define FLUXO_BLOCOS 2
+#define FLUXO_VARREDURA 3
+
+
+//************************************ Tipos de dados ********************************************
+// O n-esimo numero do fluxo depende apenas da chave e de n, e nao da plataforma nem das threads:
+// a chave e derivada de (random seed, uso, epoca, subfluxo), onde o subfluxo distingue as threads
+// ou os blocos do streaming
+typedef struct {
+  unsigned long long ulChave;
+  unsigned long long ulContador;
+} TGerador;
+
+
+//************************************** Prototipos **********************************************
+void IniciarGerador(TGerador *ptGerador, unsigned long long ulSemente, int iUso, int iEpoca, int iSubfluxo);
+unsigned long long GerarAleatorio(TGerador *ptGerador);
+double SortearReal(TGerador *ptGerador);
+int SortearInteiro(TGerador *ptGerador, int iLimite);
+void GerarPermutacao(TGerador *ptGerador, int *piOrdem, int iNum);
+
+#endif
@@ -0,0 +1,914 @@
+//************************************************************************************************
+//* UNIVERSIDADE FEDERAL DO RIO GRANDE DO SUL (UFRGS) - Campus do Vale                          **
+//* Doutorado em Ciencia da Computacao - PPGC                                                   **
+//* Doutorando: Milton Roberto Heinen - 00145752                                                **
+//* Orientador: Paulo Martins Engel                                                             **
+//* Databases de treinamento e generalizacao (texto .lrn/.tst e binario mapeado .lrnb/.tstb)    **
+//************************************************************************************************
+
+//*************************************** Includes ***********************************************
+#define _FILE_OFFSET_BITS 64
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "database.h"
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+
+//************************************** Constantes **********************************************
+#define MAX_LINHA 1024
+#define DESLOCAMENTO_BINARIO 64
+#define BUFFER_LIVRE 0
+#define BUFFER_CARREGANDO 1
+#define BUFFER_PRONTO 2
+#define MAX_THREADS_LEITURA 64
+#define TAMANHO_MINIMO_FAIXA (1 << 20)
+#define MANTISSA_EXATA (1ULL << 53)
+#define MAX_EXPOENTE_EXATO 22
+
+
+//**************************************** Macros ************************************************
+#ifdef _WIN32
+#define PosicionarArquivo(fp, lPosicao) _fseeki64((fp), (lPosicao), SEEK_SET)
+#define PosicaoArquivo(fp) ((long long) _ftelli64(fp))
+#else
+#define PosicionarArquivo(fp, lPosicao) fseeko((fp), (off_t) (lPosicao), SEEK_SET)
+#define PosicaoArquivo(fp) ((long long) ftello(fp))
+#endif
+#define ESPACO(c) ((c) == ' ' || (c) == '\t' || (c) == '\r' || (c) == '\n')
+#define DIGITO(c) ((c) >= '0' && (c) <= '9')
+#define MINIMO(a, b) ((a) < (b) ? (a) : (b))
+
+
+//************************************ Tipos de dados ********************************************
+// Faixa [pcInicio, pcFim) do database texto mapeado, terminada em quebra de linha, lida por uma thread
+typedef struct {
+  const char *pcInicio;
+  const char *pcFim;
+  TDatabase *ptDatabase;
+  int iNumLinhas;
+  int iNumRegistros;
+  int iPrimeiraLinha;
+  int iPrimeiroRegistro;
+  int iLinhaErro;
+} TFaixaTexto;
+
+
+//************************************** Variaveis ***********************************************
+static const double vdPotencia10[MAX_EXPOENTE_EXATO + 1] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+
+//************************************** Prototipos **********************************************
+static const char *LerNumero(const char *pc, const char *pcFim, double *pdValor);
+static int InterpretarLinha(const char *pc, const char *pcFim, TReal *pdRegistro, const int iNumValores);
+static int LinhaEmBranco(const char *pc, const char *pcFim);
+static int InterpretarCabecalho(const char *pc, const char *pcFim, int *piNumEntradas, int *piNumSaidas,
+    int *piNumRegistros);
+static long LerLinha(FILE *fp, char **ppcLinha, size_t *ptamLinha);
+static int LerCabecalhoTexto(FILE *fp, int *piNumEntradas, int *piNumSaidas, int *piNumRegistros);
+static int LerRegistroTexto(FILE *fp, char **ppcLinha, size_t *ptamLinha, TReal *pdRegistro, const int iNumValores,
+    int *piLinha);
+static int CarregarDatabaseTexto(TDatabase *ptDatabase, const char *szNomeArquivo);
+static int NumeroProcessadores();
+static void ExecutarFaixas(void *(*pfFuncao)(void*), TFaixaTexto *ptFaixas, const int iNumFaixas);
+static void *ContarFaixaTexto(void *pArg);
+static void *InterpretarFaixaTexto(void *pArg);
+static int CarregarDatabaseBinario(TDatabase *ptDatabase, const char *szNomeArquivo);
+static void *MapearArquivo(TDatabase *ptDatabase, const char *szNomeArquivo);
+static void DesmapearArquivo(TDatabase *ptDatabase);
+static int IndexarFluxo(TFluxo *ptFluxo);
+static int LerBlocoFluxo(TFluxo *ptFluxo, const int iBloco, const int iBuffer);
+static void *ExecutarThreadFluxo(void *pArg);
+
+
+//*************************************** Funcoes ************************************************
+int CarregarDatabase(TDatabase *ptDatabase, const char *szNomeArquivo)
+{
+  FILE *fp = NULL;
+  char vcAssinatura[4];
+  int iBinario;
+
+  // Identifica o formato pela assinatura do arquivo
+  memset(ptDatabase, 0, sizeof(TDatabase));
+  if ((fp = fopen(szNomeArquivo, "rb")) == NULL) {
+    fprintf(stderr, "ERRO: Nao foi possivel abrir o database\n");
+    return 0;
+  }
+  iBinario = (fread(vcAssinatura, 1, 4, fp) == 4 && !memcmp(vcAssinatura, ASSINATURA_BINARIO, 4));
+  fclose(fp);
+  return (iBinario ? CarregarDatabaseBinario(ptDatabase, szNomeArquivo) :
+      CarregarDatabaseTexto(ptDatabase, szNomeArquivo));
+}
+
+
+static const char *LerNumero(const char *pc, const char *pcFim, double *pdValor)
+{
+  const char *pcInicio = pc;
+  unsigned long long ulMantissa = 0;
+  int iDigitos = 0, iExpoente = 0, iExpoenteLido = 0, iNegativo = 0, iNegativoExpoente = 0, iValido = 0;
+  char vcNumero[64];
+  double dValor;
+
+  // Sinal, parte inteira e fracionaria (ate 19 digitos significativos na mantissa)
+  if (pc < pcFim && (*pc == '-' || *pc == '+'))
+    iNegativo = (*pc++ == '-');
+  for (; pc < pcFim && DIGITO(*pc); pc++, iValido = 1) {
+    if (iDigitos < 19) {
+      ulMantissa = ulMantissa * 10 + (*pc - '0');
+      iDigitos += (ulMantissa != 0);
+    }
+    else
+      iExpoente++;
+  }
+  if (pc < pcFim && *pc == '.') {
+    for (pc++; pc < pcFim && DIGITO(*pc); pc++, iValido = 1) {
+      if (iDigitos < 19) {
+        ulMantissa = ulMantissa * 10 + (*pc - '0');
+        iDigitos += (ulMantissa != 0);
+        iExpoente--;
+      }
+    }
+  }
+  if (!iValido)
+    return NULL;
+
+  // Expoente opcional
+  if (pc < pcFim && (*pc == 'e' || *pc == 'E')) {
+    pc++;
+    if (pc < pcFim && (*pc == '-' || *pc == '+'))
+      iNegativoExpoente = (*pc++ == '-');
+    if (pc >= pcFim || !DIGITO(*pc))
+      return NULL;
+    for (; pc < pcFim && DIGITO(*pc); pc++) {
+      if (iExpoenteLido < 100000)
+        iExpoenteLido = iExpoenteLido * 10 + (*pc - '0');
+    }
+    iExpoente += (iNegativoExpoente ? -iExpoenteLido : iExpoenteLido);
+  }
+  if (pc < pcFim && !ESPACO(*pc))
+    return NULL;
+
+  // Mantissa e potencia de 10 exatas em double: uma unica operacao, com arredondamento correto
+  // (mesmo resultado do strtod); os demais casos, raros, usam o strtod (ou pow, se muito longos)
+  if (ulMantissa <= MANTISSA_EXATA && iExpoente >= -MAX_EXPOENTE_EXATO && iExpoente <= MAX_EXPOENTE_EXATO)
+    dValor = (iExpoente < 0 ? (double) ulMantissa / vdPotencia10[-iExpoente] :
+        (double) ulMantissa * vdPotencia10[iExpoente]);
+  else if (pc - pcInicio < (long) sizeof(vcNumero)) {
+    memcpy(vcNumero, pcInicio, pc - pcInicio);
+    vcNumero[pc - pcInicio] = '\0';
+    *pdValor = strtod(vcNumero, NULL);
+    return pc;
+  }
+  else
+    dValor = (double) ulMantissa * pow(10.0, iExpoente);
+  *pdValor = (iNegativo ? -dValor : dValor);
+  return pc;
+}
+
+
+static int InterpretarLinha(const char *pc, const char *pcFim, TReal *pdRegistro, const int iNumValores)
+{
+  double dValor;
+  int i;
+
+  // Exatamente iNumValores numeros separados por espacos ou tabulacoes
+  for (i = 0; i < iNumValores; i++) {
+    while (pc < pcFim && (*pc == ' ' || *pc == '\t'))
+      pc++;
+    if ((pc = LerNumero(pc, pcFim, &dValor)) == NULL)
+      return 0;
+    pdRegistro[i] = (TReal) dValor;
+  }
+  while (pc < pcFim && ESPACO(*pc))
+    pc++;
+  return (pc == pcFim);
+}
+
+
+static int LinhaEmBranco(const char *pc, const char *pcFim)
+{
+  while (pc < pcFim && ESPACO(*pc))
+    pc++;
+  return (pc == pcFim);
+}
+
+
+static int InterpretarCabecalho(const char *pc, const char *pcFim, int *piNumEntradas, int *piNumSaidas,
+    int *piNumRegistros)
+{
+  char vcLinha[MAX_LINHA + 1];
+  size_t tamLinha = MINIMO((size_t) (pcFim - pc), (size_t) MAX_LINHA);
+
+  // Primeira linha: numero de entradas, saidas e registros
+  memcpy(vcLinha, pc, tamLinha);
+  vcLinha[tamLinha] = '\0';
+  if (sscanf(vcLinha, "%d %d %d", piNumEntradas, piNumSaidas, piNumRegistros) != 3 ||
+      *piNumEntradas < 1 || *piNumSaidas < 1 || *piNumRegistros < 0) {
+    fprintf(stderr, "ERRO: Cabecalho invalido no database (linha 1)\n");
+    return 0;
+  }
+  return 1;
+}
+
+
+static long LerLinha(FILE *fp, char **ppcLinha, size_t *ptamLinha)
+{
+  size_t tamUsado = 0;
+
+  // Le uma linha inteira, aumentando o buffer quando necessario; retorna -1 no fim do arquivo
+  if (*ppcLinha == NULL) {
+    *ptamLinha = MAX_LINHA;
+    *ppcLinha = (char*) malloc(*ptamLinha);
+  }
+  for (;;) {
+    if (fgets(*ppcLinha + tamUsado, (int) (*ptamLinha - tamUsado), fp) == NULL)
+      return (tamUsado > 0 ? (long) tamUsado : -1);
+    tamUsado += strlen(*ppcLinha + tamUsado);
+    if ((*ppcLinha)[tamUsado - 1] == '\n')
+      return (long) tamUsado;
+    if (tamUsado + 1 >= *ptamLinha) {
+      *ptamLinha *= 2;
+      *ppcLinha = (char*) realloc(*ppcLinha, *ptamLinha);
+    }
+  }
+}
+
+
+static int LerCabecalhoTexto(FILE *fp, int *piNumEntradas, int *piNumSaidas, int *piNumRegistros)
+{
+  char vcLinha[MAX_LINHA + 1];
+
+  if (fgets(vcLinha, MAX_LINHA, fp) == NULL) {
+    fprintf(stderr, "ERRO: Cabecalho invalido no database (linha 1)\n");
+    return 0;
+  }
+  return InterpretarCabecalho(vcLinha, vcLinha + strlen(vcLinha), piNumEntradas, piNumSaidas, piNumRegistros);
+}
+
+
+static int LerRegistroTexto(FILE *fp, char **ppcLinha, size_t *ptamLinha, TReal *pdRegistro, const int iNumValores,
+    int *piLinha)
+{
+  long lTamanho;
+
+  // Proxima linha nao vazia, com as entradas seguidas das saidas (*piLinha conta as linhas lidas)
+  do {
+    if ((lTamanho = LerLinha(fp, ppcLinha, ptamLinha)) < 0) {
+      fprintf(stderr, "ERRO: Fim inesperado do database apos a linha %d\n", *piLinha);
+      return 0;
+    }
+    (*piLinha)++;
+  } while (LinhaEmBranco(*ppcLinha, *ppcLinha + lTamanho));
+  if (!InterpretarLinha(*ppcLinha, *ppcLinha + lTamanho, pdRegistro, iNumValores)) {
+    fprintf(stderr, "ERRO: Linha %d do database invalida (esperados %d valores numericos)\n", *piLinha, iNumValores);
+    return 0;
+  }
+  return 1;
+}
+
+
+static int CarregarDatabaseTexto(TDatabase *ptDatabase, const char *szNomeArquivo)
+{
+  TFaixaTexto vtFaixas[MAX_THREADS_LEITURA];
+  const char *pcArquivo, *pcCorpo, *pcFim, *pcQuebra;
+  int t, iNumFaixas, iNumLinhas = 1, iNumRegistros = 0, iLinhaErro = 0;
+
+  // Mapeia o arquivo texto durante a leitura e interpreta o cabecalho
+  if ((pcArquivo = (const char*) MapearArquivo(ptDatabase, szNomeArquivo)) == NULL)
+    return 0;
+  pcFim = pcArquivo + ptDatabase->tamMapeamento;
+  pcQuebra = (const char*) memchr(pcArquivo, '\n', pcFim - pcArquivo);
+  pcCorpo = (pcQuebra != NULL ? pcQuebra + 1 : pcFim);
+  if (!InterpretarCabecalho(pcArquivo, pcCorpo, &ptDatabase->iNumEntradas, &ptDatabase->iNumSaidas,
+      &ptDatabase->iNumRegistros)) {
+    DesalocarDatabase(ptDatabase);
+    return 0;
+  }
+  ptDatabase->iStride = ptDatabase->iNumEntradas + ptDatabase->iNumSaidas;
+
+  // Aloca um bloco unico para todos os registros
+  ptDatabase->pdDados = (TReal*) malloc(sizeof(TReal) * ptDatabase->iStride * ((size_t) ptDatabase->iNumRegistros + 1));
+  ptDatabase->ppdRegistros = (TReal**) malloc(sizeof(TReal*) * ((size_t) ptDatabase->iNumRegistros + 1));
+  if (ptDatabase->pdDados == NULL || ptDatabase->ppdRegistros == NULL) {
+    fprintf(stderr, "ERRO: Memoria insuficiente para o database\n");
+    DesalocarDatabase(ptDatabase);
+    return 0;
+  }
+
+  // Divide o corpo em faixas terminadas em quebra de linha, uma por thread (de pelo menos 1 MB)
+  iNumFaixas = MINIMO(NumeroProcessadores(), MAX_THREADS_LEITURA);
+  iNumFaixas = (int) MINIMO((long long) iNumFaixas, (long long) (pcFim - pcCorpo) / TAMANHO_MINIMO_FAIXA + 1);
+  for (t = 0; t < iNumFaixas; t++) {
+    memset(&vtFaixas[t], 0, sizeof(TFaixaTexto));
+    vtFaixas[t].ptDatabase = ptDatabase;
+    vtFaixas[t].pcInicio = pcCorpo + (long long) (pcFim - pcCorpo) * t / iNumFaixas;
+    if (t > 0) {
+      if (vtFaixas[t].pcInicio < vtFaixas[t - 1].pcInicio)
+        vtFaixas[t].pcInicio = vtFaixas[t - 1].pcInicio;
+      pcQuebra = (const char*) memchr(vtFaixas[t].pcInicio - 1, '\n', pcFim - vtFaixas[t].pcInicio + 1);
+      vtFaixas[t].pcInicio = (pcQuebra != NULL ? pcQuebra + 1 : pcFim);
+      vtFaixas[t - 1].pcFim = vtFaixas[t].pcInicio;
+    }
+  }
+  vtFaixas[iNumFaixas - 1].pcFim = pcFim;
+
+  // Passo 1: conta as linhas e os registros de cada faixa, para saber onde cada uma comeca
+  ExecutarFaixas(ContarFaixaTexto, vtFaixas, iNumFaixas);
+  for (t = 0; t < iNumFaixas; t++) {
+    vtFaixas[t].iPrimeiraLinha = iNumLinhas + 1;
+    vtFaixas[t].iPrimeiroRegistro = iNumRegistros;
+    iNumLinhas += vtFaixas[t].iNumLinhas;
+    iNumRegistros += vtFaixas[t].iNumRegistros;
+  }
+  if (iNumRegistros < ptDatabase->iNumRegistros) {
+    fprintf(stderr, "ERRO: O database tem %d registros (esperados %d na linha 1)\n", iNumRegistros,
+        ptDatabase->iNumRegistros);
+    DesalocarDatabase(ptDatabase);
+    return 0;
+  }
+
+  // Passo 2: interpreta as faixas em paralelo, direto no bloco de registros
+  ExecutarFaixas(InterpretarFaixaTexto, vtFaixas, iNumFaixas);
+  for (t = 0; t < iNumFaixas && !iLinhaErro; t++)
+    iLinhaErro = vtFaixas[t].iLinhaErro;
+  if (iLinhaErro) {
+    fprintf(stderr, "ERRO: Linha %d do database invalida (esperados %d valores numericos)\n", iLinhaErro,
+        ptDatabase->iStride);
+    DesalocarDatabase(ptDatabase);
+    return 0;
+  }
+
+  // Se chegar aqui eh porque deu tudo certo
+  DesmapearArquivo(ptDatabase);
+  return 1;
+}
+
+
+static int NumeroProcessadores()
+{
+#ifdef _WIN32
+  SYSTEM_INFO tInfo;
+
+  GetSystemInfo(&tInfo);
+  return (int) tInfo.dwNumberOfProcessors;
+#else
+  long lNumero = sysconf(_SC_NPROCESSORS_ONLN);
+
+  return (lNumero > 0 ? (int) lNumero : 1);
+#endif
+}
+
+
+static void ExecutarFaixas(void *(*pfFuncao)(void*), TFaixaTexto *ptFaixas, const int iNumFaixas)
+{
+  pthread_t vtThreads[MAX_THREADS_LEITURA];
+  int t;
+
+  // A faixa 0 e processada pela thread que chamou
+  for (t = 1; t < iNumFaixas; t++)
+    pthread_create(&vtThreads[t], NULL, pfFuncao, &ptFaixas[t]);
+  pfFuncao(&ptFaixas[0]);
+  for (t = 1; t < iNumFaixas; t++)
+    pthread_join(vtThreads[t], NULL);
+}
+
+
+static void *ContarFaixaTexto(void *pArg)
+{
+  TFaixaTexto *ptFaixa = (TFaixaTexto*) pArg;
+  const char *pc = ptFaixa->pcInicio, *pcQuebra;
+
+  // Linhas em branco sao contadas (para os numeros de linha), mas nao sao registros
+  while (pc < ptFaixa->pcFim) {
+    if ((pcQuebra = (const char*) memchr(pc, '\n', ptFaixa->pcFim - pc)) == NULL)
+      pcQuebra = ptFaixa->pcFim;
+    ptFaixa->iNumLinhas++;
+    ptFaixa->iNumRegistros += !LinhaEmBranco(pc, pcQuebra);
+    pc = pcQuebra + 1;
+  }
+  return NULL;
+}
+
+
+static void *InterpretarFaixaTexto(void *pArg)
+{
+  TFaixaTexto *ptFaixa = (TFaixaTexto*) pArg;
+  TDatabase *ptDatabase = ptFaixa->ptDatabase;
+  const char *pc = ptFaixa->pcInicio, *pcQuebra;
+  int iLinha = ptFaixa->iPrimeiraLinha, iRegistro = ptFaixa->iPrimeiroRegistro;
+
+  // Registros alem do informado no cabecalho sao ignorados
+  for (; pc < ptFaixa->pcFim && iRegistro < ptDatabase->iNumRegistros; iLinha++, pc = pcQuebra + 1) {
+    if ((pcQuebra = (const char*) memchr(pc, '\n', ptFaixa->pcFim - pc)) == NULL)
+      pcQuebra = ptFaixa->pcFim;
+    if (LinhaEmBranco(pc, pcQuebra))
+      continue;
+    ptDatabase->ppdRegistros[iRegistro] = &ptDatabase->pdDados[(size_t) iRegistro * ptDatabase->iStride];
+    if (!InterpretarLinha(pc, pcQuebra, ptDatabase->ppdRegistros[iRegistro], ptDatabase->iStride)) {
+      ptFaixa->iLinhaErro = iLinha;
+      break;
+    }
+    iRegistro++;
+  }
+  return NULL;
+}
+
+
+static int CarregarDatabaseBinario(TDatabase *ptDatabase, const char *szNomeArquivo)
+{
+  const TCabecalhoBinario *ptCabecalho = NULL;
+  const char *pcDados = NULL;
+  int i, j;
+
+  // Mapeia o arquivo inteiro (somente leitura e compartilhado entre os processos)
+  if ((ptCabecalho = (const TCabecalhoBinario*) MapearArquivo(ptDatabase, szNomeArquivo)) == NULL)
+    return 0;
+
+  // Valida o cabecalho e o tamanho do arquivo
+  if (ptDatabase->tamMapeamento < sizeof(TCabecalhoBinario) || ptCabecalho->uiVersao != VERSAO_BINARIO ||
+      (ptCabecalho->uiTipo != sizeof(float) && ptCabecalho->uiTipo != sizeof(double)) ||
+      ptCabecalho->uiNumEntradas < 1 || ptCabecalho->uiNumSaidas < 1 || ptCabecalho->ulNumRegistros > INT_MAX ||
+      ptCabecalho->uiStride < ptCabecalho->uiNumEntradas + ptCabecalho->uiNumSaidas ||
+      ptCabecalho->ulDeslocamento < sizeof(TCabecalhoBinario) ||
+      ptCabecalho->ulDeslocamento + ptCabecalho->ulNumRegistros * ptCabecalho->uiStride * ptCabecalho->uiTipo >
+      ptDatabase->tamMapeamento) {
+    fprintf(stderr, "ERRO: Database binario invalido\n");
+    DesalocarDatabase(ptDatabase);
+    return 0;
+  }
+  ptDatabase->iNumEntradas = (int) ptCabecalho->uiNumEntradas;
+  ptDatabase->iNumSaidas = (int) ptCabecalho->uiNumSaidas;
+  ptDatabase->iNumRegistros = (int) ptCabecalho->ulNumRegistros;
+  ptDatabase->iStride = (int) ptCabecalho->uiStride;
+  pcDados = (const char*) ptCabecalho + ptCabecalho->ulDeslocamento;
+  ptDatabase->ppdRegistros = (TReal**) malloc(sizeof(TReal*) * ((size_t) ptDatabase->iNumRegistros + 1));
+  if (ptDatabase->ppdRegistros == NULL) {
+    fprintf(stderr, "ERRO: Memoria insuficiente para o database\n");
+    DesalocarDatabase(ptDatabase);
+    return 0;
+  }
+
+  // Com a mesma precisao do simulador as linhas apontam direto para as paginas mapeadas
+  if (ptCabecalho->uiTipo == sizeof(TReal)) {
+    for (i = 0; i < ptDatabase->iNumRegistros; i++)
+      ptDatabase->ppdRegistros[i] = (TReal*) pcDados + (size_t) i * ptDatabase->iStride;
+    return 1;
+  }
+
+  // Caso contrario os registros sao convertidos para um bloco alocado e o arquivo e liberado
+  ptDatabase->pdDados = (TReal*) malloc(sizeof(TReal) * ptDatabase->iStride * ((size_t) ptDatabase->iNumRegistros + 1));
+  if (ptDatabase->pdDados == NULL) {
+    fprintf(stderr, "ERRO: Memoria insuficiente para o database\n");
+    DesalocarDatabase(ptDatabase);
+    return 0;
+  }
+  for (i = 0; i < ptDatabase->iNumRegistros; i++) {
+    ptDatabase->ppdRegistros[i] = &ptDatabase->pdDados[(size_t) i * ptDatabase->iStride];
+    for (j = 0; j < ptDatabase->iStride; j++) {
+      if (ptCabecalho->uiTipo == sizeof(float))
+        ptDatabase->ppdRegistros[i][j] = (TReal) ((const float*) pcDados)[(size_t) i * ptDatabase->iStride + j];
+      else
+        ptDatabase->ppdRegistros[i][j] = (TReal) ((const double*) pcDados)[(size_t) i * ptDatabase->iStride + j];
+    }
+  }
+  DesmapearArquivo(ptDatabase);
+  return 1;
+}
+
+
+int ConverterDatabase(const char *szArquivoTexto, const char *szArquivoBinario)
+{
+  FILE *fpTexto = NULL, *fpBinario = NULL;
+  TCabecalhoBinario tCabecalho;
+  TReal *pdRegistro = NULL;
+  char *pcLinha = NULL;
+  size_t tamLinha = 0;
+  int iNumEntradas, iNumSaidas, iNumRegistros, iCount, iLinha = 1, iOk = 1;
+
+  // Abre os arquivos e le o cabecalho do database texto
+  if ((fpTexto = fopen(szArquivoTexto, "r")) == NULL) {
+    fprintf(stderr, "ERRO: Nao foi possivel abrir o database\n");
+    return 0;
+  }
+  if (!LerCabecalhoTexto(fpTexto, &iNumEntradas, &iNumSaidas, &iNumRegistros)) {
+    fclose(fpTexto);
+    return 0;
+  }
+  if ((fpBinario = fopen(szArquivoBinario, "wb")) == NULL) {
+    fprintf(stderr, "ERRO: Nao foi possivel criar o database binario\n");
+    fclose(fpTexto);
+    return 0;
+  }
+
+  // Cabecalho com a precisao do simulador; os registros sao gravados sem espacamento
+  memset(&tCabecalho, 0, sizeof(TCabecalhoBinario));
+  memcpy(tCabecalho.vcAssinatura, ASSINATURA_BINARIO, 4);
+  tCabecalho.uiVersao = VERSAO_BINARIO;
+  tCabecalho.uiNumEntradas = (unsigned int) iNumEntradas;
+  tCabecalho.uiNumSaidas = (unsigned int) iNumSaidas;
+  tCabecalho.ulNumRegistros = (unsigned long long) iNumRegistros;
+  tCabecalho.uiTipo = sizeof(TReal);
+  tCabecalho.uiStride = (unsigned int) (iNumEntradas + iNumSaidas);
+  tCabecalho.ulDeslocamento = DESLOCAMENTO_BINARIO;
+  iOk = (fwrite(&tCabecalho, sizeof(TCabecalhoBinario), 1, fpBinario) == 1);
+
+  // Converte um registro por vez, sem carregar o database inteiro na memoria
+  pdRegistro = (TReal*) malloc(sizeof(TReal) * (iNumEntradas + iNumSaidas));
+  for (iCount = 0; iOk && iCount < iNumRegistros; iCount++) {
+    if (!LerRegistroTexto(fpTexto, &pcLinha, &tamLinha, pdRegistro, iNumEntradas + iNumSaidas, &iLinha))
+      iOk = 0;
+    else if (fwrite(pdRegistro, sizeof(TReal), iNumEntradas + iNumSaidas, fpBinario) !=
+        (size_t) (iNumEntradas + iNumSaidas)) {
+      fprintf(stderr, "ERRO: Nao foi possivel gravar o database binario\n");
+      iOk = 0;
+    }
+  }
+  free(pdRegistro);
+  free(pcLinha);
+  fclose(fpTexto);
+  if (fclose(fpBinario) != 0)
+    iOk = 0;
+  if (!iOk)
+    remove(szArquivoBinario);
+  return iOk;
+}
+
+
+int ArquivoExiste(const char *szNomeArquivo)
+{
+  FILE *fp = NULL;
+
+  if ((fp = fopen(szNomeArquivo, "rb")) == NULL)
+    return 0;
+  fclose(fp);
+  return 1;
+}
+
+
+int BinarioAtualizado(const char *szArquivoBinario, const char *szArquivoTexto)
+{
+  struct stat tBinario, tTexto;
+
+  // O binario vale se nao for mais antigo que o texto (gravado junto com ele ou convertido depois)
+  if (stat(szArquivoBinario, &tBinario) != 0)
+    return 0;
+  return (stat(szArquivoTexto, &tTexto) != 0 || tBinario.st_mtime >= tTexto.st_mtime);
+}
+
+
+const char *EscolherArquivo(const char *szArquivoBinario, const char *szArquivoTexto)
+{
+  if (BinarioAtualizado(szArquivoBinario, szArquivoTexto))
+    return szArquivoBinario;
+  if (ArquivoExiste(szArquivoBinario))
+    fprintf(stderr, "AVISO: %s e mais antigo que %s e foi ignorado\n", szArquivoBinario, szArquivoTexto);
+  return szArquivoTexto;
+}
+
+
+int SubstituirArquivo(const char *szTemporario, const char *szNomeArquivo)
+{
+  // Renomeia o arquivo temporario ja fechado sobre o definitivo (leitores veem o antigo ou o novo)
+#ifdef _WIN32
+  if (!MoveFileExA(szTemporario, szNomeArquivo, MOVEFILE_REPLACE_EXISTING)) {
+#else
+  if (rename(szTemporario, szNomeArquivo) != 0) {
+#endif
+    remove(szTemporario);
+    return 0;
+  }
+  return 1;
+}
+
+
+static void *MapearArquivo(TDatabase *ptDatabase, const char *szNomeArquivo)
+{
+#ifdef _WIN32
+  HANDLE hArquivo, hMapeamento;
+  LARGE_INTEGER liTamanho;
+
+  hArquivo = CreateFileA(szNomeArquivo, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+      FILE_ATTRIBUTE_NORMAL, NULL);
+  if (hArquivo == INVALID_HANDLE_VALUE) {
+    fprintf(stderr, "ERRO: Nao foi possivel abrir o database\n");
+    return NULL;
+  }
+  if (!GetFileSizeEx(hArquivo, &liTamanho) ||
+      (hMapeamento = CreateFileMappingA(hArquivo, NULL, PAGE_READONLY, 0, 0, NULL)) == NULL) {
+    fprintf(stderr, "ERRO: Nao foi possivel mapear o database\n");
+    CloseHandle(hArquivo);
+    return NULL;
+  }
+  CloseHandle(hArquivo);
+  if ((ptDatabase->pMapeamento = MapViewOfFile(hMapeamento, FILE_MAP_READ, 0, 0, 0)) == NULL) {
+    fprintf(stderr, "ERRO: Nao foi possivel mapear o database\n");
+    CloseHandle(hMapeamento);
+    return NULL;
+  }
+  ptDatabase->pArquivoMapeado = (void*) hMapeamento;
+  ptDatabase->tamMapeamento = (size_t) liTamanho.QuadPart;
+#else
+  struct stat tStat;
+  void *pMapeamento;
+  int iArquivo;
+
+  if ((iArquivo = open(szNomeArquivo, O_RDONLY)) < 0) {
+    fprintf(stderr, "ERRO: Nao foi possivel abrir o database\n");
+    return NULL;
+  }
+  if (fstat(iArquivo, &tStat) != 0 || tStat.st_size == 0 ||
+      (pMapeamento = mmap(NULL, (size_t) tStat.st_size, PROT_READ, MAP_SHARED, iArquivo, 0)) == MAP_FAILED) {
+    fprintf(stderr, "ERRO: Nao foi possivel mapear o database\n");
+    close(iArquivo);
+    return NULL;
+  }
+  close(iArquivo);
+  ptDatabase->pMapeamento = pMapeamento;
+  ptDatabase->tamMapeamento = (size_t) tStat.st_size;
+#endif
+  return ptDatabase->pMapeamento;
+}
+
+
+static void DesmapearArquivo(TDatabase *ptDatabase)
+{
+  if (ptDatabase->pMapeamento == NULL)
+    return;
+#ifdef _WIN32
+  UnmapViewOfFile(ptDatabase->pMapeamento);
+  CloseHandle((HANDLE) ptDatabase->pArquivoMapeado);
+#else
+  munmap(ptDatabase->pMapeamento, ptDatabase->tamMapeamento);
+#endif
+  ptDatabase->pMapeamento = NULL;
+  ptDatabase->pArquivoMapeado = NULL;
+  ptDatabase->tamMapeamento = 0;
+}
+
+
+void DesalocarDatabase(TDatabase *ptDatabase)
+{
+  // Libera as linhas, o bloco de registros e o mapeamento do arquivo binario
+  if (ptDatabase->ppdRegistros != NULL) {
+    free(ptDatabase->ppdRegistros);
+    ptDatabase->ppdRegistros = NULL;
+  }
+  if (ptDatabase->pdDados != NULL) {
+    free(ptDatabase->pdDados);
+    ptDatabase->pdDados = NULL;
+  }
+  DesmapearArquivo(ptDatabase);
+  ptDatabase->iNumRegistros = 0;
+}
+
+
+int AbrirFluxo(TFluxo *ptFluxo, const char *szNomeArquivo, const int iTamanhoJanela)
+{
+  char vcAssinatura[4];
+  int b;
+
+  // Abre o arquivo e identifica o formato pela assinatura
+  memset(ptFluxo, 0, sizeof(TFluxo));
+  if ((ptFluxo->fp = fopen(szNomeArquivo, "rb")) == NULL) {
+    fprintf(stderr, "ERRO: Nao foi possivel abrir o database\n");
+    return 0;
+  }
+  ptFluxo->iBinario = (fread(vcAssinatura, 1, 4, ptFluxo->fp) == 4 && !memcmp(vcAssinatura, ASSINATURA_BINARIO, 4));
+  ptFluxo->iTamanhoJanela = iTamanhoJanela;
+  if (!IndexarFluxo(ptFluxo)) {
+    fclose(ptFluxo->fp);
+    free(ptFluxo->plPosicaoBloco);
+    free(ptFluxo->piLinhaBloco);
+    free(ptFluxo->pcLinha);
+    ptFluxo->fp = NULL;
+    return 0;
+  }
+
+  // Dois buffers de uma janela cada (um em uso e outro sendo carregado)
+  for (b = 0; b < 2; b++) {
+    ptFluxo->vpdBuffer[b] = (TReal*) malloc(sizeof(TReal) * (ptFluxo->iNumEntradas + ptFluxo->iNumSaidas) *
+        (size_t) ptFluxo->iTamanhoJanela);
+    ptFluxo->vppdRegistros[b] = (TReal**) malloc(sizeof(TReal*) * ptFluxo->iTamanhoJanela);
+  }
+  if (ptFluxo->iBinario)
+    ptFluxo->pcBruto = (char*) malloc((size_t) ptFluxo->iTipo * ptFluxo->iStrideArquivo * ptFluxo->iTamanhoJanela);
+  ptFluxo->piOrdem = (int*) malloc(sizeof(int) * (ptFluxo->iNumBlocos + 1));
+
+  // A thread de leitura fica parada ate o inicio de uma passagem
+  ptFluxo->iProximoCarregar = ptFluxo->iNumBlocos;
+  pthread_mutex_init(&ptFluxo->tMutex, NULL);
+  pthread_cond_init(&ptFluxo->tCondicao, NULL);
+  pthread_create(&ptFluxo->tThread, NULL, ExecutarThreadFluxo, ptFluxo);
+  return 1;
+}
+
+
+static int IndexarFluxo(TFluxo *ptFluxo)
+{
+  TCabecalhoBinario tCabecalho;
+  long long lPosicao;
+  long lTamanho;
+  int i, iLinha = 1;
+
+  if (ptFluxo->iBinario) {
+    // Binario: as posicoes dos blocos sao calculadas a partir do cabecalho
+    if (PosicionarArquivo(ptFluxo->fp, 0) != 0 || fread(&tCabecalho, sizeof(TCabecalhoBinario), 1, ptFluxo->fp) != 1 ||
+        tCabecalho.uiVersao != VERSAO_BINARIO || (tCabecalho.uiTipo != sizeof(float) &&
+        tCabecalho.uiTipo != sizeof(double)) || tCabecalho.uiNumEntradas < 1 || tCabecalho.uiNumSaidas < 1 ||
+        tCabecalho.ulNumRegistros > INT_MAX || tCabecalho.uiStride < tCabecalho.uiNumEntradas + tCabecalho.uiNumSaidas) {
+      fprintf(stderr, "ERRO: Database binario invalido\n");
+      return 0;
+    }
+    ptFluxo->iNumEntradas = (int) tCabecalho.uiNumEntradas;
+    ptFluxo->iNumSaidas = (int) tCabecalho.uiNumSaidas;
+    ptFluxo->iNumRegistros = (int) tCabecalho.ulNumRegistros;
+    ptFluxo->iStrideArquivo = (int) tCabecalho.uiStride;
+    ptFluxo->iTipo = (int) tCabecalho.uiTipo;
+  }
+  else {
+    // Texto: cabecalho com o numero de entradas, saidas e registros
+    if (PosicionarArquivo(ptFluxo->fp, 0) != 0 ||
+        !LerCabecalhoTexto(ptFluxo->fp, &ptFluxo->iNumEntradas, &ptFluxo->iNumSaidas, &ptFluxo->iNumRegistros))
+      return 0;
+    ptFluxo->iStrideArquivo = ptFluxo->iNumEntradas + ptFluxo->iNumSaidas;
+  }
+  if (ptFluxo->iTamanhoJanela > ptFluxo->iNumRegistros)
+    ptFluxo->iTamanhoJanela = (ptFluxo->iNumRegistros > 0 ? ptFluxo->iNumRegistros : 1);
+  ptFluxo->iNumBlocos = (ptFluxo->iNumRegistros + ptFluxo->iTamanhoJanela - 1) / ptFluxo->iTamanhoJanela;
+  ptFluxo->plPosicaoBloco = (long long*) malloc(sizeof(long long) * (ptFluxo->iNumBlocos + 1));
+  ptFluxo->piLinhaBloco = (int*) malloc(sizeof(int) * (ptFluxo->iNumBlocos + 1));
+
+  // Posicao (e linha, no texto) do primeiro registro de cada bloco; o texto exige uma leitura sequencial
+  for (i = 0; i < ptFluxo->iNumRegistros; ) {
+    if (ptFluxo->iBinario) {
+      ptFluxo->plPosicaoBloco[i / ptFluxo->iTamanhoJanela] = (long long) tCabecalho.ulDeslocamento +
+          (long long) i * ptFluxo->iStrideArquivo * ptFluxo->iTipo;
+      i += ptFluxo->iTamanhoJanela;
+      continue;
+    }
+    lPosicao = PosicaoArquivo(ptFluxo->fp);
+    if ((lTamanho = LerLinha(ptFluxo->fp, &ptFluxo->pcLinha, &ptFluxo->tamLinha)) < 0) {
+      fprintf(stderr, "ERRO: O database tem %d registros (esperados %d na linha 1)\n", i, ptFluxo->iNumRegistros);
+      return 0;
+    }
+    iLinha++;
+    if (LinhaEmBranco(ptFluxo->pcLinha, ptFluxo->pcLinha + lTamanho))
+      continue;
+    if (!(i % ptFluxo->iTamanhoJanela)) {
+      ptFluxo->plPosicaoBloco[i / ptFluxo->iTamanhoJanela] = lPosicao;
+      ptFluxo->piLinhaBloco[i / ptFluxo->iTamanhoJanela] = iLinha;
+    }
+    i++;
+  }
+  return 1;
+}
+
+
+static int LerBlocoFluxo(TFluxo *ptFluxo, const int iBloco, const int iBuffer)
+{
+  int i, j, iNumValores = ptFluxo->iNumEntradas + ptFluxo->iNumSaidas;
+  int iInicio = iBloco * ptFluxo->iTamanhoJanela, iLinha = 0;
+  int iNumRegistros = ptFluxo->iNumRegistros - iInicio;
+  TReal *pdRegistro;
+
+  // Le os registros [iInicio, iInicio + janela) para o buffer indicado
+  if (iNumRegistros > ptFluxo->iTamanhoJanela)
+    iNumRegistros = ptFluxo->iTamanhoJanela;
+  if (PosicionarArquivo(ptFluxo->fp, ptFluxo->plPosicaoBloco[iBloco]) != 0)
+    return 0;
+  if (!ptFluxo->iBinario)
+    iLinha = ptFluxo->piLinhaBloco[iBloco] - 1;
+  if (ptFluxo->iBinario && fread(ptFluxo->pcBruto, (size_t) ptFluxo->iTipo * ptFluxo->iStrideArquivo, iNumRegistros,
+      ptFluxo->fp) != (size_t) iNumRegistros)
+    return 0;
+  for (i = 0; i < iNumRegistros; i++) {
+    pdRegistro = &ptFluxo->vpdBuffer[iBuffer][(size_t) i * iNumValores];
+    ptFluxo->vppdRegistros[iBuffer][i] = pdRegistro;
+    if (!ptFluxo->iBinario) {
+      if (!LerRegistroTexto(ptFluxo->fp, &ptFluxo->pcLinha, &ptFluxo->tamLinha, pdRegistro, iNumValores, &iLinha))
+        return 0;
+      continue;
+    }
+    for (j = 0; j < iNumValores; j++) {
+      if (ptFluxo->iTipo == sizeof(float))
+        pdRegistro[j] = (TReal) ((const float*) ptFluxo->pcBruto)[(size_t) i * ptFluxo->iStrideArquivo + j];
+      else
+        pdRegistro[j] = (TReal) ((const double*) ptFluxo->pcBruto)[(size_t) i * ptFluxo->iStrideArquivo + j];
+    }
+  }
+  ptFluxo->viNumRegistros[iBuffer] = iNumRegistros;
+  return 1;
+}
+
+
+static void *ExecutarThreadFluxo(void *pArg)
+{
+  TFluxo *ptFluxo = (TFluxo*) pArg;
+  int iSequencia, iBuffer, iOk;
+
+  // Carrega o proximo bloco da passagem sempre que o seu buffer estiver livre
+  pthread_mutex_lock(&ptFluxo->tMutex);
+  while (!ptFluxo->iEncerrar) {
+    iSequencia = ptFluxo->iProximoCarregar;
+    iBuffer = iSequencia % 2;
+    if (iSequencia >= ptFluxo->iNumBlocos || ptFluxo->viEstado[iBuffer] != BUFFER_LIVRE) {
+      pthread_cond_wait(&ptFluxo->tCondicao, &ptFluxo->tMutex);
+      continue;
+    }
+    ptFluxo->viEstado[iBuffer] = BUFFER_CARREGANDO;
+    pthread_mutex_unlock(&ptFluxo->tMutex);
+    iOk = LerBlocoFluxo(ptFluxo, ptFluxo->piOrdem[iSequencia], iBuffer);
+    pthread_mutex_lock(&ptFluxo->tMutex);
+    if (!iOk)
+      ptFluxo->iErro = 1;
+    ptFluxo->viEstado[iBuffer] = BUFFER_PRONTO;
+    ptFluxo->iProximoCarregar++;
+    pthread_cond_broadcast(&ptFluxo->tCondicao);
+  }
+  pthread_mutex_unlock(&ptFluxo->tMutex);
+  return NULL;
+}
+
+
+void IniciarPassagemFluxo(TFluxo *ptFluxo, const int *piOrdem)
+{
+  int i;
+
+  // Define a ordem dos blocos (NULL = ordem do arquivo) e libera a thread de leitura
+  pthread_mutex_lock(&ptFluxo->tMutex);
+  for (i = 0; i < ptFluxo->iNumBlocos; i++)
+    ptFluxo->piOrdem[i] = (piOrdem != NULL ? piOrdem[i] : i);
+  ptFluxo->viEstado[0] = ptFluxo->viEstado[1] = BUFFER_LIVRE;
+  ptFluxo->iProximoCarregar = 0;
+  ptFluxo->iAtual = -1;
+  pthread_cond_broadcast(&ptFluxo->tCondicao);
+  pthread_mutex_unlock(&ptFluxo->tMutex);
+}
+
+
+TReal **ProximoBlocoFluxo(TFluxo *ptFluxo, int *piNumRegistros)
+{
+  int iBuffer;
+
+  // Devolve o buffer anterior para a thread de leitura e espera o proximo bloco
+  pthread_mutex_lock(&ptFluxo->tMutex);
+  if (ptFluxo->iAtual >= 0) {
+    ptFluxo->viEstado[ptFluxo->iAtual % 2] = BUFFER_LIVRE;
+    pthread_cond_broadcast(&ptFluxo->tCondicao);
+  }
+  if (++ptFluxo->iAtual >= ptFluxo->iNumBlocos) {
+    pthread_mutex_unlock(&ptFluxo->tMutex);
+    return NULL;
+  }
+  iBuffer = ptFluxo->iAtual % 2;
+  while (ptFluxo->viEstado[iBuffer] != BUFFER_PRONTO || ptFluxo->iProximoCarregar <= ptFluxo->iAtual)
+    pthread_cond_wait(&ptFluxo->tCondicao, &ptFluxo->tMutex);
+  pthread_mutex_unlock(&ptFluxo->tMutex);
+  if (ptFluxo->iErro) {
+    fprintf(stderr, "ERRO: Falha na leitura do bloco %d do database\n", ptFluxo->piOrdem[ptFluxo->iAtual] + 1);
+    exit(1);
+  }
+  *piNumRegistros = ptFluxo->viNumRegistros[iBuffer];
+  return ptFluxo->vppdRegistros[iBuffer];
+}
+
+
+void FecharFluxo(TFluxo *ptFluxo)
+{
+  int b;
+
+  // Encerra a thread de leitura e libera os buffers
+  if (ptFluxo->fp == NULL)
+    return;
+  pthread_mutex_lock(&ptFluxo->tMutex);
+  ptFluxo->iEncerrar = 1;
+  pthread_cond_broadcast(&ptFluxo->tCondicao);
+  pthread_mutex_unlock(&ptFluxo->tMutex);
+  pthread_join(ptFluxo->tThread, NULL);
+  pthread_mutex_destroy(&ptFluxo->tMutex);
+  pthread_cond_destroy(&ptFluxo->tCondicao);
+  for (b = 0; b < 2; b++) {
+    free(ptFluxo->vpdBuffer[b]);
+    free(ptFluxo->vppdRegistros[b]);
+  }
+  free(ptFluxo->pcBruto);
+  free(ptFluxo->plPosicaoBloco);
+  free(ptFluxo->piLinhaBloco);
+  free(ptFluxo->pcLinha);
+  free(ptFluxo->piOrdem);
+  fclose(ptFluxo->fp);
+  ptFluxo->fp = NULL;
+}
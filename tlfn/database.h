@@ -0,0 +1,99 @@
+//************************************************************************************************
+//* UNIVERSIDADE FEDERAL DO RIO GRANDE DO SUL (UFRGS) - Campus do Vale                          **
+//* Doutorado em Ciencia da Computacao - PPGC                                                   **
+//* Doutorando: Milton Roberto Heinen - 00145752                                                **
+//* Orientador: Paulo Martins Engel                                                             **
+//* Databases de treinamento e generalizacao (texto .lrn/.tst e binario mapeado .lrnb/.tstb)    **
+//************************************************************************************************
+#ifndef DATABASE_H
+#define DATABASE_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <pthread.h>
+#include "vetorial.h"
+
+
+//************************************** Constantes **********************************************
+#define ASSINATURA_BINARIO "LRNB"
+#define VERSAO_BINARIO 1
+#define EXTENSAO_BINARIO "b"
+
+
+//************************************ Tipos de dados ********************************************
+// Cabecalho de 64 bytes do database binario (little endian); os registros comecam em
+// uiDeslocamento, com uiStride valores de uiTipo bytes cada (entradas seguidas das saidas)
+typedef struct {
+  char vcAssinatura[4];
+  unsigned int uiVersao;
+  unsigned int uiNumEntradas;
+  unsigned int uiNumSaidas;
+  unsigned long long ulNumRegistros;
+  unsigned int uiTipo;
+  unsigned int uiStride;
+  unsigned long long ulDeslocamento;
+  char vcReservado[24];
+} TCabecalhoBinario;
+
+// Registros em um bloco unico (alocado ou mapeado do arquivo binario); ppdRegistros aponta para as
+// linhas na ordem do arquivo (o embaralhamento usa uma permutacao de indices a parte)
+typedef struct {
+  int iNumEntradas;
+  int iNumSaidas;
+  int iNumRegistros;
+  int iStride;
+  TReal **ppdRegistros;
+  TReal *pdDados;
+  void *pMapeamento;
+  size_t tamMapeamento;
+  void *pArquivoMapeado;
+} TDatabase;
+
+// Leitura do database em blocos de iTamanhoJanela registros (texto ou binario), com uma thread que
+// carrega o proximo bloco enquanto o anterior e usado (buffer duplo); a memoria fica limitada
+// pela janela, independente do tamanho do arquivo
+typedef struct {
+  FILE *fp;
+  int iBinario;
+  int iTipo;
+  int iNumEntradas;
+  int iNumSaidas;
+  int iNumRegistros;
+  int iStrideArquivo;
+  int iTamanhoJanela;
+  int iNumBlocos;
+  long long *plPosicaoBloco;
+  int *piLinhaBloco;
+  int *piOrdem;
+  char *pcLinha;
+  size_t tamLinha;
+  TReal *vpdBuffer[2];
+  TReal **vppdRegistros[2];
+  int viNumRegistros[2];
+  int viEstado[2];
+  char *pcBruto;
+  int iProximoCarregar;
+  int iAtual;
+  int iErro;
+  int iEncerrar;
+  pthread_t tThread;
+  pthread_mutex_t tMutex;
+  pthread_cond_t tCondicao;
+} TFluxo;
+
+
+//************************************** Prototipos **********************************************
+int CarregarDatabase(TDatabase *ptDatabase, const char *szNomeArquivo);
+void DesalocarDatabase(TDatabase *ptDatabase);
+int ConverterDatabase(const char *szArquivoTexto, const char *szArquivoBinario);
+int ArquivoExiste(const char *szNomeArquivo);
+int BinarioAtualizado(const char *szArquivoBinario, const char *szArquivoTexto);
+// Retorna o arquivo binario, exceto se ele nao existir ou for mais antigo que o texto (entao avisa)
+const char *EscolherArquivo(const char *szArquivoBinario, const char *szArquivoTexto);
+int SubstituirArquivo(const char *szTemporario, const char *szNomeArquivo);
+int AbrirFluxo(TFluxo *ptFluxo, const char *szNomeArquivo, const int iTamanhoJanela);
+void IniciarPassagemFluxo(TFluxo *ptFluxo, const int *piOrdem);
+TReal **ProximoBlocoFluxo(TFluxo *ptFluxo, int *piNumRegistros);
+void FecharFluxo(TFluxo *ptFluxo);
+
+#endif
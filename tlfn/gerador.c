@@ -0,0 +1,185 @@
+//************************************************************************************************
+//* UNIVERSIDADE FEDERAL DO RIO GRANDE DO SUL (UFRGS) - Campus do Vale                          **
+//* Doutorado em Ciencia da Computacao - PPGC                                                   **
+//* Doutorando: Milton Roberto Heinen - 00145752                                                **
+//* Orientador: Paulo Martins Engel                                                             **
+//* Gerador de controladores C++ com a topologia e os pesos fixados em tempo de compilacao      **
+//************************************************************************************************
+
+//*************************************** Includes ***********************************************
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include "gerador.h"
+
+
+//************************************** Constantes **********************************************
+#define VALORES_LINHA 4
+#define SECAO_CONSTANTES "//************************************** Constantes " \
+    "**********************************************"
+#define SECAO_TIPOS "//************************************ Tipos de dados " \
+    "********************************************"
+#define SECAO_FUNCOES "//*************************************** Funcoes " \
+    "************************************************"
+#define MOLDURA "//************************************************************************************************"
+
+
+//**************************************** Macros ************************************************
+#define MINIMO(a, b) ((a) < (b) ? (a) : (b))
+
+
+//*********************************** Variaveis locais *******************************************
+static const char *vszCodigosAtivacao[NUM_ATIVACOES] = { "ATIVACAO_LINEAR", "ATIVACAO_TANH", "ATIVACAO_TANH_RAPIDA" };
+
+
+//************************************** Prototipos **********************************************
+static void MontarNome(char *szNome, const char *szNomeRede);
+static void EscreverMatriz(FILE *fp, const char *szNome, const TCamada *ptCamada);
+
+
+//*************************************** Funcoes ************************************************
+int GerarControlador(const TRede *ptRede, const char *szNomeRede, TReal **ppdRegistros, const int iNumRegistros,
+    const char *szNomeArquivo)
+{
+  FILE *fp;
+  TReal **ppdSaida;
+  char vcNome[MAX_NOME_REDE + 1], vcMatriz[MAX_NOME_REDE + 32], vcTopologia[MAX_NOME_REDE + 1];
+  char vcEntrada[16];
+  int i, l, r, iNumVerificacao = MINIMO(iNumRegistros, MAX_REGISTROS_VERIFICACAO);
+
+  // O tipo e os vetores do controlador levam o nome da rede (ex.: futebol -> TRedeFutebol, vdFutebolPesos0)
+  if (iNumVerificacao < 1) {
+    fprintf(stderr, "ERRO: Nenhum registro para verificar o controlador\n");
+    return 0;
+  }
+  MontarNome(vcNome, szNomeRede);
+  if ((fp = fopen(szNomeArquivo, "w")) == NULL) {
+    fprintf(stderr, "ERRO: Nao foi possivel criar o arquivo %s\n", szNomeArquivo);
+    return 0;
+  }
+  sprintf(vcTopologia, "%d", ptRede->iNumEntradas);
+  for (l = 0; l < ptRede->iNumCamadas && strlen(vcTopologia) < MAX_NOME_REDE - 12; l++)
+    sprintf(&vcTopologia[strlen(vcTopologia)], "-%d", ptRede->vtCamadas[l].iNumNeuronios);
+
+  // Cabecalho do arquivo e tipo da rede (usado apenas para especializar os templates de redecompilada.h)
+  fprintf(fp, "%s\n//* Controlador %-79.79s **\n", MOLDURA, vcTopologia);
+  fprintf(fp, "//* Gerado pelo tlfn (-d) a partir de %-57.57s **\n%s\n", szNomeRede, MOLDURA);
+  for (i = 0; vcNome[i]; i++)
+    vcMatriz[i] = (char) toupper((unsigned char) vcNome[i]);
+  vcMatriz[i] = '\0';
+  fprintf(fp, "#ifndef REDE_%s_H\n#define REDE_%s_H\n\n#include \"redecompilada.h\"\n\n\n", vcMatriz, vcMatriz);
+  fprintf(fp, "%s\n// Topologia fixa da rede %s (as saidas da ultima camada sao as do controlador)\n", SECAO_TIPOS,
+      vcNome);
+  fprintf(fp, "struct TRede%s {\n  static constexpr int NUM_ENTRADAS = %d;\n  static constexpr int NUM_SAIDAS = %d;\n",
+      vcNome, ptRede->iNumEntradas, ptRede->iNumSaidas);
+  fprintf(fp, "  static constexpr int NUM_CAMADAS = %d;\n  static constexpr double TOLERANCIA = %g;\n};\n\n\n",
+      ptRede->iNumCamadas, TOLERANCIA_CONTROLADOR);
+
+  // Pesos de cada camada, transpostos para que os neuronios sejam propagados juntos
+  fprintf(fp, "%s\n", SECAO_CONSTANTES);
+  for (l = 0; l < ptRede->iNumCamadas; l++) {
+    fprintf(fp, "// Camada %d: (%d entradas + bias) x %d neuronios, ativacao %s\n", l,
+        ptRede->vtCamadas[l].iNumEntradas, ptRede->vtCamadas[l].iNumNeuronios,
+        NomeAtivacao(ptRede->vtCamadas[l].iAtivacao));
+    sprintf(vcMatriz, "vd%sPesos%d", vcNome, l);
+    EscreverMatriz(fp, vcMatriz, &ptRede->vtCamadas[l]);
+    fprintf(fp, "\n");
+  }
+
+  // Registros de verificacao com as saidas de AtivarRede (a mesma propagacao do stlfn)
+  ppdSaida = AlocarSaidasRede(ptRede);
+  fprintf(fp, "// Registros de verificacao e saidas calculadas pelo tlfn\n");
+  fprintf(fp, "alignas(%d) constexpr double vd%sEntradas[%d][%d] = {\n", ALINHAMENTO, vcNome, iNumVerificacao,
+      ptRede->iNumEntradas);
+  for (r = 0; r < iNumVerificacao; r++) {
+    fprintf(fp, "  {");
+    for (i = 0; i < ptRede->iNumEntradas; i++)
+      fprintf(fp, "%s%.17g", (i == 0 ? " " : (i % VALORES_LINHA ? ", " : ",\n    ")), (double) ppdRegistros[r][i]);
+    fprintf(fp, " },\n");
+  }
+  fprintf(fp, "};\n\nalignas(%d) constexpr double vd%sSaidas[%d][%d] = {\n", ALINHAMENTO, vcNome, iNumVerificacao,
+      ptRede->iNumSaidas);
+  for (r = 0; r < iNumVerificacao; r++) {
+    AtivarRede(ptRede, ppdRegistros[r], ppdSaida);
+    fprintf(fp, "  {");
+    for (i = 0; i < ptRede->iNumSaidas; i++)
+      fprintf(fp, "%s%.17g", (i == 0 ? " " : (i % VALORES_LINHA ? ", " : ",\n    ")),
+          (double) ppdSaida[ptRede->iNumCamadas - 1][i]);
+    fprintf(fp, " },\n");
+  }
+  fprintf(fp, "};\n\n\n");
+  LiberarSaidasRede(ptRede, ppdSaida);
+
+  // Propagacao com as dimensoes e as ativacoes como parametros dos templates (uma camada por comando)
+  fprintf(fp, "%s\ntemplate <>\ninline void AtivarCompilada<TRede%s>(const double *pdEntrada, double *pdSaida)\n{\n",
+      SECAO_FUNCOES, vcNome);
+  for (l = 0; l < ptRede->iNumCamadas; l++)
+    fprintf(fp, "  alignas(%d) double vdCamada%d[%d];\n", ALINHAMENTO, l,
+        LARGURA_COMPILADA(ptRede->vtCamadas[l].iNumNeuronios));
+  fprintf(fp, "\n");
+  for (l = 0; l < ptRede->iNumCamadas; l++) {
+    if (l == 0)
+      strcpy(vcEntrada, "pdEntrada");
+    else
+      sprintf(vcEntrada, "vdCamada%d", l - 1);
+    fprintf(fp, "  PropagarCompilada<%d, %d, %s>(vd%sPesos%d, %s, vdCamada%d);\n", ptRede->vtCamadas[l].iNumEntradas,
+        LARGURA_COMPILADA(ptRede->vtCamadas[l].iNumNeuronios), vszCodigosAtivacao[ptRede->vtCamadas[l].iAtivacao],
+        vcNome, l, vcEntrada, l);
+  }
+  for (i = 0; i < ptRede->iNumSaidas; i++)
+    fprintf(fp, "  pdSaida[%d] = vdCamada%d[%d];\n", i, ptRede->iNumCamadas - 1, i);
+  fprintf(fp, "}\n\n\ntemplate <>\ninline double VerificarCompilada<TRede%s>()\n{\n", vcNome);
+  fprintf(fp, "  return CompararCompilada<TRede%s>(vd%sEntradas, vd%sSaidas);\n}\n\n", vcNome, vcNome, vcNome);
+  fprintf(fp, "// Rede usada pelo controlador do robo quando nenhuma outra foi escolhida\n");
+  fprintf(fp, "#ifndef REDE_COMPILADA\n#define REDE_COMPILADA TRede%s\n#endif\n\n#endif\n", vcNome);
+  if (ferror(fp)) {
+    fprintf(stderr, "ERRO: Nao foi possivel gravar o arquivo %s\n", szNomeArquivo);
+    fclose(fp);
+    return 0;
+  }
+  fclose(fp);
+  return 1;
+}
+
+
+static void MontarNome(char *szNome, const char *szNomeRede)
+{
+  const char *pc;
+  int i = 0, iMaiuscula = 1;
+
+  // Nome do arquivo sem o diretorio, com as letras e digitos em CamelCase (o resto separa as palavras)
+  for (pc = szNomeRede; *szNomeRede; szNomeRede++) {
+    if (*szNomeRede == '/' || *szNomeRede == '\\')
+      pc = szNomeRede + 1;
+  }
+  for (; *pc && i < MAX_NOME_REDE; pc++) {
+    if (!isalnum((unsigned char) *pc))
+      iMaiuscula = 1;
+    else {
+      szNome[i++] = (char) (iMaiuscula ? toupper((unsigned char) *pc) : *pc);
+      iMaiuscula = 0;
+    }
+  }
+  if (i == 0)
+    szNome[i++] = 'X';
+  szNome[i] = '\0';
+}
+
+
+static void EscreverMatriz(FILE *fp, const char *szNome, const TCamada *ptCamada)
+{
+  int i, k, iLargura = LARGURA_COMPILADA(ptCamada->iNumNeuronios);
+
+  // Transposta (uma linha por entrada, o bias na ultima) com os valores em %.17g: o double lido pelo
+  // compilador e exatamente o peso da rede
+  fprintf(fp, "alignas(%d) constexpr double %s[%d][%d] = {\n", ALINHAMENTO, szNome, ptCamada->iNumEntradas + 1,
+      iLargura);
+  for (k = 0; k <= ptCamada->iNumEntradas; k++) {
+    fprintf(fp, "  {");
+    for (i = 0; i < iLargura; i++)
+      fprintf(fp, "%s%.17g", (i == 0 ? " " : (i % VALORES_LINHA ? ", " : ",\n    ")),
+          (i < ptCamada->iNumNeuronios ? (double) ptCamada->pdPeso[i * ptCamada->iStride + k] : 0.0));
+    fprintf(fp, " },\n");
+  }
+  fprintf(fp, "};\n");
+}
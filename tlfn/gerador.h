@@ -0,0 +1,39 @@
+//************************************************************************************************
+//* UNIVERSIDADE FEDERAL DO RIO GRANDE DO SUL (UFRGS) - Campus do Vale                          **
+//* Doutorado em Ciencia da Computacao - PPGC                                                   **
+//* Doutorando: Milton Roberto Heinen - 00145752                                                **
+//* Orientador: Paulo Martins Engel                                                             **
+//* Gerador de controladores C++ com a topologia e os pesos fixados em tempo de compilacao      **
+//************************************************************************************************
+#ifndef GERADOR_H
+#define GERADOR_H
+
+#include "vetorial.h"
+#include "rede.h"
+
+
+//************************************** Constantes **********************************************
+#define MAX_REGISTROS_VERIFICACAO 32
+#define MAX_NOME_REDE 64
+// Diferenca admitida entre as saidas do controlador (em double, com as somas na ordem de AtivarRede) e as
+// gravadas pelo tlfn: reordenacoes dos kernels vetoriais em double e o arredondamento das ativacoes em float
+#ifdef PRECISAO_SIMPLES
+#define TOLERANCIA_CONTROLADOR 1.0e-4
+#else
+#define TOLERANCIA_CONTROLADOR 1.0e-9
+#endif
+
+
+//**************************************** Macros ************************************************
+// Colunas das matrizes transpostas do controlador (neuronios com padding ate ALINHAMENTO bytes de doubles)
+#define LARGURA_COMPILADA(n) ((((n) * (int) sizeof(double) + ALINHAMENTO - 1) / ALINHAMENTO) * \
+    (ALINHAMENTO / (int) sizeof(double)))
+
+
+//************************************** Prototipos **********************************************
+// Gera o cabecalho do controlador (ver RobotNeural/redecompilada.h) com os pesos de ptRede e as saidas
+// de AtivarRede para ate MAX_REGISTROS_VERIFICACAO registros, conferidas por VerificarCompilada
+int GerarControlador(const TRede *ptRede, const char *szNomeRede, TReal **ppdRegistros, const int iNumRegistros,
+    const char *szNomeArquivo);
+
+#endif
@@ -0,0 +1,95 @@
+//************************************************************************************************
+//* UNIVERSIDADE FEDERAL DO RIO GRANDE DO SUL (UFRGS) - Campus do Vale                          **
+//* Doutorado em Ciencia da Computacao - PPGC                                                   **
+//* Doutorando: Milton Roberto Heinen - 00145752                                                **
+//* Orientador: Paulo Martins Engel                                                             **
+//* Minimos quadrados: equacoes normais resolvidas pela fatoracao de Cholesky                   **
+//************************************************************************************************
+
+//*************************************** Includes ***********************************************
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "minimos.h"
+
+
+//************************************** Demais funcoes ******************************************
+int FatorarCholesky(double *pdA, const int iN)
+{
+  register int k;
+  int i, j;
+  double dSoma;
+
+  // A = L * L^T no triangulo inferior de A (iN x iN, por linhas); o triangulo superior nao e usado
+  for (i = 0; i < iN; i++) {
+    for (j = 0; j <= i; j++) {
+      dSoma = pdA[i * iN + j];
+      for (k = 0; k < j; k++)
+        dSoma -= pdA[i * iN + k] * pdA[j * iN + k];
+      if (i == j) {
+        // A matriz nao e definida positiva (numericamente)
+        if (dSoma <= 0.0)
+          return 0;
+        pdA[i * iN + i] = sqrt(dSoma);
+      }
+      else
+        pdA[i * iN + j] = dSoma / pdA[j * iN + j];
+    }
+  }
+  return 1;
+}
+
+
+void ResolverCholesky(const double *pdL, const int iN, double *pdB, const int iNumColunas)
+{
+  register int c;
+  int i, k;
+  double dFator;
+
+  // Resolve L * L^T * X = B, sobrescrevendo B (iN x iNumColunas, por linhas) com X
+  for (i = 0; i < iN; i++) {
+    for (k = 0; k < i; k++) {
+      dFator = pdL[i * iN + k];
+      for (c = 0; c < iNumColunas; c++)
+        pdB[i * iNumColunas + c] -= dFator * pdB[k * iNumColunas + c];
+    }
+    for (c = 0; c < iNumColunas; c++)
+      pdB[i * iNumColunas + c] /= pdL[i * iN + i];
+  }
+  for (i = iN - 1; i >= 0; i--) {
+    for (k = i + 1; k < iN; k++) {
+      dFator = pdL[k * iN + i];
+      for (c = 0; c < iNumColunas; c++)
+        pdB[i * iNumColunas + c] -= dFator * pdB[k * iNumColunas + c];
+    }
+    for (c = 0; c < iNumColunas; c++)
+      pdB[i * iNumColunas + c] /= pdL[i * iN + i];
+  }
+}
+
+
+int ResolverMinimosQuadrados(double *pdA, double *pdB, const int iN, const int iNumColunas,
+    const double dRegularizacao)
+{
+  double *pdFator, dTraco = 0.0, dLambda;
+  int i, t;
+
+  // Resolve (A + lambda * I) X = B com A = H^T H simetrica (triangulo inferior); lambda e relativo a
+  // diagonal media e cresce 10x a cada tentativa se as ativacoes forem colineares
+  for (i = 0; i < iN; i++)
+    dTraco += pdA[i * iN + i];
+  dLambda = dRegularizacao * (dTraco > 0.0 ? dTraco / iN : 1.0);
+  pdFator = (double*) malloc(sizeof(double) * iN * iN);
+  for (t = 0; t < TENTATIVAS_CHOLESKY; t++, dLambda *= 10.0) {
+    memcpy(pdFator, pdA, sizeof(double) * iN * iN);
+    for (i = 0; i < iN; i++)
+      pdFator[i * iN + i] += dLambda;
+    if (FatorarCholesky(pdFator, iN)) {
+      ResolverCholesky(pdFator, iN, pdB, iNumColunas);
+      free(pdFator);
+      return 1;
+    }
+  }
+  free(pdFator);
+  return 0;
+}
@@ -0,0 +1,22 @@
+//************************************************************************************************
+//* UNIVERSIDADE FEDERAL DO RIO GRANDE DO SUL (UFRGS) - Campus do Vale                          **
+//* Doutorado em Ciencia da Computacao - PPGC                                                   **
+//* Doutorando: Milton Roberto Heinen - 00145752                                                **
+//* Orientador: Paulo Martins Engel                                                             **
+//* Minimos quadrados: equacoes normais resolvidas pela fatoracao de Cholesky                   **
+//************************************************************************************************
+#ifndef MINIMOS_H
+#define MINIMOS_H
+
+
+//************************************** Constantes **********************************************
+#define TENTATIVAS_CHOLESKY 8
+
+
+//************************************** Prototipos **********************************************
+int FatorarCholesky(double *pdA, const int iN);
+void ResolverCholesky(const double *pdL, const int iN, double *pdB, const int iNumColunas);
+int ResolverMinimosQuadrados(double *pdA, double *pdB, const int iN, const int iNumColunas,
+    const double dRegularizacao);
+
+#endif
@@ -0,0 +1,380 @@
+//************************************************************************************************
+//* UNIVERSIDADE FEDERAL DO RIO GRANDE DO SUL (UFRGS) - Campus do Vale                          **
+//* Doutorado em Ciencia da Computacao - PPGC                                                   **
+//* Doutorando: Milton Roberto Heinen - 00145752                                                **
+//* Orientador: Paulo Martins Engel                                                             **
+//* Rede quantizada em int8 (calibracao, arquivo .wtsq e inferencia) para o tlfn e o stlfn      **
+//************************************************************************************************
+
+//*************************************** Includes ***********************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "quantizada.h"
+
+
+//************************************** Prototipos **********************************************
+static int CriarRedeQuantizada(TRedeQuantizada *ptQuantizada, const int iNumEntradas, const int iNumCamadas,
+    const int *piNeuronios, const int *piAtivacoes);
+static inline int QuantizarValor(float fValor);
+static int EscreverBloco(FILE *fp, const void *pDados, size_t tamanho, unsigned long long *pulSoma);
+
+
+//*************************************** Funcoes ************************************************
+static int CriarRedeQuantizada(TRedeQuantizada *ptQuantizada, const int iNumEntradas, const int iNumCamadas,
+    const int *piNeuronios, const int *piAtivacoes)
+{
+  int l;
+  TCamadaQuantizada *ptCamada;
+
+  // Parametros de cada camada em um bloco unico (3 floats por entrada e 2 por neuronio) e pesos com padding
+  memset(ptQuantizada, 0, sizeof(TRedeQuantizada));
+  ptQuantizada->iNumEntradas = iNumEntradas;
+  ptQuantizada->iNumCamadas = iNumCamadas;
+  ptQuantizada->iNumSaidas = piNeuronios[iNumCamadas - 1];
+  for (l = 0; l < iNumCamadas; l++) {
+    ptCamada = &ptQuantizada->vtCamadas[l];
+    ptCamada->iNumEntradas = (l ? piNeuronios[l - 1] : iNumEntradas);
+    ptCamada->iNumNeuronios = piNeuronios[l];
+    ptCamada->iStride = STRIDE_INT8(ptCamada->iNumEntradas);
+    ptCamada->iAtivacao = piAtivacoes[l];
+    ptCamada->pfCentro = (float*) AlocarAlinhado(sizeof(float) * (3 * ptCamada->iNumEntradas +
+        2 * ptCamada->iNumNeuronios));
+    ptCamada->pcPeso = (signed char*) AlocarAlinhado((size_t) ptCamada->iNumNeuronios * ptCamada->iStride);
+    if (ptCamada->pfCentro == NULL || ptCamada->pcPeso == NULL) {
+      fprintf(stderr, "ERRO: Memoria insuficiente para a rede quantizada\n");
+      ptQuantizada->iNumCamadas = l + 1;
+      DestruirRedeQuantizada(ptQuantizada);
+      return 0;
+    }
+    ptCamada->pfEscalaEntrada = &ptCamada->pfCentro[ptCamada->iNumEntradas];
+    ptCamada->pfInversoEntrada = &ptCamada->pfCentro[2 * ptCamada->iNumEntradas];
+    ptCamada->pfEscalaPeso = &ptCamada->pfCentro[3 * ptCamada->iNumEntradas];
+    ptCamada->pfBias = &ptCamada->pfEscalaPeso[ptCamada->iNumNeuronios];
+    if (ptCamada->iStride > ptQuantizada->iMaiorStride)
+      ptQuantizada->iMaiorStride = ptCamada->iStride;
+    if (ptCamada->iNumNeuronios > ptQuantizada->iMaiorCamada)
+      ptQuantizada->iMaiorCamada = ptCamada->iNumNeuronios;
+  }
+  return 1;
+}
+
+
+static inline int QuantizarValor(float fValor)
+{
+  // Satura em [-LIMITE_INT8, LIMITE_INT8] e arredonda para o inteiro mais proximo sem desvios nem libm: apos o
+  // deslocamento o valor e positivo e a conversao por truncamento equivale ao arredondamento
+  fValor = (fValor < (float) -LIMITE_INT8 ? (float) -LIMITE_INT8 : fValor);
+  fValor = (fValor > (float) LIMITE_INT8 ? (float) LIMITE_INT8 : fValor);
+  return (int) (fValor + (float) (LIMITE_INT8 + 1.5)) - (LIMITE_INT8 + 1);
+}
+
+
+int QuantizarRede(TRedeQuantizada *ptQuantizada, const TRede *ptRede, TReal **ppdRegistros, const int iNumRegistros)
+{
+  int viNeuronios[MAX_CAMADAS], viAtivacoes[MAX_CAMADAS];
+  double *vpdMinimo[MAX_CAMADAS], *vpdMaximo[MAX_CAMADAS];
+  double dMaior, dBias;
+  TReal **ppdSaida;
+  const TReal *pdX, *pdPeso;
+  const TCamada *ptCamada;
+  TCamadaQuantizada *ptCamadaQ;
+  int i, k, l, r, iOk = 1;
+
+  // Mesma topologia e ativacoes da rede original
+  for (l = 0; l < ptRede->iNumCamadas; l++) {
+    viNeuronios[l] = ptRede->vtCamadas[l].iNumNeuronios;
+    viAtivacoes[l] = ptRede->vtCamadas[l].iAtivacao;
+  }
+  if (!CriarRedeQuantizada(ptQuantizada, ptRede->iNumEntradas, ptRede->iNumCamadas, viNeuronios, viAtivacoes))
+    return 0;
+  ppdSaida = AlocarSaidasRede(ptRede);
+  for (l = 0; l < ptRede->iNumCamadas; l++) {
+    vpdMinimo[l] = (double*) malloc(sizeof(double) * ptRede->vtCamadas[l].iNumEntradas);
+    vpdMaximo[l] = (double*) malloc(sizeof(double) * ptRede->vtCamadas[l].iNumEntradas);
+    iOk = iOk && vpdMinimo[l] != NULL && vpdMaximo[l] != NULL;
+    for (k = 0; iOk && k < ptRede->vtCamadas[l].iNumEntradas; k++) {
+      vpdMinimo[l][k] = HUGE_VAL;
+      vpdMaximo[l][k] = -HUGE_VAL;
+    }
+  }
+
+  // Calibracao: faixa de cada entrada de cada camada (as entradas da camada l > 0 sao as saidas da camada
+  // anterior) com a rede original propagando os registros
+  for (r = 0; iOk && r < iNumRegistros; r++) {
+    AtivarRede(ptRede, ppdRegistros[r], ppdSaida);
+    for (l = 0; l < ptRede->iNumCamadas; l++) {
+      pdX = (l ? ppdSaida[l - 1] : ppdRegistros[r]);
+      for (k = 0; k < ptRede->vtCamadas[l].iNumEntradas; k++) {
+        if (pdX[k] < vpdMinimo[l][k])
+          vpdMinimo[l][k] = pdX[k];
+        if (pdX[k] > vpdMaximo[l][k])
+          vpdMaximo[l][k] = pdX[k];
+      }
+    }
+  }
+
+  // Quantizacao afim das entradas (centro e escala por entrada) e simetrica dos pesos (escala por neuronio):
+  // a escala de cada entrada e incorporada aos pesos antes de quantiza-los e o centro e somado ao bias
+  for (l = 0; iOk && l < ptRede->iNumCamadas; l++) {
+    ptCamada = &ptRede->vtCamadas[l];
+    ptCamadaQ = &ptQuantizada->vtCamadas[l];
+    for (k = 0; k < ptCamada->iNumEntradas; k++) {
+      if (vpdMaximo[l][k] > vpdMinimo[l][k]) {
+        ptCamadaQ->pfCentro[k] = (float) (0.5 * (vpdMaximo[l][k] + vpdMinimo[l][k]));
+        ptCamadaQ->pfEscalaEntrada[k] = (float) ((vpdMaximo[l][k] - vpdMinimo[l][k]) / (2.0 * LIMITE_INT8));
+      }
+      else {
+        // Entrada constante (ou sem registros): representada apenas pelo centro
+        ptCamadaQ->pfCentro[k] = (float) (vpdMaximo[l][k] >= vpdMinimo[l][k] ? vpdMaximo[l][k] : 0.0);
+        ptCamadaQ->pfEscalaEntrada[k] = 1.0f;
+      }
+      ptCamadaQ->pfInversoEntrada[k] = 1.0f / ptCamadaQ->pfEscalaEntrada[k];
+    }
+    for (i = 0, pdPeso = ptCamada->pdPeso; i < ptCamada->iNumNeuronios; i++, pdPeso += ptCamada->iStride) {
+      dMaior = 0.0;
+      dBias = pdPeso[ptCamada->iNumEntradas];
+      for (k = 0; k < ptCamada->iNumEntradas; k++) {
+        if (fabs(pdPeso[k] * ptCamadaQ->pfEscalaEntrada[k]) > dMaior)
+          dMaior = fabs(pdPeso[k] * ptCamadaQ->pfEscalaEntrada[k]);
+        dBias += pdPeso[k] * ptCamadaQ->pfCentro[k];
+      }
+      ptCamadaQ->pfEscalaPeso[i] = (float) (dMaior > 0.0 ? dMaior / LIMITE_INT8 : 1.0);
+      ptCamadaQ->pfBias[i] = (float) dBias;
+      for (k = 0; k < ptCamada->iNumEntradas; k++)
+        ptCamadaQ->pcPeso[i * ptCamadaQ->iStride + k] = (signed char) QuantizarValor((float) (pdPeso[k] *
+            ptCamadaQ->pfEscalaEntrada[k] / ptCamadaQ->pfEscalaPeso[i]));
+    }
+  }
+
+  // Finalizacao
+  for (l = 0; l < ptRede->iNumCamadas; l++) {
+    free(vpdMinimo[l]);
+    free(vpdMaximo[l]);
+  }
+  LiberarSaidasRede(ptRede, ppdSaida);
+  if (!iOk) {
+    fprintf(stderr, "ERRO: Memoria insuficiente para a calibracao\n");
+    DestruirRedeQuantizada(ptQuantizada);
+  }
+  return iOk;
+}
+
+
+void DestruirRedeQuantizada(TRedeQuantizada *ptQuantizada)
+{
+  int l;
+
+  for (l = 0; l < ptQuantizada->iNumCamadas; l++) {
+    if (ptQuantizada->vtCamadas[l].pfCentro != NULL)
+      LiberarAlinhado(ptQuantizada->vtCamadas[l].pfCentro);
+    if (ptQuantizada->vtCamadas[l].pcPeso != NULL)
+      LiberarAlinhado(ptQuantizada->vtCamadas[l].pcPeso);
+  }
+  memset(ptQuantizada, 0, sizeof(TRedeQuantizada));
+}
+
+
+int ArquivoQuantizado(const char *szNomeArquivo)
+{
+  char vcAssinatura[4];
+  FILE *fp = NULL;
+  int iQuantizado;
+
+  if ((fp = fopen(szNomeArquivo, "rb")) == NULL)
+    return 0;
+  iQuantizado = (fread(vcAssinatura, 1, 4, fp) == 4 && !memcmp(vcAssinatura, ASSINATURA_QUANTIZADA, 4));
+  fclose(fp);
+  return iQuantizado;
+}
+
+
+int CarregarRedeQuantizada(TRedeQuantizada *ptQuantizada, const char *szNomeArquivo)
+{
+  TCabecalhoQuantizada tCabecalho;
+  const unsigned int *puiDescritor;
+  int viNeuronios[MAX_CAMADAS], viAtivacoes[MAX_CAMADAS];
+  unsigned long long ulEsperado;
+  char *pcDados = NULL, *pcPosicao;
+  FILE *fp = NULL;
+  long lTamanho;
+  int i, k, l, iEntradas, iOk;
+  TCamadaQuantizada *ptCamada;
+
+  // Le o arquivo inteiro (poucos kilobytes) e valida o cabecalho, o tamanho e a soma de verificacao
+  memset(ptQuantizada, 0, sizeof(TRedeQuantizada));
+  if ((fp = fopen(szNomeArquivo, "rb")) == NULL)
+    return 0;
+  iOk = (fseek(fp, 0, SEEK_END) == 0 && (lTamanho = ftell(fp)) >= (long) sizeof(TCabecalhoQuantizada) &&
+      fseek(fp, 0, SEEK_SET) == 0 && (pcDados = (char*) malloc((size_t) lTamanho)) != NULL &&
+      fread(pcDados, 1, (size_t) lTamanho, fp) == (size_t) lTamanho);
+  fclose(fp);
+  if (iOk) {
+    memcpy(&tCabecalho, pcDados, sizeof(TCabecalhoQuantizada));
+    iOk = (!memcmp(tCabecalho.vcAssinatura, ASSINATURA_QUANTIZADA, 4) && tCabecalho.uiVersao == VERSAO_QUANTIZADA &&
+        tCabecalho.ulTamanho == (unsigned long long) lTamanho && tCabecalho.uiNumEntradas >= 1 &&
+        tCabecalho.uiNumCamadas >= 1 && tCabecalho.uiNumCamadas <= MAX_CAMADAS &&
+        sizeof(TCabecalhoQuantizada) + 2 * sizeof(unsigned int) * tCabecalho.uiNumCamadas <= (size_t) lTamanho &&
+        SomaVerificacao(FNV_INICIAL, pcDados + sizeof(TCabecalhoQuantizada), (size_t) lTamanho -
+        sizeof(TCabecalhoQuantizada)) == tCabecalho.ulSoma);
+  }
+
+  // Valida as camadas e o tamanho esperado dos dados
+  puiDescritor = (const unsigned int*) (pcDados + sizeof(TCabecalhoQuantizada));
+  ulEsperado = sizeof(TCabecalhoQuantizada) + 2 * sizeof(unsigned int) * (iOk ? tCabecalho.uiNumCamadas : 0);
+  for (l = 0, iEntradas = (iOk ? (int) tCabecalho.uiNumEntradas : 0); iOk && l < (int) tCabecalho.uiNumCamadas; l++) {
+    viNeuronios[l] = (int) puiDescritor[2 * l];
+    viAtivacoes[l] = (int) puiDescritor[2 * l + 1];
+    iOk = (viNeuronios[l] >= 1 && viAtivacoes[l] >= 0 && viAtivacoes[l] < NUM_ATIVACOES);
+    ulEsperado += sizeof(float) * (2ULL * iEntradas + 2ULL * viNeuronios[l]) + (unsigned long long) viNeuronios[l] *
+        iEntradas;
+    iEntradas = viNeuronios[l];
+  }
+  if (!iOk || ulEsperado != (unsigned long long) lTamanho || !CriarRedeQuantizada(ptQuantizada,
+      (int) tCabecalho.uiNumEntradas, (int) tCabecalho.uiNumCamadas, viNeuronios, viAtivacoes)) {
+    free(pcDados);
+    return 0;
+  }
+
+  // Copia os parametros e os pesos (as linhas int8 recebem o padding zerado)
+  pcPosicao = pcDados + sizeof(TCabecalhoQuantizada) + 2 * sizeof(unsigned int) * tCabecalho.uiNumCamadas;
+  for (l = 0; l < ptQuantizada->iNumCamadas; l++) {
+    ptCamada = &ptQuantizada->vtCamadas[l];
+    memcpy(ptCamada->pfCentro, pcPosicao, sizeof(float) * ptCamada->iNumEntradas);
+    pcPosicao += sizeof(float) * ptCamada->iNumEntradas;
+    memcpy(ptCamada->pfEscalaEntrada, pcPosicao, sizeof(float) * ptCamada->iNumEntradas);
+    pcPosicao += sizeof(float) * ptCamada->iNumEntradas;
+    memcpy(ptCamada->pfEscalaPeso, pcPosicao, sizeof(float) * 2 * ptCamada->iNumNeuronios);
+    pcPosicao += sizeof(float) * 2 * ptCamada->iNumNeuronios;
+    for (i = 0; i < ptCamada->iNumNeuronios; i++, pcPosicao += ptCamada->iNumEntradas)
+      memcpy(&ptCamada->pcPeso[i * ptCamada->iStride], pcPosicao, ptCamada->iNumEntradas);
+    for (k = 0; k < ptCamada->iNumEntradas; k++)
+      ptCamada->pfInversoEntrada[k] = 1.0f / ptCamada->pfEscalaEntrada[k];
+  }
+  free(pcDados);
+  return 1;
+}
+
+
+static int EscreverBloco(FILE *fp, const void *pDados, size_t tamanho, unsigned long long *pulSoma)
+{
+  *pulSoma = SomaVerificacao(*pulSoma, pDados, tamanho);
+  return (fwrite(pDados, 1, tamanho, fp) == tamanho);
+}
+
+
+int SalvarRedeQuantizada(const TRedeQuantizada *ptQuantizada, const char *szNomeArquivo)
+{
+  TCabecalhoQuantizada tCabecalho;
+  unsigned int vuiDescritor[2 * MAX_CAMADAS];
+  const TCamadaQuantizada *ptCamada;
+  FILE *fp = NULL;
+  int i, l, iOk;
+
+  // Cabecalho (regravado no final com a soma de verificacao) e descritores das camadas
+  if ((fp = fopen(szNomeArquivo, "wb")) == NULL)
+    return 0;
+  memset(&tCabecalho, 0, sizeof(TCabecalhoQuantizada));
+  memcpy(tCabecalho.vcAssinatura, ASSINATURA_QUANTIZADA, 4);
+  tCabecalho.uiVersao = VERSAO_QUANTIZADA;
+  tCabecalho.uiNumEntradas = (unsigned int) ptQuantizada->iNumEntradas;
+  tCabecalho.uiNumCamadas = (unsigned int) ptQuantizada->iNumCamadas;
+  tCabecalho.ulTamanho = sizeof(TCabecalhoQuantizada) + 2 * sizeof(unsigned int) * ptQuantizada->iNumCamadas;
+  for (l = 0; l < ptQuantizada->iNumCamadas; l++) {
+    ptCamada = &ptQuantizada->vtCamadas[l];
+    vuiDescritor[2 * l] = (unsigned int) ptCamada->iNumNeuronios;
+    vuiDescritor[2 * l + 1] = (unsigned int) ptCamada->iAtivacao;
+    tCabecalho.ulTamanho += sizeof(float) * (2ULL * ptCamada->iNumEntradas + 2ULL * ptCamada->iNumNeuronios) +
+        (unsigned long long) ptCamada->iNumNeuronios * ptCamada->iNumEntradas;
+  }
+  tCabecalho.ulSoma = FNV_INICIAL;
+  iOk = (fwrite(&tCabecalho, sizeof(TCabecalhoQuantizada), 1, fp) == 1);
+  iOk = iOk && EscreverBloco(fp, vuiDescritor, 2 * sizeof(unsigned int) * ptQuantizada->iNumCamadas,
+      &tCabecalho.ulSoma);
+
+  // Parametros e pesos de cada camada (as linhas sem o padding)
+  for (l = 0; iOk && l < ptQuantizada->iNumCamadas; l++) {
+    ptCamada = &ptQuantizada->vtCamadas[l];
+    iOk = EscreverBloco(fp, ptCamada->pfCentro, sizeof(float) * ptCamada->iNumEntradas, &tCabecalho.ulSoma);
+    iOk = iOk && EscreverBloco(fp, ptCamada->pfEscalaEntrada, sizeof(float) * ptCamada->iNumEntradas,
+        &tCabecalho.ulSoma);
+    iOk = iOk && EscreverBloco(fp, ptCamada->pfEscalaPeso, sizeof(float) * 2 * ptCamada->iNumNeuronios,
+        &tCabecalho.ulSoma);
+    for (i = 0; iOk && i < ptCamada->iNumNeuronios; i++)
+      iOk = EscreverBloco(fp, &ptCamada->pcPeso[i * ptCamada->iStride], ptCamada->iNumEntradas, &tCabecalho.ulSoma);
+  }
+  iOk = (iOk && fseek(fp, 0, SEEK_SET) == 0 && fwrite(&tCabecalho, sizeof(TCabecalhoQuantizada), 1, fp) == 1);
+  if (fclose(fp) != 0)
+    iOk = 0;
+  return iOk;
+}
+
+
+size_t MemoriaRedeQuantizada(const TRedeQuantizada *ptQuantizada)
+{
+  size_t tamanho = 0;
+  int l;
+
+  // Bytes lidos por uma ativacao: pesos int8 (com o padding) e parametros em float
+  for (l = 0; l < ptQuantizada->iNumCamadas; l++)
+    tamanho += (size_t) ptQuantizada->vtCamadas[l].iNumNeuronios * ptQuantizada->vtCamadas[l].iStride +
+        sizeof(float) * (3 * ptQuantizada->vtCamadas[l].iNumEntradas + 2 * ptQuantizada->vtCamadas[l].iNumNeuronios);
+  return tamanho;
+}
+
+
+TReal **AlocarSaidasQuantizada(const TRedeQuantizada *ptQuantizada)
+{
+  TReal **ppdSaida;
+  int l;
+
+  // Um vetor de ativacoes por camada, como em AlocarSaidasRede
+  ppdSaida = (TReal**) malloc(sizeof(TReal*) * ptQuantizada->iNumCamadas);
+  for (l = 0; l < ptQuantizada->iNumCamadas; l++)
+    ppdSaida[l] = (TReal*) AlocarAlinhado(sizeof(TReal) * STRIDE(ptQuantizada->vtCamadas[l].iNumNeuronios + 1));
+  return ppdSaida;
+}
+
+
+void LiberarSaidasQuantizada(const TRedeQuantizada *ptQuantizada, TReal **ppdSaida)
+{
+  int l;
+
+  if (ppdSaida != NULL) {
+    for (l = 0; l < ptQuantizada->iNumCamadas; l++)
+      LiberarAlinhado(ppdSaida[l]);
+    free(ppdSaida);
+  }
+}
+
+
+int TamanhoTrabalhoQuantizado(const TRedeQuantizada *ptQuantizada)
+{
+  // Entradas quantizadas da camada mais larga (o padding pode conter lixo: os pesos do padding sao zero)
+  // seguidas, a partir de um multiplo de ALINHAMENTO, das somas inteiras da camada com mais neuronios
+  return ((ptQuantizada->iMaiorStride + ALINHAMENTO - 1) / ALINHAMENTO) * ALINHAMENTO +
+      (int) sizeof(int) * ptQuantizada->iMaiorCamada;
+}
+
+
+void AtivarRedeQuantizada(const TRedeQuantizada *ptQuantizada, const TReal *pdEntrada, signed char *pcTrabalho,
+    TReal **ppdSaida)
+{
+  register int i;
+  int l;
+  int *piSoma = (int*) &pcTrabalho[((ptQuantizada->iMaiorStride + ALINHAMENTO - 1) / ALINHAMENTO) * ALINHAMENTO];
+  const TReal *pdAnterior = pdEntrada;
+  const TCamadaQuantizada *ptCamada;
+
+  // Quantiza as entradas de cada camada, acumula os produtos em inteiros e volta a escala real para a ativacao
+  for (l = 0; l < ptQuantizada->iNumCamadas; l++) {
+    ptCamada = &ptQuantizada->vtCamadas[l];
+    QuantizarInt8(pcTrabalho, pdAnterior, ptCamada->pfCentro, ptCamada->pfInversoEntrada, ptCamada->iNumEntradas);
+    ProdutoMatrizInt8(piSoma, ptCamada->pcPeso, pcTrabalho, ptCamada->iNumNeuronios, ptCamada->iStride);
+    for (i = 0; i < ptCamada->iNumNeuronios; i++)
+      ppdSaida[l][i] = (TReal) (ptCamada->pfEscalaPeso[i] * (float) piSoma[i] + ptCamada->pfBias[i]);
+    AplicarAtivacao(ptCamada->iAtivacao, ppdSaida[l], ptCamada->iNumNeuronios);
+    pdAnterior = ppdSaida[l];
+  }
+}
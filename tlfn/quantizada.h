@@ -0,0 +1,83 @@
+//************************************************************************************************
+//* UNIVERSIDADE FEDERAL DO RIO GRANDE DO SUL (UFRGS) - Campus do Vale                          **
+//* Doutorado em Ciencia da Computacao - PPGC                                                   **
+//* Doutorando: Milton Roberto Heinen - 00145752                                                **
+//* Orientador: Paulo Martins Engel                                                             **
+//* Rede quantizada em int8 (calibracao, arquivo .wtsq e inferencia) para o tlfn e o stlfn      **
+//************************************************************************************************
+#ifndef QUANTIZADA_H
+#define QUANTIZADA_H
+
+#include <stddef.h>
+#include "vetorial.h"
+#include "rede.h"
+
+
+//************************************** Constantes **********************************************
+#define ASSINATURA_QUANTIZADA "WTSQ"
+#define VERSAO_QUANTIZADA 1
+#define EXTENSAO_QUANTIZADA "q"
+#define LIMITE_INT8 127
+#define GRANULO_INT8 16
+
+
+//**************************************** Macros ************************************************
+// Linhas de pesos int8 com padding zerado ate um multiplo de GRANULO_INT8 bytes (sem resto nos kernels AVX2)
+#define STRIDE_INT8(n) ((((n) + GRANULO_INT8 - 1) / GRANULO_INT8) * GRANULO_INT8)
+
+
+//************************************ Tipos de dados ********************************************
+// Camada quantizada: a entrada k e aproximada por pfCentro[k] + pfEscalaEntrada[k] * q (q int8, escala
+// calibrada por entrada) e o neuronio i por pfEscalaPeso[i] * soma(pcPeso[i][k] * q[k]) + pfBias[i]
+// (as escalas das entradas ja estao nos pesos int8 e os centros no bias)
+typedef struct {
+  int iNumEntradas;
+  int iNumNeuronios;
+  int iStride;
+  int iAtivacao;
+  float *pfCentro;
+  float *pfEscalaEntrada;
+  float *pfInversoEntrada;
+  float *pfEscalaPeso;
+  float *pfBias;
+  signed char *pcPeso;
+} TCamadaQuantizada;
+
+// iMaiorStride e iMaiorCamada dimensionam a area de trabalho da ativacao
+typedef struct {
+  int iNumEntradas;
+  int iNumSaidas;
+  int iNumCamadas;
+  int iMaiorStride;
+  int iMaiorCamada;
+  TCamadaQuantizada vtCamadas[MAX_CAMADAS];
+} TRedeQuantizada;
+
+// Cabecalho de 64 bytes do arquivo .wtsq (little endian), seguido de (neuronios, ativacao) por camada e,
+// para cada camada, centros, escalas das entradas, escalas dos pesos e bias (float) e os pesos int8 sem
+// padding; ulSoma e o FNV-1a de 64 bits de tudo apos o cabecalho
+typedef struct {
+  char vcAssinatura[4];
+  unsigned int uiVersao;
+  unsigned int uiNumEntradas;
+  unsigned int uiNumCamadas;
+  unsigned long long ulTamanho;
+  unsigned long long ulSoma;
+  char vcReservado[32];
+} TCabecalhoQuantizada;
+
+
+//************************************** Prototipos **********************************************
+int QuantizarRede(TRedeQuantizada *ptQuantizada, const TRede *ptRede, TReal **ppdRegistros, const int iNumRegistros);
+void DestruirRedeQuantizada(TRedeQuantizada *ptQuantizada);
+int ArquivoQuantizado(const char *szNomeArquivo);
+int CarregarRedeQuantizada(TRedeQuantizada *ptQuantizada, const char *szNomeArquivo);
+int SalvarRedeQuantizada(const TRedeQuantizada *ptQuantizada, const char *szNomeArquivo);
+size_t MemoriaRedeQuantizada(const TRedeQuantizada *ptQuantizada);
+TReal **AlocarSaidasQuantizada(const TRedeQuantizada *ptQuantizada);
+void LiberarSaidasQuantizada(const TRedeQuantizada *ptQuantizada, TReal **ppdSaida);
+int TamanhoTrabalhoQuantizado(const TRedeQuantizada *ptQuantizada);
+void AtivarRedeQuantizada(const TRedeQuantizada *ptQuantizada, const TReal *pdEntrada, signed char *pcTrabalho,
+    TReal **ppdSaida);
+
+#endif
@@ -0,0 +1,797 @@
+//************************************************************************************************
+//* UNIVERSIDADE FEDERAL DO RIO GRANDE DO SUL (UFRGS) - Campus do Vale                          **
+//* Doutorado em Ciencia da Computacao - PPGC                                                   **
+//* Doutorando: Milton Roberto Heinen - 00145752                                                **
+//* Orientador: Paulo Martins Engel                                                             **
+//* Rede multicamadas (MLP) compartilhada pelo treinamento (tlfn) e pela inferencia (stlfn)     **
+//************************************************************************************************
+
+//*************************************** Includes ***********************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "rede.h"
+#include "vetorial.h"
+#ifdef _WIN32
+#include <malloc.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+
+//************************************** Constantes **********************************************
+#define MAX_PALAVRA 64
+#define FNV_PRIMO 0x100000001b3ULL
+
+
+//**************************************** Macros ************************************************
+#define ALINHAR(n) ((((n) + ALINHAMENTO - 1) / ALINHAMENTO) * ALINHAMENTO)
+
+
+//*********************************** Variaveis locais *******************************************
+static const char *vszNomesAtivacao[NUM_ATIVACOES] = { "linear", "tanh", "tanh_rapida" };
+
+
+//************************************** Prototipos **********************************************
+static int ArquivoPesosBinario(const char *szNomeArquivo);
+static int CarregarRedeBinaria(TRede *ptRede, const char *szNomeArquivo);
+static int EscreverBinario(FILE *fp, const void *pDados, size_t tamanho, unsigned long long *pulSoma);
+static void *MapearPesos(TRede *ptRede, const char *szNomeArquivo);
+static void DesmapearPesos(TRede *ptRede);
+
+
+//*************************************** Funcoes ************************************************
+void *AlocarAlinhado(size_t tamanho)
+{
+  void *pMemoria = NULL;
+
+  // Aloca um bloco alinhado em linha de cache e zerado (o padding das linhas fica em zero)
+  tamanho = ((tamanho + ALINHAMENTO - 1) / ALINHAMENTO) * ALINHAMENTO;
+#ifdef _WIN32
+  pMemoria = _aligned_malloc(tamanho, ALINHAMENTO);
+#else
+  if (posix_memalign(&pMemoria, ALINHAMENTO, tamanho))
+    pMemoria = NULL;
+#endif
+  if (pMemoria != NULL)
+    memset(pMemoria, 0, tamanho);
+  return pMemoria;
+}
+
+
+void LiberarAlinhado(void *pMemoria)
+{
+#ifdef _WIN32
+  _aligned_free(pMemoria);
+#else
+  free(pMemoria);
+#endif
+}
+
+
+int CriarRede(TRede *ptRede, const int iNumEntradas, const int iNumCamadas, const int *piNeuronios,
+    const int *piAtivacoes)
+{
+  int l;
+  TCamada *ptCamada;
+
+  // Valida a topologia
+  memset(ptRede, 0, sizeof(TRede));
+  if (iNumEntradas < 1 || iNumCamadas < 1 || iNumCamadas > MAX_CAMADAS)
+    return 0;
+  for (l = 0; l < iNumCamadas; l++) {
+    if (piNeuronios[l] < 1 || piAtivacoes[l] < 0 || piAtivacoes[l] >= NUM_ATIVACOES)
+      return 0;
+  }
+
+  // Cada camada recebe as saidas da anterior (a primeira recebe as entradas da rede)
+  ptRede->iNumEntradas = iNumEntradas;
+  ptRede->iNumCamadas = iNumCamadas;
+  ptRede->iNumSaidas = piNeuronios[iNumCamadas - 1];
+  for (l = 0; l < iNumCamadas; l++) {
+    ptCamada = &ptRede->vtCamadas[l];
+    ptCamada->iNumEntradas = (l ? piNeuronios[l - 1] : iNumEntradas);
+    ptCamada->iNumNeuronios = piNeuronios[l];
+    ptCamada->iStride = STRIDE(ptCamada->iNumEntradas + 1);
+    ptCamada->iAtivacao = piAtivacoes[l];
+    ptCamada->pdPeso = (TReal*) AlocarAlinhado(sizeof(TReal) * ptCamada->iNumNeuronios * ptCamada->iStride);
+    if (ptCamada->pdPeso == NULL) {
+      DestruirRede(ptRede);
+      return 0;
+    }
+  }
+  return 1;
+}
+
+
+void DestruirRede(TRede *ptRede)
+{
+  int l;
+
+  // Desaloca as matrizes de pesos de todas as camadas (as mapeadas sao liberadas com o arquivo)
+  LiberarPesosMestres(ptRede);
+  LiberarEstadoAjuste(ptRede);
+  if (ptRede->pMapeamento != NULL) {
+    for (l = 0; l < MAX_CAMADAS; l++)
+      ptRede->vtCamadas[l].pdPeso = NULL;
+    DesmapearPesos(ptRede);
+  }
+  for (l = 0; l < MAX_CAMADAS; l++) {
+    if (ptRede->vtCamadas[l].pdPeso != NULL) {
+      LiberarAlinhado(ptRede->vtCamadas[l].pdPeso);
+      ptRede->vtCamadas[l].pdPeso = NULL;
+    }
+  }
+  ptRede->iNumCamadas = 0;
+}
+
+
+int CopiarRede(TRede *ptDestino, const TRede *ptOrigem)
+{
+  int l, iRecriar = (ptDestino->iNumCamadas != ptOrigem->iNumCamadas ||
+      ptDestino->iNumEntradas != ptOrigem->iNumEntradas || ptDestino->pMapeamento != NULL);
+  int viNeuronios[MAX_CAMADAS], viAtivacoes[MAX_CAMADAS];
+  const TCamada *ptCamada;
+
+  // Recria o destino (inicializado com zeros ou ja criado) apenas se a topologia for diferente ou
+  // se os pesos do destino forem mapeados (somente leitura)
+  for (l = 0; l < ptOrigem->iNumCamadas; l++) {
+    ptCamada = &ptOrigem->vtCamadas[l];
+    viNeuronios[l] = ptCamada->iNumNeuronios;
+    viAtivacoes[l] = ptCamada->iAtivacao;
+    iRecriar = iRecriar || ptDestino->vtCamadas[l].iNumNeuronios != ptCamada->iNumNeuronios ||
+        ptDestino->vtCamadas[l].iAtivacao != ptCamada->iAtivacao ||
+        (ptDestino->vtCamadas[l].pdMestre == NULL) != (ptCamada->pdMestre == NULL);
+  }
+  if (iRecriar) {
+    DestruirRede(ptDestino);
+    if (!CriarRede(ptDestino, ptOrigem->iNumEntradas, ptOrigem->iNumCamadas, viNeuronios, viAtivacoes))
+      return 0;
+    if (ptOrigem->vtCamadas[0].pdMestre != NULL && !CriarPesosMestres(ptDestino)) {
+      DestruirRede(ptDestino);
+      return 0;
+    }
+  }
+
+  // Copia os pesos (e as copias mestres) de cada camada
+  for (l = 0; l < ptOrigem->iNumCamadas; l++) {
+    ptCamada = &ptOrigem->vtCamadas[l];
+    memcpy(ptDestino->vtCamadas[l].pdPeso, ptCamada->pdPeso,
+        sizeof(TReal) * ptCamada->iNumNeuronios * ptCamada->iStride);
+    if (ptCamada->pdMestre != NULL)
+      memcpy(ptDestino->vtCamadas[l].pdMestre, ptCamada->pdMestre,
+          sizeof(double) * ptCamada->iNumNeuronios * ptCamada->iStride);
+  }
+  return 1;
+}
+
+
+int CriarPesosMestres(TRede *ptRede)
+{
+  int i, l;
+  TCamada *ptCamada;
+
+  // Copia em double dos pesos atuais de cada camada
+  for (l = 0; l < ptRede->iNumCamadas; l++) {
+    ptCamada = &ptRede->vtCamadas[l];
+    ptCamada->pdMestre = (double*) AlocarAlinhado(sizeof(double) * ptCamada->iNumNeuronios * ptCamada->iStride);
+    if (ptCamada->pdMestre == NULL) {
+      LiberarPesosMestres(ptRede);
+      return 0;
+    }
+    for (i = 0; i < ptCamada->iNumNeuronios * ptCamada->iStride; i++)
+      ptCamada->pdMestre[i] = ptCamada->pdPeso[i];
+  }
+  return 1;
+}
+
+
+void LiberarPesosMestres(TRede *ptRede)
+{
+  int l;
+
+  for (l = 0; l < MAX_CAMADAS; l++) {
+    if (ptRede->vtCamadas[l].pdMestre != NULL) {
+      LiberarAlinhado(ptRede->vtCamadas[l].pdMestre);
+      ptRede->vtCamadas[l].pdMestre = NULL;
+    }
+  }
+}
+
+
+void SomarEscaladoMestre(double *pdMestre, TReal *pdPeso, double dA, const TReal *pdX, int iN)
+{
+  register int i;
+
+  // O ajuste acumula na copia em double e o peso usado na propagacao recebe o valor arredondado
+  for (i = 0; i < iN; i++) {
+    pdMestre[i] += dA * pdX[i];
+    pdPeso[i] = (TReal) pdMestre[i];
+  }
+}
+
+
+int CriarEstadoAjuste(TRede *ptRede, const int iNumBuffers)
+{
+  int l, iTamanho;
+  TCamada *ptCamada;
+
+  // Um bloco alinhado por camada com iNumBuffers matrizes zeradas (velocidade e segundo momento),
+  // cada uma com o layout da matriz de pesos
+  LiberarEstadoAjuste(ptRede);
+  for (l = 0; l < ptRede->iNumCamadas; l++) {
+    ptCamada = &ptRede->vtCamadas[l];
+    iTamanho = ptCamada->iNumNeuronios * ptCamada->iStride;
+    ptCamada->pdVelocidade = (TReal*) AlocarAlinhado(sizeof(TReal) * iTamanho * iNumBuffers);
+    if (ptCamada->pdVelocidade == NULL) {
+      LiberarEstadoAjuste(ptRede);
+      return 0;
+    }
+    memset(ptCamada->pdVelocidade, 0, sizeof(TReal) * iTamanho * iNumBuffers);
+    if (iNumBuffers > 1)
+      ptCamada->pdSegundoMomento = &ptCamada->pdVelocidade[iTamanho];
+  }
+  return 1;
+}
+
+
+void LiberarEstadoAjuste(TRede *ptRede)
+{
+  int l;
+
+  for (l = 0; l < MAX_CAMADAS; l++) {
+    if (ptRede->vtCamadas[l].pdVelocidade != NULL) {
+      LiberarAlinhado(ptRede->vtCamadas[l].pdVelocidade);
+      ptRede->vtCamadas[l].pdVelocidade = NULL;
+      ptRede->vtCamadas[l].pdSegundoMomento = NULL;
+    }
+  }
+}
+
+
+void AjustarMomentoMestre(double *pdMestre, TReal *pdPeso, TReal *pdV, double dMomento, double dFatorV, double dFatorG,
+    double dA, const TReal *pdX, int iN)
+{
+  register int i;
+  double dG;
+
+  // Como AjustarMomento, acumulando o passo na copia em double
+  for (i = 0; i < iN; i++) {
+    dG = dA * pdX[i];
+    pdV[i] = (TReal) (dMomento * pdV[i] + dG);
+    pdMestre[i] += dFatorV * pdV[i] + dFatorG * dG;
+    pdPeso[i] = (TReal) pdMestre[i];
+  }
+}
+
+
+void AjustarAdamMestre(double *pdMestre, TReal *pdPeso, TReal *pdM, TReal *pdV, double dBeta1, double dBeta2,
+    double dTaxa, double dEpsilon, double dA, const TReal *pdX, int iN)
+{
+  register int i;
+  double dG;
+
+  // Como AjustarAdam, acumulando o passo na copia em double
+  for (i = 0; i < iN; i++) {
+    dG = dA * pdX[i];
+    pdM[i] = (TReal) (dBeta1 * pdM[i] + (1.0 - dBeta1) * dG);
+    pdV[i] = (TReal) (dBeta2 * pdV[i] + (1.0 - dBeta2) * dG * dG);
+    pdMestre[i] += dTaxa * (pdM[i] / (sqrt(pdV[i]) + dEpsilon));
+    pdPeso[i] = (TReal) pdMestre[i];
+  }
+}
+
+
+int CarregarRede(TRede *ptRede, const char *szNomeArquivo)
+{
+  FILE *fp = NULL;
+  char vcPalavra[MAX_PALAVRA + 1];
+  int viNeuronios[MAX_CAMADAS], viAtivacoes[MAX_CAMADAS];
+  int i, j, l, iVersao, iNumEntradas, iNumCamadas;
+  double dPeso;
+  TCamada *ptCamada;
+
+  // O arquivo binario e identificado pela assinatura e mapeado
+  if (ArquivoPesosBinario(szNomeArquivo))
+    return CarregarRedeBinaria(ptRede, szNomeArquivo);
+
+  // Abre o arquivo texto
+  memset(ptRede, 0, sizeof(TRede));
+  if ((fp = fopen(szNomeArquivo, "r")) == NULL)
+    return 0;
+  if (fscanf(fp, "%64s", vcPalavra) != 1) {
+    fclose(fp);
+    return 0;
+  }
+
+  if (!strcmp(vcPalavra, "TLFN")) {
+    // Cabecalho versionado: "TLFN versao", "entradas camadas n1 .. nL" e o nome da ativacao de cada camada
+    if (fscanf(fp, "%d %d %d", &iVersao, &iNumEntradas, &iNumCamadas) != 3 || iVersao != VERSAO_PESOS ||
+        iNumCamadas < 1 || iNumCamadas > MAX_CAMADAS) {
+      fclose(fp);
+      return 0;
+    }
+    for (l = 0; l < iNumCamadas; l++) {
+      if (fscanf(fp, "%d", &viNeuronios[l]) != 1) {
+        fclose(fp);
+        return 0;
+      }
+    }
+    for (l = 0; l < iNumCamadas; l++) {
+      if (fscanf(fp, "%64s", vcPalavra) != 1 || (viAtivacoes[l] = CodigoAtivacao(vcPalavra)) < 0) {
+        fclose(fp);
+        return 0;
+      }
+    }
+  }
+  else {
+    // Cabecalho antigo "entradas ocultos saidas": uma camada oculta tanh e saidas lineares
+    iNumEntradas = atoi(vcPalavra);
+    iNumCamadas = 2;
+    if (fscanf(fp, "%d %d", &viNeuronios[0], &viNeuronios[1]) != 2) {
+      fclose(fp);
+      return 0;
+    }
+    viAtivacoes[0] = ATIVACAO_TANH;
+    viAtivacoes[1] = ATIVACAO_LINEAR;
+  }
+  if (!CriarRede(ptRede, iNumEntradas, iNumCamadas, viNeuronios, viAtivacoes)) {
+    fclose(fp);
+    return 0;
+  }
+
+  // Carrega os pesos de cada camada, uma linha por neuronio com o bias no final
+  for (l = 0; l < ptRede->iNumCamadas; l++) {
+    ptCamada = &ptRede->vtCamadas[l];
+    for (i = 0; i < ptCamada->iNumNeuronios; i++) {
+      for (j = 0; j <= ptCamada->iNumEntradas; j++) {
+        if (fscanf(fp, "%lf", &dPeso) != 1) {
+          fclose(fp);
+          DestruirRede(ptRede);
+          return 0;
+        }
+        ptCamada->pdPeso[i * ptCamada->iStride + j] = (TReal) dPeso;
+      }
+    }
+  }
+  fclose(fp);
+  return 1;
+}
+
+
+int SalvarRede(const TRede *ptRede, const char *szNomeArquivo)
+{
+  FILE *fp = NULL;
+
+  // Salva a topologia e os pesos
+  if ((fp = fopen(szNomeArquivo, "w")) == NULL)
+    return 0;
+  EscreverRede(ptRede, fp);
+  fclose(fp);
+  return 1;
+}
+
+
+void EscreverRede(const TRede *ptRede, FILE *fp)
+{
+  int i, j, l;
+  const TCamada *ptCamada;
+
+  // Escreve o cabecalho versionado
+  fprintf(fp, "TLFN %d\n%d %d", VERSAO_PESOS, ptRede->iNumEntradas, ptRede->iNumCamadas);
+  for (l = 0; l < ptRede->iNumCamadas; l++)
+    fprintf(fp, " %d", ptRede->vtCamadas[l].iNumNeuronios);
+  fprintf(fp, "\n");
+  for (l = 0; l < ptRede->iNumCamadas; l++)
+    fprintf(fp, "%s%s", (l ? " " : ""), NomeAtivacao(ptRede->vtCamadas[l].iAtivacao));
+  fprintf(fp, "\n");
+
+  // Escreve os pesos de cada camada (a copia mestre, se existir)
+  for (l = 0; l < ptRede->iNumCamadas; l++) {
+    ptCamada = &ptRede->vtCamadas[l];
+    for (i = 0; i < ptCamada->iNumNeuronios; i++) {
+      for (j = 0; j <= ptCamada->iNumEntradas; j++)
+        fprintf(fp, "%.8f ", (ptCamada->pdMestre != NULL ? ptCamada->pdMestre[i * ptCamada->iStride + j] :
+            (double) ptCamada->pdPeso[i * ptCamada->iStride + j]));
+      fprintf(fp, "\n");
+    }
+  }
+}
+
+
+unsigned long long SomaVerificacao(unsigned long long ulSoma, const void *pDados, size_t tamanho)
+{
+  const unsigned char *pcDados = (const unsigned char*) pDados;
+  size_t i;
+
+  // FNV-1a de 64 bits, acumulado a partir de ulSoma
+  for (i = 0; i < tamanho; i++)
+    ulSoma = (ulSoma ^ pcDados[i]) * FNV_PRIMO;
+  return ulSoma;
+}
+
+
+static int ArquivoPesosBinario(const char *szNomeArquivo)
+{
+  char vcAssinatura[4];
+  FILE *fp = NULL;
+  int iBinario;
+
+  if ((fp = fopen(szNomeArquivo, "rb")) == NULL)
+    return 0;
+  iBinario = (fread(vcAssinatura, 1, 4, fp) == 4 && !memcmp(vcAssinatura, ASSINATURA_PESOS, 4));
+  fclose(fp);
+  return iBinario;
+}
+
+
+static int CarregarRedeBinaria(TRede *ptRede, const char *szNomeArquivo)
+{
+  TRede tMapa;
+  const TCabecalhoPesos *ptCabecalho = NULL;
+  const TDescritorCamada *ptDescritor = NULL;
+  const char *pcDados = NULL;
+  int viNeuronios[MAX_CAMADAS], viAtivacoes[MAX_CAMADAS];
+  int i, j, l, iNumEntradas, iDireto = 1;
+  TCamada *ptCamada;
+
+  // Mapeia o arquivo inteiro (somente leitura e compartilhado entre os processos)
+  memset(ptRede, 0, sizeof(TRede));
+  memset(&tMapa, 0, sizeof(TRede));
+  if ((ptCabecalho = (const TCabecalhoPesos*) MapearPesos(&tMapa, szNomeArquivo)) == NULL)
+    return 0;
+  pcDados = (const char*) ptCabecalho;
+  ptDescritor = (const TDescritorCamada*) (pcDados + sizeof(TCabecalhoPesos));
+
+  // Valida o cabecalho, o tamanho e a soma de verificacao
+  if (tMapa.tamMapeamento < sizeof(TCabecalhoPesos) || memcmp(ptCabecalho->vcAssinatura, ASSINATURA_PESOS, 4) ||
+      ptCabecalho->uiVersao != VERSAO_PESOS_BINARIO || ptCabecalho->ulTamanho != tMapa.tamMapeamento ||
+      (ptCabecalho->uiTipo != sizeof(float) && ptCabecalho->uiTipo != sizeof(double)) ||
+      ptCabecalho->uiNumEntradas < 1 || ptCabecalho->uiNumCamadas < 1 || ptCabecalho->uiNumCamadas > MAX_CAMADAS ||
+      sizeof(TCabecalhoPesos) + ptCabecalho->uiNumCamadas * sizeof(TDescritorCamada) > tMapa.tamMapeamento ||
+      SomaVerificacao(FNV_INICIAL, pcDados + sizeof(TCabecalhoPesos), tMapa.tamMapeamento - sizeof(TCabecalhoPesos)) !=
+      ptCabecalho->ulSoma) {
+    DesmapearPesos(&tMapa);
+    return 0;
+  }
+
+  // Valida as camadas; os pesos sao usados direto das paginas mapeadas se a precisao e o stride coincidem
+  iNumEntradas = (int) ptCabecalho->uiNumEntradas;
+  for (l = 0; l < (int) ptCabecalho->uiNumCamadas; l++) {
+    if (ptDescritor[l].uiNumNeuronios < 1 || ptDescritor[l].uiAtivacao >= NUM_ATIVACOES ||
+        ptDescritor[l].uiStride < (unsigned int) iNumEntradas + 1 || ptDescritor[l].ulDeslocamento % ALINHAMENTO ||
+        ptDescritor[l].ulDeslocamento + (unsigned long long) ptDescritor[l].uiNumNeuronios * ptDescritor[l].uiStride *
+        ptCabecalho->uiTipo > tMapa.tamMapeamento) {
+      DesmapearPesos(&tMapa);
+      return 0;
+    }
+    viNeuronios[l] = (int) ptDescritor[l].uiNumNeuronios;
+    viAtivacoes[l] = (int) ptDescritor[l].uiAtivacao;
+    iDireto = iDireto && ptCabecalho->uiTipo == sizeof(TReal) && ptDescritor[l].uiStride == STRIDE(iNumEntradas + 1);
+    iNumEntradas = viNeuronios[l];
+  }
+  if (iDireto) {
+    ptRede->iNumEntradas = (int) ptCabecalho->uiNumEntradas;
+    ptRede->iNumCamadas = (int) ptCabecalho->uiNumCamadas;
+    ptRede->iNumSaidas = viNeuronios[ptRede->iNumCamadas - 1];
+    for (l = 0; l < ptRede->iNumCamadas; l++) {
+      ptCamada = &ptRede->vtCamadas[l];
+      ptCamada->iNumEntradas = (l ? viNeuronios[l - 1] : ptRede->iNumEntradas);
+      ptCamada->iNumNeuronios = viNeuronios[l];
+      ptCamada->iStride = (int) ptDescritor[l].uiStride;
+      ptCamada->iAtivacao = viAtivacoes[l];
+      ptCamada->pdPeso = (TReal*) (pcDados + ptDescritor[l].ulDeslocamento);
+    }
+    ptRede->pMapeamento = tMapa.pMapeamento;
+    ptRede->tamMapeamento = tMapa.tamMapeamento;
+    ptRede->pArquivoMapeado = tMapa.pArquivoMapeado;
+    return 1;
+  }
+
+  // Caso contrario os pesos sao convertidos para matrizes alocadas e o arquivo e liberado
+  if (!CriarRede(ptRede, (int) ptCabecalho->uiNumEntradas, (int) ptCabecalho->uiNumCamadas, viNeuronios, viAtivacoes)) {
+    DesmapearPesos(&tMapa);
+    return 0;
+  }
+  for (l = 0; l < ptRede->iNumCamadas; l++) {
+    ptCamada = &ptRede->vtCamadas[l];
+    for (i = 0; i < ptCamada->iNumNeuronios; i++) {
+      for (j = 0; j <= ptCamada->iNumEntradas; j++) {
+        if (ptCabecalho->uiTipo == sizeof(float))
+          ptCamada->pdPeso[i * ptCamada->iStride + j] = (TReal) ((const float*) (pcDados +
+              ptDescritor[l].ulDeslocamento))[(size_t) i * ptDescritor[l].uiStride + j];
+        else
+          ptCamada->pdPeso[i * ptCamada->iStride + j] = (TReal) ((const double*) (pcDados +
+              ptDescritor[l].ulDeslocamento))[(size_t) i * ptDescritor[l].uiStride + j];
+      }
+    }
+  }
+  DesmapearPesos(&tMapa);
+  return 1;
+}
+
+
+int SalvarRedeBinaria(const TRede *ptRede, const char *szNomeArquivo)
+{
+  FILE *fp = NULL;
+  int iOk;
+
+  // Salva a topologia e os pesos no formato binario
+  if ((fp = fopen(szNomeArquivo, "wb")) == NULL)
+    return 0;
+  iOk = EscreverRedeBinaria(ptRede, fp);
+  if (fclose(fp) != 0)
+    iOk = 0;
+  return iOk;
+}
+
+
+static int EscreverBinario(FILE *fp, const void *pDados, size_t tamanho, unsigned long long *pulSoma)
+{
+  *pulSoma = SomaVerificacao(*pulSoma, pDados, tamanho);
+  return (fwrite(pDados, 1, tamanho, fp) == tamanho);
+}
+
+
+int EscreverRedeBinaria(const TRede *ptRede, FILE *fp)
+{
+  TCabecalhoPesos tCabecalho;
+  TDescritorCamada vtDescritores[MAX_CAMADAS];
+  char vcZeros[ALINHAMENTO];
+  unsigned long long ulPosicao;
+  const TCamada *ptCamada;
+  int l, iOk = 1;
+
+  // Com pesos mestres a copia em double e gravada (sem perda); caso contrario, os pesos em TReal
+  memset(&tCabecalho, 0, sizeof(TCabecalhoPesos));
+  memset(vtDescritores, 0, sizeof(vtDescritores));
+  memset(vcZeros, 0, sizeof(vcZeros));
+  memcpy(tCabecalho.vcAssinatura, ASSINATURA_PESOS, 4);
+  tCabecalho.uiVersao = VERSAO_PESOS_BINARIO;
+  tCabecalho.uiNumEntradas = (unsigned int) ptRede->iNumEntradas;
+  tCabecalho.uiNumCamadas = (unsigned int) ptRede->iNumCamadas;
+  tCabecalho.uiTipo = (ptRede->vtCamadas[0].pdMestre != NULL ? sizeof(double) : sizeof(TReal));
+
+  // Descritores das camadas, com as matrizes (incluindo o padding das linhas) em posicoes alinhadas
+  ulPosicao = ALINHAR(sizeof(TCabecalhoPesos) + ptRede->iNumCamadas * sizeof(TDescritorCamada));
+  for (l = 0; l < ptRede->iNumCamadas; l++) {
+    ptCamada = &ptRede->vtCamadas[l];
+    vtDescritores[l].uiNumNeuronios = (unsigned int) ptCamada->iNumNeuronios;
+    vtDescritores[l].uiAtivacao = (unsigned int) ptCamada->iAtivacao;
+    vtDescritores[l].uiStride = (unsigned int) ptCamada->iStride;
+    vtDescritores[l].ulDeslocamento = ulPosicao;
+    ulPosicao = ALINHAR(ulPosicao + (unsigned long long) ptCamada->iNumNeuronios * ptCamada->iStride * tCabecalho.uiTipo);
+  }
+  tCabecalho.ulTamanho = ulPosicao;
+
+  // O cabecalho e regravado no final, com a soma de verificacao do restante do arquivo
+  tCabecalho.ulSoma = FNV_INICIAL;
+  iOk = (fwrite(&tCabecalho, sizeof(TCabecalhoPesos), 1, fp) == 1);
+  ulPosicao = sizeof(TCabecalhoPesos) + ptRede->iNumCamadas * sizeof(TDescritorCamada);
+  iOk = iOk && EscreverBinario(fp, vtDescritores, ptRede->iNumCamadas * sizeof(TDescritorCamada), &tCabecalho.ulSoma);
+  for (l = 0; iOk && l < ptRede->iNumCamadas; l++) {
+    ptCamada = &ptRede->vtCamadas[l];
+    iOk = EscreverBinario(fp, vcZeros, (size_t) (vtDescritores[l].ulDeslocamento - ulPosicao), &tCabecalho.ulSoma);
+    ulPosicao = vtDescritores[l].ulDeslocamento + (unsigned long long) ptCamada->iNumNeuronios * ptCamada->iStride *
+        tCabecalho.uiTipo;
+    if (ptCamada->pdMestre != NULL)
+      iOk = iOk && EscreverBinario(fp, ptCamada->pdMestre, sizeof(double) * ptCamada->iNumNeuronios * ptCamada->iStride,
+          &tCabecalho.ulSoma);
+    else
+      iOk = iOk && EscreverBinario(fp, ptCamada->pdPeso, sizeof(TReal) * ptCamada->iNumNeuronios * ptCamada->iStride,
+          &tCabecalho.ulSoma);
+  }
+  iOk = iOk && EscreverBinario(fp, vcZeros, (size_t) (tCabecalho.ulTamanho - ulPosicao), &tCabecalho.ulSoma);
+  return (iOk && fseek(fp, 0, SEEK_SET) == 0 && fwrite(&tCabecalho, sizeof(TCabecalhoPesos), 1, fp) == 1);
+}
+
+
+static void *MapearPesos(TRede *ptRede, const char *szNomeArquivo)
+{
+#ifdef _WIN32
+  HANDLE hArquivo, hMapeamento;
+  LARGE_INTEGER liTamanho;
+
+  hArquivo = CreateFileA(szNomeArquivo, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+      FILE_ATTRIBUTE_NORMAL, NULL);
+  if (hArquivo == INVALID_HANDLE_VALUE)
+    return NULL;
+  if (!GetFileSizeEx(hArquivo, &liTamanho) ||
+      (hMapeamento = CreateFileMappingA(hArquivo, NULL, PAGE_READONLY, 0, 0, NULL)) == NULL) {
+    CloseHandle(hArquivo);
+    return NULL;
+  }
+  CloseHandle(hArquivo);
+  if ((ptRede->pMapeamento = MapViewOfFile(hMapeamento, FILE_MAP_READ, 0, 0, 0)) == NULL) {
+    CloseHandle(hMapeamento);
+    return NULL;
+  }
+  ptRede->pArquivoMapeado = (void*) hMapeamento;
+  ptRede->tamMapeamento = (size_t) liTamanho.QuadPart;
+#else
+  struct stat tStat;
+  void *pMapeamento;
+  int iArquivo;
+
+  if ((iArquivo = open(szNomeArquivo, O_RDONLY)) < 0)
+    return NULL;
+  if (fstat(iArquivo, &tStat) != 0 || tStat.st_size == 0 ||
+      (pMapeamento = mmap(NULL, (size_t) tStat.st_size, PROT_READ, MAP_SHARED, iArquivo, 0)) == MAP_FAILED) {
+    close(iArquivo);
+    return NULL;
+  }
+  close(iArquivo);
+  ptRede->pMapeamento = pMapeamento;
+  ptRede->tamMapeamento = (size_t) tStat.st_size;
+#endif
+  return ptRede->pMapeamento;
+}
+
+
+static void DesmapearPesos(TRede *ptRede)
+{
+  if (ptRede->pMapeamento == NULL)
+    return;
+#ifdef _WIN32
+  UnmapViewOfFile(ptRede->pMapeamento);
+  CloseHandle((HANDLE) ptRede->pArquivoMapeado);
+#else
+  munmap(ptRede->pMapeamento, ptRede->tamMapeamento);
+#endif
+  ptRede->pMapeamento = NULL;
+  ptRede->pArquivoMapeado = NULL;
+  ptRede->tamMapeamento = 0;
+}
+
+
+TReal **AlocarSaidasRede(const TRede *ptRede)
+{
+  TReal **ppdSaida;
+  int l;
+
+  // Um vetor de ativacoes por camada (com espaco para a coluna de bias)
+  ppdSaida = (TReal**) malloc(sizeof(TReal*) * ptRede->iNumCamadas);
+  for (l = 0; l < ptRede->iNumCamadas; l++)
+    ppdSaida[l] = (TReal*) AlocarAlinhado(sizeof(TReal) * STRIDE(ptRede->vtCamadas[l].iNumNeuronios + 1));
+  return ppdSaida;
+}
+
+
+void LiberarSaidasRede(const TRede *ptRede, TReal **ppdSaida)
+{
+  int l;
+
+  if (ppdSaida != NULL) {
+    for (l = 0; l < ptRede->iNumCamadas; l++)
+      LiberarAlinhado(ppdSaida[l]);
+    free(ppdSaida);
+  }
+}
+
+
+void AtivarRede(const TRede *ptRede, const TReal *pdEntrada, TReal **ppdSaida)
+{
+  register int i;
+  int l;
+  const TReal *pdPeso, *pdAnterior = pdEntrada;
+  const TCamada *ptCamada;
+
+  // Propaga as entradas camada a camada
+  for (l = 0; l < ptRede->iNumCamadas; l++) {
+    ptCamada = &ptRede->vtCamadas[l];
+    for (i = 0, pdPeso = ptCamada->pdPeso; i < ptCamada->iNumNeuronios; i++, pdPeso += ptCamada->iStride)
+      ppdSaida[l][i] = ProdutoEscalar(pdPeso[ptCamada->iNumEntradas], pdAnterior, pdPeso, ptCamada->iNumEntradas);
+    AplicarAtivacao(ptCamada->iAtivacao, ppdSaida[l], ptCamada->iNumNeuronios);
+    pdAnterior = ppdSaida[l];
+  }
+}
+
+
+int TamanhoTrabalhoLote(const TRede *ptRede)
+{
+  int l, iMaximo = ptRede->iNumEntradas;
+
+  // Duas matrizes (entradas e saidas da camada atual) com uma linha de BLOCO_ATIVACAO_LOTE registros por neuronio
+  for (l = 0; l < ptRede->iNumCamadas; l++) {
+    if (ptRede->vtCamadas[l].iNumNeuronios > iMaximo)
+      iMaximo = ptRede->vtCamadas[l].iNumNeuronios;
+  }
+  return 2 * iMaximo * BLOCO_ATIVACAO_LOTE;
+}
+
+
+void AtivarRedeLote(const TRede *ptRede, const double *pdEntradas, double *pdSaidas, const int iNumRegistros,
+    TReal *pdTrabalho)
+{
+  register int i, k;
+  int b, l, iBloco, iMinimo = MIN_BLOCO_TRANSPOSTO, iMetade = TamanhoTrabalhoLote(ptRede) / 2;
+  TReal *pdAnterior, *pdAtual, *pdAux, *pdLinha;
+  TReal *vpdSaida[MAX_CAMADAS];
+  const TReal *pdPeso;
+  const TCamada *ptCamada;
+
+  // Para poucos registros as camadas alternam entre as duas metades da area de trabalho, como em AtivarRede
+  for (l = 0; l < ptRede->iNumCamadas; l++)
+    vpdSaida[l] = &pdTrabalho[((l + 1) % 2) * iMetade];
+
+  // Com camadas largas os produtos escalares de AtivarRede ja sao eficientes e a area transposta nao cabe na cache
+  for (l = 0; l < ptRede->iNumCamadas; l++) {
+    if (ptRede->vtCamadas[l].iNumEntradas > MAX_ENTRADAS_TRANSPOSTO)
+      iMinimo = BLOCO_ATIVACAO_LOTE + 1;
+  }
+
+  // Propaga blocos de registros com as ativacoes transpostas (uma linha contigua por neuronio): cada peso e
+  // lido uma vez por bloco e o campo local de um neuronio e acumulado sobre todo o bloco pelos kernels vetoriais
+  for (b = 0; b < iNumRegistros; b += BLOCO_ATIVACAO_LOTE) {
+    iBloco = (iNumRegistros - b < BLOCO_ATIVACAO_LOTE ? iNumRegistros - b : BLOCO_ATIVACAO_LOTE);
+    if (iBloco < iMinimo) {
+      // A transposicao nao compensa: propaga registro a registro
+      for (i = 0; i < iBloco; i++) {
+        for (k = 0; k < ptRede->iNumEntradas; k++)
+          pdTrabalho[k] = (TReal) pdEntradas[(size_t) (b + i) * ptRede->iNumEntradas + k];
+        AtivarRede(ptRede, pdTrabalho, vpdSaida);
+        for (k = 0; k < ptRede->iNumSaidas; k++)
+          pdSaidas[(size_t) (b + i) * ptRede->iNumSaidas + k] = vpdSaida[ptRede->iNumCamadas - 1][k];
+      }
+      continue;
+    }
+    pdAnterior = pdTrabalho;
+    pdAtual = &pdTrabalho[iMetade];
+    for (i = 0; i < iBloco; i++) {
+      for (k = 0; k < ptRede->iNumEntradas; k++)
+        pdAnterior[k * BLOCO_ATIVACAO_LOTE + i] = (TReal) pdEntradas[(size_t) (b + i) * ptRede->iNumEntradas + k];
+    }
+    for (l = 0; l < ptRede->iNumCamadas; l++) {
+      ptCamada = &ptRede->vtCamadas[l];
+      for (i = 0, pdPeso = ptCamada->pdPeso; i < ptCamada->iNumNeuronios; i++, pdPeso += ptCamada->iStride) {
+        // Bias seguido das entradas em ordem crescente, como em AtivarRede
+        pdLinha = &pdAtual[i * BLOCO_ATIVACAO_LOTE];
+        for (k = 0; k < iBloco; k++)
+          pdLinha[k] = pdPeso[ptCamada->iNumEntradas];
+        for (k = 0; k < ptCamada->iNumEntradas; k++)
+          SomarEscalado(pdLinha, pdPeso[k], &pdAnterior[k * BLOCO_ATIVACAO_LOTE], iBloco);
+        AplicarAtivacao(ptCamada->iAtivacao, pdLinha, iBloco);
+      }
+      pdAux = pdAnterior;
+      pdAnterior = pdAtual;
+      pdAtual = pdAux;
+    }
+    for (i = 0; i < iBloco; i++) {
+      for (k = 0; k < ptRede->iNumSaidas; k++)
+        pdSaidas[(size_t) (b + i) * ptRede->iNumSaidas + k] = pdAnterior[k * BLOCO_ATIVACAO_LOTE + i];
+    }
+  }
+}
+
+
+void AplicarAtivacao(const int iAtivacao, TReal *pdX, const int iN)
+{
+  // A ativacao linear nao altera o campo local
+  if (iAtivacao == ATIVACAO_TANH)
+    TangenteHiperbolica(pdX, iN);
+  else if (iAtivacao == ATIVACAO_TANH_RAPIDA)
+    TangenteHiperbolicaRapida(pdX, iN);
+}
+
+
+int CodigoAtivacao(const char *szNome)
+{
+  int i;
+
+  for (i = 0; i < NUM_ATIVACOES; i++) {
+    if (!strcmp(szNome, vszNomesAtivacao[i]))
+      return i;
+  }
+  return -1;
+}
+
+
+const char *NomeAtivacao(const int iAtivacao)
+{
+  return (iAtivacao >= 0 && iAtivacao < NUM_ATIVACOES ? vszNomesAtivacao[iAtivacao] : "?");
+}
@@ -0,0 +1,122 @@
+//************************************************************************************************
+//* UNIVERSIDADE FEDERAL DO RIO GRANDE DO SUL (UFRGS) - Campus do Vale                          **
+//* Doutorado em Ciencia da Computacao - PPGC                                                   **
+//* Doutorando: Milton Roberto Heinen - 00145752                                                **
+//* Orientador: Paulo Martins Engel                                                             **
+//* Rede multicamadas (MLP) compartilhada pelo treinamento (tlfn) e pela inferencia (stlfn)     **
+//************************************************************************************************
+#ifndef REDE_H
+#define REDE_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include "vetorial.h"
+
+
+//************************************** Constantes **********************************************
+#define MAX_CAMADAS 16
+#define ALINHAMENTO 64
+#define VERSAO_PESOS 2
+#define ATIVACAO_LINEAR 0
+#define ATIVACAO_TANH 1
+#define ATIVACAO_TANH_RAPIDA 2
+#define NUM_ATIVACOES 3
+#define ASSINATURA_PESOS "WTSB"
+#define VERSAO_PESOS_BINARIO 1
+#define EXTENSAO_PESOS_BINARIO "b"
+#define FNV_INICIAL 0xcbf29ce484222325ULL
+#define BLOCO_ATIVACAO_LOTE 256
+#define MIN_BLOCO_TRANSPOSTO 8
+#define MAX_ENTRADAS_TRANSPOSTO 24
+
+
+//**************************************** Macros ************************************************
+#define STRIDE(n) ((((n) * sizeof(TReal) + ALINHAMENTO - 1) / ALINHAMENTO) * (ALINHAMENTO / sizeof(TReal)))
+// (a tanh rapida usa a derivada da tanh exata, 1 - y^2, pois o erro da aproximacao e desprezivel)
+#define DERIVADA_ATIVACAO(a, y) ((a) != ATIVACAO_LINEAR ? (TReal) 1.0 - (y) * (y) : (TReal) 1.0)
+
+
+//************************************ Tipos de dados ********************************************
+// Camada totalmente conectada: matriz iNumNeuronios x iStride, com o bias na coluna iNumEntradas
+// (pdMestre, se alocado, e a copia em double usada nos ajustes quando TReal e float; pdVelocidade e
+// pdSegundoMomento, se alocados, sao o estado da regra de ajuste, com o mesmo layout da matriz)
+typedef struct {
+  int iNumEntradas;
+  int iNumNeuronios;
+  int iStride;
+  int iAtivacao;
+  TReal *pdPeso;
+  double *pdMestre;
+  TReal *pdVelocidade;
+  TReal *pdSegundoMomento;
+} TCamada;
+
+// Lista de camadas; a ultima e a camada de saida (se pMapeamento != NULL os pesos apontam para as
+// paginas somente leitura do arquivo binario, compartilhadas entre os processos)
+typedef struct {
+  int iNumEntradas;
+  int iNumSaidas;
+  int iNumCamadas;
+  TCamada vtCamadas[MAX_CAMADAS];
+  void *pMapeamento;
+  size_t tamMapeamento;
+  void *pArquivoMapeado;
+} TRede;
+
+// Cabecalho de 64 bytes do arquivo de pesos binario (little endian), seguido de um descritor por
+// camada; as matrizes (iNumNeuronios x uiStride valores de uiTipo bytes, com o padding) comecam em
+// deslocamentos multiplos de ALINHAMENTO e ulSoma e o FNV-1a de 64 bits de tudo apos o cabecalho
+typedef struct {
+  char vcAssinatura[4];
+  unsigned int uiVersao;
+  unsigned int uiNumEntradas;
+  unsigned int uiNumCamadas;
+  unsigned int uiTipo;
+  unsigned int uiReservado;
+  unsigned long long ulTamanho;
+  unsigned long long ulSoma;
+  char vcReservado[24];
+} TCabecalhoPesos;
+
+typedef struct {
+  unsigned int uiNumNeuronios;
+  unsigned int uiAtivacao;
+  unsigned int uiStride;
+  unsigned int uiReservado;
+  unsigned long long ulDeslocamento;
+} TDescritorCamada;
+
+
+//************************************** Prototipos **********************************************
+void *AlocarAlinhado(size_t tamanho);
+void LiberarAlinhado(void *pMemoria);
+int CriarRede(TRede *ptRede, const int iNumEntradas, const int iNumCamadas, const int *piNeuronios,
+    const int *piAtivacoes);
+void DestruirRede(TRede *ptRede);
+int CopiarRede(TRede *ptDestino, const TRede *ptOrigem);
+int CriarPesosMestres(TRede *ptRede);
+void LiberarPesosMestres(TRede *ptRede);
+void SomarEscaladoMestre(double *pdMestre, TReal *pdPeso, double dA, const TReal *pdX, int iN);
+int CriarEstadoAjuste(TRede *ptRede, const int iNumBuffers);
+void LiberarEstadoAjuste(TRede *ptRede);
+void AjustarMomentoMestre(double *pdMestre, TReal *pdPeso, TReal *pdV, double dMomento, double dFatorV, double dFatorG,
+    double dA, const TReal *pdX, int iN);
+void AjustarAdamMestre(double *pdMestre, TReal *pdPeso, TReal *pdM, TReal *pdV, double dBeta1, double dBeta2,
+    double dTaxa, double dEpsilon, double dA, const TReal *pdX, int iN);
+int CarregarRede(TRede *ptRede, const char *szNomeArquivo);
+int SalvarRede(const TRede *ptRede, const char *szNomeArquivo);
+void EscreverRede(const TRede *ptRede, FILE *fp);
+int SalvarRedeBinaria(const TRede *ptRede, const char *szNomeArquivo);
+int EscreverRedeBinaria(const TRede *ptRede, FILE *fp);
+unsigned long long SomaVerificacao(unsigned long long ulSoma, const void *pDados, size_t tamanho);
+TReal **AlocarSaidasRede(const TRede *ptRede);
+void LiberarSaidasRede(const TRede *ptRede, TReal **ppdSaida);
+void AtivarRede(const TRede *ptRede, const TReal *pdEntrada, TReal **ppdSaida);
+int TamanhoTrabalhoLote(const TRede *ptRede);
+void AtivarRedeLote(const TRede *ptRede, const double *pdEntradas, double *pdSaidas, const int iNumRegistros,
+    TReal *pdTrabalho);
+void AplicarAtivacao(const int iAtivacao, TReal *pdX, const int iN);
+int CodigoAtivacao(const char *szNome);
+const char *NomeAtivacao(const int iAtivacao);
+
+#endif
@@ -3,7 +3,7 @@
 //* Doutorado em Ciencia da Computacao - PPGC                                                   **
 //* Doutorando: Milton Roberto Heinen - 00145752                                                **
 //* Orientador: Paulo Martins Engel                                                             **
-//* Simulador de redes neurais com o algoritmo backpropagation padrao (sem momentum)            **
+//* Simulador de redes neurais com backpropagation (SGD, momentum, Nesterov ou Adam)            **
 //************************************************************************************************
 
 //*************************************** Includes ***********************************************
@@ -12,6 +12,18 @@
 #include <string.h>
 #include <time.h>
 #include <math.h>
+#include <pthread.h>
+#include "vetorial.h"
+#include "rede.h"
+#include "database.h"
+#include "aleatorio.h"
+#include "minimos.h"
+#include "quantizada.h"
+#include "gerador.h"
+#include "varredura.h"
+#ifdef _WIN32
+#include <windows.h>
+#endif
 
 
 //************************************** Constantes **********************************************
@@ -22,10 +34,205 @@
 #define FREQ_GENERAL 10
 #define NUM_OCULTOS 5
 #define FREQ_RELATOR 500
+#define TAMANHO_LOTE 1
+#define NUM_THREADS 1
+#define TAMANHO_JANELA 0
+#define FREQ_QUADRADOS 0
+#define NUM_PARCIAIS_NORMAIS 8
+#define REGULARIZACAO_QUADRADOS 1.0e-8
+#define ALGORITMO_BACKPROP 0
+#define ALGORITMO_LM 1
+#define ALGORITMO_RPROP 2
+#define ALGORITMO_LBFGS 3
+#define NUM_ALGORITMOS 4
+#define REGRA_SGD 0
+#define REGRA_MOMENTUM 1
+#define REGRA_NESTEROV 2
+#define REGRA_ADAM 3
+#define NUM_REGRAS 4
+#define MOMENTO 0.9
+#define BETA2_ADAM 0.999
+#define EPSILON_ADAM 1.0e-8
+#define MAX_PESOS_LM 1024
+#define AMORTECIMENTO_LM 0.001
+#define FATOR_LM 10.0
+#define MIN_AMORTECIMENTO_LM 1.0e-12
+#define MAX_AMORTECIMENTO_LM 1.0e10
+#define TENTATIVAS_LM 10
+#define DELTA_INICIAL_RPROP 0.01
+#define MIN_DELTA_RPROP 1.0e-8
+#define MAX_DELTA_RPROP 1.0
+#define AUMENTO_RPROP 1.2
+#define REDUCAO_RPROP 0.5
+#define MEMORIA_LBFGS 10
+#define TENTATIVAS_LBFGS 30
+#define ARMIJO_LBFGS 1.0e-4
+#define BLOCO_LINHAS 64
+#define BLOCO_COLUNAS 64
+#define BLOCO_PROFUNDIDADE 256
+#define TAMANHO_FATIA_TESTE 256
+#define ATIVACOES_MEDICAO 1000000
+#define JOBS_VARREDURA 1
 
 
 //**************************************** Macros ************************************************
 #define QUADRADO(x) ((x) * (x))
+#define MINIMO(a, b) ((a) < (b) ? (a) : (b))
+#define MAXIMO(a, b) ((a) > (b) ? (a) : (b))
+
+
+//************************************ Tipos de dados ********************************************
+// O contexto de um treinamento (TTreino, declarado em varredura.h e definido abaixo) chega as threads de
+// cada pool pela sua fatia
+
+// (vdPotencia guarda beta1^t e beta2^t da correcao de vies do Adam, por thread no Hogwild)
+typedef struct {
+  TReal **ppdSaida;
+  TReal **ppdErro;
+  TReal **ppdAjuste;
+  double vdPotencia[2];
+} TPropagacao;
+
+typedef struct {
+  TReal **ppdRegistros;
+  int iInicio;
+  int iFim;
+  int iCalcularErro;
+  double dErroQuadrado;
+  TPropagacao tPropagacao;
+  TTreino *ptTreino;
+} TTrabalhador;
+
+typedef struct {
+  TReal *vpdAtivacao[MAX_CAMADAS + 1];
+  TReal *vpdErro[MAX_CAMADAS];
+  TReal *vpdAjuste[MAX_CAMADAS];
+  TReal *vpdGrad[MAX_CAMADAS];
+  TReal *pdTransposta;
+  TReal **ppdRegistros;
+  int iNumRegistros;
+  double dErroQuadrado;
+  TTreino *ptTreino;
+} TLote;
+
+typedef struct {
+  TReal **ppdRegistros;
+  int iNumRegistros;
+  int iPrimeiraFatia;
+  double *pdErroFatia;
+  TReal **ppdSaida;
+  TReal **ppdErro;
+  TTreino *ptTreino;
+} TAvaliador;
+
+// Estado dos otimizadores de lote completo (RPROP e L-BFGS): vetores com um valor por peso, na ordem de
+// ExtrairPesos, e os ultimos MEMORIA_LBFGS pares (s, y) do L-BFGS em fila circular
+typedef struct {
+  int iNumPesos;
+  double *pdPesos;
+  double *pdGradiente;
+  double *pdGradienteAnterior;
+  double *pdDelta;
+  double *pdTentativa;
+  double *pdS;
+  double *pdY;
+  double vdRho[MEMORIA_LBFGS];
+  double vdAlfa[MEMORIA_LBFGS];
+  int iNumPares;
+  int iProximoPar;
+  double dErro;
+  int iValido;
+} TOtimizador;
+
+// Gera as linhas de H (e de Y) das equacoes normais a partir de um registro; retorna o numero de linhas
+typedef int (*TGerarLinhas)(const TReal *pdRegistro, TAvaliador *ptAval, double *pdLinhas, double *pdAlvos);
+
+// Gravador da melhor epoca: tPendente recebe a copia mais recente dos pesos (substituindo uma
+// copia ainda nao gravada) e a thread grava a partir de tGravando, sem bloquear o treinamento
+typedef struct {
+  TRede tPendente;
+  TRede tGravando;
+  int iPendente;
+  int iEncerrar;
+  int iAtivo;
+  pthread_t tThread;
+  pthread_mutex_t tMutex;
+  pthread_cond_t tCondicao;
+} TGravador;
+
+// Hiperparametros de um treinamento: os da linha de comando ou, na varredura, os de cada job
+typedef struct {
+  int iNumeroCamadasOcultas;
+  int viNumeroOcultos[MAX_CAMADAS];
+  int viAtivacaoOculta[MAX_CAMADAS];
+  int iMaximoEpocas;
+  int iFreqGeneral;
+  int iFreqRelator;
+  int iTamanhoLote;
+  int iNumeroThreads;
+  int iFreqQuadrados;
+  int iAlgoritmo;
+  int iRegra;
+  double dMomento;
+  double dMseAlvo;
+  int iPesosMestres;
+  double dInitPesos;
+  double dPasso;
+  unsigned long ulRandomSeed;
+} TParametros;
+
+// Estado de um treinamento: rede, buffers da thread coordenadora, ordem da epoca, pools de threads, solvers,
+// gravador da melhor epoca e progresso do aprendizado, retomado apos cada degrau da varredura (iNumeroThreads
+// e o numero de threads em uso, redistribuido nos degraus); os databases sao somente lidos pelos treinamentos
+struct TTreino {
+  TParametros tParametros;
+  int iNumeroThreads;
+  char vcArquivoPesos[MAX_LINHA + 1];
+  char vcArquivoPesosBinario[MAX_LINHA + 1];
+  char vcArquivoSaida[MAX_LINHA + 1];
+  FILE *fpSaida;
+  TRede tRede;
+  TPropagacao tPropagacaoAnn;
+  TReal *pdSaidaObtida;
+  int *piOrdemTreino;
+  TReal **ppdEpocaTreino;
+  int viStrideLote[MAX_CAMADAS + 1];
+  TLote *ptLotes;
+  pthread_t *ptThreadsLote;
+  pthread_barrier_t pbBarreiraLote;
+  int iCalcularErroLote;
+  int iEncerrarThreadsLote;
+  double vdPotenciaLote[2];
+  TTrabalhador *ptTrabalhadores;
+  pthread_t *ptThreadsHogwild;
+  pthread_barrier_t pbBarreiraHogwild;
+  int iEncerrarThreadsHogwild;
+  TAvaliador *ptAvaliadores;
+  pthread_t *ptThreadsAvaliadores;
+  pthread_barrier_t pbBarreiraAvaliadores;
+  int iEncerrarThreadsAvaliadores;
+  void *(*pfTarefaAvaliadores)(void *pArg);
+  double *pdParciaisNormais;
+  int iDimensaoNormais;
+  int iColunasNormais;
+  TGerarLinhas pfGerarLinhas;
+  double *pdPesosLM;
+  int iNumeroPesosLM;
+  double dAmortecimentoLM;
+  TOtimizador tOtimizador;
+  double *pdParciaisGradiente;
+  TGravador tGravador;
+  int iEncerrarAprendizado;
+  int iEpoca;
+  int iMelhorEpoca;
+  int iEpocasTreinadas;
+  int iEpocaAlvo;
+  int iSaidaResolvida;
+  double dErroMedioTreino;
+  double dMenorErro;
+  double dTempoAprendizado;
+  double dTempoAlvo;
+};
 
 
 //********************************** Variaveis globais *******************************************
@@ -33,106 +240,226 @@ int iNumeroEntradas = 0;
 int iNumeroSaidas = 0;
 int iNumeroRegistrosTreino = 0;
 int iNumeroRegistrosGenera = 0;
-int iNumeroOcultos = NUM_OCULTOS;
-int iMaximoEpocas = MAX_EPOCAS;
-int iFreqGeneral = FREQ_GENERAL;
-int iFreqRelator = FREQ_RELATOR;
-int iEncerrarAprendizado = 0;
+TParametros tParametros = { 1, { NUM_OCULTOS }, { ATIVACAO_TANH }, MAX_EPOCAS, FREQ_GENERAL, FREQ_RELATOR, TAMANHO_LOTE,
+    NUM_THREADS, FREQ_QUADRADOS, ALGORITMO_BACKPROP, REGRA_SGD, MOMENTO, 0.0, 0, INIT_PESOS, PASSO, 0 };
+int iTamanhoJanela = TAMANHO_JANELA;
+int iNivelVetorial = VETORIAL_AVX512;
+int iVerificarVetorial = 0;
+int iConverterDatabase = 0;
 int iRealizarAprendizado = 1;
-unsigned long ulRandomSeed = 0;
-double **ppdDatabaseTreino = NULL;
-double **ppdDatabaseGenera = NULL;
-double **ppdPesoOculto = NULL;
-double *pdCampoOculto = NULL;
-double **ppdPesoSaida = NULL;
-double *pdSaidaObtida = NULL;
-double *pdAjusteSaida = NULL;
-double dInitPesos = INIT_PESOS;
-double dPasso = PASSO;
+int iNumeroJobs = JOBS_VARREDURA;
+TDatabase tDatabaseTreino;
+TDatabase tDatabaseGenera;
+TFluxo tFluxoTreino;
+TFluxo tFluxoGenera;
+TFluxo tFluxoSaidas;
+int *piOrdemBlocos = NULL;
+TReal **ppdDatabaseTreino = NULL;
+TReal **ppdDatabaseGenera = NULL;
+const char *vszNomesAlgoritmos[NUM_ALGORITMOS] = { "backprop", "lm", "rprop", "lbfgs" };
+const char *vszNomesRegras[NUM_REGRAS] = { "sgd", "momentum", "nesterov", "adam" };
 char vcArquivoTreino[MAX_LINHA + 1];
 char vcArquivoGenera[MAX_LINHA + 1];
 char vcArquivoPesos[MAX_LINHA + 1];
-char vcArquivoSaida[MAX_LINHA + 1];
+char vcArquivoPesosBinario[MAX_LINHA + 1];
+char vcArquivoVarredura[MAX_LINHA + 1];
+char vcArquivoCalibracao[MAX_LINHA + 1];
+char vcArquivoControlador[MAX_LINHA + 1];
 
 
 //************************************** Prototipos **********************************************
 void ProcessaLinhaComando(int argc, char *argv[]);
-double **CarregarDatabase(const char *szNomeArquivo, int *iNumeroRegistros);
-void AlocarMemoriaAnn();
-void InicializarPesos();
-void AlteraCamadaOculta(const int iNumNeronios);
-double RealizarAprendizado();
-inline void AtivarAnn(const double *pdRegistro);
-inline void AjustarPesos(const double *pdRegistro);
-inline int SaidaCorreta(const double *pdSaidaDesej);
-inline double CalcularErroQuadrado(const double *pdSaidaDesej);
-int CarregarPesos(const char *szNomeArquivo);
-void SalvarPesos(const char *szNomeArquivo);
-void MostrarPesos();
-void TestarDatabase(double** ppdDatabase, const int iNumRegistros);
-void GerarArquivoSaidas(double** ppdDatabase, const int iNumRegistros, const char *szNomeArquivo);
-void DesalocarMemoriaAnn();
-void DesalocarDatabase(double** ppdDatabase, int iNumRegistros);
+int AplicarParametro(TParametros *ptParametros, const char cParametro, const char *szValor);
+void ValidarParametros(TParametros *ptParametros);
+void LerCamadasOcultas(TParametros *ptParametros, const char *szLista);
+void LerAtivacoesOcultas(TParametros *ptParametros, const char *szLista);
+int CarregarDatabases(const char *szNomeBase);
+void PreferirBinario(char *szArquivo);
+int ConverterDatabases(const char *szNomeBase);
+int QuantizarPesos(const char *szNomeBase);
+int GerarControladorCompilado(const char *szNomeBase);
+int AlocarMemoriaAnn(TTreino *ptTreino);
+void AlocarPropagacao(TTreino *ptTreino, TPropagacao *ptProp);
+void LiberarPropagacao(TTreino *ptTreino, TPropagacao *ptProp);
+void InicializarPesos(TTreino *ptTreino);
+void AlteraCamadaOculta(TTreino *ptTreino, const int iCamada, const int iNumNeronios);
+TReal **EmbaralharRegistros(TTreino *ptTreino, TReal **ppdRegistros, const int iNumRegistros, const int iEpoca,
+    const int iSubfluxo);
+double TreinarRegistros(TTreino *ptTreino, TReal **ppdRegistros, const int iNumRegistros, const int iCalcularErro);
+void ImprimirParametros(TTreino *ptTreino);
+int TreinarRede(TTreino *ptTreino, double *pdMenorErro, int *piMelhorEpoca, int *piEpocas);
+TTreino *CriarTreino(const TParametros *ptParametros, const char *szNomeSaida);
+TTreino *CriarJob(const char *szNomeBase, const int iJob, const char *szConfiguracao, FILE *fpSaida);
+int TreinarJob(TTreino *ptTreino, const int iDegrau, const int iNumThreads, double *pdMenorErro, int *piMelhorEpoca,
+    int *piEpocas);
+void EncerrarJob(TTreino *ptTreino, double *pdMenorErro, int *piMelhorEpoca, int *piEpocas);
+int IniciarAprendizado(TTreino *ptTreino);
+int ContinuarAprendizado(TTreino *ptTreino, const int iDegrau);
+double EncerrarAprendizado(TTreino *ptTreino, int *piMelhorEpoca, int *piEpocas);
+void AlocarMemoriaLote(TTreino *ptTreino);
+void MultiplicarMatrizesNT(const TReal *pdA, int iLdA, const TReal *pdB, int iLdB, TReal *pdC, int iLdC,
+    int iM, int iN, int iK, TReal *pdTransposta);
+void MultiplicarMatrizesNN(const TReal *pdA, int iLdA, const TReal *pdB, int iLdB, TReal *pdC, int iLdC,
+    int iM, int iN, int iK);
+void MultiplicarMatrizesTN(const TReal *pdA, int iLdA, const TReal *pdB, int iLdB, TReal *pdC, int iLdC,
+    int iM, int iN, int iK, TReal *pdTransposta);
+void AtivarAnnLote(TLote *ptLote);
+void CalcularGradientesLote(TLote *ptLote);
+void AplicarGradientes(TTreino *ptTreino, const int iParte, const int iNumPartes);
+void ReduzirGradientes(TTreino *ptTreino, const int iCamada, const int iInicio, const int iFim);
+double CalcularErroQuadradoLote(TLote *ptLote);
+void ProcessarFatiaLote(TLote *ptLote);
+void *ExecutarThreadLote(void *pArg);
+double TreinarLote(TTreino *ptTreino, TReal **ppdRegistros, const int iNumRegistros, const int iCalcularErro);
+void DesalocarMemoriaLote(TTreino *ptTreino);
+double TempoReal();
+void AlocarTrabalhadores(TTreino *ptTreino);
+void *TreinarParticao(void *pArg);
+void *ExecutarThreadHogwild(void *pArg);
+double TreinarHogwild(TTreino *ptTreino, TReal **ppdRegistros, const int iNumRegistros, const int iCalcularErro);
+void DesalocarTrabalhadores(TTreino *ptTreino);
+void RedimensionarThreads(TTreino *ptTreino, const int iNumThreads);
+void AtivarAnnLocal(TTreino *ptTreino, const TReal *pdRegistro, TPropagacao *ptProp);
+void AjustarPesosLocal(TTreino *ptTreino, const TReal *pdRegistro, TPropagacao *ptProp);
+void IniciarRegra(TTreino *ptTreino);
+void AvancarPotencias(TTreino *ptTreino, double *pdPotencia);
+void AjustarLinha(TTreino *ptTreino, const TCamada *ptCamada, const int iDeslocamento, const double dA,
+    const TReal *pdX, const int iN, const double *pdPotencia);
+int CodigoRegra(const char *szNome);
+inline void AtivarAnn(TTreino *ptTreino, const TReal *pdRegistro);
+inline void AjustarPesos(TTreino *ptTreino, const TReal *pdRegistro);
+inline int SaidaCorreta(const TReal *pdSaidaDesej);
+inline double CalcularErroQuadrado(TTreino *ptTreino, const TReal *pdSaidaDesej);
+int CarregarPesos(TTreino *ptTreino, const char *szNomeArquivo);
+void MostrarPesos(TTreino *ptTreino);
+double AvaliarRede(const TRede *ptRede, TReal **ppdSaida, TReal **ppdRegistros, const int iNumRegistros, FILE *fp);
+void AlocarAvaliadores(TTreino *ptTreino);
+void *AvaliarFatias(void *pArg);
+double AvaliarRegistros(TTreino *ptTreino, TReal** ppdRegistros, const int iNumRegistros);
+double TestarGeneralizacao(TTreino *ptTreino);
+void TestarDatabase(TTreino *ptTreino);
+void DesalocarAvaliadores(TTreino *ptTreino);
+void *ExecutarThreadAvaliador(void *pArg);
+void AlocarEquacoesNormais(TTreino *ptTreino, const int iDimensao, const int iNumColunas);
+int TamanhoParcialNormais(TTreino *ptTreino);
+void *AcumularParciais(void *pArg);
+void ExecutarAvaliadores(TTreino *ptTreino, void *(*pfTarefa)(void *pArg), TReal **ppdRegistros,
+    const int iNumRegistros);
+void PercorrerTreinamento(TTreino *ptTreino, void *(*pfTarefa)(void *pArg));
+void SomarEquacoesNormais(TTreino *ptTreino, TGerarLinhas pfGerador);
+void DesalocarEquacoesNormais(TTreino *ptTreino);
+int GerarLinhasSaida(const TReal *pdRegistro, TAvaliador *ptAval, double *pdLinhas, double *pdAlvos);
+int AjustarSaidaMinimosQuadrados(TTreino *ptTreino);
+int NumeroPesosRede(TTreino *ptTreino);
+void ExtrairPesos(TTreino *ptTreino, double *pdPesos);
+void InserirPesos(TTreino *ptTreino, const double *pdPesos);
+double ErroTreinamento(TTreino *ptTreino);
+int AlocarLevenbergMarquardt(TTreino *ptTreino);
+int GerarLinhasJacobiano(const TReal *pdRegistro, TAvaliador *ptAval, double *pdLinhas, double *pdAlvos);
+double TreinarLevenbergMarquardt(TTreino *ptTreino, const int iCalcularErro);
+void DesalocarLevenbergMarquardt(TTreino *ptTreino);
+double TreinarLoteCompleto(TTreino *ptTreino, const int iCalcularErro);
+int AlocarOtimizador(TTreino *ptTreino);
+void *AcumularGradientes(void *pArg);
+double CalcularGradiente(TTreino *ptTreino, double *pdGradiente);
+double TreinarRprop(TTreino *ptTreino, const int iCalcularErro);
+double TreinarLbfgs(TTreino *ptTreino, const int iCalcularErro);
+void DesalocarOtimizador(TTreino *ptTreino);
+int CodigoAlgoritmo(const char *szNome);
+void IniciarGravador(TTreino *ptTreino);
+void SolicitarGravacao(TTreino *ptTreino);
+void *ExecutarGravador(void *pArg);
+int GravarArquivoSaidas(const TRede *ptRede, TReal **ppdSaida, const char *szNomeArquivo);
+int GravarPesos(const TRede *ptRede, const char *szNomeArquivo, const int iBinario);
+void EncerrarGravador(TTreino *ptTreino);
+void DesalocarMemoriaAnn(TTreino *ptTreino);
+void LiberarTreino(TTreino *ptTreino);
+void DesalocarDatabases();
 
 
 //************************************* Funcao main **********************************************
 int main (int argc, char *argv[])
 {
+  TTreino *ptTreino;
+  int l;
+
   // Busca os parametros de treinamento na linha de comando
   if (argc < 3) {
-    printf("Uso: %s <arquivo_sem_extensao> [-o num_ocultos=%d] [-p passo=%f] [-i init_pesos=%f] [-e max_epocas=%d] [-g freq_general=%d] [-r freq_rel=%d] [-s random_seed] [-t]\n", 
-        argv[0], iNumeroOcultos, dPasso, dInitPesos, iMaximoEpocas, iFreqGeneral, iFreqRelator);
+    printf("Uso: %s <arquivo_sem_extensao> [-o num_ocultos=%d[,...]] [-f ativacoes=%s[,...]] [-p passo=%f] [-a algoritmo=%s] [-n regra=%s] [-y momento=%.2f] [-i init_pesos=%f] [-e max_epocas=%d] [-g freq_general=%d] [-r freq_rel=%d] [-b tamanho_lote=%d] [-j threads=%d] [-w janela_streaming=%d] [-x nivel_vetorial=%d] [-q freq_minimos_quadrados=%d] [-u mse_alvo] [-s random_seed] [-h arquivo_varredura] [-k jobs=%d] [-z arquivo_calibracao] [-d arquivo_controlador] [-m] [-t] [-v] [-c]\n", 
+        argv[0], tParametros.viNumeroOcultos[0], NomeAtivacao(tParametros.viAtivacaoOculta[0]), tParametros.dPasso,
+        vszNomesAlgoritmos[tParametros.iAlgoritmo], vszNomesRegras[tParametros.iRegra], tParametros.dMomento,
+        tParametros.dInitPesos, tParametros.iMaximoEpocas, tParametros.iFreqGeneral, tParametros.iFreqRelator,
+        tParametros.iTamanhoLote, tParametros.iNumeroThreads, iTamanhoJanela, iNivelVetorial,
+        tParametros.iFreqQuadrados, iNumeroJobs);
     printf("Pressione <enter> para encerrar...");
     getchar();
     return 0;
   }
   ProcessaLinhaComando(argc, argv);
 
-  // Carrega as bases de dados
-  sprintf(vcArquivoTreino, "%s.lrn", argv[1]);
-  sprintf(vcArquivoGenera, "%s.tst", argv[1]);
+  // Seleciona os kernels vetoriais e, se solicitado, compara-os com o caminho escalar
+  InicializarVetorial(iNivelVetorial);
+  if (iVerificarVetorial)
+    return (VerificarVetorial() ? 0 : 1);
+
+  // Converte os databases (e os pesos, se existirem) texto para o formato binario, se solicitado
   sprintf(vcArquivoPesos, "%s.wts", argv[1]);
-  sprintf(vcArquivoSaida, "%s.out", argv[1]);
-  if ((ppdDatabaseTreino = CarregarDatabase(vcArquivoTreino, &iNumeroRegistrosTreino)) == NULL)
-    return 1;
-  if ((ppdDatabaseGenera = CarregarDatabase(vcArquivoGenera, &iNumeroRegistrosGenera)) == NULL) {
-    DesalocarDatabase(ppdDatabaseTreino, iNumeroRegistrosTreino);
+  sprintf(vcArquivoPesosBinario, "%s.wts%s", argv[1], EXTENSAO_PESOS_BINARIO);
+  if (iConverterDatabase)
+    return (ConverterDatabases(argv[1]) ? 0 : 1);
+
+  // Quantiza os pesos em int8 com as faixas das ativacoes no arquivo de calibracao, se solicitado
+  if (vcArquivoCalibracao[0])
+    return (QuantizarPesos(argv[1]) ? 0 : 1);
+
+  // Gera o controlador C++ com a topologia e os pesos fixos, se solicitado
+  if (vcArquivoControlador[0])
+    return (GerarControladorCompilado(argv[1]) ? 0 : 1);
+
+  // Inicializa o random seed (origem de todos os fluxos do gerador aleatorio)
+  if (!tParametros.ulRandomSeed)
+    tParametros.ulRandomSeed = time(NULL);
+
+  // Le a especificacao da varredura antes de carregar os databases
+  if (vcArquivoVarredura[0] && (!iRealizarAprendizado || iTamanhoJanela > 0)) {
+    fprintf(stderr, "ERRO: A varredura exige o treinamento com os databases em memoria (sem -t e -w)\n");
     return 1;
   }
+  if (vcArquivoVarredura[0] && !LerVarredura(vcArquivoVarredura, tParametros.ulRandomSeed))
+    return 1;
+
+  // Carrega as bases de dados
+  if (!CarregarDatabases(argv[1]))
+    return 1;
 
-  // Inicializa o random seed
-  if (!ulRandomSeed)
-    ulRandomSeed = time(NULL);
-  srand(ulRandomSeed);
+  // Varredura: cada job treina uma configuracao sobre os databases ja carregados
+  if (vcArquivoVarredura[0]) {
+    l = RealizarVarredura(argv[1], iNumeroJobs, tParametros.iNumeroThreads);
+    DesalocarDatabases();
+    return (l ? 0 : 1);
+  }
 
-  // Prepara a ANN
-  AlocarMemoriaAnn();
+  // Prepara a ANN (contexto do treinamento com os parametros da linha de comando, gravando <arquivo>.wts/.out)
+  if ((ptTreino = CriarTreino(&tParametros, argv[1])) == NULL || !AlocarMemoriaAnn(ptTreino)) {
+    LiberarTreino(ptTreino);
+    DesalocarDatabases();
+    return 1;
+  }
   if (!iRealizarAprendizado) {
-    // Carrega os pesos e testa o database
-    if (!CarregarPesos(vcArquivoPesos))
+    // Carrega os pesos (de preferencia os binarios atualizados, sem perda de precisao) e testa o database
+    if (!CarregarPesos(ptTreino, EscolherArquivo(vcArquivoPesosBinario, vcArquivoPesos)))
       return 1;
-    TestarDatabase(ppdDatabaseGenera, iNumeroRegistrosGenera);
+    TestarDatabase(ptTreino);
   }
   else {
-    InicializarPesos();  
-    // Imprime os parametros da simulacao
-    printf("*******************************************************\n");
-    printf("* Arquivo de treinamento......: %-13s (%-5d) *\n", vcArquivoTreino, iNumeroRegistrosTreino);
-    printf("* Arquivo de generalizacao....: %-13s (%-5d) *\n", vcArquivoGenera, iNumeroRegistrosGenera);
-    printf("* Neuronios nas camadas.......: %-4d %-4d %-4d        *\n", iNumeroEntradas,
-        iNumeroOcultos, iNumeroSaidas);
-    printf("* Passo, init_pesos e epocas..: %7.5f %6.4f %6d *\n", dPasso, dInitPesos, iMaximoEpocas);
-    printf("* Generalizacao e random seed.: %-5d %.10lu      *\n", iFreqGeneral, ulRandomSeed);
-    printf("*******************************************************\n");
-
     // Realiza o aprendizado
-    RealizarAprendizado();
+    if (!TreinarRede(ptTreino, NULL, NULL, NULL))
+      return 1;
   }
 
   // Finalizacao
-  DesalocarMemoriaAnn();
-  DesalocarDatabase(ppdDatabaseTreino, iNumeroRegistrosTreino);
-  DesalocarDatabase(ppdDatabaseGenera, iNumeroRegistrosGenera);
+  LiberarTreino(ptTreino);
+  DesalocarDatabases();
   printf("Pressione <enter> para encerrar...");
   getchar();
   return 0;
@@ -146,486 +473,2477 @@ void ProcessaLinhaComando(int argc, char *argv[])
 
   // Busca os parametros da linha de comando
   for (i = 2; i < argc; i++) {
-    if (argv[i][0] == '-' && (i < argc - 1 || argv[i][1] == 't')) {
+    if (argv[i][0] == '-' && (i < argc - 1 || argv[i][1] == 't' || argv[i][1] == 'v' || argv[i][1] == 'm' ||
+        argv[i][1] == 'c')) {
       switch(argv[i][1]) {
-        case 'o':
-          iNumeroOcultos = atoi(argv[i + 1]);
-          break;
-        case 'i':
-          dInitPesos = atof(argv[i + 1]);
-          break;
-        case 'p':
-          dPasso = atof(argv[i + 1]);
-          break;
-        case 'e':
-          iMaximoEpocas = atoi(argv[i + 1]);
+        case 't':
+          iRealizarAprendizado = 0;
           break;
-        case 's':
-          ulRandomSeed = atol(argv[i + 1]);
+        case 'v':
+          iVerificarVetorial = 1;
           break;
-        case 'g':
-          iFreqGeneral = atoi(argv[i + 1]);
+        case 'm':
+          tParametros.iPesosMestres = 1;
           break;
-        case 'r':
-          iFreqRelator = atoi(argv[i + 1]);
+        case 'c':
+          iConverterDatabase = 1;
           break;
-        case 't':
-          iRealizarAprendizado = 0;
+        default:
+          AplicarParametro(&tParametros, argv[i][1], argv[i + 1]);
           break;
       }
     }
   }
-  if (iFreqRelator < iFreqGeneral)
-    iFreqRelator = iFreqGeneral;
+  ValidarParametros(&tParametros);
 }
 
 
-double **CarregarDatabase(const char *szNomeArquivo, int *iNumeroRegistros)
+int AplicarParametro(TParametros *ptParametros, const char cParametro, const char *szValor)
 {
-  FILE *fp = NULL;
-  char vcLinha[MAX_LINHA + 1];
-  char *szPalavra = NULL;
-  int i, iCount;
-  double **ppdDatabase = NULL;
-
-  // Abre o arquivo
-  if ((fp = fopen(szNomeArquivo, "r")) == NULL) {
-    fprintf(stderr, "ERRO: Nao foi possivel abrir o database\n");
-    return NULL;
+  // Parametros com valor (da linha de comando ou de um job da varredura)
+  switch(cParametro) {
+    case 'o':
+      LerCamadasOcultas(ptParametros, szValor);
+      break;
+    case 'f':
+      LerAtivacoesOcultas(ptParametros, szValor);
+      break;
+    case 'i':
+      ptParametros->dInitPesos = atof(szValor);
+      break;
+    case 'p':
+      ptParametros->dPasso = atof(szValor);
+      break;
+    case 'e':
+      ptParametros->iMaximoEpocas = atoi(szValor);
+      break;
+    case 's':
+      ptParametros->ulRandomSeed = atol(szValor);
+      break;
+    case 'g':
+      ptParametros->iFreqGeneral = atoi(szValor);
+      break;
+    case 'r':
+      ptParametros->iFreqRelator = atoi(szValor);
+      break;
+    case 'b':
+      ptParametros->iTamanhoLote = atoi(szValor);
+      break;
+    case 'j':
+      ptParametros->iNumeroThreads = atoi(szValor);
+      break;
+    case 'w':
+      iTamanhoJanela = atoi(szValor);
+      break;
+    case 'x':
+      iNivelVetorial = atoi(szValor);
+      break;
+    case 'q':
+      ptParametros->iFreqQuadrados = atoi(szValor);
+      break;
+    case 'a':
+      ptParametros->iAlgoritmo = CodigoAlgoritmo(szValor);
+      break;
+    case 'n':
+      ptParametros->iRegra = CodigoRegra(szValor);
+      break;
+    case 'y':
+      ptParametros->dMomento = atof(szValor);
+      break;
+    case 'u':
+      ptParametros->dMseAlvo = atof(szValor);
+      break;
+    case 'h':
+      strncpy(vcArquivoVarredura, szValor, MAX_LINHA);
+      vcArquivoVarredura[MAX_LINHA] = '\0';
+      break;
+    case 'k':
+      iNumeroJobs = atoi(szValor);
+      break;
+    case 'z':
+      strncpy(vcArquivoCalibracao, szValor, MAX_LINHA);
+      vcArquivoCalibracao[MAX_LINHA] = '\0';
+      break;
+    case 'd':
+      strncpy(vcArquivoControlador, szValor, MAX_LINHA);
+      vcArquivoControlador[MAX_LINHA] = '\0';
+      break;
+    default:
+      return 0;
+  }
+  return 1;
+}
+
+
+void ValidarParametros(TParametros *ptParametros)
+{
+  if (ptParametros->iFreqRelator < ptParametros->iFreqGeneral)
+    ptParametros->iFreqRelator = ptParametros->iFreqGeneral;
+  if (ptParametros->iTamanhoLote < 1)
+    ptParametros->iTamanhoLote = 1;
+  if (ptParametros->iNumeroThreads < 1)
+    ptParametros->iNumeroThreads = 1;
+  if (iTamanhoJanela < 0)
+    iTamanhoJanela = 0;
+  if (iNumeroJobs < 1)
+    iNumeroJobs = 1;
+  if (ptParametros->iFreqQuadrados < 0)
+    ptParametros->iFreqQuadrados = 0;
+  if (ptParametros->iAlgoritmo < 0) {
+    fprintf(stderr, "ERRO: Algoritmo invalido, usando %s\n", vszNomesAlgoritmos[ALGORITMO_BACKPROP]);
+    ptParametros->iAlgoritmo = ALGORITMO_BACKPROP;
   }
+  if (ptParametros->iRegra < 0) {
+    fprintf(stderr, "ERRO: Regra de ajuste invalida, usando %s\n", vszNomesRegras[REGRA_SGD]);
+    ptParametros->iRegra = REGRA_SGD;
+  }
+  if (ptParametros->dMomento < 0.0 || ptParametros->dMomento >= 1.0) {
+    fprintf(stderr, "ERRO: Momento fora de [0, 1), usando %.2f\n", MOMENTO);
+    ptParametros->dMomento = MOMENTO;
+  }
+  // Os otimizadores de lote completo ja ajustam todos os pesos em conjunto (com as suas proprias regras)
+  if (ptParametros->iAlgoritmo != ALGORITMO_BACKPROP) {
+    ptParametros->iFreqQuadrados = 0;
+    ptParametros->iRegra = REGRA_SGD;
+  }
+}
+
+
+void LerCamadasOcultas(TParametros *ptParametros, const char *szLista)
+{
+  int n, l = 0;
+
+  // Lista separada por virgulas com o numero de neuronios de cada camada oculta (ex: 32,16); sem strtok,
+  // pois os jobs da varredura leem as suas configuracoes em paralelo
+  for (; *szLista != '\0' && l < MAX_CAMADAS - 1; szLista += n + (szLista[n] == ',')) {
+    if ((n = (int) strcspn(szLista, ",")) > 0)
+      ptParametros->viNumeroOcultos[l++] = atoi(szLista);
+  }
+  ptParametros->iNumeroCamadasOcultas = l;
+}
 
-  // Busca o numero de entradas, saidas e registros
-  fgets(vcLinha, MAX_LINHA, fp);
-  szPalavra = strtok(vcLinha, " ");
-  iNumeroEntradas = atoi(szPalavra);
-  szPalavra = strtok('\0', " ");
-  iNumeroSaidas = atoi(szPalavra);
-  szPalavra = strtok('\0', " ");
-  (*iNumeroRegistros) = atoi(szPalavra);
 
-  // Aloca memoria para o database
-  ppdDatabase = (double**) malloc(sizeof(double*) * (*iNumeroRegistros));
-  for (i = 0; i < (*iNumeroRegistros); i++)
-    ppdDatabase[i] = (double*) malloc(sizeof(double) * (iNumeroEntradas + iNumeroSaidas));
+void LerAtivacoesOcultas(TParametros *ptParametros, const char *szLista)
+{
+  char vcPalavra[MAX_LINHA + 1];
+  int n, l = 0;
+
+  // Lista separada por virgulas com a ativacao de cada camada oculta; a ultima vale para as seguintes
+  for (; *szLista != '\0' && l < MAX_CAMADAS - 1; szLista += n + (szLista[n] == ',')) {
+    if ((n = (int) strcspn(szLista, ",")) > 0) {
+      sprintf(vcPalavra, "%.*s", MINIMO(n, MAX_LINHA), szLista);
+      ptParametros->viAtivacaoOculta[l++] = CodigoAtivacao(vcPalavra);
+    }
+  }
+  for (; l > 0 && l < MAX_CAMADAS - 1; l++)
+    ptParametros->viAtivacaoOculta[l] = ptParametros->viAtivacaoOculta[l - 1];
+}
+
 
-  // Le o arquivo e preenche o database em memoria
-  for (iCount = 0; iCount < (*iNumeroRegistros); iCount++) {
-    fgets(vcLinha, MAX_LINHA, fp);
-    szPalavra = strtok(vcLinha, " ");
-    for (i = 0; i < iNumeroEntradas + iNumeroSaidas; i++) {
-      ppdDatabase[iCount][i] = atof(szPalavra);
-      szPalavra = strtok('\0', " ");
+int CarregarDatabases(const char *szNomeBase)
+{
+  // Prefere a versao binaria (.lrnb/.tstb) de cada database, que e mapeada sem conversao
+  sprintf(vcArquivoTreino, "%s.lrn", szNomeBase);
+  PreferirBinario(vcArquivoTreino);
+  sprintf(vcArquivoGenera, "%s.tst", szNomeBase);
+  PreferirBinario(vcArquivoGenera);
+  if (iTamanhoJanela > 0) {
+    // Streaming: cada database e lido em blocos por uma thread propria, sem carrega-lo inteiro
+    if (!AbrirFluxo(&tFluxoTreino, vcArquivoTreino, iTamanhoJanela))
+      return 0;
+    if (!AbrirFluxo(&tFluxoGenera, vcArquivoGenera, iTamanhoJanela)) {
+      FecharFluxo(&tFluxoTreino);
+      return 0;
+    }
+    // O gravador da melhor epoca tem o seu proprio fluxo de generalizacao
+    if (iRealizarAprendizado && !AbrirFluxo(&tFluxoSaidas, vcArquivoGenera, iTamanhoJanela)) {
+      DesalocarDatabases();
+      return 0;
+    }
+    if (tFluxoTreino.iNumEntradas != tFluxoGenera.iNumEntradas || tFluxoTreino.iNumSaidas != tFluxoGenera.iNumSaidas) {
+      fprintf(stderr, "ERRO: Os databases de treinamento e generalizacao nao correspondem\n");
+      DesalocarDatabases();
+      return 0;
+    }
+    piOrdemBlocos = (int*) malloc(sizeof(int) * (tFluxoTreino.iNumBlocos + 1));
+    if (piOrdemBlocos == NULL) {
+      fprintf(stderr, "ERRO: Memoria insuficiente para o database\n");
+      DesalocarDatabases();
+      return 0;
     }
+    iNumeroEntradas = tFluxoTreino.iNumEntradas;
+    iNumeroSaidas = tFluxoTreino.iNumSaidas;
+    iNumeroRegistrosTreino = tFluxoTreino.iNumRegistros;
+    iNumeroRegistrosGenera = tFluxoGenera.iNumRegistros;
+    return 1;
+  }
+  if (!CarregarDatabase(&tDatabaseTreino, vcArquivoTreino))
+    return 0;
+  if (!CarregarDatabase(&tDatabaseGenera, vcArquivoGenera)) {
+    DesalocarDatabase(&tDatabaseTreino);
+    return 0;
+  }
+  if (tDatabaseTreino.iNumEntradas != tDatabaseGenera.iNumEntradas ||
+      tDatabaseTreino.iNumSaidas != tDatabaseGenera.iNumSaidas) {
+    fprintf(stderr, "ERRO: Os databases de treinamento e generalizacao nao correspondem\n");
+    DesalocarDatabases();
+    return 0;
   }
 
-  // Se chegar aqui eh porque deu tudo certo
-  fclose(fp);
-  return ppdDatabase;
+  // Atalhos usados pelo restante do simulador
+  iNumeroEntradas = tDatabaseTreino.iNumEntradas;
+  iNumeroSaidas = tDatabaseTreino.iNumSaidas;
+  ppdDatabaseTreino = tDatabaseTreino.ppdRegistros;
+  iNumeroRegistrosTreino = tDatabaseTreino.iNumRegistros;
+  ppdDatabaseGenera = tDatabaseGenera.ppdRegistros;
+  iNumeroRegistrosGenera = tDatabaseGenera.iNumRegistros;
+  return 1;
 }
 
 
-void EmbaralharDatabase(double **ppdDatabase, int iNumRegistros)
+void PreferirBinario(char *szArquivo)
 {
-  int i, iPosicao;
-  double *pdAux;
+  char vcArquivoBinario[MAX_LINHA + sizeof(EXTENSAO_BINARIO)];
 
-  // Embaralha o database
-  for (i = 0; i < iNumRegistros; i++) {
-    do
-      iPosicao = (int) ((double) rand() / RAND_MAX * iNumRegistros);
-    while (iPosicao < 0 || iPosicao >= iNumRegistros);
-    pdAux = ppdDatabase[i];
-    ppdDatabase[i] = ppdDatabase[iPosicao];
-    ppdDatabase[iPosicao] = pdAux;
+  // Troca o nome do database texto pelo do binario, se ele existir e nao estiver desatualizado
+  sprintf(vcArquivoBinario, "%s%s", szArquivo, EXTENSAO_BINARIO);
+  if (EscolherArquivo(vcArquivoBinario, szArquivo) == vcArquivoBinario)
+    strcpy(szArquivo, vcArquivoBinario);
+}
+
+
+int ConverterDatabases(const char *szNomeBase)
+{
+  TRede tRede;
+  char vcArquivoBinario[MAX_LINHA + 1];
+
+  // Gera <base>.lrnb e <base>.tstb a partir dos databases texto
+  sprintf(vcArquivoTreino, "%s.lrn", szNomeBase);
+  sprintf(vcArquivoBinario, "%s.lrn%s", szNomeBase, EXTENSAO_BINARIO);
+  if (!ConverterDatabase(vcArquivoTreino, vcArquivoBinario))
+    return 0;
+  printf("%s -> %s\n", vcArquivoTreino, vcArquivoBinario);
+  sprintf(vcArquivoGenera, "%s.tst", szNomeBase);
+  sprintf(vcArquivoBinario, "%s.tst%s", szNomeBase, EXTENSAO_BINARIO);
+  if (!ConverterDatabase(vcArquivoGenera, vcArquivoBinario))
+    return 0;
+  printf("%s -> %s\n", vcArquivoGenera, vcArquivoBinario);
+
+  // Gera <base>.wtsb a partir dos pesos texto, se existirem e forem mais recentes (o .wtsb gravado pelo
+  // treinamento tem os pesos exatos, enquanto o .wts os arredonda)
+  if (BinarioAtualizado(vcArquivoPesosBinario, vcArquivoPesos))
+    printf("%s mantido (nao e mais antigo que %s)\n", vcArquivoPesosBinario, vcArquivoPesos);
+  else if (ArquivoExiste(vcArquivoPesos)) {
+    if (!CarregarRede(&tRede, vcArquivoPesos) || !SalvarRedeBinaria(&tRede, vcArquivoPesosBinario)) {
+      fprintf(stderr, "ERRO: Nao foi possivel converter os pesos\n");
+      DestruirRede(&tRede);
+      return 0;
+    }
+    DestruirRede(&tRede);
+    printf("%s -> %s\n", vcArquivoPesos, vcArquivoPesosBinario);
+  }
+  return 1;
+}
+
+
+int QuantizarPesos(const char *szNomeBase)
+{
+  TRede tRede;
+  TRedeQuantizada tQuantizada;
+  TDatabase *ptAvaliacao = &tDatabaseTreino;
+  TReal **ppdSaida = NULL, **ppdSaidaQuantizada = NULL;
+  signed char *pcTrabalho = NULL;
+  char vcArquivoQuantizado[MAX_LINHA + 1];
+  double *pdErroMaximo = NULL, *pdErroQuadrado = NULL;
+  double dDiferenca, dMseOriginal = 0.0, dMseQuantizada = 0.0, dTempoOriginal, dTempoQuantizada;
+  size_t tamOriginal = 0, tamQuantizada;
+  clock_t tInicio;
+  int i, j, l, r, iRepeticoes;
+
+  // Pesos (de preferencia os binarios atualizados, sem perda de precisao) e registros de calibracao (.lrn ou
+  // log no mesmo formato); a avaliacao usa o database de generalizacao, se existir, ou a propria calibracao
+  if (!CarregarRede(&tRede, EscolherArquivo(vcArquivoPesosBinario, vcArquivoPesos))) {
+    fprintf(stderr, "ERRO: Nao foi possivel carregar os pesos de %s\n", szNomeBase);
+    return 0;
+  }
+  if (!CarregarDatabase(&tDatabaseTreino, vcArquivoCalibracao)) {
+    DestruirRede(&tRede);
+    return 0;
   }
+  sprintf(vcArquivoGenera, "%s.tst", szNomeBase);
+  PreferirBinario(vcArquivoGenera);
+  if (ArquivoExiste(vcArquivoGenera) && CarregarDatabase(&tDatabaseGenera, vcArquivoGenera))
+    ptAvaliacao = &tDatabaseGenera;
+  else
+    strcpy(vcArquivoGenera, vcArquivoCalibracao);
+  if (tDatabaseTreino.iNumEntradas != tRede.iNumEntradas || ptAvaliacao->iNumEntradas != tRede.iNumEntradas ||
+      ptAvaliacao->iNumSaidas != tRede.iNumSaidas || ptAvaliacao->iNumRegistros < 1) {
+    fprintf(stderr, "ERRO: Os pesos nao correspondem aos databases\n");
+    DestruirRede(&tRede);
+    DesalocarDatabases();
+    return 0;
+  }
+
+  // Calibra, quantiza e grava <base>.wtsq
+  sprintf(vcArquivoQuantizado, "%s.wts%s", szNomeBase, EXTENSAO_QUANTIZADA);
+  if (!QuantizarRede(&tQuantizada, &tRede, tDatabaseTreino.ppdRegistros, tDatabaseTreino.iNumRegistros)) {
+    DestruirRede(&tRede);
+    DesalocarDatabases();
+    return 0;
+  }
+  if (!SalvarRedeQuantizada(&tQuantizada, vcArquivoQuantizado)) {
+    fprintf(stderr, "ERRO: Nao foi possivel gravar %s\n", vcArquivoQuantizado);
+    DestruirRedeQuantizada(&tQuantizada);
+    DestruirRede(&tRede);
+    DesalocarDatabases();
+    return 0;
+  }
+  printf("Calibracao: %s (%d registros) -> %s\n", vcArquivoCalibracao, tDatabaseTreino.iNumRegistros,
+      vcArquivoQuantizado);
+
+  // Erro da rede int8 em relacao a original, por saida, e MSE de ambas em relacao as saidas desejadas
+  ppdSaida = AlocarSaidasRede(&tRede);
+  ppdSaidaQuantizada = AlocarSaidasQuantizada(&tQuantizada);
+  pcTrabalho = (signed char*) AlocarAlinhado(TamanhoTrabalhoQuantizado(&tQuantizada));
+  pdErroMaximo = (double*) calloc(tRede.iNumSaidas, sizeof(double));
+  pdErroQuadrado = (double*) calloc(tRede.iNumSaidas, sizeof(double));
+  for (r = 0; r < ptAvaliacao->iNumRegistros; r++) {
+    AtivarRede(&tRede, ptAvaliacao->ppdRegistros[r], ppdSaida);
+    AtivarRedeQuantizada(&tQuantizada, ptAvaliacao->ppdRegistros[r], pcTrabalho, ppdSaidaQuantizada);
+    for (j = 0; j < tRede.iNumSaidas; j++) {
+      dDiferenca = fabs(ppdSaidaQuantizada[tRede.iNumCamadas - 1][j] - ppdSaida[tRede.iNumCamadas - 1][j]);
+      pdErroMaximo[j] = MAXIMO(pdErroMaximo[j], dDiferenca);
+      pdErroQuadrado[j] += QUADRADO(dDiferenca);
+    }
+    dMseOriginal += SomaQuadradosDiferenca(&ptAvaliacao->ppdRegistros[r][tRede.iNumEntradas],
+        ppdSaida[tRede.iNumCamadas - 1], tRede.iNumSaidas);
+    dMseQuantizada += SomaQuadradosDiferenca(&ptAvaliacao->ppdRegistros[r][tRede.iNumEntradas],
+        ppdSaidaQuantizada[tRede.iNumCamadas - 1], tRede.iNumSaidas);
+  }
+  printf("Avaliacao: %s (%d registros)\n", vcArquivoGenera, ptAvaliacao->iNumRegistros);
+  printf("Saida  Erro maximo  Erro RMS\n");
+  for (j = 0; j < tRede.iNumSaidas; j++)
+    printf("%-6d %.3e    %.3e\n", j, pdErroMaximo[j], sqrt(pdErroQuadrado[j] / ptAvaliacao->iNumRegistros));
+  printf("MSE: original %f, int8 %f\n", dMseOriginal / ((double) tRede.iNumSaidas * ptAvaliacao->iNumRegistros),
+      dMseQuantizada / ((double) tRede.iNumSaidas * ptAvaliacao->iNumRegistros));
+
+  // Memoria lida por ativacao (pesos com o padding das linhas) e tempo medio por registro
+  for (l = 0; l < tRede.iNumCamadas; l++)
+    tamOriginal += sizeof(TReal) * tRede.vtCamadas[l].iNumNeuronios * tRede.vtCamadas[l].iStride;
+  tamQuantizada = MemoriaRedeQuantizada(&tQuantizada);
+  iRepeticoes = 1 + ATIVACOES_MEDICAO / ptAvaliacao->iNumRegistros;
+  tInicio = clock();
+  for (i = 0; i < iRepeticoes; i++) {
+    for (r = 0; r < ptAvaliacao->iNumRegistros; r++)
+      AtivarRede(&tRede, ptAvaliacao->ppdRegistros[r], ppdSaida);
+  }
+  dTempoOriginal = (double) (clock() - tInicio) / CLOCKS_PER_SEC * 1.0e9 / ((double) iRepeticoes *
+      ptAvaliacao->iNumRegistros);
+  tInicio = clock();
+  for (i = 0; i < iRepeticoes; i++) {
+    for (r = 0; r < ptAvaliacao->iNumRegistros; r++)
+      AtivarRedeQuantizada(&tQuantizada, ptAvaliacao->ppdRegistros[r], pcTrabalho, ppdSaidaQuantizada);
+  }
+  dTempoQuantizada = (double) (clock() - tInicio) / CLOCKS_PER_SEC * 1.0e9 / ((double) iRepeticoes *
+      ptAvaliacao->iNumRegistros);
+  printf("Pesos: original %lu bytes, int8 %lu bytes (%.2fx menor)\n", (unsigned long) tamOriginal,
+      (unsigned long) tamQuantizada, (double) tamOriginal / tamQuantizada);
+  printf("Ativacao (%s): original %.1f ns, int8 %.1f ns (%.2fx)\n", NomeNivelVetorial(NivelVetorial()), dTempoOriginal,
+      dTempoQuantizada, dTempoOriginal / dTempoQuantizada);
+
+  // Finalizacao
+  free(pdErroMaximo);
+  free(pdErroQuadrado);
+  LiberarAlinhado(pcTrabalho);
+  LiberarSaidasQuantizada(&tQuantizada, ppdSaidaQuantizada);
+  LiberarSaidasRede(&tRede, ppdSaida);
+  DestruirRedeQuantizada(&tQuantizada);
+  DestruirRede(&tRede);
+  DesalocarDatabases();
+  return 1;
 }
 
 
-void AlocarMemoriaAnn()
+int GerarControladorCompilado(const char *szNomeBase)
 {
+  const char *szArquivoPesos = EscolherArquivo(vcArquivoPesosBinario, vcArquivoPesos);
+  TRede tRede;
   int i;
 
-  // Aloca memoria para a camada oculta
-  ppdPesoOculto = (double**) malloc(sizeof(double*) * iNumeroOcultos);
-  for (i = 0; i < iNumeroOcultos; i++)
-    ppdPesoOculto[i] = (double*) malloc(sizeof(double) * (iNumeroEntradas + 1));
-  pdCampoOculto = (double*) malloc(sizeof(double) * iNumeroOcultos);
+  // Pesos (de preferencia os binarios atualizados, sem perda de precisao) e registros de verificacao do
+  // controlador, do database de generalizacao ou, na falta dele, do de treinamento
+  if (!CarregarRede(&tRede, szArquivoPesos)) {
+    fprintf(stderr, "ERRO: Nao foi possivel carregar os pesos de %s\n", szNomeBase);
+    return 0;
+  }
+  for (i = 0; i < 2; i++) {
+    sprintf(vcArquivoGenera, "%s.%s", szNomeBase, (i == 0 ? "tst" : "lrn"));
+    PreferirBinario(vcArquivoGenera);
+    if (ArquivoExiste(vcArquivoGenera))
+      break;
+  }
+  if (i == 2 || !CarregarDatabase(&tDatabaseGenera, vcArquivoGenera)) {
+    fprintf(stderr, "ERRO: Nenhum database de %s para verificar o controlador\n", szNomeBase);
+    DestruirRede(&tRede);
+    return 0;
+  }
+  if (tDatabaseGenera.iNumEntradas != tRede.iNumEntradas) {
+    fprintf(stderr, "ERRO: Os pesos nao correspondem ao database %s\n", vcArquivoGenera);
+    DestruirRede(&tRede);
+    DesalocarDatabases();
+    return 0;
+  }
+
+  // Grava o cabecalho com os pesos e as saidas de referencia dos primeiros registros
+  i = GerarControlador(&tRede, szNomeBase, tDatabaseGenera.ppdRegistros, tDatabaseGenera.iNumRegistros,
+      vcArquivoControlador);
+  if (i)
+    printf("%s -> %s (verificacao: %d registros de %s)\n", szArquivoPesos, vcArquivoControlador,
+        MINIMO(tDatabaseGenera.iNumRegistros, MAX_REGISTROS_VERIFICACAO), vcArquivoGenera);
+  DestruirRede(&tRede);
+  DesalocarDatabases();
+  return i;
+}
+
 
-  // Aloca memoria para a camada de saida
-  ppdPesoSaida = (double**) malloc(sizeof(double*) * iNumeroSaidas);
-  for (i = 0; i < iNumeroSaidas; i++)
-    ppdPesoSaida[i] = (double*) malloc(sizeof(double) * (iNumeroOcultos + 1));
-  pdSaidaObtida = (double*) malloc(sizeof(double) * iNumeroSaidas);
-  pdAjusteSaida = (double*) malloc(sizeof(double) * iNumeroSaidas);
+void ImprimirParametros(TTreino *ptTreino)
+{
+  const TParametros *ptPar = &ptTreino->tParametros;
+  FILE *fp = ptTreino->fpSaida;
+  char vcCamadas[MAX_LINHA + 1];
+  int l;
+
+  // Monta a lista de neuronios das camadas (entradas, ocultas e saidas)
+  sprintf(vcCamadas, "%-4d ", iNumeroEntradas);
+  for (l = 0; l < ptTreino->tRede.iNumCamadas; l++)
+    sprintf(&vcCamadas[strlen(vcCamadas)], "%-4d ", ptTreino->tRede.vtCamadas[l].iNumNeuronios);
+
+  // Imprime os parametros da simulacao
+  fprintf(fp, "*******************************************************\n");
+  fprintf(fp, "* Arquivo de treinamento......: %-13s (%-5d) *\n", vcArquivoTreino, iNumeroRegistrosTreino);
+  fprintf(fp, "* Arquivo de generalizacao....: %-13s (%-5d) *\n", vcArquivoGenera, iNumeroRegistrosGenera);
+  fprintf(fp, "* Neuronios nas camadas.......: %-22s*\n", vcCamadas);
+  fprintf(fp, "* Passo, init_pesos e epocas..: %7.5f %6.4f %6d *\n", ptPar->dPasso, ptPar->dInitPesos,
+      ptPar->iMaximoEpocas);
+  fprintf(fp, "* Generalizacao e random seed.: %-5d %.10lu      *\n", ptPar->iFreqGeneral, ptPar->ulRandomSeed);
+  fprintf(fp, "* Lote, threads e kernels.....: %-6d %-4d %-9s *\n", ptPar->iTamanhoLote, ptTreino->iNumeroThreads,
+      NomeNivelVetorial(NivelVetorial()));
+  fprintf(fp, "* Precisao (pesos/ativacoes)..: %-22s*\n", (sizeof(TReal) == sizeof(double) ? "float64" :
+      (ptPar->iPesosMestres ? "float32 + mestre64" : "float32")));
+  if (ptPar->iAlgoritmo != ALGORITMO_BACKPROP)
+    fprintf(fp, "* Algoritmo de treinamento....: %-22s*\n", vszNomesAlgoritmos[ptPar->iAlgoritmo]);
+  if (ptPar->iRegra != REGRA_SGD)
+    fprintf(fp, "* Regra de ajuste e momento...: %-9s %-12.4f*\n", vszNomesRegras[ptPar->iRegra], ptPar->dMomento);
+  if (ptPar->iFreqQuadrados > 0)
+    fprintf(fp, "* Minimos quadrados na saida..: a cada %-7d epocas *\n", ptPar->iFreqQuadrados);
+  if (iTamanhoJanela > 0)
+    fprintf(fp, "* Streaming (janela e blocos).: %-10d %-11d*\n", tFluxoTreino.iTamanhoJanela, tFluxoTreino.iNumBlocos);
+  fprintf(fp, "*******************************************************\n");
 }
 
 
-void InicializarPesos()
+int TreinarRede(TTreino *ptTreino, double *pdMenorErro, int *piMelhorEpoca, int *piEpocas)
 {
-  int i, j;
+  double dMenorErro;
+
+  // Inicializa os pesos da rede ja alocada e realiza todo o aprendizado
+  if (!IniciarAprendizado(ptTreino))
+    return 0;
+  ContinuarAprendizado(ptTreino, 0);
+  dMenorErro = EncerrarAprendizado(ptTreino, piMelhorEpoca, piEpocas);
+  if (pdMenorErro != NULL)
+    *pdMenorErro = dMenorErro;
+  return 1;
+}
+
 
-  // Inicializa os pesos ocultos e os passos iniciais
-  for (i = 0; i < iNumeroOcultos; i++) {
-    for (j = 0; j <= iNumeroEntradas; j++)
-      ppdPesoOculto[i][j] = ((double) rand() / RAND_MAX - 0.5) * dInitPesos * 2.0;
+TTreino *CriarJob(const char *szNomeBase, const int iJob, const char *szConfiguracao, FILE *fpSaida)
+{
+  TParametros tJob = tParametros;
+  TTreino *ptTreino;
+  char vcNome[MAX_LINHA + 1], vcValor[MAX_VALOR + 1];
+  char cParametro;
+  int n;
+
+  // A configuracao do job ("-c valor ...") e aplicada sobre uma copia dos parametros da linha de comando;
+  // cada job grava <base>_<job>.wts/.wtsb/.out e apenas os do vencedor sao mantidos pela varredura
+  for (; sscanf(szConfiguracao, " -%c %64s%n", &cParametro, vcValor, &n) == 2; szConfiguracao += n)
+    AplicarParametro(&tJob, cParametro, vcValor);
+  ValidarParametros(&tJob);
+  sprintf(vcNome, "%s_%d", szNomeBase, iJob + 1);
+  if ((ptTreino = CriarTreino(&tJob, vcNome)) == NULL)
+    return NULL;
+  ptTreino->fpSaida = fpSaida;
+  if (!AlocarMemoriaAnn(ptTreino) || !IniciarAprendizado(ptTreino)) {
+    LiberarTreino(ptTreino);
+    return NULL;
   }
+  return ptTreino;
+}
+
+
+int TreinarJob(TTreino *ptTreino, const int iDegrau, const int iNumThreads, double *pdMenorErro, int *piMelhorEpoca,
+    int *piEpocas)
+{
+  int iPausado;
+
+  // Continua o aprendizado com as threads do degrau ate o proximo degrau (ou ate o fim); o resultado parcial
+  // e o MSE da melhor epoca ate aqui
+  if (iNumThreads != ptTreino->iNumeroThreads)
+    RedimensionarThreads(ptTreino, iNumThreads);
+  iPausado = ContinuarAprendizado(ptTreino, iDegrau);
+  *pdMenorErro = ptTreino->dMenorErro;
+  *piMelhorEpoca = ptTreino->iMelhorEpoca;
+  *piEpocas = ptTreino->iEpoca - 1;
+  return iPausado;
+}
+
+
+void EncerrarJob(TTreino *ptTreino, double *pdMenorErro, int *piMelhorEpoca, int *piEpocas)
+{
+  // Conclui o aprendizado (tambem o de um job eliminado no degrau) e libera o contexto
+  *pdMenorErro = EncerrarAprendizado(ptTreino, piMelhorEpoca, piEpocas);
+  LiberarTreino(ptTreino);
+}
 
-  // Inicializa os pesos de saida e os passos iniciais
-  for (i = 0; i < iNumeroSaidas; i++) {
-    for (j = 0; j <= iNumeroOcultos; j++)
-      ppdPesoSaida[i][j] = ((double) rand() / RAND_MAX - 0.5) * dInitPesos * 2.0;
+
+TTreino *CriarTreino(const TParametros *ptParametros, const char *szNomeSaida)
+{
+  TTreino *ptTreino;
+  int iNumRegistros = (iTamanhoJanela > 0 ? tFluxoTreino.iTamanhoJanela : iNumeroRegistrosTreino);
+
+  // Contexto zerado com os hiperparametros e os arquivos de saida <nome>.wts/.wtsb/.out (o relatorio do
+  // aprendizado vai para a saida padrao ou, na varredura, para o log do job)
+  ptTreino = (TTreino*) calloc(1, sizeof(TTreino));
+  if (ptTreino == NULL) {
+    fprintf(stderr, "ERRO: Memoria insuficiente para o treinamento\n");
+    return NULL;
+  }
+  ptTreino->tParametros = *ptParametros;
+  ptTreino->iNumeroThreads = ptParametros->iNumeroThreads;
+  ptTreino->dAmortecimentoLM = AMORTECIMENTO_LM;
+  ptTreino->vdPotenciaLote[0] = ptTreino->vdPotenciaLote[1] = 1.0;
+  ptTreino->fpSaida = stdout;
+  sprintf(ptTreino->vcArquivoPesos, "%s.wts", szNomeSaida);
+  sprintf(ptTreino->vcArquivoPesosBinario, "%s.wts%s", szNomeSaida, EXTENSAO_PESOS_BINARIO);
+  sprintf(ptTreino->vcArquivoSaida, "%s.out", szNomeSaida);
+
+  // Indices da permutacao e linhas reunidas na ordem da epoca (o database nunca e reordenado)
+  ptTreino->piOrdemTreino = (int*) malloc(sizeof(int) * ((size_t) iNumRegistros + 1));
+  ptTreino->ppdEpocaTreino = (TReal**) malloc(sizeof(TReal*) * ((size_t) iNumRegistros + 1));
+  if (ptTreino->piOrdemTreino == NULL || ptTreino->ppdEpocaTreino == NULL) {
+    fprintf(stderr, "ERRO: Memoria insuficiente para o database\n");
+    LiberarTreino(ptTreino);
+    return NULL;
   }
+  return ptTreino;
 }
 
 
-void AlteraCamadaOculta(const int iNumNeronios)
+TReal **EmbaralharRegistros(TTreino *ptTreino, TReal **ppdRegistros, const int iNumRegistros, const int iEpoca,
+    const int iSubfluxo)
 {
-  int i;
+  TGerador tGerador;
+  int k;
+
+  // A ordem da epoca (ou do bloco iSubfluxo no streaming) depende apenas do random seed
+  IniciarGerador(&tGerador, ptTreino->tParametros.ulRandomSeed, FLUXO_REGISTROS, iEpoca, iSubfluxo);
+  GerarPermutacao(&tGerador, ptTreino->piOrdemTreino, iNumRegistros);
+  for (k = 0; k < iNumRegistros; k++)
+    ptTreino->ppdEpocaTreino[k] = ppdRegistros[ptTreino->piOrdemTreino[k]];
+  return ptTreino->ppdEpocaTreino;
+}
 
-  // Desaloca a memoria dos neuronios individuais se a camada diminuir
-  for (i = iNumNeronios; i < iNumeroOcultos; i++) {
-    if (ppdPesoOculto[i] != NULL) {
-      free(ppdPesoOculto[i]);
-      ppdPesoOculto[i] = NULL;
-    }
+
+int AlocarMemoriaAnn(TTreino *ptTreino)
+{
+  int viNeuronios[MAX_CAMADAS], viAtivacoes[MAX_CAMADAS];
+  int l;
+
+  // As camadas ocultas dos parametros sao seguidas pela camada de saida linear
+  for (l = 0; l < ptTreino->tParametros.iNumeroCamadasOcultas; l++) {
+    viNeuronios[l] = ptTreino->tParametros.viNumeroOcultos[l];
+    viAtivacoes[l] = ptTreino->tParametros.viAtivacaoOculta[l];
+  }
+  viNeuronios[l] = iNumeroSaidas;
+  viAtivacoes[l] = ATIVACAO_LINEAR;
+  if (!CriarRede(&ptTreino->tRede, iNumeroEntradas, ptTreino->tParametros.iNumeroCamadasOcultas + 1, viNeuronios,
+      viAtivacoes)) {
+    fprintf(stderr, "ERRO: Topologia invalida\n");
+    return 0;
   }
 
-  // Altera o tamanho da camada oculta
-  ppdPesoOculto = (double**) realloc(ppdPesoOculto, sizeof(double*) * iNumNeronios);
-  pdCampoOculto = (double*) realloc(pdCampoOculto, sizeof(double) * iNumNeronios);
+  // Buffers de ativacao da thread coordenadora
+  AlocarPropagacao(ptTreino, &ptTreino->tPropagacaoAnn);
+  ptTreino->pdSaidaObtida = ptTreino->tPropagacaoAnn.ppdSaida[ptTreino->tRede.iNumCamadas - 1];
+  return 1;
+}
+
 
-   // Aloca a memoria dos neuronios individuais se a camada aumentar
-  for (i = iNumeroOcultos; i < iNumNeronios; i++)
-    ppdPesoOculto[i] = (double*) malloc(sizeof(double) * (iNumeroEntradas + 1));
+void AlocarPropagacao(TTreino *ptTreino, TPropagacao *ptProp)
+{
+  // Saidas, erros retropropagados e ajustes de cada camada
+  ptProp->ppdSaida = AlocarSaidasRede(&ptTreino->tRede);
+  ptProp->ppdErro = AlocarSaidasRede(&ptTreino->tRede);
+  ptProp->ppdAjuste = AlocarSaidasRede(&ptTreino->tRede);
+  ptProp->vdPotencia[0] = ptProp->vdPotencia[1] = 1.0;
+}
+
+
+void LiberarPropagacao(TTreino *ptTreino, TPropagacao *ptProp)
+{
+  LiberarSaidasRede(&ptTreino->tRede, ptProp->ppdSaida);
+  LiberarSaidasRede(&ptTreino->tRede, ptProp->ppdErro);
+  LiberarSaidasRede(&ptTreino->tRede, ptProp->ppdAjuste);
+  ptProp->ppdSaida = ptProp->ppdErro = ptProp->ppdAjuste = NULL;
+}
 
-  // Altera o numero de pesos na camada de saida
-  for (i = 0; i < iNumeroSaidas; i++)
-    ppdPesoSaida[i] = (double*) realloc(ppdPesoSaida[i], sizeof(double) * (iNumNeronios + 1));
 
-  // Altera o tamanho da camada na variavel global
-  iNumeroOcultos = iNumNeronios;
+void InicializarPesos(TTreino *ptTreino)
+{
+  int i, j, l;
+  TCamada *ptCamada;
+  TGerador tGerador;
+
+  // Inicializa os pesos de cada camada, da primeira oculta ate a saida
+  IniciarGerador(&tGerador, ptTreino->tParametros.ulRandomSeed, FLUXO_PESOS, 0, 0);
+  for (l = 0; l < ptTreino->tRede.iNumCamadas; l++) {
+    ptCamada = &ptTreino->tRede.vtCamadas[l];
+    for (i = 0; i < ptCamada->iNumNeuronios; i++) {
+      for (j = 0; j <= ptCamada->iNumEntradas; j++)
+        ptCamada->pdPeso[i * ptCamada->iStride + j] =
+            (SortearReal(&tGerador) - 0.5) * ptTreino->tParametros.dInitPesos * 2.0;
+    }
+  }
 }
 
 
-double RealizarAprendizado()
+void AlteraCamadaOculta(TTreino *ptTreino, const int iCamada, const int iNumNeronios)
 {
-  register int k, l;
-  int iMelhorEpoca = 0;
-  double dErroMedioTreino = 0.0, dErroMedioTeste = 0.0, dMenorErro = 1.0e32;
-  clock_t clInicio = clock();
+  int i, j;
+  TCamada *ptOculta = &ptTreino->tRede.vtCamadas[iCamada];
+  TCamada *ptProxima = &ptTreino->tRede.vtCamadas[iCamada + 1];
+  int iNovoStride = STRIDE(iNumNeronios + 1);
+  int iMinimo = MINIMO(iNumNeronios, ptOculta->iNumNeuronios);
+  int iMestres = (ptOculta->pdMestre != NULL), iEstado = (ptOculta->pdVelocidade != NULL);
+  TReal *pdNovoPeso = NULL;
+
+  // Os buffers de ativacao, as copias mestres e o estado da regra de ajuste dependem do tamanho das camadas
+  LiberarPropagacao(ptTreino, &ptTreino->tPropagacaoAnn);
+  LiberarPesosMestres(&ptTreino->tRede);
+  LiberarEstadoAjuste(&ptTreino->tRede);
+
+  // Realoca a matriz da camada oculta mantendo as linhas dos neuronios que permanecem
+  pdNovoPeso = (TReal*) AlocarAlinhado(sizeof(TReal) * iNumNeronios * ptOculta->iStride);
+  memcpy(pdNovoPeso, ptOculta->pdPeso, sizeof(TReal) * iMinimo * ptOculta->iStride);
+  LiberarAlinhado(ptOculta->pdPeso);
+  ptOculta->pdPeso = pdNovoPeso;
+
+  // Realoca a matriz da camada seguinte com o novo stride (o bias passa para a coluna iNumNeronios)
+  pdNovoPeso = (TReal*) AlocarAlinhado(sizeof(TReal) * ptProxima->iNumNeuronios * iNovoStride);
+  for (i = 0; i < ptProxima->iNumNeuronios; i++) {
+    for (j = 0; j < iMinimo; j++)
+      pdNovoPeso[i * iNovoStride + j] = ptProxima->pdPeso[i * ptProxima->iStride + j];
+    pdNovoPeso[i * iNovoStride + iNumNeronios] = ptProxima->pdPeso[i * ptProxima->iStride + ptProxima->iNumEntradas];
+  }
+  LiberarAlinhado(ptProxima->pdPeso);
+  ptProxima->pdPeso = pdNovoPeso;
+  ptProxima->iStride = iNovoStride;
+  ptProxima->iNumEntradas = iNumNeronios;
+
+  // Altera o tamanho da camada
+  ptOculta->iNumNeuronios = iNumNeronios;
+  ptTreino->tParametros.viNumeroOcultos[iCamada] = iNumNeronios;
+  AlocarPropagacao(ptTreino, &ptTreino->tPropagacaoAnn);
+  ptTreino->pdSaidaObtida = ptTreino->tPropagacaoAnn.ppdSaida[ptTreino->tRede.iNumCamadas - 1];
+  if (iMestres)
+    CriarPesosMestres(&ptTreino->tRede);
+  if (iEstado)
+    IniciarRegra(ptTreino);
+}
 
-  // Realiza o aprendizado neural
-  for (l = 1; l <= iMaximoEpocas && !iEncerrarAprendizado; l++) {
-    // Treina uma epoca
-    EmbaralharDatabase(ppdDatabaseTreino, iNumeroRegistrosTreino);
-    for (k = 0; k < iNumeroRegistrosTreino; k++) {
-      AtivarAnn(ppdDatabaseTreino[k]);
-      AjustarPesos(ppdDatabaseTreino[k]);
+
+double TreinarRegistros(TTreino *ptTreino, TReal **ppdRegistros, const int iNumRegistros, const int iCalcularErro)
+{
+  register int k;
+  double dErro = 0.0;
+
+  if (ptTreino->tParametros.iTamanhoLote > 1) {
+    // Treinamento em lote: um unico ajuste dos pesos por lote (sincrono e deterministico com -j)
+    for (k = 0; k < iNumRegistros; k += ptTreino->tParametros.iTamanhoLote)
+      dErro += TreinarLote(ptTreino, &ppdRegistros[k], MINIMO(ptTreino->tParametros.iTamanhoLote, iNumRegistros - k),
+          iCalcularErro);
+  }
+  else if (ptTreino->iNumeroThreads > 1) {
+    // Hogwild: as threads ajustam os pesos compartilhados sem sincronizacao
+    dErro = TreinarHogwild(ptTreino, ppdRegistros, iNumRegistros, iCalcularErro);
+  }
+  else {
+    for (k = 0; k < iNumRegistros; k++) {
+      AtivarAnn(ptTreino, ppdRegistros[k]);
+      AjustarPesos(ptTreino, ppdRegistros[k]);
       // Calcula as estatisticas do treinamento na epoca de relatorio
-      if (!(l % iFreqRelator))
-        dErroMedioTreino += CalcularErroQuadrado(&ppdDatabaseTreino[k][iNumeroEntradas]);
+      if (iCalcularErro)
+        dErro += CalcularErroQuadrado(ptTreino, &ppdRegistros[k][iNumeroEntradas]);
     }
+  }
+  return dErro;
+}
+
+
+int IniciarAprendizado(TTreino *ptTreino)
+{
+  const TParametros *ptPar = &ptTreino->tParametros;
+  double dInicio = TempoReal();
+
+  // Inicializa os pesos da rede ja alocada
+  InicializarPesos(ptTreino);
+  if (ptPar->iPesosMestres && !CriarPesosMestres(&ptTreino->tRede)) {
+    fprintf(stderr, "ERRO: Nao foi possivel alocar os pesos mestres\n");
+    return 0;
+  }
+  ImprimirParametros(ptTreino);
+
+  // Aloca os buffers do treinamento em lote ou dos trabalhadores Hogwild
+  if (ptPar->iTamanhoLote > 1)
+    AlocarMemoriaLote(ptTreino);
+  else if (ptTreino->iNumeroThreads > 1)
+    AlocarTrabalhadores(ptTreino);
+  AlocarAvaliadores(ptTreino);
+  IniciarRegra(ptTreino);
+  if (ptPar->iAlgoritmo == ALGORITMO_LM && !AlocarLevenbergMarquardt(ptTreino))
+    ptTreino->iEncerrarAprendizado = 1;
+  else if (ptPar->iAlgoritmo == ALGORITMO_RPROP || ptPar->iAlgoritmo == ALGORITMO_LBFGS)
+    AlocarOtimizador(ptTreino);
+  else if (ptPar->iFreqQuadrados > 0)
+    AlocarEquacoesNormais(ptTreino, ptTreino->tRede.vtCamadas[ptTreino->tRede.iNumCamadas - 1].iNumEntradas + 1,
+        iNumeroSaidas);
+  IniciarGravador(ptTreino);
+
+  // O aprendizado comeca na epoca 1 e pode ser retomado apos cada degrau da varredura
+  ptTreino->iEpoca = 1;
+  ptTreino->dMenorErro = 1.0e32;
+  ptTreino->dTempoAprendizado = TempoReal() - dInicio;
+  return 1;
+}
 
-    // Teste de generalizacao
-    if (!(l % iFreqGeneral)) {
-      for (k = 0; k < iNumeroRegistrosGenera; k++) {
-        // Ativa a ANN e verifica os acertos
-        AtivarAnn(ppdDatabaseGenera[k]);
-        dErroMedioTeste += CalcularErroQuadrado(&ppdDatabaseGenera[k][iNumeroEntradas]);
+
+int ContinuarAprendizado(TTreino *ptTreino, const int iDegrau)
+{
+  const TParametros *ptPar = &ptTreino->tParametros;
+  register int l;
+  int iNumBloco, iPausado = 0, b;
+  TReal **ppdBloco;
+  TGerador tGerador;
+  double dErroMedioTeste, dInicio = TempoReal();
+
+  // Realiza o aprendizado neural ate o fim ou, na varredura, ate o degrau iDegrau
+  for (l = ptTreino->iEpoca; l <= ptPar->iMaximoEpocas && !ptTreino->iEncerrarAprendizado && !iPausado; l++) {
+    // Resolve a camada de saida (linear) para as ativacoes ocultas atuais; o gradiente so ajusta as ocultas
+    if (ptPar->iFreqQuadrados > 0 && !ptTreino->iSaidaResolvida && !((l - 1) % ptPar->iFreqQuadrados))
+      AjustarSaidaMinimosQuadrados(ptTreino);
+
+    // Treina uma epoca
+    if (ptPar->iAlgoritmo != ALGORITMO_BACKPROP) {
+      // Levenberg-Marquardt, RPROP ou L-BFGS: uma iteracao sobre todo o database (em memoria ou pelo fluxo)
+      ptTreino->dErroMedioTreino += TreinarLoteCompleto(ptTreino, !(l % ptPar->iFreqRelator));
+    }
+    else if (iTamanhoJanela > 0) {
+      // Streaming: blocos em ordem aleatoria, embaralhados dentro da janela
+      IniciarGerador(&tGerador, ptPar->ulRandomSeed, FLUXO_BLOCOS, l, 0);
+      GerarPermutacao(&tGerador, piOrdemBlocos, tFluxoTreino.iNumBlocos);
+      IniciarPassagemFluxo(&tFluxoTreino, piOrdemBlocos);
+      for (b = 0; (ppdBloco = ProximoBlocoFluxo(&tFluxoTreino, &iNumBloco)) != NULL; b++) {
+        ppdBloco = EmbaralharRegistros(ptTreino, ppdBloco, iNumBloco, l, piOrdemBlocos[b]);
+        ptTreino->dErroMedioTreino += TreinarRegistros(ptTreino, ppdBloco, iNumBloco, !(l % ptPar->iFreqRelator));
       }
-      dErroMedioTeste /= (double) iNumeroSaidas * iNumeroRegistrosGenera;
+    }
+    else {
+      ppdBloco = EmbaralharRegistros(ptTreino, ppdDatabaseTreino, iNumeroRegistrosTreino, l, 0);
+      ptTreino->dErroMedioTreino += TreinarRegistros(ptTreino, ppdBloco, iNumeroRegistrosTreino,
+          !(l % ptPar->iFreqRelator));
+    }
+    ptTreino->iEpocasTreinadas++;
+    ptTreino->iSaidaResolvida = 0;
+
+    // Teste de generalizacao (sempre na thread coordenadora), tambem no degrau da reducao sucessiva para que
+    // os jobs sejam comparados na mesma epoca qualquer que seja o seu -g
+    if (!(l % ptPar->iFreqGeneral) || l == iDegrau) {
+      // A saida e resolvida para as ocultas desta epoca, para testar e gravar a rede resolvida
+      if (ptPar->iFreqQuadrados > 0)
+        ptTreino->iSaidaResolvida = AjustarSaidaMinimosQuadrados(ptTreino);
+      dErroMedioTeste = TestarGeneralizacao(ptTreino) / ((double) iNumeroSaidas * iNumeroRegistrosGenera);
       // Exibe as estatisticas
-      if (!(l % iFreqRelator)) {
-        printf("* EPOCA:%6d * TREINO: %9.6f * TESTE: %9.6f *\n", l,
-            dErroMedioTreino / (double) (iNumeroSaidas * iNumeroRegistrosTreino), dErroMedioTeste);
+      if (!(l % ptPar->iFreqRelator)) {
+        fprintf(ptTreino->fpSaida, "* EPOCA:%6d * TREINO: %9.6f * TESTE: %9.6f *\n", l,
+            ptTreino->dErroMedioTreino / (double) (iNumeroSaidas * iNumeroRegistrosTreino), dErroMedioTeste);
+      }
+      // Registra a primeira epoca que atinge o MSE alvo (tempo ate o alvo)
+      if (ptPar->dMseAlvo > 0.0 && !ptTreino->iEpocaAlvo && dErroMedioTeste <= ptPar->dMseAlvo) {
+        ptTreino->iEpocaAlvo = l;
+        ptTreino->dTempoAlvo = ptTreino->dTempoAprendizado + TempoReal() - dInicio;
       }
       // Verifica se foi a melhor epoca
-      if (dMenorErro > dErroMedioTeste) {
-        dMenorErro = dErroMedioTeste;
-        iMelhorEpoca = l;
-        // Salva as ativacoes e os pesos na melhor epoca
-        GerarArquivoSaidas(ppdDatabaseGenera, iNumeroRegistrosGenera, vcArquivoSaida);
-        SalvarPesos(vcArquivoPesos);
+      if (ptTreino->dMenorErro > dErroMedioTeste) {
+        ptTreino->dMenorErro = dErroMedioTeste;
+        ptTreino->iMelhorEpoca = l;
+        // Salva as ativacoes e os pesos na melhor epoca (em segundo plano, a partir de uma copia)
+        SolicitarGravacao(ptTreino);
       }
       // Reinicializa as estatisticas
-      dErroMedioTreino = dErroMedioTeste = 0.0;
+      ptTreino->dErroMedioTreino = 0.0;
 
       // Verifica a parada prematura
-      if (l - iMelhorEpoca > iMaximoEpocas / 5) {
-        iEncerrarAprendizado = 1;
+      if (l - ptTreino->iMelhorEpoca > ptPar->iMaximoEpocas / 5) {
+        ptTreino->iEncerrarAprendizado = 1;
       }
+
+      // Degrau da reducao sucessiva (varredura): pausa o aprendizado ate a decisao de continuar
+      if (l == iDegrau && l < ptPar->iMaximoEpocas && !ptTreino->iEncerrarAprendizado)
+        iPausado = 1;
     }
   }
+  ptTreino->iEpoca = l;
+  ptTreino->dTempoAprendizado += TempoReal() - dInicio;
+  return iPausado;
+}
 
-  // Relatorio final
-  printf("*******************************************************\n");
-  printf("* Melhor epoca: %-6d          MSE: %8.6f         *\n", iMelhorEpoca, dMenorErro);
-  printf("* Tempo total de aprendizado:%7.2f segundos         *\n",
-      (double) (clock() - clInicio) / CLOCKS_PER_SEC);
-  printf("*******************************************************\n");
 
-  // Retorna o erro MSE da melhor epoca
-  return dMenorErro;
+double EncerrarAprendizado(TTreino *ptTreino, int *piMelhorEpoca, int *piEpocas)
+{
+  const TParametros *ptPar = &ptTreino->tParametros;
+  FILE *fp = ptTreino->fpSaida;
+  double dInicio = TempoReal(), dTempoTotal;
+
+  // Relatorio final (apos a gravacao pendente da melhor epoca)
+  EncerrarGravador(ptTreino);
+  DesalocarMemoriaLote(ptTreino);
+  DesalocarTrabalhadores(ptTreino);
+  DesalocarAvaliadores(ptTreino);
+  DesalocarEquacoesNormais(ptTreino);
+  DesalocarLevenbergMarquardt(ptTreino);
+  DesalocarOtimizador(ptTreino);
+  LiberarEstadoAjuste(&ptTreino->tRede);
+  dTempoTotal = ptTreino->dTempoAprendizado + TempoReal() - dInicio;
+  fprintf(fp, "*******************************************************\n");
+  fprintf(fp, "* Melhor epoca: %-6d          MSE: %8.6f         *\n", ptTreino->iMelhorEpoca, ptTreino->dMenorErro);
+  fprintf(fp, "* Tempo total de aprendizado:%7.2f segundos         *\n", dTempoTotal);
+  fprintf(fp, "* Amostras por segundo:%12.0f (%3d threads)     *\n",
+      (double) ptTreino->iEpocasTreinadas * iNumeroRegistrosTreino / (dTempoTotal > 0.0 ? dTempoTotal : 1.0e-9),
+      ptTreino->iNumeroThreads);
+  if (ptPar->dMseAlvo > 0.0 && ptTreino->iEpocaAlvo)
+    fprintf(fp, "* MSE alvo %9.6f: epoca %-6d %9.2f segundos *\n", ptPar->dMseAlvo, ptTreino->iEpocaAlvo,
+        ptTreino->dTempoAlvo);
+  else if (ptPar->dMseAlvo > 0.0)
+    fprintf(fp, "* MSE alvo %9.6f: %-32s*\n", ptPar->dMseAlvo, "nao atingido");
+  fprintf(fp, "*******************************************************\n");
+
+  // Retorna o erro MSE, a melhor epoca e as epocas treinadas
+  if (piMelhorEpoca != NULL)
+    *piMelhorEpoca = ptTreino->iMelhorEpoca;
+  if (piEpocas != NULL)
+    *piEpocas = ptTreino->iEpocasTreinadas;
+  return ptTreino->dMenorErro;
 }
 
 
-inline void AtivarAnn(const double *pdRegistro)
+void AlocarMemoriaLote(TTreino *ptTreino)
 {
-  register int i, j;
+  int t, l, iTamanho, iMaxTransposta = 0;
+  int iMaxRegistros = (ptTreino->tParametros.iTamanhoLote + ptTreino->iNumeroThreads - 1) / ptTreino->iNumeroThreads;
+  TCamada *ptCamada;
+  TLote *ptLote;
+
+  // Matriz de ativacoes l + 1 recebe as saidas da camada l, uma linha por registro, com uma coluna
+  // extra de 1.0 para o bias da camada seguinte (a matriz 0 recebe as entradas)
+  ptTreino->viStrideLote[0] = ptTreino->tRede.vtCamadas[0].iStride;
+  for (l = 0; l < ptTreino->tRede.iNumCamadas; l++)
+    ptTreino->viStrideLote[l + 1] = STRIDE(ptTreino->tRede.vtCamadas[l].iNumNeuronios + 1);
+
+  // Area das matrizes transpostas para o micro-kernel (pesos de uma camada ou ajustes da fatia do lote)
+  for (l = 0; l < ptTreino->tRede.iNumCamadas; l++) {
+    ptCamada = &ptTreino->tRede.vtCamadas[l];
+    iMaxTransposta = MAXIMO(iMaxTransposta, ptCamada->iNumNeuronios * MAXIMO(ptCamada->iNumEntradas, iMaxRegistros));
+  }
 
-  // Ativa a camada oculta
-  for (i = 0; i < iNumeroOcultos; i++) {
-    pdCampoOculto[i] = ppdPesoOculto[i][iNumeroEntradas];
-    for (j = 0; j < iNumeroEntradas; j++)
-      pdCampoOculto[i] += pdRegistro[j] * ppdPesoOculto[i][j];
-    pdCampoOculto[i] = tanh(pdCampoOculto[i]);
+  // Cada thread tem as matrizes da sua fatia do lote e o seu buffer de gradientes
+  ptTreino->ptLotes = (TLote*) malloc(sizeof(TLote) * ptTreino->iNumeroThreads);
+  for (t = 0; t < ptTreino->iNumeroThreads; t++) {
+    ptLote = &ptTreino->ptLotes[t];
+    memset(ptLote, 0, sizeof(TLote));
+    ptLote->ptTreino = ptTreino;
+    ptLote->pdTransposta = (TReal*) AlocarAlinhado(sizeof(TReal) * iMaxTransposta);
+    ptLote->vpdAtivacao[0] = (TReal*) AlocarAlinhado(sizeof(TReal) * iMaxRegistros * ptTreino->viStrideLote[0]);
+    for (l = 0; l < ptTreino->tRede.iNumCamadas; l++) {
+      ptCamada = &ptTreino->tRede.vtCamadas[l];
+      iTamanho = iMaxRegistros * ptTreino->viStrideLote[l + 1];
+      ptLote->vpdAtivacao[l + 1] = (TReal*) AlocarAlinhado(sizeof(TReal) * iTamanho);
+      ptLote->vpdErro[l] = (TReal*) AlocarAlinhado(sizeof(TReal) * iTamanho);
+      ptLote->vpdAjuste[l] = (TReal*) AlocarAlinhado(sizeof(TReal) * iTamanho);
+      ptLote->vpdGrad[l] = (TReal*) AlocarAlinhado(sizeof(TReal) * ptCamada->iNumNeuronios * ptCamada->iStride);
+    }
   }
 
-  // Ativa as saidas lineares
-  for (i = 0; i < iNumeroSaidas; i++) {
-    pdSaidaObtida[i] = ppdPesoSaida[i][iNumeroOcultos];
-    for (j = 0; j < iNumeroOcultos; j++)
-      pdSaidaObtida[i] += pdCampoOculto[j] * ppdPesoSaida[i][j];
+  // Cria as threads persistentes do treinamento sincrono (a thread 0 e a coordenadora)
+  if (ptTreino->iNumeroThreads > 1) {
+    ptTreino->iEncerrarThreadsLote = 0;
+    ptTreino->ptThreadsLote = (pthread_t*) malloc(sizeof(pthread_t) * ptTreino->iNumeroThreads);
+    pthread_barrier_init(&ptTreino->pbBarreiraLote, NULL, ptTreino->iNumeroThreads);
+    for (t = 1; t < ptTreino->iNumeroThreads; t++)
+      pthread_create(&ptTreino->ptThreadsLote[t], NULL, ExecutarThreadLote, &ptTreino->ptLotes[t]);
   }
 }
 
 
-inline void AjustarPesos(const double *pdRegistro)
+void MultiplicarMatrizesNT(const TReal *pdA, int iLdA, const TReal *pdB, int iLdB, TReal *pdC, int iLdC,
+    int iM, int iN, int iK, TReal *pdTransposta)
 {
-  register int i, j;
-  double dAjuste;
-
-  // Calcula o ajuste das saidas
-  for (i = 0; i < iNumeroSaidas; i++)
-    pdAjusteSaida[i] = (pdRegistro[iNumeroEntradas + i] - pdSaidaObtida[i]);
-
-  // Ajusta os pesos da camada oculta
-  for (i = 0; i < iNumeroOcultos; i++) {
-    dAjuste = 0.0;
-    for (j = 0; j < iNumeroSaidas; j++)
-      dAjuste += pdAjusteSaida[j] * ppdPesoSaida[j][i];
-    dAjuste *= dPasso * (1.0 - QUADRADO(pdCampoOculto[i]));
-    for (j = 0; j < iNumeroEntradas; j++)
-      ppdPesoOculto[i][j] += dAjuste * pdRegistro[j];
-    ppdPesoOculto[i][iNumeroEntradas] += dAjuste;
+  register int j;
+  int r;
+
+  // C(MxN) += A(MxK) * B(NxK)^T: B e transposta (KxN) para que o micro-kernel reuse cada linha de B nas
+  // linhas de C; a soma de cada elemento segue a ordem crescente de K
+  for (r = 0; r < iK; r++) {
+    for (j = 0; j < iN; j++)
+      pdTransposta[r * iN + j] = pdB[j * iLdB + r];
   }
+  MultiplicarMatrizesNN(pdA, iLdA, pdTransposta, iN, pdC, iLdC, iM, iN, iK);
+}
+
 
-  // Ajusta os pesos da camada de saida
-  for (i = 0; i < iNumeroSaidas; i++) {
-    dAjuste = dPasso * pdAjusteSaida[i];
-    for (j = 0; j < iNumeroOcultos; j++)
-      ppdPesoSaida[i][j] += dAjuste * pdCampoOculto[j];
-    ppdPesoSaida[i][iNumeroOcultos] += dAjuste;
+void MultiplicarMatrizesNN(const TReal *pdA, int iLdA, const TReal *pdB, int iLdB, TReal *pdC, int iLdC,
+    int iM, int iN, int iK)
+{
+  int ii, jj, rr, iFimI, iFimJ, iFimR;
+
+  // C(MxN) += A(MxK) * B(KxN) em blocos de cache; dentro de cada bloco o micro-kernel mantem blocos de 4
+  // linhas de C nos registradores (a soma de cada elemento segue a ordem crescente de K)
+  for (rr = 0; rr < iK; rr += BLOCO_PROFUNDIDADE) {
+    iFimR = MINIMO(rr + BLOCO_PROFUNDIDADE, iK);
+    for (ii = 0; ii < iM; ii += BLOCO_LINHAS) {
+      iFimI = MINIMO(ii + BLOCO_LINHAS, iM);
+      for (jj = 0; jj < iN; jj += BLOCO_COLUNAS) {
+        iFimJ = MINIMO(jj + BLOCO_COLUNAS, iN);
+        ProdutoMatrizes(&pdC[ii * iLdC + jj], iLdC, &pdA[ii * iLdA + rr], iLdA, &pdB[rr * iLdB + jj], iLdB,
+            iFimI - ii, iFimJ - jj, iFimR - rr);
+      }
+    }
   }
 }
 
 
-inline double CalcularErroQuadrado(const double *pdSaidaDesej)
+void MultiplicarMatrizesTN(const TReal *pdA, int iLdA, const TReal *pdB, int iLdB, TReal *pdC, int iLdC,
+    int iM, int iN, int iK, TReal *pdTransposta)
 {
   register int i;
-  double dErro = 0.0;
+  int r;
 
-  // Calcula a soma do erro quadrado de todas as saidas
-  for (i = 0; i < iNumeroSaidas; i++)
-    dErro += QUADRADO(pdSaidaDesej[i] - pdSaidaObtida[i]);
-  return dErro;
+  // C(MxN) += A(KxM)^T * B(KxN), usado para acumular os gradientes sobre os registros do lote: A e
+  // transposta (MxK) e o produto segue como em MultiplicarMatrizesNN
+  for (i = 0; i < iM; i++) {
+    for (r = 0; r < iK; r++)
+      pdTransposta[i * iK + r] = pdA[r * iLdA + i];
+  }
+  MultiplicarMatrizesNN(pdTransposta, iK, pdB, iLdB, pdC, iLdC, iM, iN, iK);
 }
 
 
-int CarregarPesos(const char *szNomeArquivo)
+void AtivarAnnLote(TLote *ptLote)
 {
-  FILE* fp = NULL;
-  char vcLinha[MAX_LINHA + 1];
-  char *szPalavra = NULL;
-  int i, j;
-
-  // Salva os pesos
-  if ((fp = fopen(szNomeArquivo, "r")) == NULL)
-    return 0;
-
-  // Busca o numero de entradas, ocultos e saidas
-  fgets(vcLinha, MAX_LINHA, fp);
-  szPalavra = strtok(vcLinha, " ");
-  iNumeroEntradas = atoi(szPalavra);
-  szPalavra = strtok('\0', " ");
-  iNumeroOcultos = atoi(szPalavra);
-  szPalavra = strtok('\0', " ");
-  iNumeroSaidas = atoi(szPalavra);
-
-  // Carrega os pesos da camada oculta
-  for (i = 0; i < iNumeroOcultos && !feof(fp); i++) {
-    fgets(vcLinha, MAX_LINHA, fp);
-    szPalavra = strtok(vcLinha, " ");
-    for (j = 0; j <= iNumeroEntradas && szPalavra; j++) {
-      ppdPesoOculto[i][j] = atof(szPalavra);
-      szPalavra = strtok('\0', " ");
-    }
-    if (j <= iNumeroEntradas) {
-      fclose(fp);
-      return 0;
-    } 
+  TTreino *ptTreino = ptLote->ptTreino;
+  const int *piStride = ptTreino->viStrideLote;
+  register int i, b;
+  int l;
+  TReal *pdLinha;
+  const TCamada *ptCamada;
+
+  // Copia as entradas do lote para uma matriz contigua
+  for (b = 0; b < ptLote->iNumRegistros; b++) {
+    pdLinha = &ptLote->vpdAtivacao[0][b * piStride[0]];
+    memcpy(pdLinha, ptLote->ppdRegistros[b], sizeof(TReal) * iNumeroEntradas);
+    pdLinha[iNumeroEntradas] = 1.0;
   }
-  if (i < iNumeroOcultos) {
-    fclose(fp);
-    return 0;
-  } 
-
-  // Carrega os pesos da camada de saida
-  for (i = 0; i < iNumeroSaidas && !feof(fp); i++) {
-    fgets(vcLinha, MAX_LINHA, fp);
-    szPalavra = strtok(vcLinha, " ");
-    for (j = 0; j <= iNumeroOcultos && szPalavra; j++) {
-      ppdPesoSaida[i][j] = atof(szPalavra);
-      szPalavra = strtok('\0', " ");
-    }
-    if (j <= iNumeroOcultos) {
-      fclose(fp);
-      return 0;
+
+  // Ativa cada camada: A(l + 1) = f(bias + A(l) * W^T)
+  for (l = 0; l < ptTreino->tRede.iNumCamadas; l++) {
+    ptCamada = &ptTreino->tRede.vtCamadas[l];
+    for (b = 0; b < ptLote->iNumRegistros; b++) {
+      pdLinha = &ptLote->vpdAtivacao[l + 1][b * piStride[l + 1]];
+      for (i = 0; i < ptCamada->iNumNeuronios; i++)
+        pdLinha[i] = ptCamada->pdPeso[i * ptCamada->iStride + ptCamada->iNumEntradas];
+    }
+    MultiplicarMatrizesNT(ptLote->vpdAtivacao[l], piStride[l], ptCamada->pdPeso, ptCamada->iStride,
+        ptLote->vpdAtivacao[l + 1], piStride[l + 1], ptLote->iNumRegistros, ptCamada->iNumNeuronios,
+        ptCamada->iNumEntradas, ptLote->pdTransposta);
+    for (b = 0; b < ptLote->iNumRegistros; b++) {
+      pdLinha = &ptLote->vpdAtivacao[l + 1][b * piStride[l + 1]];
+      AplicarAtivacao(ptCamada->iAtivacao, pdLinha, ptCamada->iNumNeuronios);
+      pdLinha[ptCamada->iNumNeuronios] = 1.0;
     }
   }
-  fclose(fp);
-  return (i < iNumeroSaidas ? 0 : 1);
 }
 
 
-void SalvarPesos(const char *szNomeArquivo)
+void CalcularGradientesLote(TLote *ptLote)
 {
-  FILE* fp = NULL;
-  int i, j;
-
-  // Salva os pesos
-  if ((fp = fopen(szNomeArquivo, "w")) == NULL)
-    return;
-  fprintf(fp, "%d %d %d\n", iNumeroEntradas, iNumeroOcultos, iNumeroSaidas);
-
-  // Salva os pesos da camada oculta
-  for (i = 0; i < iNumeroOcultos; i++) {
-    for (j = 0; j <= iNumeroEntradas; j++)
-      fprintf(fp, "%.8f ", ppdPesoOculto[i][j]);
-    fprintf(fp, "\n");
+  TTreino *ptTreino = ptLote->ptTreino;
+  const int *piStride = ptTreino->viStrideLote;
+  register int i, b;
+  int l, iUltima = ptTreino->tRede.iNumCamadas - 1;
+  TReal dSoma, dDerivada;
+  const TReal *pdSaida;
+  const TCamada *ptCamada;
+
+  // Calcula o erro das saidas de cada registro
+  for (b = 0; b < ptLote->iNumRegistros; b++) {
+    pdSaida = &ptLote->vpdAtivacao[iUltima + 1][b * piStride[iUltima + 1]];
+    for (i = 0; i < iNumeroSaidas; i++)
+      ptLote->vpdAjuste[iUltima][b * piStride[iUltima + 1] + i] = ptLote->ppdRegistros[b][iNumeroEntradas + i] -
+          pdSaida[i];
   }
 
-  // Salva os pesos da camada de saida
-  for (i = 0; i < iNumeroSaidas; i++) {
-    for (j = 0; j <= iNumeroOcultos; j++)
-      fprintf(fp, "%.8f ", ppdPesoSaida[i][j]);
-    fprintf(fp, "\n");
+  // Retropropaga da saida ate a primeira camada oculta
+  for (l = iUltima; l >= 0; l--) {
+    ptCamada = &ptTreino->tRede.vtCamadas[l];
+    // E = S .* f'(A) e o ajuste escalado pelo passo
+    for (b = 0; b < ptLote->iNumRegistros; b++) {
+      for (i = 0; i < ptCamada->iNumNeuronios; i++) {
+        dSoma = ptLote->vpdAjuste[l][b * piStride[l + 1] + i];
+        dDerivada = DERIVADA_ATIVACAO(ptCamada->iAtivacao, ptLote->vpdAtivacao[l + 1][b * piStride[l + 1] + i]);
+        ptLote->vpdErro[l][b * piStride[l + 1] + i] = dSoma * dDerivada;
+        ptLote->vpdAjuste[l][b * piStride[l + 1] + i] = dSoma * ((TReal) ptTreino->tParametros.dPasso * dDerivada);
+      }
+    }
+    // Soma retropropagada para a camada anterior: S = E * W
+    if (l > 0) {
+      memset(ptLote->vpdAjuste[l - 1], 0, sizeof(TReal) * ptLote->iNumRegistros * piStride[l]);
+      MultiplicarMatrizesNN(ptLote->vpdErro[l], piStride[l + 1], ptCamada->pdPeso, ptCamada->iStride,
+          ptLote->vpdAjuste[l - 1], piStride[l], ptLote->iNumRegistros, ptCamada->iNumEntradas,
+          ptCamada->iNumNeuronios);
+    }
+    // Acumula os gradientes (a coluna de 1.0 das ativacoes gera o ajuste do bias)
+    if (l < iUltima || ptTreino->tParametros.iFreqQuadrados <= 0)
+      MultiplicarMatrizesTN(ptLote->vpdAjuste[l], piStride[l + 1], ptLote->vpdAtivacao[l], piStride[l],
+          ptLote->vpdGrad[l], ptCamada->iStride, ptCamada->iNumNeuronios, ptCamada->iNumEntradas + 1,
+          ptLote->iNumRegistros, ptLote->pdTransposta);
   }
-  fclose(fp);
 }
 
 
-void MostrarPesos()
+void AplicarGradientes(TTreino *ptTreino, const int iParte, const int iNumPartes)
 {
-  int i, j;
+  int l, iTamanho, iInicio, iFim;
+
+  // Cada parte reduz e aplica uma faixa fixa de cada matriz de pesos
+  for (l = 0; l < ptTreino->tRede.iNumCamadas - (ptTreino->tParametros.iFreqQuadrados > 0); l++) {
+    iTamanho = ptTreino->tRede.vtCamadas[l].iNumNeuronios * ptTreino->tRede.vtCamadas[l].iStride;
+    iInicio = (int) ((long long) iTamanho * iParte / iNumPartes);
+    iFim = (int) ((long long) iTamanho * (iParte + 1) / iNumPartes);
+    ReduzirGradientes(ptTreino, l, iInicio, iFim);
+  }
+}
 
-  // Mostra os pesos
-  printf("%d %d %d\n", iNumeroEntradas, iNumeroOcultos, iNumeroSaidas);
 
-  // Mostra os pesos da camada oculta
-  for (i = 0; i < iNumeroOcultos; i++) {
-    for (j = 0; j <= iNumeroEntradas; j++)
-      printf("%.8f ", ppdPesoOculto[i][j]);
-    printf("\n");
+void ReduzirGradientes(TTreino *ptTreino, const int iCamada, const int iInicio, const int iFim)
+{
+  register int i;
+  int t, iPasso;
+  TReal *pdDestino, *pdOrigem, *pdPeso = ptTreino->tRede.vtCamadas[iCamada].pdPeso;
+  double *pdMestre = ptTreino->tRede.vtCamadas[iCamada].pdMestre;
+
+  // Reducao em arvore com ordem fixa: no nivel iPasso o buffer t recebe o buffer t + iPasso
+  for (iPasso = 1; iPasso < ptTreino->iNumeroThreads; iPasso *= 2) {
+    for (t = 0; t + iPasso < ptTreino->iNumeroThreads; t += 2 * iPasso) {
+      pdDestino = ptTreino->ptLotes[t].vpdGrad[iCamada];
+      pdOrigem = ptTreino->ptLotes[t + iPasso].vpdGrad[iCamada];
+      for (i = iInicio; i < iFim; i++) {
+        pdDestino[i] += pdOrigem[i];
+        pdOrigem[i] = 0.0;
+      }
+    }
   }
 
-  // Mostra os pesos da camada de saida
-  for (i = 0; i < iNumeroSaidas; i++) {
-    for (j = 0; j <= iNumeroOcultos; j++)
-      printf("%.8f ", ppdPesoSaida[i][j]);
-    printf("\n");
+  // Aplica um unico ajuste aos pesos (ou a copia mestre) e zera o gradiente acumulado; as regras com
+  // estado usam o kernel fundido da regra sobre a faixa (o gradiente do lote ja inclui o passo)
+  pdDestino = ptTreino->ptLotes[0].vpdGrad[iCamada];
+  if (ptTreino->tParametros.iRegra != REGRA_SGD) {
+    AjustarLinha(ptTreino, &ptTreino->tRede.vtCamadas[iCamada], iInicio, 1.0, &pdDestino[iInicio], iFim - iInicio,
+        ptTreino->vdPotenciaLote);
+    memset(&pdDestino[iInicio], 0, sizeof(TReal) * (iFim - iInicio));
+  }
+  else if (pdMestre != NULL) {
+    for (i = iInicio; i < iFim; i++) {
+      pdMestre[i] += pdDestino[i];
+      pdPeso[i] = (TReal) pdMestre[i];
+      pdDestino[i] = 0.0;
+    }
+  }
+  else {
+    for (i = iInicio; i < iFim; i++) {
+      pdPeso[i] += pdDestino[i];
+      pdDestino[i] = 0.0;
+    }
   }
 }
 
 
-void TestarDatabase(double** ppdDatabase, const int iNumRegistros)
+double CalcularErroQuadradoLote(TLote *ptLote)
 {
-  double dErroMedio = 0.0;
-  int i;
+  TTreino *ptTreino = ptLote->ptTreino;
+  register int b;
+  int iSaida = ptTreino->tRede.iNumCamadas;
+  double dErro = 0.0;
 
-  for (i = 0; i < iNumRegistros; i++) {
-    AtivarAnn(ppdDatabase[i]);
-    dErroMedio += CalcularErroQuadrado(&ppdDatabase[i][iNumeroEntradas]);
-  }
-  printf("MSE: %f\n", dErroMedio / (double) (iNumeroSaidas * iNumRegistros));
+  // Calcula a soma do erro quadrado de todas as saidas do lote
+  for (b = 0; b < ptLote->iNumRegistros; b++)
+    dErro += SomaQuadradosDiferenca(&ptLote->ppdRegistros[b][iNumeroEntradas],
+        &ptLote->vpdAtivacao[iSaida][b * ptTreino->viStrideLote[iSaida]], iNumeroSaidas);
+  return dErro;
 }
 
 
-void GerarArquivoSaidas(double** ppdDatabase, const int iNumRegistros, const char *szNomeArquivo)
+void ProcessarFatiaLote(TLote *ptLote)
 {
-  int i, j;
-  double dErroMedio = 0.0;
-  FILE* fp = NULL;
+  TTreino *ptTreino = ptLote->ptTreino;
 
-  if ((fp = fopen(szNomeArquivo, "w")) == NULL)
-    return;
-  for (i = 0; i < iNumRegistros; i++) {
-    AtivarAnn(ppdDatabase[i]);
-    dErroMedio += CalcularErroQuadrado(&ppdDatabase[i][iNumeroEntradas]);
-    for (j = 0; j < iNumeroSaidas; j++)
-      fprintf(fp, "%f %f   ", ppdDatabase[i][iNumeroEntradas + j], pdSaidaObtida[j]);
-    fprintf(fp, "\n");
-  }
-  fprintf(fp, "MSE: %f\n", dErroMedio / (double) (iNumeroSaidas * iNumRegistros));
-  fclose(fp);
+  // Propagacao, retropropagacao e erro da fatia do lote atribuida a uma thread
+  AtivarAnnLote(ptLote);
+  CalcularGradientesLote(ptLote);
+  ptLote->dErroQuadrado = (ptTreino->iCalcularErroLote ? CalcularErroQuadradoLote(ptLote) : 0.0);
 }
 
 
-void DesalocarMemoriaAnn()
+void *ExecutarThreadLote(void *pArg)
 {
-  int i;
+  TLote *ptLote = (TLote*) pArg;
+  TTreino *ptTreino = ptLote->ptTreino;
+  int iParte = (int) (ptLote - ptTreino->ptLotes);
+
+  for (;;) {
+    // Aguarda o proximo lote (ou o encerramento)
+    pthread_barrier_wait(&ptTreino->pbBarreiraLote);
+    if (ptTreino->iEncerrarThreadsLote)
+      break;
+    ProcessarFatiaLote(ptLote);
+    // Aguarda todos os gradientes e reduz a faixa de pesos desta thread
+    pthread_barrier_wait(&ptTreino->pbBarreiraLote);
+    AplicarGradientes(ptTreino, iParte, ptTreino->iNumeroThreads);
+    pthread_barrier_wait(&ptTreino->pbBarreiraLote);
+  }
+  return NULL;
+}
+
 
-  // Desaloca a memoria da camada oculta
-  if (pdCampoOculto != NULL) {
-    free(pdCampoOculto);
-    pdCampoOculto = NULL;
+double TreinarLote(TTreino *ptTreino, TReal **ppdRegistros, const int iNumRegistros, const int iCalcularErro)
+{
+  double dErro = 0.0;
+  int t, iInicio, iFim;
+
+  // Divide o lote em fatias fixas, uma por thread, na ordem do database embaralhado
+  for (t = 0; t < ptTreino->iNumeroThreads; t++) {
+    iInicio = (int) ((long long) iNumRegistros * t / ptTreino->iNumeroThreads);
+    iFim = (int) ((long long) iNumRegistros * (t + 1) / ptTreino->iNumeroThreads);
+    ptTreino->ptLotes[t].ppdRegistros = &ppdRegistros[iInicio];
+    ptTreino->ptLotes[t].iNumRegistros = iFim - iInicio;
   }
-  if (ppdPesoOculto != NULL) {
-    for (i = 0; i < iNumeroOcultos; i++) {
-      if (ppdPesoOculto[i] != NULL) {
-        free(ppdPesoOculto[i]);
-        ppdPesoOculto[i] = NULL;
-      }
-    }
-    free(ppdPesoOculto);
-    ppdPesoOculto = NULL;
+  ptTreino->iCalcularErroLote = iCalcularErro;
+  AvancarPotencias(ptTreino, ptTreino->vdPotenciaLote);
+
+  // A thread coordenadora processa a fatia 0 e a faixa de pesos 0
+  if (ptTreino->iNumeroThreads > 1) {
+    pthread_barrier_wait(&ptTreino->pbBarreiraLote);
+    ProcessarFatiaLote(&ptTreino->ptLotes[0]);
+    pthread_barrier_wait(&ptTreino->pbBarreiraLote);
+    AplicarGradientes(ptTreino, 0, ptTreino->iNumeroThreads);
+    pthread_barrier_wait(&ptTreino->pbBarreiraLote);
   }
+  else {
+    ProcessarFatiaLote(&ptTreino->ptLotes[0]);
+    AplicarGradientes(ptTreino, 0, 1);
+  }
+
+  // Soma os erros das fatias em ordem fixa
+  for (t = 0; t < ptTreino->iNumeroThreads; t++)
+    dErro += ptTreino->ptLotes[t].dErroQuadrado;
+  return dErro;
+}
+
 
-  // Desaloca a memoria da camada de saida
-  if (pdSaidaObtida != NULL) {
-    free(pdSaidaObtida);
-    pdSaidaObtida = NULL;
+void DesalocarMemoriaLote(TTreino *ptTreino)
+{
+  int t, l;
+
+  // Encerra as threads do treinamento sincrono
+  if (ptTreino->ptThreadsLote != NULL) {
+    ptTreino->iEncerrarThreadsLote = 1;
+    pthread_barrier_wait(&ptTreino->pbBarreiraLote);
+    for (t = 1; t < ptTreino->iNumeroThreads; t++)
+      pthread_join(ptTreino->ptThreadsLote[t], NULL);
+    pthread_barrier_destroy(&ptTreino->pbBarreiraLote);
+    free(ptTreino->ptThreadsLote);
+    ptTreino->ptThreadsLote = NULL;
   }
-  if (ppdPesoSaida != NULL) {
-    for (i = 0; i < iNumeroSaidas; i++) {
-      if (ppdPesoSaida[i] != NULL) {
-        free(ppdPesoSaida[i]);
-        ppdPesoSaida[i] = NULL;
+
+  // Desaloca os buffers do treinamento em lote
+  if (ptTreino->ptLotes != NULL) {
+    for (t = 0; t < ptTreino->iNumeroThreads; t++) {
+      LiberarAlinhado(ptTreino->ptLotes[t].pdTransposta);
+      LiberarAlinhado(ptTreino->ptLotes[t].vpdAtivacao[0]);
+      for (l = 0; l < ptTreino->tRede.iNumCamadas; l++) {
+        LiberarAlinhado(ptTreino->ptLotes[t].vpdAtivacao[l + 1]);
+        LiberarAlinhado(ptTreino->ptLotes[t].vpdErro[l]);
+        LiberarAlinhado(ptTreino->ptLotes[t].vpdAjuste[l]);
+        LiberarAlinhado(ptTreino->ptLotes[t].vpdGrad[l]);
       }
     }
-    free(ppdPesoSaida);
-    ppdPesoSaida = NULL;
-  }
-  if (pdAjusteSaida != NULL) {
-    free(pdAjusteSaida);
-    pdAjusteSaida = NULL;
+    free(ptTreino->ptLotes);
+    ptTreino->ptLotes = NULL;
   }
 }
 
 
-void DesalocarDatabase(double** ppdDatabase, int iNumRegistros)
+double TempoReal()
 {
-  int i;
+#ifdef _WIN32
+  LARGE_INTEGER liContador, liFrequencia;
+
+  QueryPerformanceCounter(&liContador);
+  QueryPerformanceFrequency(&liFrequencia);
+  return (double) liContador.QuadPart / (double) liFrequencia.QuadPart;
+#else
+  struct timespec tsAgora;
+
+  // Tempo de parede (o clock() soma o tempo de CPU de todas as threads)
+  clock_gettime(CLOCK_MONOTONIC, &tsAgora);
+  return tsAgora.tv_sec + tsAgora.tv_nsec * 1.0e-9;
+#endif
+}
 
-  // Desaloca a memoria do database
-  if (ppdDatabase != NULL) {
-    for (i = 0; i < iNumRegistros; i++) {
-      if (ppdDatabase[i] != NULL) {
-        free(ppdDatabase[i]);
-        ppdDatabase[i] = NULL;
-      }
+
+void AlocarTrabalhadores(TTreino *ptTreino)
+{
+  int t;
+
+  // Cada trabalhador tem os seus proprios buffers de ativacao; os pesos sao compartilhados
+  ptTreino->ptTrabalhadores = (TTrabalhador*) malloc(sizeof(TTrabalhador) * ptTreino->iNumeroThreads);
+  for (t = 0; t < ptTreino->iNumeroThreads; t++) {
+    ptTreino->ptTrabalhadores[t].ptTreino = ptTreino;
+    AlocarPropagacao(ptTreino, &ptTreino->ptTrabalhadores[t].tPropagacao);
+  }
+
+  // Threads persistentes durante todo o aprendizado, como as do treinamento sincrono (a thread 0 e a
+  // coordenadora), para nao criar threads a cada epoca ou bloco do streaming
+  ptTreino->iEncerrarThreadsHogwild = 0;
+  ptTreino->ptThreadsHogwild = (pthread_t*) malloc(sizeof(pthread_t) * ptTreino->iNumeroThreads);
+  pthread_barrier_init(&ptTreino->pbBarreiraHogwild, NULL, ptTreino->iNumeroThreads);
+  for (t = 1; t < ptTreino->iNumeroThreads; t++)
+    pthread_create(&ptTreino->ptThreadsHogwild[t], NULL, ExecutarThreadHogwild, &ptTreino->ptTrabalhadores[t]);
+}
+
+
+void *TreinarParticao(void *pArg)
+{
+  TTrabalhador *ptTrab = (TTrabalhador*) pArg;
+  TTreino *ptTreino = ptTrab->ptTreino;
+  register int k;
+
+  // Treina a particao [iInicio, iFim) dos registros embaralhados
+  ptTrab->dErroQuadrado = 0.0;
+  for (k = ptTrab->iInicio; k < ptTrab->iFim; k++) {
+    AtivarAnnLocal(ptTreino, ptTrab->ppdRegistros[k], &ptTrab->tPropagacao);
+    AjustarPesosLocal(ptTreino, ptTrab->ppdRegistros[k], &ptTrab->tPropagacao);
+    if (ptTrab->iCalcularErro)
+      ptTrab->dErroQuadrado += SomaQuadradosDiferenca(&ptTrab->ppdRegistros[k][iNumeroEntradas],
+          ptTrab->tPropagacao.ppdSaida[ptTreino->tRede.iNumCamadas - 1], iNumeroSaidas);
+  }
+  return NULL;
+}
+
+
+void *ExecutarThreadHogwild(void *pArg)
+{
+  TTreino *ptTreino = ((TTrabalhador*) pArg)->ptTreino;
+
+  for (;;) {
+    // Aguarda a proxima particao (ou o encerramento) e sinaliza o fim do seu treinamento
+    pthread_barrier_wait(&ptTreino->pbBarreiraHogwild);
+    if (ptTreino->iEncerrarThreadsHogwild)
+      break;
+    TreinarParticao(pArg);
+    pthread_barrier_wait(&ptTreino->pbBarreiraHogwild);
+  }
+  return NULL;
+}
+
+
+double TreinarHogwild(TTreino *ptTreino, TReal **ppdRegistros, const int iNumRegistros, const int iCalcularErro)
+{
+  double dErro = 0.0;
+  int t;
+
+  // Divide os registros (a epoca ou um bloco do streaming) em particoes contiguas, uma por thread
+  for (t = 0; t < ptTreino->iNumeroThreads; t++) {
+    ptTreino->ptTrabalhadores[t].ppdRegistros = ppdRegistros;
+    ptTreino->ptTrabalhadores[t].iInicio = (int) ((long long) iNumRegistros * t / ptTreino->iNumeroThreads);
+    ptTreino->ptTrabalhadores[t].iFim = (int) ((long long) iNumRegistros * (t + 1) / ptTreino->iNumeroThreads);
+    ptTreino->ptTrabalhadores[t].iCalcularErro = iCalcularErro;
+  }
+
+  // As threads 1..n-1 sao liberadas pela barreira e a particao 0 e treinada pela thread coordenadora
+  pthread_barrier_wait(&ptTreino->pbBarreiraHogwild);
+  TreinarParticao(&ptTreino->ptTrabalhadores[0]);
+  pthread_barrier_wait(&ptTreino->pbBarreiraHogwild);
+
+  // Soma os erros das particoes
+  for (t = 0; t < ptTreino->iNumeroThreads; t++)
+    dErro += ptTreino->ptTrabalhadores[t].dErroQuadrado;
+  return dErro;
+}
+
+
+void DesalocarTrabalhadores(TTreino *ptTreino)
+{
+  int t;
+
+  // Encerra as threads e desaloca os buffers dos trabalhadores
+  if (ptTreino->ptThreadsHogwild != NULL) {
+    ptTreino->iEncerrarThreadsHogwild = 1;
+    pthread_barrier_wait(&ptTreino->pbBarreiraHogwild);
+    for (t = 1; t < ptTreino->iNumeroThreads; t++)
+      pthread_join(ptTreino->ptThreadsHogwild[t], NULL);
+    pthread_barrier_destroy(&ptTreino->pbBarreiraHogwild);
+    free(ptTreino->ptThreadsHogwild);
+    ptTreino->ptThreadsHogwild = NULL;
+  }
+  if (ptTreino->ptTrabalhadores != NULL) {
+    for (t = 0; t < ptTreino->iNumeroThreads; t++)
+      LiberarPropagacao(ptTreino, &ptTreino->ptTrabalhadores[t].tPropagacao);
+    free(ptTreino->ptTrabalhadores);
+    ptTreino->ptTrabalhadores = NULL;
+  }
+}
+
+
+void RedimensionarThreads(TTreino *ptTreino, const int iNumThreads)
+{
+  double vdPotencia[2];
+  int t;
+
+  // Recria os buffers e as threads persistentes com o novo numero de threads durante o aprendizado; o
+  // estado da regra fica ao lado dos pesos, exceto as potencias do Adam de cada trabalhador Hogwild
+  memcpy(vdPotencia, (ptTreino->ptTrabalhadores != NULL ? ptTreino->ptTrabalhadores[0].tPropagacao.vdPotencia :
+      ptTreino->tPropagacaoAnn.vdPotencia), sizeof(vdPotencia));
+  DesalocarMemoriaLote(ptTreino);
+  DesalocarTrabalhadores(ptTreino);
+  DesalocarAvaliadores(ptTreino);
+  ptTreino->iNumeroThreads = iNumThreads;
+  if (ptTreino->tParametros.iTamanhoLote > 1)
+    AlocarMemoriaLote(ptTreino);
+  else if (ptTreino->iNumeroThreads > 1) {
+    AlocarTrabalhadores(ptTreino);
+    for (t = 0; t < ptTreino->iNumeroThreads; t++)
+      memcpy(ptTreino->ptTrabalhadores[t].tPropagacao.vdPotencia, vdPotencia, sizeof(vdPotencia));
+  }
+  else
+    memcpy(ptTreino->tPropagacaoAnn.vdPotencia, vdPotencia, sizeof(vdPotencia));
+  AlocarAvaliadores(ptTreino);
+}
+
+
+void AtivarAnnLocal(TTreino *ptTreino, const TReal *pdRegistro, TPropagacao *ptProp)
+{
+  AtivarRede(&ptTreino->tRede, pdRegistro, ptProp->ppdSaida);
+}
+
+
+void AjustarPesosLocal(TTreino *ptTreino, const TReal *pdRegistro, TPropagacao *ptProp)
+{
+  register int i, j;
+  int l, iUltima = ptTreino->tRede.iNumCamadas - 1;
+  TReal dSoma, dDerivada;
+  static const TReal dUm = 1.0;
+  const TReal *pdEntrada, *pdSaida;
+  const TCamada *ptCamada, *ptProxima;
+
+  // Retropropaga o erro da saida ate a primeira camada oculta (com os pesos antes do ajuste)
+  for (l = iUltima; l >= 0; l--) {
+    ptCamada = &ptTreino->tRede.vtCamadas[l];
+    ptProxima = &ptTreino->tRede.vtCamadas[l + 1];
+    pdSaida = ptProp->ppdSaida[l];
+    for (i = 0; i < ptCamada->iNumNeuronios; i++) {
+      if (l == iUltima)
+        dSoma = pdRegistro[iNumeroEntradas + i] - pdSaida[i];
+      else {
+        dSoma = 0.0;
+        for (j = 0; j < ptProxima->iNumNeuronios; j++)
+          dSoma += ptProp->ppdErro[l + 1][j] * ptProxima->pdPeso[j * ptProxima->iStride + i];
+      }
+      dDerivada = DERIVADA_ATIVACAO(ptCamada->iAtivacao, pdSaida[i]);
+      ptProp->ppdErro[l][i] = dSoma * dDerivada;
+      ptProp->ppdAjuste[l][i] = dSoma * ((TReal) ptTreino->tParametros.dPasso * dDerivada);
+    }
+  }
+
+  // Ajusta os pesos de cada camada com as ativacoes da camada anterior (menos a saida, se ela e
+  // resolvida por minimos quadrados); o bias e ajustado como uma entrada constante de 1.0
+  AvancarPotencias(ptTreino, ptProp->vdPotencia);
+  for (l = 0; l <= iUltima - (ptTreino->tParametros.iFreqQuadrados > 0); l++) {
+    ptCamada = &ptTreino->tRede.vtCamadas[l];
+    pdEntrada = (l ? ptProp->ppdSaida[l - 1] : pdRegistro);
+    for (i = 0; i < ptCamada->iNumNeuronios; i++) {
+      AjustarLinha(ptTreino, ptCamada, i * ptCamada->iStride, ptProp->ppdAjuste[l][i], pdEntrada,
+          ptCamada->iNumEntradas, ptProp->vdPotencia);
+      AjustarLinha(ptTreino, ptCamada, i * ptCamada->iStride + ptCamada->iNumEntradas, ptProp->ppdAjuste[l][i], &dUm, 1,
+          ptProp->vdPotencia);
+    }
+  }
+}
+
+
+void IniciarRegra(TTreino *ptTreino)
+{
+  // Velocidades (e segundos momentos do Adam) zeradas, ao lado dos pesos de cada camada
+  if (ptTreino->tParametros.iRegra != REGRA_SGD &&
+      !CriarEstadoAjuste(&ptTreino->tRede, (ptTreino->tParametros.iRegra == REGRA_ADAM ? 2 : 1))) {
+    fprintf(stderr, "ERRO: Nao foi possivel alocar o estado da regra de ajuste, usando %s\n",
+        vszNomesRegras[REGRA_SGD]);
+    ptTreino->tParametros.iRegra = REGRA_SGD;
+  }
+  ptTreino->tPropagacaoAnn.vdPotencia[0] = ptTreino->tPropagacaoAnn.vdPotencia[1] = 1.0;
+  ptTreino->vdPotenciaLote[0] = ptTreino->vdPotenciaLote[1] = 1.0;
+}
+
+
+void AvancarPotencias(TTreino *ptTreino, double *pdPotencia)
+{
+  // Um passo do Adam por ajuste (registro ou lote)
+  if (ptTreino->tParametros.iRegra == REGRA_ADAM) {
+    pdPotencia[0] *= ptTreino->tParametros.dMomento;
+    pdPotencia[1] *= BETA2_ADAM;
+  }
+}
+
+
+void AjustarLinha(TTreino *ptTreino, const TCamada *ptCamada, const int iDeslocamento, const double dA,
+    const TReal *pdX, const int iN, const double *pdPotencia)
+{
+  TReal *pdPeso = &ptCamada->pdPeso[iDeslocamento];
+  TReal *pdVelocidade = (ptCamada->pdVelocidade != NULL ? &ptCamada->pdVelocidade[iDeslocamento] : NULL);
+  double *pdMestre = (ptCamada->pdMestre != NULL ? &ptCamada->pdMestre[iDeslocamento] : NULL);
+  double dMomento = ptTreino->tParametros.dMomento, dPasso = ptTreino->tParametros.dPasso;
+  double dFatorV, dFatorG, dTaxa;
+
+  // Ajusta iN pesos consecutivos com o gradiente dA * pdX (ja multiplicado pelo passo) em uma unica passagem;
+  // com precisao mista o ajuste e acumulado na copia mestre em double
+  switch (ptTreino->tParametros.iRegra) {
+    case REGRA_MOMENTUM:
+    case REGRA_NESTEROV:
+      // Nesterov na forma de Sutskever: o passo usa a velocidade ja atualizada, sem o gradiente adiantado
+      dFatorV = (ptTreino->tParametros.iRegra == REGRA_NESTEROV ? dMomento : 1.0);
+      dFatorG = (ptTreino->tParametros.iRegra == REGRA_NESTEROV ? 1.0 : 0.0);
+      if (pdMestre != NULL)
+        AjustarMomentoMestre(pdMestre, pdPeso, pdVelocidade, dMomento, dFatorV, dFatorG, dA, pdX, iN);
+      else
+        AjustarMomento(pdPeso, pdVelocidade, dMomento, dFatorV, dFatorG, dA, pdX, iN);
+      break;
+    case REGRA_ADAM:
+      // O Adam e invariante a escala do gradiente: como o passo ja foi aplicado, ele multiplica a taxa e o
+      // epsilon; o momento e o beta1 e a correcao de vies entra na taxa
+      dTaxa = dPasso * sqrt(1.0 - pdPotencia[1]) / (1.0 - pdPotencia[0]);
+      if (pdMestre != NULL)
+        AjustarAdamMestre(pdMestre, pdPeso, pdVelocidade, &ptCamada->pdSegundoMomento[iDeslocamento], dMomento,
+            BETA2_ADAM, dTaxa, EPSILON_ADAM * dPasso, dA, pdX, iN);
+      else
+        AjustarAdam(pdPeso, pdVelocidade, &ptCamada->pdSegundoMomento[iDeslocamento], dMomento, BETA2_ADAM, dTaxa,
+            EPSILON_ADAM * dPasso, dA, pdX, iN);
+      break;
+    default:
+      if (pdMestre != NULL)
+        SomarEscaladoMestre(pdMestre, pdPeso, dA, pdX, iN);
+      else
+        SomarEscalado(pdPeso, dA, pdX, iN);
+      break;
+  }
+}
+
+
+inline void AtivarAnn(TTreino *ptTreino, const TReal *pdRegistro)
+{
+  AtivarAnnLocal(ptTreino, pdRegistro, &ptTreino->tPropagacaoAnn);
+}
+
+
+inline void AjustarPesos(TTreino *ptTreino, const TReal *pdRegistro)
+{
+  AjustarPesosLocal(ptTreino, pdRegistro, &ptTreino->tPropagacaoAnn);
+}
+
+
+inline double CalcularErroQuadrado(TTreino *ptTreino, const TReal *pdSaidaDesej)
+{
+  // Calcula a soma do erro quadrado de todas as saidas
+  return SomaQuadradosDiferenca(pdSaidaDesej, ptTreino->pdSaidaObtida, iNumeroSaidas);
+}
+
+
+int CarregarPesos(TTreino *ptTreino, const char *szNomeArquivo)
+{
+  TRede tNova;
+  int l;
+
+  // Aceita o formato binario, o cabecalho versionado e o antigo (entradas ocultos saidas)
+  if (!CarregarRede(&tNova, szNomeArquivo))
+    return 0;
+  if (tNova.iNumEntradas != iNumeroEntradas || tNova.iNumSaidas != iNumeroSaidas) {
+    fprintf(stderr, "ERRO: Os pesos nao correspondem ao database\n");
+    DestruirRede(&tNova);
+    return 0;
+  }
+
+  // Substitui a rede atual pela carregada
+  DesalocarMemoriaAnn(ptTreino);
+  ptTreino->tRede = tNova;
+  ptTreino->tParametros.iNumeroCamadasOcultas = ptTreino->tRede.iNumCamadas - 1;
+  for (l = 0; l < ptTreino->tParametros.iNumeroCamadasOcultas; l++) {
+    ptTreino->tParametros.viNumeroOcultos[l] = ptTreino->tRede.vtCamadas[l].iNumNeuronios;
+    ptTreino->tParametros.viAtivacaoOculta[l] = ptTreino->tRede.vtCamadas[l].iAtivacao;
+  }
+  AlocarPropagacao(ptTreino, &ptTreino->tPropagacaoAnn);
+  ptTreino->pdSaidaObtida = ptTreino->tPropagacaoAnn.ppdSaida[ptTreino->tRede.iNumCamadas - 1];
+  return 1;
+}
+
+
+void MostrarPesos(TTreino *ptTreino)
+{
+  // Mostra a topologia e os pesos no formato do arquivo .wts
+  EscreverRede(&ptTreino->tRede, stdout);
+}
+
+
+double AvaliarRede(const TRede *ptRede, TReal **ppdSaida, TReal **ppdRegistros, const int iNumRegistros, FILE *fp)
+{
+  int i, j;
+  double dErro = 0.0, dErroFatia = 0.0;
+  const TReal *pdSaida = ppdSaida[ptRede->iNumCamadas - 1];
+
+  // Soma dos erros quadrados por fatias de TAMANHO_FATIA_TESTE registros, na mesma ordem da
+  // avaliacao paralela (o resultado nao depende do numero de threads); se fp != NULL grava as
+  // saidas desejadas e obtidas
+  for (i = 0; i < iNumRegistros; i++) {
+    AtivarRede(ptRede, ppdRegistros[i], ppdSaida);
+    dErroFatia += SomaQuadradosDiferenca(&ppdRegistros[i][iNumeroEntradas], pdSaida, iNumeroSaidas);
+    if (!((i + 1) % TAMANHO_FATIA_TESTE)) {
+      dErro += dErroFatia;
+      dErroFatia = 0.0;
+    }
+    if (fp != NULL) {
+      for (j = 0; j < iNumeroSaidas; j++)
+        fprintf(fp, "%f %f   ", ppdRegistros[i][iNumeroEntradas + j], pdSaida[j]);
+      fprintf(fp, "\n");
     }
-    free(ppdDatabase);
-    ppdDatabase = NULL;
   }
+  return dErro + dErroFatia;
+}
+
+
+void AlocarAvaliadores(TTreino *ptTreino)
+{
+  int t;
+
+  // Com mais de uma thread o teste de generalizacao e dividido entre avaliadores com buffers proprios
+  if (ptTreino->iNumeroThreads <= 1 || ptTreino->ptAvaliadores != NULL)
+    return;
+  ptTreino->ptAvaliadores = (TAvaliador*) malloc(sizeof(TAvaliador) * ptTreino->iNumeroThreads);
+  for (t = 0; t < ptTreino->iNumeroThreads; t++) {
+    memset(&ptTreino->ptAvaliadores[t], 0, sizeof(TAvaliador));
+    ptTreino->ptAvaliadores[t].ptTreino = ptTreino;
+    ptTreino->ptAvaliadores[t].iPrimeiraFatia = t;
+    ptTreino->ptAvaliadores[t].ppdSaida = AlocarSaidasRede(&ptTreino->tRede);
+    ptTreino->ptAvaliadores[t].ppdErro = AlocarSaidasRede(&ptTreino->tRede);
+  }
+
+  // Threads persistentes enquanto os avaliadores existirem (a thread 0 e a coordenadora), para nao criar
+  // threads a cada teste de generalizacao ou passagem dos otimizadores de lote completo
+  ptTreino->iEncerrarThreadsAvaliadores = 0;
+  ptTreino->ptThreadsAvaliadores = (pthread_t*) malloc(sizeof(pthread_t) * ptTreino->iNumeroThreads);
+  pthread_barrier_init(&ptTreino->pbBarreiraAvaliadores, NULL, ptTreino->iNumeroThreads);
+  for (t = 1; t < ptTreino->iNumeroThreads; t++)
+    pthread_create(&ptTreino->ptThreadsAvaliadores[t], NULL, ExecutarThreadAvaliador, &ptTreino->ptAvaliadores[t]);
+}
+
+
+void *ExecutarThreadAvaliador(void *pArg)
+{
+  TTreino *ptTreino = ((TAvaliador*) pArg)->ptTreino;
+
+  for (;;) {
+    // Aguarda a proxima tarefa (ou o encerramento) e sinaliza o fim da sua parte
+    pthread_barrier_wait(&ptTreino->pbBarreiraAvaliadores);
+    if (ptTreino->iEncerrarThreadsAvaliadores)
+      break;
+    ptTreino->pfTarefaAvaliadores(pArg);
+    pthread_barrier_wait(&ptTreino->pbBarreiraAvaliadores);
+  }
+  return NULL;
+}
+
+
+void *AvaliarFatias(void *pArg)
+{
+  TAvaliador *ptAval = (TAvaliador*) pArg;
+  TTreino *ptTreino = ptAval->ptTreino;
+  int c, iNumFatias = (ptAval->iNumRegistros + TAMANHO_FATIA_TESTE - 1) / TAMANHO_FATIA_TESTE;
+
+  // Fatias intercaladas entre as threads; os pesos sao apenas lidos
+  for (c = ptAval->iPrimeiraFatia; c < iNumFatias; c += ptTreino->iNumeroThreads)
+    ptAval->pdErroFatia[c] = AvaliarRede(&ptTreino->tRede, ptAval->ppdSaida,
+        &ptAval->ppdRegistros[c * TAMANHO_FATIA_TESTE],
+        MINIMO(TAMANHO_FATIA_TESTE, ptAval->iNumRegistros - c * TAMANHO_FATIA_TESTE), NULL);
+  return NULL;
+}
+
+
+double AvaliarRegistros(TTreino *ptTreino, TReal** ppdRegistros, const int iNumRegistros)
+{
+  double *pdErroFatia, dErro = 0.0;
+  int c, t, iNumFatias = (iNumRegistros + TAMANHO_FATIA_TESTE - 1) / TAMANHO_FATIA_TESTE;
+
+  // Uma unica fatia (ou uma unica thread) e avaliada diretamente pela thread coordenadora
+  if (ptTreino->ptAvaliadores == NULL || iNumFatias <= 1)
+    return AvaliarRede(&ptTreino->tRede, ptTreino->tPropagacaoAnn.ppdSaida, ppdRegistros, iNumRegistros, NULL);
+
+  // Os avaliadores gravam o erro de cada fatia no vetor compartilhado
+  pdErroFatia = (double*) malloc(sizeof(double) * iNumFatias);
+  for (t = 0; t < ptTreino->iNumeroThreads; t++)
+    ptTreino->ptAvaliadores[t].pdErroFatia = pdErroFatia;
+  ExecutarAvaliadores(ptTreino, AvaliarFatias, ppdRegistros, iNumRegistros);
+
+  // Soma as fatias em ordem
+  for (c = 0; c < iNumFatias; c++)
+    dErro += pdErroFatia[c];
+  free(pdErroFatia);
+  return dErro;
+}
+
+
+double TestarGeneralizacao(TTreino *ptTreino)
+{
+  TReal **ppdBloco;
+  int iNumBloco;
+  double dErro = 0.0;
+
+  // O database de generalizacao em memoria ou uma passagem sequencial pelo seu fluxo
+  if (iTamanhoJanela <= 0)
+    return AvaliarRegistros(ptTreino, ppdDatabaseGenera, iNumeroRegistrosGenera);
+  IniciarPassagemFluxo(&tFluxoGenera, NULL);
+  while ((ppdBloco = ProximoBlocoFluxo(&tFluxoGenera, &iNumBloco)) != NULL)
+    dErro += AvaliarRegistros(ptTreino, ppdBloco, iNumBloco);
+  return dErro;
+}
+
+
+void TestarDatabase(TTreino *ptTreino)
+{
+  AlocarAvaliadores(ptTreino);
+  printf("MSE: %f\n", TestarGeneralizacao(ptTreino) / (double) (iNumeroSaidas * iNumeroRegistrosGenera));
+  DesalocarAvaliadores(ptTreino);
+}
+
+
+void DesalocarAvaliadores(TTreino *ptTreino)
+{
+  int t;
+
+  // Encerra as threads e desaloca os buffers dos avaliadores
+  if (ptTreino->ptThreadsAvaliadores != NULL) {
+    ptTreino->iEncerrarThreadsAvaliadores = 1;
+    pthread_barrier_wait(&ptTreino->pbBarreiraAvaliadores);
+    for (t = 1; t < ptTreino->iNumeroThreads; t++)
+      pthread_join(ptTreino->ptThreadsAvaliadores[t], NULL);
+    pthread_barrier_destroy(&ptTreino->pbBarreiraAvaliadores);
+    free(ptTreino->ptThreadsAvaliadores);
+    ptTreino->ptThreadsAvaliadores = NULL;
+  }
+  if (ptTreino->ptAvaliadores != NULL) {
+    for (t = 0; t < ptTreino->iNumeroThreads; t++) {
+      LiberarSaidasRede(&ptTreino->tRede, ptTreino->ptAvaliadores[t].ppdSaida);
+      LiberarSaidasRede(&ptTreino->tRede, ptTreino->ptAvaliadores[t].ppdErro);
+    }
+    free(ptTreino->ptAvaliadores);
+    ptTreino->ptAvaliadores = NULL;
+  }
+}
+
+
+void AlocarEquacoesNormais(TTreino *ptTreino, const int iDimensao, const int iNumColunas)
+{
+  // Acumuladores parciais de H^T H (d x d) e H^T Y (d x colunas) dos minimos quadrados da saida
+  // (d = ocultos da ultima camada + bias) ou do Levenberg-Marquardt (d = numero de pesos)
+  ptTreino->iDimensaoNormais = iDimensao;
+  ptTreino->iColunasNormais = iNumColunas;
+  ptTreino->pdParciaisNormais = (double*) malloc(sizeof(double) * NUM_PARCIAIS_NORMAIS *
+      TamanhoParcialNormais(ptTreino));
+}
+
+
+int TamanhoParcialNormais(TTreino *ptTreino)
+{
+  return ptTreino->iDimensaoNormais * (ptTreino->iDimensaoNormais + ptTreino->iColunasNormais);
+}
+
+
+void *AcumularParciais(void *pArg)
+{
+  register int j;
+  TAvaliador *ptAval = (TAvaliador*) pArg;
+  TTreino *ptTreino = ptAval->ptTreino;
+  int c, i, k, n, p, r, iFim, iNumLinhas, iD = ptTreino->iDimensaoNormais, iM = ptTreino->iColunasNormais;
+  int iNumFatias = (ptAval->iNumRegistros + TAMANHO_FATIA_TESTE - 1) / TAMANHO_FATIA_TESTE;
+  int iNumThreads = (ptTreino->ptAvaliadores != NULL ? ptTreino->iNumeroThreads : 1);
+  double *pdG, *pdC, *pdLinhas, *pdAlvos, *pdLinha, dXi;
+
+  // A parcial p acumula as fatias p, p + NUM_PARCIAIS_NORMAIS, ... (a divisao nao depende das threads)
+  pdLinhas = (double*) malloc(sizeof(double) * iNumeroSaidas * iD);
+  pdAlvos = (double*) malloc(sizeof(double) * iNumeroSaidas * iM);
+  for (p = ptAval->iPrimeiraFatia; p < NUM_PARCIAIS_NORMAIS; p += iNumThreads) {
+    pdG = &ptTreino->pdParciaisNormais[p * TamanhoParcialNormais(ptTreino)];
+    pdC = &pdG[iD * iD];
+    for (c = p; c < iNumFatias; c += NUM_PARCIAIS_NORMAIS) {
+      iFim = MINIMO((c + 1) * TAMANHO_FATIA_TESTE, ptAval->iNumRegistros);
+      for (r = c * TAMANHO_FATIA_TESTE; r < iFim; r++) {
+        // Linhas de H e de Y geradas pelo registro; acumula o triangulo inferior de H^T H e H^T Y
+        iNumLinhas = ptTreino->pfGerarLinhas(ptAval->ppdRegistros[r], ptAval, pdLinhas, pdAlvos);
+        for (n = 0; n < iNumLinhas; n++) {
+          pdLinha = &pdLinhas[n * iD];
+          for (i = 0; i < iD; i++) {
+            if ((dXi = pdLinha[i]) == 0.0)
+              continue;
+            for (j = 0; j <= i; j++)
+              pdG[i * iD + j] += dXi * pdLinha[j];
+            for (k = 0; k < iM; k++)
+              pdC[i * iM + k] += dXi * pdAlvos[n * iM + k];
+          }
+        }
+      }
+    }
+  }
+  free(pdLinhas);
+  free(pdAlvos);
+  return NULL;
+}
+
+
+void ExecutarAvaliadores(TTreino *ptTreino, void *(*pfTarefa)(void *pArg), TReal **ppdRegistros,
+    const int iNumRegistros)
+{
+  TAvaliador tAvaliador;
+  int t;
+
+  // Com uma unica thread a coordenadora executa a tarefa com os seus buffers
+  if (ptTreino->ptAvaliadores == NULL) {
+    tAvaliador.ptTreino = ptTreino;
+    tAvaliador.ppdRegistros = ppdRegistros;
+    tAvaliador.iNumRegistros = iNumRegistros;
+    tAvaliador.iPrimeiraFatia = 0;
+    tAvaliador.ppdSaida = ptTreino->tPropagacaoAnn.ppdSaida;
+    tAvaliador.ppdErro = ptTreino->tPropagacaoAnn.ppdErro;
+    pfTarefa(&tAvaliador);
+    return;
+  }
+
+  // As threads 1..n-1 sao liberadas pela barreira e a parte da thread 0 e executada pela coordenadora
+  for (t = 0; t < ptTreino->iNumeroThreads; t++) {
+    ptTreino->ptAvaliadores[t].ppdRegistros = ppdRegistros;
+    ptTreino->ptAvaliadores[t].iNumRegistros = iNumRegistros;
+  }
+  ptTreino->pfTarefaAvaliadores = pfTarefa;
+  pthread_barrier_wait(&ptTreino->pbBarreiraAvaliadores);
+  pfTarefa(&ptTreino->ptAvaliadores[0]);
+  pthread_barrier_wait(&ptTreino->pbBarreiraAvaliadores);
+}
+
+
+void PercorrerTreinamento(TTreino *ptTreino, void *(*pfTarefa)(void *pArg))
+{
+  TReal **ppdBloco;
+  int iNumBloco;
+
+  // Executa a tarefa sobre o database de treinamento em memoria ou bloco a bloco pelo fluxo
+  if (iTamanhoJanela <= 0) {
+    ExecutarAvaliadores(ptTreino, pfTarefa, ppdDatabaseTreino, iNumeroRegistrosTreino);
+    return;
+  }
+  IniciarPassagemFluxo(&tFluxoTreino, NULL);
+  while ((ppdBloco = ProximoBlocoFluxo(&tFluxoTreino, &iNumBloco)) != NULL)
+    ExecutarAvaliadores(ptTreino, pfTarefa, ppdBloco, iNumBloco);
+}
+
+
+void SomarEquacoesNormais(TTreino *ptTreino, TGerarLinhas pfGerador)
+{
+  int i, p, iTamanho = TamanhoParcialNormais(ptTreino);
+
+  // Acumula sobre o database de treinamento e soma as parciais em ordem fixa na parcial 0
+  ptTreino->pfGerarLinhas = pfGerador;
+  memset(ptTreino->pdParciaisNormais, 0, sizeof(double) * NUM_PARCIAIS_NORMAIS * iTamanho);
+  PercorrerTreinamento(ptTreino, AcumularParciais);
+  for (p = 1; p < NUM_PARCIAIS_NORMAIS; p++)
+    for (i = 0; i < iTamanho; i++)
+      ptTreino->pdParciaisNormais[i] += ptTreino->pdParciaisNormais[p * iTamanho + i];
+}
+
+
+void DesalocarEquacoesNormais(TTreino *ptTreino)
+{
+  free(ptTreino->pdParciaisNormais);
+  ptTreino->pdParciaisNormais = NULL;
+}
+
+
+int GerarLinhasSaida(const TReal *pdRegistro, TAvaliador *ptAval, double *pdLinhas, double *pdAlvos)
+{
+  TTreino *ptTreino = ptAval->ptTreino;
+  int i, iD = ptTreino->iDimensaoNormais;
+  const TReal *pdOculta;
+
+  // Uma linha por registro: as ativacoes que alimentam a saida (as entradas, se nao ha camadas
+  // ocultas) seguidas do bias, com as saidas desejadas como alvos
+  AtivarRede(&ptTreino->tRede, pdRegistro, ptAval->ppdSaida);
+  pdOculta = (ptTreino->tRede.iNumCamadas > 1 ? ptAval->ppdSaida[ptTreino->tRede.iNumCamadas - 2] : pdRegistro);
+  for (i = 0; i < iD - 1; i++)
+    pdLinhas[i] = pdOculta[i];
+  pdLinhas[iD - 1] = 1.0;
+  for (i = 0; i < iNumeroSaidas; i++)
+    pdAlvos[i] = pdRegistro[iNumeroEntradas + i];
+  return 1;
+}
+
+
+int AjustarSaidaMinimosQuadrados(TTreino *ptTreino)
+{
+  TCamada *ptSaida = &ptTreino->tRede.vtCamadas[ptTreino->tRede.iNumCamadas - 1];
+  int i, j, iD = ptTreino->iDimensaoNormais;
+  double *pdC = &ptTreino->pdParciaisNormais[iD * iD];
+
+  // Resolve W^T = (H^T H)^-1 H^T Y sobre o database de treinamento
+  SomarEquacoesNormais(ptTreino, GerarLinhasSaida);
+  if (!ResolverMinimosQuadrados(ptTreino->pdParciaisNormais, pdC, iD, iNumeroSaidas, REGULARIZACAO_QUADRADOS)) {
+    fprintf(stderr, "ERRO: Nao foi possivel resolver a camada de saida por minimos quadrados\n");
+    return 0;
+  }
+
+  // Copia a solucao para os pesos da saida (e para a copia mestre), com o bias na ultima linha
+  for (i = 0; i < ptSaida->iNumNeuronios; i++) {
+    for (j = 0; j < iD; j++) {
+      ptSaida->pdPeso[i * ptSaida->iStride + j] = (TReal) pdC[j * iNumeroSaidas + i];
+      if (ptSaida->pdMestre != NULL)
+        ptSaida->pdMestre[i * ptSaida->iStride + j] = pdC[j * iNumeroSaidas + i];
+    }
+  }
+  return 1;
+}
+
+
+int NumeroPesosRede(TTreino *ptTreino)
+{
+  int l, iNumPesos = 0;
+
+  for (l = 0; l < ptTreino->tRede.iNumCamadas; l++)
+    iNumPesos += ptTreino->tRede.vtCamadas[l].iNumNeuronios * (ptTreino->tRede.vtCamadas[l].iNumEntradas + 1);
+  return iNumPesos;
+}
+
+
+void ExtrairPesos(TTreino *ptTreino, double *pdPesos)
+{
+  int i, j, l;
+  const TCamada *ptCamada;
+
+  // Vetor com todos os pesos (camada, neuronio e entrada, com o bias no final de cada neuronio)
+  for (l = 0; l < ptTreino->tRede.iNumCamadas; l++) {
+    ptCamada = &ptTreino->tRede.vtCamadas[l];
+    for (i = 0; i < ptCamada->iNumNeuronios; i++)
+      for (j = 0; j <= ptCamada->iNumEntradas; j++)
+        *pdPesos++ = (ptCamada->pdMestre != NULL ? ptCamada->pdMestre[i * ptCamada->iStride + j] :
+            (double) ptCamada->pdPeso[i * ptCamada->iStride + j]);
+  }
+}
+
+
+void InserirPesos(TTreino *ptTreino, const double *pdPesos)
+{
+  int i, j, l;
+  TCamada *ptCamada;
+
+  // Inverso de ExtrairPesos (atualizando tambem a copia mestre)
+  for (l = 0; l < ptTreino->tRede.iNumCamadas; l++) {
+    ptCamada = &ptTreino->tRede.vtCamadas[l];
+    for (i = 0; i < ptCamada->iNumNeuronios; i++) {
+      for (j = 0; j <= ptCamada->iNumEntradas; j++, pdPesos++) {
+        ptCamada->pdPeso[i * ptCamada->iStride + j] = (TReal) *pdPesos;
+        if (ptCamada->pdMestre != NULL)
+          ptCamada->pdMestre[i * ptCamada->iStride + j] = *pdPesos;
+      }
+    }
+  }
+}
+
+
+double ErroTreinamento(TTreino *ptTreino)
+{
+  TReal **ppdBloco;
+  int iNumBloco;
+  double dErro = 0.0;
+
+  // Soma dos erros quadrados sobre o database de treinamento, com a avaliacao paralela do teste
+  if (iTamanhoJanela <= 0)
+    return AvaliarRegistros(ptTreino, ppdDatabaseTreino, iNumeroRegistrosTreino);
+  IniciarPassagemFluxo(&tFluxoTreino, NULL);
+  while ((ppdBloco = ProximoBlocoFluxo(&tFluxoTreino, &iNumBloco)) != NULL)
+    dErro += AvaliarRegistros(ptTreino, ppdBloco, iNumBloco);
+  return dErro;
+}
+
+
+int AlocarLevenbergMarquardt(TTreino *ptTreino)
+{
+  // J^T J tem numero de pesos ao quadrado elementos em cada parcial
+  if ((ptTreino->iNumeroPesosLM = NumeroPesosRede(ptTreino)) > MAX_PESOS_LM) {
+    fprintf(stderr, "ERRO: O Levenberg-Marquardt aceita ate %d pesos (a rede tem %d)\n", MAX_PESOS_LM,
+        ptTreino->iNumeroPesosLM);
+    return 0;
+  }
+  AlocarEquacoesNormais(ptTreino, ptTreino->iNumeroPesosLM, 1);
+  ptTreino->pdPesosLM = (double*) malloc(sizeof(double) * ptTreino->iNumeroPesosLM * (ptTreino->iNumeroPesosLM + 2));
+  ptTreino->dAmortecimentoLM = AMORTECIMENTO_LM;
+  return 1;
+}
+
+
+int GerarLinhasJacobiano(const TReal *pdRegistro, TAvaliador *ptAval, double *pdLinhas, double *pdAlvos)
+{
+  TTreino *ptTreino = ptAval->ptTreino;
+  int i, j, k, l, iUltima = ptTreino->tRede.iNumCamadas - 1;
+  double dSoma, *pdLinha;
+  const TReal *pdEntrada, *pdSaida;
+  const TCamada *ptCamada, *ptProxima;
+
+  // Uma linha por saida k: a derivada da saida k em relacao a cada peso (retropropagando 1 a partir
+  // do neuronio k), com o erro y - o como alvo
+  AtivarRede(&ptTreino->tRede, pdRegistro, ptAval->ppdSaida);
+  for (k = 0; k < iNumeroSaidas; k++) {
+    for (l = iUltima; l >= 0; l--) {
+      ptCamada = &ptTreino->tRede.vtCamadas[l];
+      ptProxima = &ptTreino->tRede.vtCamadas[l + 1];
+      pdSaida = ptAval->ppdSaida[l];
+      for (i = 0; i < ptCamada->iNumNeuronios; i++) {
+        if (l == iUltima)
+          dSoma = (i == k ? 1.0 : 0.0);
+        else {
+          dSoma = 0.0;
+          for (j = 0; j < ptProxima->iNumNeuronios; j++)
+            dSoma += ptAval->ppdErro[l + 1][j] * ptProxima->pdPeso[j * ptProxima->iStride + i];
+        }
+        ptAval->ppdErro[l][i] = (TReal) (dSoma * DERIVADA_ATIVACAO(ptCamada->iAtivacao, pdSaida[i]));
+      }
+    }
+    pdLinha = &pdLinhas[k * ptTreino->iDimensaoNormais];
+    for (l = 0; l <= iUltima; l++) {
+      ptCamada = &ptTreino->tRede.vtCamadas[l];
+      pdEntrada = (l ? ptAval->ppdSaida[l - 1] : pdRegistro);
+      for (i = 0; i < ptCamada->iNumNeuronios; i++) {
+        for (j = 0; j < ptCamada->iNumEntradas; j++)
+          *pdLinha++ = ptAval->ppdErro[l][i] * pdEntrada[j];
+        *pdLinha++ = ptAval->ppdErro[l][i];
+      }
+    }
+    pdAlvos[k] = pdRegistro[iNumeroEntradas + k] - ptAval->ppdSaida[iUltima][k];
+  }
+  return iNumeroSaidas;
+}
+
+
+double TreinarLevenbergMarquardt(TTreino *ptTreino, const int iCalcularErro)
+{
+  register int i;
+  int j, t, iP = ptTreino->iNumeroPesosLM;
+  double *pdFator = &ptTreino->pdPesosLM[iP], *pdPasso = &ptTreino->pdPesosLM[iP * (iP + 1)];
+  double *pdG = ptTreino->pdParciaisNormais, *pdC = &ptTreino->pdParciaisNormais[iP * iP];
+  double dErro, dNovoErro;
+
+  // Uma iteracao por epoca: J^T J e J^T e sobre todo o database (em fatias paralelas) e o passo de
+  // (J^T J + mu I) dw = J^T e; mu diminui quando o passo reduz o erro e aumenta quando e rejeitado
+  SomarEquacoesNormais(ptTreino, GerarLinhasJacobiano);
+  ExtrairPesos(ptTreino, ptTreino->pdPesosLM);
+  dErro = ErroTreinamento(ptTreino);
+  for (t = 0; t < TENTATIVAS_LM && ptTreino->dAmortecimentoLM <= MAX_AMORTECIMENTO_LM; t++) {
+    memcpy(pdFator, pdG, sizeof(double) * iP * iP);
+    for (i = 0; i < iP; i++)
+      pdFator[i * iP + i] += ptTreino->dAmortecimentoLM;
+    if (FatorarCholesky(pdFator, iP)) {
+      memcpy(pdPasso, pdC, sizeof(double) * iP);
+      ResolverCholesky(pdFator, iP, pdPasso, 1);
+      for (j = 0; j < iP; j++)
+        pdPasso[j] += ptTreino->pdPesosLM[j];
+      InserirPesos(ptTreino, pdPasso);
+      if ((dNovoErro = ErroTreinamento(ptTreino)) < dErro) {
+        ptTreino->dAmortecimentoLM = MAXIMO(ptTreino->dAmortecimentoLM / FATOR_LM, MIN_AMORTECIMENTO_LM);
+        return (iCalcularErro ? dNovoErro : 0.0);
+      }
+    }
+    ptTreino->dAmortecimentoLM *= FATOR_LM;
+  }
+
+  // Nenhum passo reduz o erro de treinamento: restaura os pesos e encerra (convergiu)
+  InserirPesos(ptTreino, ptTreino->pdPesosLM);
+  ptTreino->iEncerrarAprendizado = 1;
+  return (iCalcularErro ? dErro : 0.0);
+}
+
+
+void DesalocarLevenbergMarquardt(TTreino *ptTreino)
+{
+  free(ptTreino->pdPesosLM);
+  ptTreino->pdPesosLM = NULL;
+}
+
+
+double TreinarLoteCompleto(TTreino *ptTreino, const int iCalcularErro)
+{
+  // Uma iteracao do otimizador de lote completo sobre todo o database
+  switch (ptTreino->tParametros.iAlgoritmo) {
+    case ALGORITMO_LM:
+      return TreinarLevenbergMarquardt(ptTreino, iCalcularErro);
+    case ALGORITMO_RPROP:
+      return TreinarRprop(ptTreino, iCalcularErro);
+    default:
+      return TreinarLbfgs(ptTreino, iCalcularErro);
+  }
+}
+
+
+int AlocarOtimizador(TTreino *ptTreino)
+{
+  int i, iP = NumeroPesosRede(ptTreino);
+
+  // Vetores com um valor por peso (os pares do L-BFGS ocupam MEMORIA_LBFGS vetores cada)
+  memset(&ptTreino->tOtimizador, 0, sizeof(TOtimizador));
+  ptTreino->tOtimizador.iNumPesos = iP;
+  ptTreino->tOtimizador.pdPesos = (double*) malloc(sizeof(double) * iP * (5 + 2 * MEMORIA_LBFGS));
+  ptTreino->tOtimizador.pdGradiente = &ptTreino->tOtimizador.pdPesos[iP];
+  ptTreino->tOtimizador.pdGradienteAnterior = &ptTreino->tOtimizador.pdPesos[2 * iP];
+  ptTreino->tOtimizador.pdDelta = &ptTreino->tOtimizador.pdPesos[3 * iP];
+  ptTreino->tOtimizador.pdTentativa = &ptTreino->tOtimizador.pdPesos[4 * iP];
+  ptTreino->tOtimizador.pdS = &ptTreino->tOtimizador.pdPesos[5 * iP];
+  ptTreino->tOtimizador.pdY = &ptTreino->tOtimizador.pdS[MEMORIA_LBFGS * iP];
+  for (i = 0; i < iP; i++) {
+    ptTreino->tOtimizador.pdGradienteAnterior[i] = 0.0;
+    ptTreino->tOtimizador.pdDelta[i] = DELTA_INICIAL_RPROP;
+  }
+  ptTreino->pdParciaisGradiente = (double*) malloc(sizeof(double) * NUM_PARCIAIS_NORMAIS * (iP + 1));
+  return 1;
+}
+
+
+void *AcumularGradientes(void *pArg)
+{
+  register int j;
+  TAvaliador *ptAval = (TAvaliador*) pArg;
+  TTreino *ptTreino = ptAval->ptTreino;
+  int c, i, l, p, r, iFim, iP = ptTreino->tOtimizador.iNumPesos, iUltima = ptTreino->tRede.iNumCamadas - 1;
+  int iNumFatias = (ptAval->iNumRegistros + TAMANHO_FATIA_TESTE - 1) / TAMANHO_FATIA_TESTE;
+  int iNumThreads = (ptTreino->ptAvaliadores != NULL ? ptTreino->iNumeroThreads : 1);
+  double *pdGradiente, dSoma;
+  const TReal *pdRegistro, *pdEntrada, *pdSaida;
+  const TCamada *ptCamada, *ptProxima;
+
+  // A parcial p acumula as fatias p, p + NUM_PARCIAIS_NORMAIS, ... (a divisao nao depende das threads);
+  // cada parcial tem o gradiente de 1/2 * erro quadrado seguido do erro quadrado
+  for (p = ptAval->iPrimeiraFatia; p < NUM_PARCIAIS_NORMAIS; p += iNumThreads) {
+    for (c = p; c < iNumFatias; c += NUM_PARCIAIS_NORMAIS) {
+      iFim = MINIMO((c + 1) * TAMANHO_FATIA_TESTE, ptAval->iNumRegistros);
+      for (r = c * TAMANHO_FATIA_TESTE; r < iFim; r++) {
+        pdRegistro = ptAval->ppdRegistros[r];
+        AtivarRede(&ptTreino->tRede, pdRegistro, ptAval->ppdSaida);
+        ptTreino->pdParciaisGradiente[p * (iP + 1) + iP] += SomaQuadradosDiferenca(&pdRegistro[iNumeroEntradas],
+            ptAval->ppdSaida[iUltima], iNumeroSaidas);
+
+        // Retropropaga o erro (como em AjustarPesosLocal, sem o passo)
+        for (l = iUltima; l >= 0; l--) {
+          ptCamada = &ptTreino->tRede.vtCamadas[l];
+          ptProxima = &ptTreino->tRede.vtCamadas[l + 1];
+          pdSaida = ptAval->ppdSaida[l];
+          for (i = 0; i < ptCamada->iNumNeuronios; i++) {
+            if (l == iUltima)
+              dSoma = pdRegistro[iNumeroEntradas + i] - pdSaida[i];
+            else {
+              dSoma = 0.0;
+              for (j = 0; j < ptProxima->iNumNeuronios; j++)
+                dSoma += ptAval->ppdErro[l + 1][j] * ptProxima->pdPeso[j * ptProxima->iStride + i];
+            }
+            ptAval->ppdErro[l][i] = (TReal) (dSoma * DERIVADA_ATIVACAO(ptCamada->iAtivacao, pdSaida[i]));
+          }
+        }
+
+        // Gradiente na ordem de ExtrairPesos
+        pdGradiente = &ptTreino->pdParciaisGradiente[p * (iP + 1)];
+        for (l = 0; l <= iUltima; l++) {
+          ptCamada = &ptTreino->tRede.vtCamadas[l];
+          pdEntrada = (l ? ptAval->ppdSaida[l - 1] : pdRegistro);
+          for (i = 0; i < ptCamada->iNumNeuronios; i++) {
+            dSoma = ptAval->ppdErro[l][i];
+            for (j = 0; j < ptCamada->iNumEntradas; j++)
+              pdGradiente[j] -= dSoma * pdEntrada[j];
+            pdGradiente[ptCamada->iNumEntradas] -= dSoma;
+            pdGradiente += ptCamada->iNumEntradas + 1;
+          }
+        }
+      }
+    }
+  }
+  return NULL;
+}
+
+
+double CalcularGradiente(TTreino *ptTreino, double *pdGradiente)
+{
+  int i, p, iP = ptTreino->tOtimizador.iNumPesos;
+
+  // Gradiente do erro sobre todo o database de treinamento, somando as parciais em ordem fixa;
+  // retorna a soma dos erros quadrados
+  memset(ptTreino->pdParciaisGradiente, 0, sizeof(double) * NUM_PARCIAIS_NORMAIS * (iP + 1));
+  PercorrerTreinamento(ptTreino, AcumularGradientes);
+  for (p = 1; p < NUM_PARCIAIS_NORMAIS; p++)
+    for (i = 0; i <= iP; i++)
+      ptTreino->pdParciaisGradiente[i] += ptTreino->pdParciaisGradiente[p * (iP + 1) + i];
+  memcpy(pdGradiente, ptTreino->pdParciaisGradiente, sizeof(double) * iP);
+  return ptTreino->pdParciaisGradiente[iP];
+}
+
+
+double TreinarRprop(TTreino *ptTreino, const int iCalcularErro)
+{
+  register int i;
+  TOtimizador *ptOt = &ptTreino->tOtimizador;
+  double dErro, dProduto;
+
+  // iRprop-: cada peso tem o seu passo, que cresce enquanto o sinal do gradiente se mantem e diminui
+  // quando ele troca (e entao o peso nao e ajustado nesta iteracao); o passo -p nao e usado
+  dErro = CalcularGradiente(ptTreino, ptOt->pdGradiente);
+  ExtrairPesos(ptTreino, ptOt->pdPesos);
+  for (i = 0; i < ptOt->iNumPesos; i++) {
+    dProduto = ptOt->pdGradiente[i] * ptOt->pdGradienteAnterior[i];
+    if (dProduto > 0.0)
+      ptOt->pdDelta[i] = MINIMO(ptOt->pdDelta[i] * AUMENTO_RPROP, MAX_DELTA_RPROP);
+    else if (dProduto < 0.0) {
+      ptOt->pdDelta[i] = MAXIMO(ptOt->pdDelta[i] * REDUCAO_RPROP, MIN_DELTA_RPROP);
+      ptOt->pdGradiente[i] = 0.0;
+    }
+    if (ptOt->pdGradiente[i] > 0.0)
+      ptOt->pdPesos[i] -= ptOt->pdDelta[i];
+    else if (ptOt->pdGradiente[i] < 0.0)
+      ptOt->pdPesos[i] += ptOt->pdDelta[i];
+    ptOt->pdGradienteAnterior[i] = ptOt->pdGradiente[i];
+  }
+  InserirPesos(ptTreino, ptOt->pdPesos);
+  return (iCalcularErro ? dErro : 0.0);
+}
+
+
+double TreinarLbfgs(TTreino *ptTreino, const int iCalcularErro)
+{
+  register int i;
+  TOtimizador *ptOt = &ptTreino->tOtimizador;
+  int k, t, iPar, iP = ptOt->iNumPesos;
+  double dDerivada, dPassoLinha, dNovoErro, dBeta, dSy, dYy, dNorma = 0.0;
+  double *pdS, *pdY;
+
+  // Gradiente nos pesos atuais (apenas na primeira iteracao; depois vem da busca linear anterior)
+  if (!ptOt->iValido) {
+    ExtrairPesos(ptTreino, ptOt->pdPesos);
+    ptOt->dErro = CalcularGradiente(ptTreino, ptOt->pdGradiente);
+    ptOt->iValido = 1;
+  }
+
+  // Direcao d = -H g pela recursao de dois lacos sobre os ultimos pares (s, y), com H0 = s'y / y'y
+  for (i = 0; i < iP; i++)
+    ptOt->pdDelta[i] = -ptOt->pdGradiente[i];
+  for (k = 0; k < ptOt->iNumPares; k++) {
+    iPar = (ptOt->iProximoPar - 1 - k + MEMORIA_LBFGS) % MEMORIA_LBFGS;
+    pdS = &ptOt->pdS[iPar * iP];
+    pdY = &ptOt->pdY[iPar * iP];
+    for (i = 0, ptOt->vdAlfa[iPar] = 0.0; i < iP; i++)
+      ptOt->vdAlfa[iPar] += pdS[i] * ptOt->pdDelta[i];
+    ptOt->vdAlfa[iPar] *= ptOt->vdRho[iPar];
+    for (i = 0; i < iP; i++)
+      ptOt->pdDelta[i] -= ptOt->vdAlfa[iPar] * pdY[i];
+  }
+  if (ptOt->iNumPares > 0) {
+    iPar = (ptOt->iProximoPar - 1 + MEMORIA_LBFGS) % MEMORIA_LBFGS;
+    for (i = 0, dSy = dYy = 0.0; i < iP; i++) {
+      dSy += ptOt->pdS[iPar * iP + i] * ptOt->pdY[iPar * iP + i];
+      dYy += ptOt->pdY[iPar * iP + i] * ptOt->pdY[iPar * iP + i];
+    }
+    for (i = 0; i < iP; i++)
+      ptOt->pdDelta[i] *= dSy / dYy;
+  }
+  for (k = ptOt->iNumPares - 1; k >= 0; k--) {
+    iPar = (ptOt->iProximoPar - 1 - k + MEMORIA_LBFGS) % MEMORIA_LBFGS;
+    pdS = &ptOt->pdS[iPar * iP];
+    pdY = &ptOt->pdY[iPar * iP];
+    for (i = 0, dBeta = 0.0; i < iP; i++)
+      dBeta += pdY[i] * ptOt->pdDelta[i];
+    dBeta *= ptOt->vdRho[iPar];
+    for (i = 0; i < iP; i++)
+      ptOt->pdDelta[i] += (ptOt->vdAlfa[iPar] - dBeta) * pdS[i];
+  }
+
+  // Sem memoria (ou se d nao e de descida) usa -g com passo unitario no espaco dos pesos
+  for (i = 0, dDerivada = 0.0; i < iP; i++) {
+    dDerivada += ptOt->pdGradiente[i] * ptOt->pdDelta[i];
+    dNorma += ptOt->pdGradiente[i] * ptOt->pdGradiente[i];
+  }
+  dPassoLinha = 1.0;
+  if (!ptOt->iNumPares || dDerivada >= 0.0) {
+    for (i = 0; i < iP; i++)
+      ptOt->pdDelta[i] = -ptOt->pdGradiente[i];
+    dDerivada = -dNorma;
+    dPassoLinha = 1.0 / MAXIMO(sqrt(dNorma), 1.0e-30);
+  }
+
+  // Busca linear com retrocesso ate a condicao de Armijo (o erro e 1/2 * soma dos quadrados)
+  for (t = 0; t < TENTATIVAS_LBFGS; t++, dPassoLinha *= 0.5) {
+    for (i = 0; i < iP; i++)
+      ptOt->pdTentativa[i] = ptOt->pdPesos[i] + dPassoLinha * ptOt->pdDelta[i];
+    InserirPesos(ptTreino, ptOt->pdTentativa);
+    dNovoErro = CalcularGradiente(ptTreino, ptOt->pdGradienteAnterior);
+    if (0.5 * dNovoErro <= 0.5 * ptOt->dErro + ARMIJO_LBFGS * dPassoLinha * dDerivada)
+      break;
+  }
+  if (t == TENTATIVAS_LBFGS) {
+    // Nenhum passo reduz o erro: descarta a memoria ou, se ela ja estava vazia, encerra (convergiu)
+    InserirPesos(ptTreino, ptOt->pdPesos);
+    if (!ptOt->iNumPares)
+      ptTreino->iEncerrarAprendizado = 1;
+    ptOt->iNumPares = ptOt->iProximoPar = 0;
+    return (iCalcularErro ? ptOt->dErro : 0.0);
+  }
+
+  // Guarda o par s = w' - w, y = g' - g se a curvatura for positiva e avanca
+  iPar = ptOt->iProximoPar;
+  pdS = &ptOt->pdS[iPar * iP];
+  pdY = &ptOt->pdY[iPar * iP];
+  for (i = 0, dSy = 0.0; i < iP; i++) {
+    pdS[i] = ptOt->pdTentativa[i] - ptOt->pdPesos[i];
+    pdY[i] = ptOt->pdGradienteAnterior[i] - ptOt->pdGradiente[i];
+    dSy += pdS[i] * pdY[i];
+  }
+  if (dSy > 1.0e-10) {
+    ptOt->vdRho[iPar] = 1.0 / dSy;
+    ptOt->iProximoPar = (iPar + 1) % MEMORIA_LBFGS;
+    ptOt->iNumPares = MINIMO(ptOt->iNumPares + 1, MEMORIA_LBFGS);
+  }
+  memcpy(ptOt->pdPesos, ptOt->pdTentativa, sizeof(double) * iP);
+  memcpy(ptOt->pdGradiente, ptOt->pdGradienteAnterior, sizeof(double) * iP);
+  ptOt->dErro = dNovoErro;
+  return (iCalcularErro ? dNovoErro : 0.0);
+}
+
+
+void DesalocarOtimizador(TTreino *ptTreino)
+{
+  free(ptTreino->tOtimizador.pdPesos);
+  free(ptTreino->pdParciaisGradiente);
+  ptTreino->tOtimizador.pdPesos = NULL;
+  ptTreino->pdParciaisGradiente = NULL;
+}
+
+
+int CodigoAlgoritmo(const char *szNome)
+{
+  int i;
+
+  for (i = 0; i < NUM_ALGORITMOS; i++) {
+    if (!strcmp(szNome, vszNomesAlgoritmos[i]))
+      return i;
+  }
+  return -1;
+}
+
+
+int CodigoRegra(const char *szNome)
+{
+  int i;
+
+  for (i = 0; i < NUM_REGRAS; i++) {
+    if (!strcmp(szNome, vszNomesRegras[i]))
+      return i;
+  }
+  return -1;
+}
+
+
+void IniciarGravador(TTreino *ptTreino)
+{
+  // A thread de gravacao espera pelas copias dos pesos da melhor epoca
+  memset(&ptTreino->tGravador, 0, sizeof(TGravador));
+  pthread_mutex_init(&ptTreino->tGravador.tMutex, NULL);
+  pthread_cond_init(&ptTreino->tGravador.tCondicao, NULL);
+  pthread_create(&ptTreino->tGravador.tThread, NULL, ExecutarGravador, ptTreino);
+  ptTreino->tGravador.iAtivo = 1;
+}
+
+
+void SolicitarGravacao(TTreino *ptTreino)
+{
+  // Apenas a copia dos pesos e feita pela thread de treinamento
+  pthread_mutex_lock(&ptTreino->tGravador.tMutex);
+  if (CopiarRede(&ptTreino->tGravador.tPendente, &ptTreino->tRede))
+    ptTreino->tGravador.iPendente = 1;
+  else
+    fprintf(stderr, "ERRO: Memoria insuficiente para a copia dos pesos\n");
+  pthread_cond_broadcast(&ptTreino->tGravador.tCondicao);
+  pthread_mutex_unlock(&ptTreino->tGravador.tMutex);
+}
+
+
+void *ExecutarGravador(void *pArg)
+{
+  TTreino *ptTreino = (TTreino*) pArg;
+  TGravador *ptGrav = &ptTreino->tGravador;
+  TRede tAux;
+  TReal **ppdSaida;
+
+  pthread_mutex_lock(&ptGrav->tMutex);
+  for (;;) {
+    // Espera uma nova copia; ao encerrar, grava a que estiver pendente antes de sair
+    while (!ptGrav->iPendente && !ptGrav->iEncerrar)
+      pthread_cond_wait(&ptGrav->tCondicao, &ptGrav->tMutex);
+    if (!ptGrav->iPendente)
+      break;
+    tAux = ptGrav->tGravando;
+    ptGrav->tGravando = ptGrav->tPendente;
+    ptGrav->tPendente = tAux;
+    ptGrav->iPendente = 0;
+    pthread_mutex_unlock(&ptGrav->tMutex);
+
+    // Grava as saidas e os pesos fora da regiao critica
+    ppdSaida = AlocarSaidasRede(&ptGrav->tGravando);
+    if (!GravarArquivoSaidas(&ptGrav->tGravando, ppdSaida, ptTreino->vcArquivoSaida) ||
+        !GravarPesos(&ptGrav->tGravando, ptTreino->vcArquivoPesos, 0) ||
+        !GravarPesos(&ptGrav->tGravando, ptTreino->vcArquivoPesosBinario, 1))
+      fprintf(stderr, "ERRO: Nao foi possivel gravar a melhor epoca\n");
+    LiberarSaidasRede(&ptGrav->tGravando, ppdSaida);
+    pthread_mutex_lock(&ptGrav->tMutex);
+  }
+  pthread_mutex_unlock(&ptGrav->tMutex);
+  return NULL;
+}
+
+
+int GravarArquivoSaidas(const TRede *ptRede, TReal **ppdSaida, const char *szNomeArquivo)
+{
+  char vcTemporario[MAX_LINHA + 5];
+  TReal **ppdBloco;
+  int iNumBloco;
+  double dErro = 0.0;
+  FILE* fp = NULL;
+
+  // Grava em um arquivo temporario, substituido de uma vez ao final
+  sprintf(vcTemporario, "%s.tmp", szNomeArquivo);
+  if ((fp = fopen(vcTemporario, "w")) == NULL)
+    return 0;
+  if (iTamanhoJanela <= 0)
+    dErro = AvaliarRede(ptRede, ppdSaida, ppdDatabaseGenera, iNumeroRegistrosGenera, fp);
+  else {
+    IniciarPassagemFluxo(&tFluxoSaidas, NULL);
+    while ((ppdBloco = ProximoBlocoFluxo(&tFluxoSaidas, &iNumBloco)) != NULL)
+      dErro += AvaliarRede(ptRede, ppdSaida, ppdBloco, iNumBloco, fp);
+  }
+  fprintf(fp, "MSE: %f\n", dErro / (double) (iNumeroSaidas * iNumeroRegistrosGenera));
+  if (fclose(fp) != 0) {
+    remove(vcTemporario);
+    return 0;
+  }
+  return SubstituirArquivo(vcTemporario, szNomeArquivo);
+}
+
+
+int GravarPesos(const TRede *ptRede, const char *szNomeArquivo, const int iBinario)
+{
+  char vcTemporario[MAX_LINHA + 5];
+  FILE *fp = NULL;
+  int iOk = 1;
+
+  // Topologia e pesos no formato .wts (texto) ou .wtsb (binario), tambem por arquivo temporario
+  sprintf(vcTemporario, "%s.tmp", szNomeArquivo);
+  if ((fp = fopen(vcTemporario, (iBinario ? "wb" : "w"))) == NULL)
+    return 0;
+  if (iBinario)
+    iOk = EscreverRedeBinaria(ptRede, fp);
+  else
+    EscreverRede(ptRede, fp);
+  if (fclose(fp) != 0 || !iOk) {
+    remove(vcTemporario);
+    return 0;
+  }
+  return SubstituirArquivo(vcTemporario, szNomeArquivo);
+}
+
+
+void EncerrarGravador(TTreino *ptTreino)
+{
+  // Aguarda a gravacao pendente e libera as copias dos pesos
+  if (!ptTreino->tGravador.iAtivo)
+    return;
+  pthread_mutex_lock(&ptTreino->tGravador.tMutex);
+  ptTreino->tGravador.iEncerrar = 1;
+  pthread_cond_broadcast(&ptTreino->tGravador.tCondicao);
+  pthread_mutex_unlock(&ptTreino->tGravador.tMutex);
+  pthread_join(ptTreino->tGravador.tThread, NULL);
+  DestruirRede(&ptTreino->tGravador.tPendente);
+  DestruirRede(&ptTreino->tGravador.tGravando);
+  pthread_mutex_destroy(&ptTreino->tGravador.tMutex);
+  pthread_cond_destroy(&ptTreino->tGravador.tCondicao);
+  ptTreino->tGravador.iAtivo = 0;
+}
+
+
+void DesalocarMemoriaAnn(TTreino *ptTreino)
+{
+  // Desaloca os buffers de ativacao e as camadas
+  if (ptTreino->tPropagacaoAnn.ppdSaida != NULL)
+    LiberarPropagacao(ptTreino, &ptTreino->tPropagacaoAnn);
+  ptTreino->pdSaidaObtida = NULL;
+  DestruirRede(&ptTreino->tRede);
+}
+
+
+void LiberarTreino(TTreino *ptTreino)
+{
+  // Libera a rede, a ordem da epoca e o proprio contexto
+  if (ptTreino == NULL)
+    return;
+  DesalocarMemoriaAnn(ptTreino);
+  free(ptTreino->piOrdemTreino);
+  free(ptTreino->ppdEpocaTreino);
+  free(ptTreino);
+}
+
+
+void DesalocarDatabases()
+{
+  // Desaloca os databases (ou libera o mapeamento dos arquivos binarios e os fluxos)
+  DesalocarDatabase(&tDatabaseTreino);
+  DesalocarDatabase(&tDatabaseGenera);
+  FecharFluxo(&tFluxoTreino);
+  FecharFluxo(&tFluxoGenera);
+  FecharFluxo(&tFluxoSaidas);
+  if (piOrdemBlocos != NULL) {
+    free(piOrdemBlocos);
+    piOrdemBlocos = NULL;
+  }
+  ppdDatabaseTreino = ppdDatabaseGenera = NULL;
+  iNumeroRegistrosTreino = iNumeroRegistrosGenera = 0;
 }
@@ -0,0 +1,490 @@
+//************************************************************************************************
+//* UNIVERSIDADE FEDERAL DO RIO GRANDE DO SUL (UFRGS) - Campus do Vale                          **
+//* Doutorado em Ciencia da Computacao - PPGC                                                   **
+//* Doutorando: Milton Roberto Heinen - 00145752                                                **
+//* Orientador: Paulo Martins Engel                                                             **
+//* Varredura de hiperparametros (grade, busca aleatoria e reducao sucessiva em threads)        **
+//************************************************************************************************
+
+//*************************************** Includes ***********************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include "rede.h"
+#include "database.h"
+#include "aleatorio.h"
+#include "varredura.h"
+
+
+//************************************** Constantes **********************************************
+#define MAX_LINHA 1024
+#define JOB_PENDENTE 0
+#define JOB_EXECUTANDO 1
+#define JOB_PAUSADO 2
+#define JOB_APROVADO 3
+#define JOB_ENCERRANDO 4
+#define JOB_CONCLUIDO 5
+#define MINIMO(a, b) ((a) < (b) ? (a) : (b))
+#define MAXIMO(a, b) ((a) > (b) ? (a) : (b))
+
+
+//************************************ Tipos de dados ********************************************
+// Parametro da varredura: valores da grade (ou faixas "min:max" na busca aleatoria)
+typedef struct {
+  char cParametro;
+  int iNumValores;
+  char vszValores[MAX_VALORES][MAX_VALOR + 1];
+} TParametroVarredura;
+
+// Configuracao de um job da varredura, o seu resultado e o seu treinamento (o contexto, mantido enquanto o
+// job esta pausado em um degrau da reducao sucessiva, e o log <base>_<job>.log)
+typedef struct {
+  char vszValores[MAX_PARAMETROS][MAX_VALOR + 1];
+  double dMenorErro;
+  int iMelhorEpoca;
+  int iEpocas;
+  double dTempo;
+  int iIndice;
+  int iOk;
+  int iEstado;
+  int iEliminado;
+  int iNumThreads;
+  TTreino *ptTreino;
+  FILE *fpLog;
+} TJob;
+
+
+//*********************************** Variaveis locais *******************************************
+static TParametroVarredura vtParametrosVarredura[MAX_PARAMETROS];
+static int iNumeroParametrosVarredura = 0;
+static TJob *ptJobs = NULL;
+static int iNumeroJobsVarredura = 0;
+static int iEpocasDegrau = 0;
+static int iFatorReducao = FATOR_REDUCAO;
+static int iProximoDegrau = 0;
+static int iThreadsDegrau = 0;
+static int iJobsSimultaneos = 0;
+static int iThreadsJob = 0;
+static int iConcluidos = 0;
+static int iAtivos = 0;
+static const char *szNomeVarredura = NULL;
+static pthread_mutex_t tMutexVarredura;
+static pthread_cond_t tCondicaoVarredura;
+
+
+//************************************** Prototipos **********************************************
+static int GerarJobsVarredura(const int iNumAmostras, const unsigned long ulSemente);
+static void SortearValor(TGerador *ptGerador, const char *szFaixa, char *szValor);
+static void DescreverJob(const TJob *ptJob, char *szDescricao);
+static void *ExecutarTrabalhador(void *pArg);
+static int EscolherJob();
+static int ExecutarJob(TJob *ptJob, const int iEstado, const int iDegrau, const int iNumThreads);
+static void PromoverDegrau();
+static int CompararPausados(const void *pA, const void *pB);
+static int CompararJobs(const void *pA, const void *pB);
+static int ConcluirVarredura(const char *szNomeBase);
+
+
+//*************************************** Funcoes ************************************************
+int LerVarredura(const char *szNomeArquivo, const unsigned long ulSemente)
+{
+  char vcLinha[MAX_LINHA + 1];
+  char *szPalavra = NULL;
+  TParametroVarredura *ptParametro;
+  int iNumAmostras = 0, iLinha = 0;
+  FILE *fp = NULL;
+
+  // Uma linha por parametro com os seus valores (ex: "p 0.001 0.0001"); "aleatorio N" sorteia N
+  // configuracoes em vez de percorrer a grade, aceitando tambem faixas "min:max", e "reducao N [fator]"
+  // elimina as piores configuracoes nos degraus de N, N*fator, ... epocas
+  if ((fp = fopen(szNomeArquivo, "r")) == NULL) {
+    fprintf(stderr, "ERRO: Nao foi possivel abrir a varredura\n");
+    return 0;
+  }
+  while (fgets(vcLinha, MAX_LINHA, fp) != NULL) {
+    iLinha++;
+    if ((szPalavra = strtok(vcLinha, " \t\r\n")) == NULL || szPalavra[0] == '#')
+      continue;
+    if (!strcmp(szPalavra, "reducao")) {
+      // Reducao sucessiva: degraus em N, N*fator, ... epocas, mantendo o melhor 1/fator em cada um
+      szPalavra = strtok(NULL, " \t\r\n");
+      if (szPalavra == NULL || (iEpocasDegrau = atoi(szPalavra)) < 1 ||
+          ((szPalavra = strtok(NULL, " \t\r\n")) != NULL && (iFatorReducao = atoi(szPalavra)) < 2)) {
+        fprintf(stderr, "ERRO: Degrau ou fator de reducao invalido na linha %d da varredura\n", iLinha);
+        fclose(fp);
+        return 0;
+      }
+      continue;
+    }
+    if (!strcmp(szPalavra, "aleatorio")) {
+      szPalavra = strtok(NULL, " \t\r\n");
+      if (szPalavra == NULL || (iNumAmostras = atoi(szPalavra)) < 1) {
+        fprintf(stderr, "ERRO: Numero de amostras invalido na linha %d da varredura\n", iLinha);
+        fclose(fp);
+        return 0;
+      }
+      continue;
+    }
+    if (strlen(szPalavra) != 1 || strchr(PARAMETROS_VARREDURA, szPalavra[0]) == NULL ||
+        iNumeroParametrosVarredura >= MAX_PARAMETROS) {
+      fprintf(stderr, "ERRO: Parametro invalido na linha %d da varredura (aceitos: %s)\n", iLinha,
+          PARAMETROS_VARREDURA);
+      fclose(fp);
+      return 0;
+    }
+    ptParametro = &vtParametrosVarredura[iNumeroParametrosVarredura++];
+    ptParametro->cParametro = szPalavra[0];
+    for (ptParametro->iNumValores = 0; (szPalavra = strtok(NULL, " \t\r\n")) != NULL &&
+        ptParametro->iNumValores < MAX_VALORES; ptParametro->iNumValores++) {
+      strncpy(ptParametro->vszValores[ptParametro->iNumValores], szPalavra, MAX_VALOR);
+      ptParametro->vszValores[ptParametro->iNumValores][MAX_VALOR] = '\0';
+    }
+    if (!ptParametro->iNumValores) {
+      fprintf(stderr, "ERRO: Parametro sem valores na linha %d da varredura\n", iLinha);
+      fclose(fp);
+      return 0;
+    }
+  }
+  fclose(fp);
+  if (!iNumeroParametrosVarredura) {
+    fprintf(stderr, "ERRO: A varredura nao tem parametros\n");
+    return 0;
+  }
+  return GerarJobsVarredura(iNumAmostras, ulSemente);
+}
+
+
+static int GerarJobsVarredura(const int iNumAmostras, const unsigned long ulSemente)
+{
+  TGerador tGerador;
+  TParametroVarredura *ptParametro;
+  int j, k, iIndice;
+
+  // Grade: produto cartesiano dos valores (o primeiro parametro varia mais rapido)
+  iNumeroJobsVarredura = iNumAmostras;
+  if (!iNumAmostras) {
+    for (k = 0, iNumeroJobsVarredura = 1; k < iNumeroParametrosVarredura && iNumeroJobsVarredura <= MAX_JOBS; k++)
+      iNumeroJobsVarredura *= vtParametrosVarredura[k].iNumValores;
+  }
+  if (iNumeroJobsVarredura > MAX_JOBS) {
+    fprintf(stderr, "ERRO: A varredura tem mais de %d configuracoes\n", MAX_JOBS);
+    return 0;
+  }
+  if ((ptJobs = (TJob*) calloc(iNumeroJobsVarredura, sizeof(TJob))) == NULL) {
+    fprintf(stderr, "ERRO: Memoria insuficiente para a varredura\n");
+    return 0;
+  }
+
+  // Na busca aleatoria cada parametro e sorteado de um fluxo proprio derivado do random seed
+  IniciarGerador(&tGerador, ulSemente, FLUXO_VARREDURA, 0, 0);
+  for (j = 0; j < iNumeroJobsVarredura; j++) {
+    ptJobs[j].iIndice = j;
+    ptJobs[j].dMenorErro = 1.0e32;
+    for (k = 0, iIndice = j; k < iNumeroParametrosVarredura; k++) {
+      ptParametro = &vtParametrosVarredura[k];
+      if (iNumAmostras)
+        SortearValor(&tGerador, ptParametro->vszValores[SortearInteiro(&tGerador, ptParametro->iNumValores)],
+            ptJobs[j].vszValores[k]);
+      else {
+        if (strchr(ptParametro->vszValores[iIndice % ptParametro->iNumValores], ':') != NULL) {
+          fprintf(stderr, "ERRO: Faixas min:max exigem a busca aleatoria\n");
+          return 0;
+        }
+        strcpy(ptJobs[j].vszValores[k], ptParametro->vszValores[iIndice % ptParametro->iNumValores]);
+        iIndice /= ptParametro->iNumValores;
+      }
+    }
+  }
+  return 1;
+}
+
+
+static void SortearValor(TGerador *ptGerador, const char *szFaixa, char *szValor)
+{
+  const char *pcSeparador = strchr(szFaixa, ':');
+  double dMinimo, dMaximo, dAux;
+
+  // Sem ':' o valor e usado como esta; faixas inteiras sao sorteadas uniformemente e as reais
+  // positivas em escala logaritmica (adequado ao passo e a amplitude dos pesos)
+  if (pcSeparador == NULL) {
+    strcpy(szValor, szFaixa);
+    return;
+  }
+  dMinimo = atof(szFaixa);
+  dMaximo = atof(pcSeparador + 1);
+  if (dMaximo < dMinimo) {
+    dAux = dMinimo;
+    dMinimo = dMaximo;
+    dMaximo = dAux;
+  }
+  if (strpbrk(szFaixa, ".eE") == NULL)
+    sprintf(szValor, "%d", (int) dMinimo + SortearInteiro(ptGerador, (int) (dMaximo - dMinimo) + 1));
+  else if (dMinimo > 0.0)
+    sprintf(szValor, "%.6g", dMinimo * pow(dMaximo / dMinimo, SortearReal(ptGerador)));
+  else
+    sprintf(szValor, "%.6g", dMinimo + (dMaximo - dMinimo) * SortearReal(ptGerador));
+}
+
+
+static void DescreverJob(const TJob *ptJob, char *szDescricao)
+{
+  int k;
+
+  // Parametros do job no formato da linha de comando
+  szDescricao[0] = '\0';
+  for (k = 0; k < iNumeroParametrosVarredura; k++)
+    sprintf(&szDescricao[strlen(szDescricao)], "%s-%c %s", (k ? " " : ""), vtParametrosVarredura[k].cParametro,
+        ptJob->vszValores[k]);
+}
+
+
+int RealizarVarredura(const char *szNomeBase, const int iNumJobs, const int iNumThreads)
+{
+  pthread_t *ptThreads;
+  int t, iNumTrabalhadores = MAXIMO(MINIMO(iNumJobs, iNumeroJobsVarredura), 1);
+
+  printf("* Varredura: %d configuracoes, %d jobs simultaneos com %d threads cada\n", iNumeroJobsVarredura,
+      iNumJobs, iNumThreads);
+
+  // Cada uma das -k threads da varredura treina um job por vez, com o seu proprio contexto sobre os
+  // databases ja carregados (somente lidos); com a reducao sucessiva os jobs pausam nos degraus, liberando
+  // a thread, e so os melhores continuam (a thread principal e um dos trabalhadores)
+  szNomeVarredura = szNomeBase;
+  iJobsSimultaneos = iNumJobs;
+  iThreadsJob = iThreadsDegrau = iNumThreads;
+  iProximoDegrau = iEpocasDegrau;
+  iConcluidos = iAtivos = 0;
+  pthread_mutex_init(&tMutexVarredura, NULL);
+  pthread_cond_init(&tCondicaoVarredura, NULL);
+  ptThreads = (pthread_t*) malloc(sizeof(pthread_t) * iNumTrabalhadores);
+  for (t = 1; t < iNumTrabalhadores; t++)
+    pthread_create(&ptThreads[t], NULL, ExecutarTrabalhador, NULL);
+  ExecutarTrabalhador(NULL);
+  for (t = 1; t < iNumTrabalhadores; t++)
+    pthread_join(ptThreads[t], NULL);
+  free(ptThreads);
+  pthread_mutex_destroy(&tMutexVarredura);
+  pthread_cond_destroy(&tCondicaoVarredura);
+
+  // Ordena os resultados e mantem apenas os arquivos do vencedor
+  return ConcluirVarredura(szNomeBase);
+}
+
+
+static void *ExecutarTrabalhador(void *pArg)
+{
+  char vcDescricao[MAX_LINHA + 1];
+  int j, iEstado, iDegrau, iNumThreads, iPausado;
+
+  pthread_mutex_lock(&tMutexVarredura);
+  while (iConcluidos < iNumeroJobsVarredura) {
+    // Sem jobs disponiveis, aguarda os jobs em execucao; se os restantes estao todos pausados no degrau,
+    // este trabalhador decide quais continuam
+    if ((j = EscolherJob()) < 0) {
+      if (!iAtivos)
+        PromoverDegrau();
+      else
+        pthread_cond_wait(&tCondicaoVarredura, &tMutexVarredura);
+      continue;
+    }
+    iEstado = ptJobs[j].iEstado;
+    iDegrau = iProximoDegrau;
+    iNumThreads = (iEstado == JOB_PENDENTE ? iThreadsJob : iThreadsDegrau);
+    ptJobs[j].iEstado = JOB_EXECUTANDO;
+    iAtivos++;
+    pthread_mutex_unlock(&tMutexVarredura);
+
+    // Treina o job fora da regiao critica ate o proximo degrau ou ate o fim
+    iPausado = ExecutarJob(&ptJobs[j], iEstado, iDegrau, iNumThreads);
+    pthread_mutex_lock(&tMutexVarredura);
+    iAtivos--;
+    if (iPausado)
+      ptJobs[j].iEstado = JOB_PAUSADO;
+    else {
+      ptJobs[j].iEstado = JOB_CONCLUIDO;
+      DescreverJob(&ptJobs[j], vcDescricao);
+      printf("* Job %4d/%d: MSE %9.6f epoca %6d %8.2f s  %s%s\n", ++iConcluidos, iNumeroJobsVarredura,
+          ptJobs[j].dMenorErro, ptJobs[j].iMelhorEpoca, ptJobs[j].dTempo, vcDescricao,
+          (ptJobs[j].iEliminado ? "  (eliminado)" : ""));
+      fflush(stdout);
+    }
+    pthread_cond_broadcast(&tCondicaoVarredura);
+  }
+  pthread_mutex_unlock(&tMutexVarredura);
+  return NULL;
+}
+
+
+static int EscolherJob()
+{
+  static const int viOrdem[3] = { JOB_ENCERRANDO, JOB_APROVADO, JOB_PENDENTE };
+  int e, j;
+
+  // Primeiro os jobs eliminados no degrau (que so precisam ser encerrados), depois os aprovados e por fim
+  // os que ainda nao comecaram
+  for (e = 0; e < 3; e++) {
+    for (j = 0; j < iNumeroJobsVarredura; j++)
+      if (ptJobs[j].iEstado == viOrdem[e])
+        return j;
+  }
+  return -1;
+}
+
+
+static int ExecutarJob(TJob *ptJob, const int iEstado, const int iDegrau, const int iNumThreads)
+{
+  char vcArquivoLog[MAX_LINHA + 1], vcDescricao[MAX_LINHA + 1];
+  double dInicio = TempoReal();
+  int iPausado = 0;
+
+  // Um job novo prepara o seu treinamento, com o relatorio em <base>_<job>.log; a configuracao e aplicada
+  // pelo tlfn sobre uma copia dos parametros da linha de comando
+  if (iEstado == JOB_PENDENTE) {
+    DescreverJob(ptJob, vcDescricao);
+    sprintf(vcArquivoLog, "%s_%d.log", szNomeVarredura, ptJob->iIndice + 1);
+    if ((ptJob->fpLog = fopen(vcArquivoLog, "w")) == NULL) {
+      fprintf(stderr, "ERRO: Nao foi possivel iniciar o job %d\n", ptJob->iIndice + 1);
+      return 0;
+    }
+    fprintf(ptJob->fpLog, "* Job %d: %s\n", ptJob->iIndice + 1, vcDescricao);
+    ptJob->iNumThreads = iNumThreads;
+    if ((ptJob->ptTreino = CriarJob(szNomeVarredura, ptJob->iIndice, vcDescricao, ptJob->fpLog)) == NULL) {
+      fclose(ptJob->fpLog);
+      return 0;
+    }
+  }
+  else if (iEstado == JOB_ENCERRANDO)
+    fprintf(ptJob->fpLog, "* Job eliminado no degrau da epoca %d\n", ptJob->iEpocas);
+  else if (iNumThreads != ptJob->iNumThreads)
+    fprintf(ptJob->fpLog, "* Job continua no degrau da epoca %d com %d threads\n", ptJob->iEpocas, iNumThreads);
+
+  // Treina ate o degrau (o tempo pausado nos degraus nao conta) e encerra o job que nao pausou
+  if (iEstado != JOB_ENCERRANDO) {
+    ptJob->iNumThreads = iNumThreads;
+    iPausado = TreinarJob(ptJob->ptTreino, iDegrau, iNumThreads, &ptJob->dMenorErro, &ptJob->iMelhorEpoca,
+        &ptJob->iEpocas);
+  }
+  if (!iPausado) {
+    EncerrarJob(ptJob->ptTreino, &ptJob->dMenorErro, &ptJob->iMelhorEpoca, &ptJob->iEpocas);
+    ptJob->ptTreino = NULL;
+    ptJob->iOk = 1;
+    fclose(ptJob->fpLog);
+  }
+  else
+    fflush(ptJob->fpLog);
+  ptJob->dTempo += TempoReal() - dInicio;
+  return iPausado;
+}
+
+
+static void PromoverDegrau()
+{
+  int *piPausados, iNumPausados = 0, iSobreviventes, j;
+
+  // Barreira do degrau: o melhor 1/fator dos jobs pausados (pelo MSE ate o degrau) continua e os demais
+  // sao encerrados pelos trabalhadores; com um unico sobrevivente nao ha mais degraus
+  piPausados = (int*) malloc(sizeof(int) * iNumeroJobsVarredura);
+  for (j = 0; j < iNumeroJobsVarredura; j++)
+    if (ptJobs[j].iEstado == JOB_PAUSADO)
+      piPausados[iNumPausados++] = j;
+  qsort(piPausados, iNumPausados, sizeof(int), CompararPausados);
+  iSobreviventes = (iNumPausados + iFatorReducao - 1) / iFatorReducao;
+  for (j = 0; j < iNumPausados; j++) {
+    if (j < iSobreviventes)
+      ptJobs[piPausados[j]].iEstado = JOB_APROVADO;
+    else {
+      ptJobs[piPausados[j]].iEstado = JOB_ENCERRANDO;
+      ptJobs[piPausados[j]].iEliminado = 1;
+    }
+  }
+  free(piPausados);
+
+  // As threads de -k x -j sao divididas entre os sobreviventes que cabem nas vagas (nunca menos que -j)
+  iThreadsDegrau = MAXIMO(iThreadsJob, iJobsSimultaneos * iThreadsJob /
+      MAXIMO(MINIMO(iSobreviventes, iJobsSimultaneos), 1));
+  printf("* Degrau da epoca %d: %d de %d jobs continuam com %d threads cada\n", iProximoDegrau, iSobreviventes,
+      iNumPausados, iThreadsDegrau);
+  iProximoDegrau = (iSobreviventes > 1 ? iProximoDegrau * iFatorReducao : 0);
+  pthread_cond_broadcast(&tCondicaoVarredura);
+}
+
+
+static int CompararPausados(const void *pA, const void *pB)
+{
+  const TJob *ptA = &ptJobs[*(const int*) pA], *ptB = &ptJobs[*(const int*) pB];
+
+  // Menor MSE ate o degrau primeiro (empates pela ordem dos jobs)
+  if (ptA->dMenorErro != ptB->dMenorErro)
+    return (ptA->dMenorErro < ptB->dMenorErro ? -1 : 1);
+  return ptA->iIndice - ptB->iIndice;
+}
+
+
+static int CompararJobs(const void *pA, const void *pB)
+{
+  const TJob *ptA = (const TJob*) pA, *ptB = (const TJob*) pB;
+
+  // Menor MSE primeiro; jobs que falharam ficam no final
+  if (ptA->iOk != ptB->iOk)
+    return (ptA->iOk ? -1 : 1);
+  if (ptA->dMenorErro != ptB->dMenorErro)
+    return (ptA->dMenorErro < ptB->dMenorErro ? -1 : 1);
+  return ptA->iIndice - ptB->iIndice;
+}
+
+
+static int ConcluirVarredura(const char *szNomeBase)
+{
+  static const char *vszExtensoes[4] = { "wts", "wts" EXTENSAO_PESOS_BINARIO, "out", "log" };
+  char vcArquivoJob[MAX_LINHA + 1], vcArquivoFinal[MAX_LINHA + 1], vcDescricao[MAX_LINHA + 1];
+  double dTempoTotal = 0.0;
+  FILE *fp = NULL;
+  int j, e, iVencedor;
+
+  // Resumo ordenado pelo MSE da melhor epoca em <base>_varredura.txt (e na saida padrao)
+  qsort(ptJobs, iNumeroJobsVarredura, sizeof(TJob), CompararJobs);
+  sprintf(vcArquivoFinal, "%s_varredura.txt", szNomeBase);
+  if ((fp = fopen(vcArquivoFinal, "w")) == NULL)
+    fprintf(stderr, "ERRO: Nao foi possivel gravar o resumo da varredura\n");
+  printf("*******************************************************\n");
+  printf("# posicao       mse  epoca epocas    tempo  job  configuracao\n");
+  if (fp != NULL)
+    fprintf(fp, "# posicao mse epoca epocas tempo job configuracao\n");
+  for (j = 0; j < iNumeroJobsVarredura; j++) {
+    DescreverJob(&ptJobs[j], vcDescricao);
+    printf("%9d %9.6f %6d %6d %8.2f %4d  %s%s\n", j + 1, ptJobs[j].dMenorErro, ptJobs[j].iMelhorEpoca,
+        ptJobs[j].iEpocas, ptJobs[j].dTempo, ptJobs[j].iIndice + 1, vcDescricao,
+        (!ptJobs[j].iOk ? "  (falhou)" : (ptJobs[j].iEliminado ? "  (eliminado)" : "")));
+    if (fp != NULL)
+      fprintf(fp, "%d %f %d %d %.2f %d %s%s\n", j + 1, ptJobs[j].dMenorErro, ptJobs[j].iMelhorEpoca,
+          ptJobs[j].iEpocas, ptJobs[j].dTempo, ptJobs[j].iIndice + 1, vcDescricao,
+          (!ptJobs[j].iOk ? " (falhou)" : (ptJobs[j].iEliminado ? " (eliminado)" : "")));
+    dTempoTotal += ptJobs[j].dTempo;
+  }
+  printf("* Tempo somado dos jobs: %.2f segundos\n", dTempoTotal);
+  if (fp != NULL)
+    fclose(fp);
+
+  // Os arquivos do vencedor passam a ser <base>.wts/.wtsb/.out/.log e os demais sao removidos
+  iVencedor = (iNumeroJobsVarredura > 0 && ptJobs[0].iOk && ptJobs[0].dMenorErro < 1.0e32);
+  for (j = 0; j < iNumeroJobsVarredura; j++) {
+    for (e = 0; e < 4; e++) {
+      sprintf(vcArquivoJob, "%s_%d.%s", szNomeBase, ptJobs[j].iIndice + 1, vszExtensoes[e]);
+      sprintf(vcArquivoFinal, "%s.%s", szNomeBase, vszExtensoes[e]);
+      if (!ArquivoExiste(vcArquivoJob))
+        continue;
+      if (!j && iVencedor)
+        SubstituirArquivo(vcArquivoJob, vcArquivoFinal);
+      else
+        remove(vcArquivoJob);
+    }
+  }
+  if (iVencedor)
+    printf("* Vencedor: job %d (%s.wts)\n", ptJobs[0].iIndice + 1, szNomeBase);
+  printf("*******************************************************\n");
+  free(ptJobs);
+  ptJobs = NULL;
+  return iVencedor;
+}
@@ -0,0 +1,40 @@
+//************************************************************************************************
+//* UNIVERSIDADE FEDERAL DO RIO GRANDE DO SUL (UFRGS) - Campus do Vale                          **
+//* Doutorado em Ciencia da Computacao - PPGC                                                   **
+//* Doutorando: Milton Roberto Heinen - 00145752                                                **
+//* Orientador: Paulo Martins Engel                                                             **
+//* Varredura de hiperparametros (grade, busca aleatoria e reducao sucessiva em threads)        **
+//************************************************************************************************
+#ifndef VARREDURA_H
+#define VARREDURA_H
+
+
+//************************************** Constantes **********************************************
+#define MAX_JOBS 4096
+#define MAX_PARAMETROS 16
+#define MAX_VALORES 64
+#define MAX_VALOR 64
+#define PARAMETROS_VARREDURA "ofpiesbgrqany"
+#define FATOR_REDUCAO 3
+
+
+//************************************ Tipos de dados ********************************************
+// Contexto de treinamento de um job (definido pelo tlfn)
+typedef struct TTreino TTreino;
+
+
+//************************************** Prototipos **********************************************
+int LerVarredura(const char *szNomeArquivo, const unsigned long ulSemente);
+int RealizarVarredura(const char *szNomeBase, const int iNumJobs, const int iNumThreads);
+
+// Definidas pelo tlfn: CriarJob prepara o treinamento da configuracao szConfiguracao (no formato da linha de
+// comando, sobre os parametros da linha de comando) com os pesos e as saidas em <base>_<job> e o relatorio em
+// fpSaida (NULL se falhar); TreinarJob treina com iNumThreads threads ate o degrau iDegrau (0 = ate o fim) e
+// retorna 1 se pausou nele; EncerrarJob conclui o treinamento, pausado ou nao, e libera o contexto
+TTreino *CriarJob(const char *szNomeBase, const int iJob, const char *szConfiguracao, FILE *fpSaida);
+int TreinarJob(TTreino *ptTreino, const int iDegrau, const int iNumThreads, double *pdMenorErro, int *piMelhorEpoca,
+    int *piEpocas);
+void EncerrarJob(TTreino *ptTreino, double *pdMenorErro, int *piMelhorEpoca, int *piEpocas);
+double TempoReal();
+
+#endif
@@ -0,0 +1,1772 @@
+//************************************************************************************************
+//* UNIVERSIDADE FEDERAL DO RIO GRANDE DO SUL (UFRGS) - Campus do Vale                          **
+//* Doutorado em Ciencia da Computacao - PPGC                                                   **
+//* Doutorando: Milton Roberto Heinen - 00145752                                                **
+//* Orientador: Paulo Martins Engel                                                             **
+//* Kernels vetoriais (escalar, AVX2 e AVX-512) com selecao em tempo de execucao                **
+//************************************************************************************************
+
+//*************************************** Includes ***********************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "vetorial.h"
+#if defined(__GNUC__) && __GNUC__ >= 7 && (defined(__x86_64__) || defined(__i386__))
+#define VETORIAL_X86
+#include <immintrin.h>
+#endif
+
+
+//************************************** Constantes **********************************************
+#ifdef PRECISAO_SIMPLES
+#define TOLERANCIA_PRODUTO 1.0e-6
+#define TOLERANCIA_TANH 1.0e-7
+#define TOLERANCIA_TANH_RAPIDA 5.0e-7
+#else
+#define TOLERANCIA_PRODUTO 1.0e-14
+#define TOLERANCIA_TANH 1.0e-15
+#define TOLERANCIA_TANH_RAPIDA 3.0e-8
+#endif
+#define TAMANHO_VERIFICACAO 300
+#define LINHAS_VERIFICACAO 6
+#define PROFUNDIDADE_VERIFICACAO 9
+#define TAMANHO_MEDICAO 1024
+#define LIMITE_INT8 127
+#define REPETICOES_MEDICAO 2000
+
+
+//**************************************** Macros ************************************************
+#define QUADRADO(x) ((x) * (x))
+
+
+//*********************************** Kernels escalares ******************************************
+static TReal ProdutoEscalarGenerico(TReal dInicial, const TReal *pdA, const TReal *pdB, int iN)
+{
+  register int i;
+
+  for (i = 0; i < iN; i++)
+    dInicial += pdA[i] * pdB[i];
+  return dInicial;
+}
+
+
+static void SomarEscaladoGenerico(TReal *pdY, TReal dA, const TReal *pdX, int iN)
+{
+  register int i;
+
+  for (i = 0; i < iN; i++)
+    pdY[i] += dA * pdX[i];
+}
+
+
+static void ProdutoMatrizesGenerico(TReal *pdC, int iLdC, const TReal *pdA, int iLdA, const TReal *pdB, int iLdB,
+    int iM, int iN, int iK)
+{
+  register int j;
+  int i, k;
+  TReal dA;
+
+  // Uma linha de C por vez, somando as linhas de B na ordem crescente de k
+  for (i = 0; i < iM; i++) {
+    for (k = 0; k < iK; k++) {
+      dA = pdA[i * iLdA + k];
+      for (j = 0; j < iN; j++)
+        pdC[i * iLdC + j] += dA * pdB[k * iLdB + j];
+    }
+  }
+}
+
+
+static void TangenteHiperbolicaGenerica(TReal *pdX, int iN)
+{
+  register int i;
+
+  for (i = 0; i < iN; i++)
+    pdX[i] = tanh(pdX[i]);
+}
+
+
+// tanh(x) ~ p(x) / q(x^2) (aproximacao racional de grau 13/6) com |x| limitado a TANH_RAPIDA_LIMITE;
+// erro absoluto maximo de 2.6e-8 em relacao a tanh() da libm (ver TangenteHiperbolicaRapida em vetorial.h)
+static void TangenteHiperbolicaRapidaGenerica(TReal *pdX, int iN)
+{
+  register int i;
+  TReal dX, dX2, dP, dQ;
+
+  for (i = 0; i < iN; i++) {
+    dX = pdX[i];
+    if (dX > (TReal) TANH_RAPIDA_LIMITE)
+      dX = (TReal) TANH_RAPIDA_LIMITE;
+    else if (dX < (TReal) -TANH_RAPIDA_LIMITE)
+      dX = (TReal) -TANH_RAPIDA_LIMITE;
+    dX2 = dX * dX;
+    dP = (TReal) TANH_RAPIDA_P13;
+    dP = dP * dX2 + (TReal) TANH_RAPIDA_P11;
+    dP = dP * dX2 + (TReal) TANH_RAPIDA_P9;
+    dP = dP * dX2 + (TReal) TANH_RAPIDA_P7;
+    dP = dP * dX2 + (TReal) TANH_RAPIDA_P5;
+    dP = dP * dX2 + (TReal) TANH_RAPIDA_P3;
+    dP = dP * dX2 + (TReal) TANH_RAPIDA_P1;
+    dQ = (TReal) TANH_RAPIDA_Q6;
+    dQ = dQ * dX2 + (TReal) TANH_RAPIDA_Q4;
+    dQ = dQ * dX2 + (TReal) TANH_RAPIDA_Q2;
+    dQ = dQ * dX2 + (TReal) TANH_RAPIDA_Q0;
+    pdX[i] = dP * dX / dQ;
+  }
+}
+
+
+static double SomaQuadradosDiferencaGenerica(const TReal *pdA, const TReal *pdB, int iN)
+{
+  register int i;
+  double dSoma = 0.0;
+
+  for (i = 0; i < iN; i++)
+    dSoma += QUADRADO(pdA[i] - pdB[i]);
+  return dSoma;
+}
+
+
+static void AjustarMomentoGenerico(TReal *pdY, TReal *pdV, TReal dMomento, TReal dFatorV, TReal dFatorG, TReal dA,
+    const TReal *pdX, int iN)
+{
+  register int i;
+  TReal dG;
+
+  // Uma unica passagem sobre os pesos e as velocidades
+  for (i = 0; i < iN; i++) {
+    dG = dA * pdX[i];
+    pdV[i] = dMomento * pdV[i] + dG;
+    pdY[i] += dFatorV * pdV[i] + dFatorG * dG;
+  }
+}
+
+
+static void AjustarAdamGenerico(TReal *pdY, TReal *pdM, TReal *pdV, TReal dBeta1, TReal dBeta2, TReal dTaxa,
+    TReal dEpsilon, TReal dA, const TReal *pdX, int iN)
+{
+  register int i;
+  TReal dG;
+
+  // Uma unica passagem sobre os pesos e os dois momentos
+  for (i = 0; i < iN; i++) {
+    dG = dA * pdX[i];
+    pdM[i] = dBeta1 * pdM[i] + ((TReal) 1.0 - dBeta1) * dG;
+    pdV[i] = dBeta2 * pdV[i] + ((TReal) 1.0 - dBeta2) * dG * dG;
+    pdY[i] += dTaxa * (pdM[i] / ((TReal) sqrt(pdV[i]) + dEpsilon));
+  }
+}
+
+
+static int ProdutoEscalarInt8Generico(const signed char *pcA, const signed char *pcB, int iN)
+{
+  register int i;
+  int iSoma = 0;
+
+  for (i = 0; i < iN; i++)
+    iSoma += pcA[i] * pcB[i];
+  return iSoma;
+}
+
+
+static void ProdutoMatrizInt8Generico(int *piY, const signed char *pcW, const signed char *pcX, int iNumLinhas,
+    int iStride)
+{
+  register int i;
+
+  for (i = 0; i < iNumLinhas; i++)
+    piY[i] = ProdutoEscalarInt8Generico(&pcW[i * iStride], pcX, iStride);
+}
+
+
+static void QuantizarInt8Generico(signed char *pcY, const TReal *pdX, const float *pfCentro, const float *pfInverso,
+    int iN)
+{
+  register int i;
+  float fValor;
+
+  // Apos a saturacao o valor deslocado e positivo e o truncamento equivale ao arredondamento
+  for (i = 0; i < iN; i++) {
+    fValor = ((float) pdX[i] - pfCentro[i]) * pfInverso[i];
+    fValor = (fValor < (float) -LIMITE_INT8 ? (float) -LIMITE_INT8 : fValor);
+    fValor = (fValor > (float) LIMITE_INT8 ? (float) LIMITE_INT8 : fValor);
+    pcY[i] = (signed char) ((int) (fValor + (float) (LIMITE_INT8 + 1.5)) - (LIMITE_INT8 + 1));
+  }
+}
+
+
+//************************************* Kernels AVX2 *********************************************
+#ifdef VETORIAL_X86
+__attribute__((target("avx2,fma")))
+static inline double SomaHorizontalAvx2(__m256d vSoma)
+{
+  __m128d vMetade = _mm_add_pd(_mm256_castpd256_pd128(vSoma), _mm256_extractf128_pd(vSoma, 1));
+
+  return _mm_cvtsd_f64(_mm_add_sd(vMetade, _mm_unpackhi_pd(vMetade, vMetade)));
+}
+
+
+// tanh(x) = sinal(x) * expm1(2|x|) / (expm1(2|x|) + 2), com expm1 = 2^k * expm1(r) + (2^k - 1)
+// e expm1(r) aproximado por Taylor de grau 13 em |r| <= ln2 / 2 (erro absoluto < 1e-15)
+__attribute__((target("avx2,fma")))
+static inline __m256d TangenteHiperbolicaVetorAvx2(__m256d vX)
+{
+  const __m256d vSinal = _mm256_set1_pd(-0.0);
+  __m256d vY, vK, vR, vQ, vExpm1, vPot;
+  __m256i viExpoente;
+
+  // Reducao do argumento: 2|x| = k * ln2 + r
+  vY = _mm256_min_pd(_mm256_add_pd(_mm256_andnot_pd(vSinal, vX), _mm256_andnot_pd(vSinal, vX)),
+      _mm256_set1_pd(TANH_LIMITE));
+  vK = _mm256_round_pd(_mm256_mul_pd(vY, _mm256_set1_pd(INV_LN2)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+  vR = _mm256_fnmadd_pd(vK, _mm256_set1_pd(LN2_HI), vY);
+  vR = _mm256_fnmadd_pd(vK, _mm256_set1_pd(LN2_LO), vR);
+
+  // expm1(r) por Horner
+  vQ = _mm256_set1_pd(1.0 / 6227020800.0);
+  vQ = _mm256_fmadd_pd(vQ, vR, _mm256_set1_pd(1.0 / 479001600.0));
+  vQ = _mm256_fmadd_pd(vQ, vR, _mm256_set1_pd(1.0 / 39916800.0));
+  vQ = _mm256_fmadd_pd(vQ, vR, _mm256_set1_pd(1.0 / 3628800.0));
+  vQ = _mm256_fmadd_pd(vQ, vR, _mm256_set1_pd(1.0 / 362880.0));
+  vQ = _mm256_fmadd_pd(vQ, vR, _mm256_set1_pd(1.0 / 40320.0));
+  vQ = _mm256_fmadd_pd(vQ, vR, _mm256_set1_pd(1.0 / 5040.0));
+  vQ = _mm256_fmadd_pd(vQ, vR, _mm256_set1_pd(1.0 / 720.0));
+  vQ = _mm256_fmadd_pd(vQ, vR, _mm256_set1_pd(1.0 / 120.0));
+  vQ = _mm256_fmadd_pd(vQ, vR, _mm256_set1_pd(1.0 / 24.0));
+  vQ = _mm256_fmadd_pd(vQ, vR, _mm256_set1_pd(1.0 / 6.0));
+  vQ = _mm256_fmadd_pd(vQ, vR, _mm256_set1_pd(0.5));
+  vExpm1 = _mm256_fmadd_pd(_mm256_mul_pd(vR, vR), vQ, vR);
+
+  // Reconstrucao: 2^k montado diretamente no expoente
+  viExpoente = _mm256_cvtepi32_epi64(_mm256_cvtpd_epi32(vK));
+  vPot = _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_add_epi64(viExpoente, _mm256_set1_epi64x(1023)), 52));
+  vExpm1 = _mm256_fmadd_pd(vPot, vExpm1, _mm256_sub_pd(vPot, _mm256_set1_pd(1.0)));
+
+  // Quociente e restauracao do sinal
+  vY = _mm256_div_pd(vExpm1, _mm256_add_pd(vExpm1, _mm256_set1_pd(2.0)));
+  return _mm256_or_pd(vY, _mm256_and_pd(vSinal, vX));
+}
+
+
+// Produto int8 (independe da precisao): 16 bytes estendidos para 16 bits e multiplicados aos pares em 32 bits
+__attribute__((target("avx2")))
+static int ProdutoEscalarInt8Avx2(const signed char *pcA, const signed char *pcB, int iN)
+{
+  register int i;
+  __m256i viSoma = _mm256_setzero_si256();
+  __m128i viMetade;
+  int iSoma;
+
+  for (i = 0; i + 16 <= iN; i += 16)
+    viSoma = _mm256_add_epi32(viSoma, _mm256_madd_epi16(_mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*) &pcA[i])),
+        _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*) &pcB[i]))));
+  viMetade = _mm_add_epi32(_mm256_castsi256_si128(viSoma), _mm256_extracti128_si256(viSoma, 1));
+  viMetade = _mm_add_epi32(viMetade, _mm_shuffle_epi32(viMetade, 0x4e));
+  viMetade = _mm_add_epi32(viMetade, _mm_shuffle_epi32(viMetade, 0xb1));
+  iSoma = _mm_cvtsi128_si32(viMetade);
+  for (; i < iN; i++)
+    iSoma += pcA[i] * pcB[i];
+  return iSoma;
+}
+
+
+// Quatro linhas por vez (linhas de multiplos de 16 bytes), com as quatro somas reduzidas juntas por hadd
+__attribute__((target("avx2")))
+static void ProdutoMatrizInt8Avx2(int *piY, const signed char *pcW, const signed char *pcX, int iNumLinhas, int iStride)
+{
+  register int i, k;
+  __m256i viX, viSoma0, viSoma1, viSoma2, viSoma3;
+  const signed char *pcLinha;
+
+  for (i = 0; !(iStride % 16) && i + 4 <= iNumLinhas; i += 4) {
+    viSoma0 = viSoma1 = viSoma2 = viSoma3 = _mm256_setzero_si256();
+    for (k = 0, pcLinha = &pcW[i * iStride]; k < iStride; k += 16) {
+      viX = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*) &pcX[k]));
+      viSoma0 = _mm256_add_epi32(viSoma0, _mm256_madd_epi16(viX,
+          _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*) &pcLinha[k]))));
+      viSoma1 = _mm256_add_epi32(viSoma1, _mm256_madd_epi16(viX,
+          _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*) &pcLinha[iStride + k]))));
+      viSoma2 = _mm256_add_epi32(viSoma2, _mm256_madd_epi16(viX,
+          _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*) &pcLinha[2 * iStride + k]))));
+      viSoma3 = _mm256_add_epi32(viSoma3, _mm256_madd_epi16(viX,
+          _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*) &pcLinha[3 * iStride + k]))));
+    }
+    viSoma0 = _mm256_hadd_epi32(_mm256_hadd_epi32(viSoma0, viSoma1), _mm256_hadd_epi32(viSoma2, viSoma3));
+    _mm_storeu_si128((__m128i*) &piY[i], _mm_add_epi32(_mm256_castsi256_si128(viSoma0),
+        _mm256_extracti128_si256(viSoma0, 1)));
+  }
+  for (; i < iNumLinhas; i++)
+    piY[i] = ProdutoEscalarInt8Avx2(&pcW[i * iStride], pcX, iStride);
+}
+
+
+// Quantizacao com o mesmo arredondamento do caminho escalar, 8 elementos por passo (tambem usada no nivel AVX-512)
+__attribute__((target("avx2")))
+static void QuantizarInt8Avx2(signed char *pcY, const TReal *pdX, const float *pfCentro, const float *pfInverso,
+    int iN)
+{
+  register int i;
+  __m256 vX;
+  __m256i viY;
+  __m128i viPar;
+
+  for (i = 0; i + 8 <= iN; i += 8) {
+#ifdef PRECISAO_SIMPLES
+    vX = _mm256_loadu_ps(&pdX[i]);
+#else
+    vX = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm256_cvtpd_ps(_mm256_loadu_pd(&pdX[i]))),
+        _mm256_cvtpd_ps(_mm256_loadu_pd(&pdX[i + 4])), 1);
+#endif
+    vX = _mm256_mul_ps(_mm256_sub_ps(vX, _mm256_loadu_ps(&pfCentro[i])), _mm256_loadu_ps(&pfInverso[i]));
+    vX = _mm256_min_ps(_mm256_max_ps(vX, _mm256_set1_ps((float) -LIMITE_INT8)), _mm256_set1_ps((float) LIMITE_INT8));
+    viY = _mm256_sub_epi32(_mm256_cvttps_epi32(_mm256_add_ps(vX, _mm256_set1_ps((float) (LIMITE_INT8 + 1.5)))),
+        _mm256_set1_epi32(LIMITE_INT8 + 1));
+    viPar = _mm_packs_epi32(_mm256_castsi256_si128(viY), _mm256_extracti128_si256(viY, 1));
+    _mm_storel_epi64((__m128i*) &pcY[i], _mm_packs_epi16(viPar, viPar));
+  }
+  QuantizarInt8Generico(&pcY[i], &pdX[i], &pfCentro[i], &pfInverso[i], iN - i);
+}
+
+
+#ifndef PRECISAO_SIMPLES
+__attribute__((target("avx2,fma")))
+static double ProdutoEscalarAvx2(double dInicial, const double *pdA, const double *pdB, int iN)
+{
+  register int i;
+  __m256d vSoma0 = _mm256_setzero_pd(), vSoma1 = _mm256_setzero_pd();
+  double dSoma;
+
+  for (i = 0; i + 8 <= iN; i += 8) {
+    vSoma0 = _mm256_fmadd_pd(_mm256_loadu_pd(&pdA[i]), _mm256_loadu_pd(&pdB[i]), vSoma0);
+    vSoma1 = _mm256_fmadd_pd(_mm256_loadu_pd(&pdA[i + 4]), _mm256_loadu_pd(&pdB[i + 4]), vSoma1);
+  }
+  if (i + 4 <= iN) {
+    vSoma0 = _mm256_fmadd_pd(_mm256_loadu_pd(&pdA[i]), _mm256_loadu_pd(&pdB[i]), vSoma0);
+    i += 4;
+  }
+  dSoma = SomaHorizontalAvx2(_mm256_add_pd(vSoma0, vSoma1));
+  for (; i < iN; i++)
+    dSoma += pdA[i] * pdB[i];
+  return dInicial + dSoma;
+}
+
+
+__attribute__((target("avx2,fma")))
+static void SomarEscaladoAvx2(double *pdY, double dA, const double *pdX, int iN)
+{
+  register int i;
+  __m256d vA = _mm256_set1_pd(dA);
+
+  for (i = 0; i + 4 <= iN; i += 4)
+    _mm256_storeu_pd(&pdY[i], _mm256_fmadd_pd(vA, _mm256_loadu_pd(&pdX[i]), _mm256_loadu_pd(&pdY[i])));
+  for (; i < iN; i++)
+    pdY[i] += dA * pdX[i];
+}
+
+
+__attribute__((target("avx2,fma")))
+static void ProdutoMatrizesAvx2(double *pdC, int iLdC, const double *pdA, int iLdA, const double *pdB, int iLdB,
+    int iM, int iN, int iK)
+{
+  register int k;
+  int i, j;
+  const double *pdLinhaA, *pdLinhaB;
+  double *pdLinhaC;
+  __m256d vA, vB0, vB1, vC00, vC01, vC10, vC11, vC20, vC21, vC30, vC31;
+
+  // Blocos de 4 linhas x 8 colunas de C em 8 acumuladores: cada par de vetores de B e reusado pelas 4 linhas
+  // e cada elemento de A e difundido para as colunas do vetor
+  for (i = 0; i + 4 <= iM; i += 4) {
+    pdLinhaA = &pdA[i * iLdA];
+    pdLinhaC = &pdC[i * iLdC];
+    for (j = 0; j + 8 <= iN; j += 8) {
+      vC00 = _mm256_loadu_pd(&pdLinhaC[j]);
+      vC01 = _mm256_loadu_pd(&pdLinhaC[j + 4]);
+      vC10 = _mm256_loadu_pd(&pdLinhaC[iLdC + j]);
+      vC11 = _mm256_loadu_pd(&pdLinhaC[iLdC + j + 4]);
+      vC20 = _mm256_loadu_pd(&pdLinhaC[2 * iLdC + j]);
+      vC21 = _mm256_loadu_pd(&pdLinhaC[2 * iLdC + j + 4]);
+      vC30 = _mm256_loadu_pd(&pdLinhaC[3 * iLdC + j]);
+      vC31 = _mm256_loadu_pd(&pdLinhaC[3 * iLdC + j + 4]);
+      for (k = 0, pdLinhaB = &pdB[j]; k < iK; k++, pdLinhaB += iLdB) {
+        vB0 = _mm256_loadu_pd(pdLinhaB);
+        vB1 = _mm256_loadu_pd(pdLinhaB + 4);
+        vA = _mm256_set1_pd(pdLinhaA[k]);
+        vC00 = _mm256_fmadd_pd(vA, vB0, vC00);
+        vC01 = _mm256_fmadd_pd(vA, vB1, vC01);
+        vA = _mm256_set1_pd(pdLinhaA[iLdA + k]);
+        vC10 = _mm256_fmadd_pd(vA, vB0, vC10);
+        vC11 = _mm256_fmadd_pd(vA, vB1, vC11);
+        vA = _mm256_set1_pd(pdLinhaA[2 * iLdA + k]);
+        vC20 = _mm256_fmadd_pd(vA, vB0, vC20);
+        vC21 = _mm256_fmadd_pd(vA, vB1, vC21);
+        vA = _mm256_set1_pd(pdLinhaA[3 * iLdA + k]);
+        vC30 = _mm256_fmadd_pd(vA, vB0, vC30);
+        vC31 = _mm256_fmadd_pd(vA, vB1, vC31);
+      }
+      _mm256_storeu_pd(&pdLinhaC[j], vC00);
+      _mm256_storeu_pd(&pdLinhaC[j + 4], vC01);
+      _mm256_storeu_pd(&pdLinhaC[iLdC + j], vC10);
+      _mm256_storeu_pd(&pdLinhaC[iLdC + j + 4], vC11);
+      _mm256_storeu_pd(&pdLinhaC[2 * iLdC + j], vC20);
+      _mm256_storeu_pd(&pdLinhaC[2 * iLdC + j + 4], vC21);
+      _mm256_storeu_pd(&pdLinhaC[3 * iLdC + j], vC30);
+      _mm256_storeu_pd(&pdLinhaC[3 * iLdC + j + 4], vC31);
+    }
+    // Colunas restantes em blocos de 4 linhas x 4 colunas
+    for (; j + 4 <= iN; j += 4) {
+      vC00 = _mm256_loadu_pd(&pdLinhaC[j]);
+      vC10 = _mm256_loadu_pd(&pdLinhaC[iLdC + j]);
+      vC20 = _mm256_loadu_pd(&pdLinhaC[2 * iLdC + j]);
+      vC30 = _mm256_loadu_pd(&pdLinhaC[3 * iLdC + j]);
+      for (k = 0, pdLinhaB = &pdB[j]; k < iK; k++, pdLinhaB += iLdB) {
+        vB0 = _mm256_loadu_pd(pdLinhaB);
+        vC00 = _mm256_fmadd_pd(_mm256_set1_pd(pdLinhaA[k]), vB0, vC00);
+        vC10 = _mm256_fmadd_pd(_mm256_set1_pd(pdLinhaA[iLdA + k]), vB0, vC10);
+        vC20 = _mm256_fmadd_pd(_mm256_set1_pd(pdLinhaA[2 * iLdA + k]), vB0, vC20);
+        vC30 = _mm256_fmadd_pd(_mm256_set1_pd(pdLinhaA[3 * iLdA + k]), vB0, vC30);
+      }
+      _mm256_storeu_pd(&pdLinhaC[j], vC00);
+      _mm256_storeu_pd(&pdLinhaC[iLdC + j], vC10);
+      _mm256_storeu_pd(&pdLinhaC[2 * iLdC + j], vC20);
+      _mm256_storeu_pd(&pdLinhaC[3 * iLdC + j], vC30);
+    }
+    // Colunas finais pelo caminho escalar
+    if (j < iN)
+      ProdutoMatrizesGenerico(&pdLinhaC[j], iLdC, pdLinhaA, iLdA, &pdB[j], iLdB, 4, iN - j, iK);
+  }
+
+  // Linhas restantes, uma a uma
+  for (; i < iM; i++) {
+    pdLinhaA = &pdA[i * iLdA];
+    pdLinhaC = &pdC[i * iLdC];
+    for (j = 0; j + 4 <= iN; j += 4) {
+      vC00 = _mm256_loadu_pd(&pdLinhaC[j]);
+      for (k = 0, pdLinhaB = &pdB[j]; k < iK; k++, pdLinhaB += iLdB)
+        vC00 = _mm256_fmadd_pd(_mm256_set1_pd(pdLinhaA[k]), _mm256_loadu_pd(pdLinhaB), vC00);
+      _mm256_storeu_pd(&pdLinhaC[j], vC00);
+    }
+    if (j < iN)
+      ProdutoMatrizesGenerico(&pdLinhaC[j], iLdC, pdLinhaA, iLdA, &pdB[j], iLdB, 1, iN - j, iK);
+  }
+}
+
+
+__attribute__((target("avx2,fma")))
+static void TangenteHiperbolicaAvx2(double *pdX, int iN)
+{
+  register int i;
+  double vdResto[4] = { 0.0, 0.0, 0.0, 0.0 };
+
+  for (i = 0; i + 4 <= iN; i += 4)
+    _mm256_storeu_pd(&pdX[i], TangenteHiperbolicaVetorAvx2(_mm256_loadu_pd(&pdX[i])));
+  if (i < iN) {
+    memcpy(vdResto, &pdX[i], sizeof(double) * (iN - i));
+    _mm256_storeu_pd(vdResto, TangenteHiperbolicaVetorAvx2(_mm256_loadu_pd(vdResto)));
+    memcpy(&pdX[i], vdResto, sizeof(double) * (iN - i));
+  }
+}
+
+
+// Mesma aproximacao racional de TangenteHiperbolicaRapidaGenerica
+__attribute__((target("avx2,fma")))
+static inline __m256d TangenteHiperbolicaRapidaVetorAvx2(__m256d vX)
+{
+  __m256d vX2, vP, vQ;
+
+  vX = _mm256_max_pd(_mm256_min_pd(vX, _mm256_set1_pd(TANH_RAPIDA_LIMITE)), _mm256_set1_pd(-TANH_RAPIDA_LIMITE));
+  vX2 = _mm256_mul_pd(vX, vX);
+  vP = _mm256_fmadd_pd(_mm256_set1_pd(TANH_RAPIDA_P13), vX2, _mm256_set1_pd(TANH_RAPIDA_P11));
+  vP = _mm256_fmadd_pd(vP, vX2, _mm256_set1_pd(TANH_RAPIDA_P9));
+  vP = _mm256_fmadd_pd(vP, vX2, _mm256_set1_pd(TANH_RAPIDA_P7));
+  vP = _mm256_fmadd_pd(vP, vX2, _mm256_set1_pd(TANH_RAPIDA_P5));
+  vP = _mm256_fmadd_pd(vP, vX2, _mm256_set1_pd(TANH_RAPIDA_P3));
+  vP = _mm256_fmadd_pd(vP, vX2, _mm256_set1_pd(TANH_RAPIDA_P1));
+  vQ = _mm256_fmadd_pd(_mm256_set1_pd(TANH_RAPIDA_Q6), vX2, _mm256_set1_pd(TANH_RAPIDA_Q4));
+  vQ = _mm256_fmadd_pd(vQ, vX2, _mm256_set1_pd(TANH_RAPIDA_Q2));
+  vQ = _mm256_fmadd_pd(vQ, vX2, _mm256_set1_pd(TANH_RAPIDA_Q0));
+  return _mm256_div_pd(_mm256_mul_pd(vP, vX), vQ);
+}
+
+
+__attribute__((target("avx2,fma")))
+static void TangenteHiperbolicaRapidaAvx2(double *pdX, int iN)
+{
+  register int i;
+  double vdResto[4] = { 0.0, 0.0, 0.0, 0.0 };
+
+  for (i = 0; i + 4 <= iN; i += 4)
+    _mm256_storeu_pd(&pdX[i], TangenteHiperbolicaRapidaVetorAvx2(_mm256_loadu_pd(&pdX[i])));
+  if (i < iN) {
+    memcpy(vdResto, &pdX[i], sizeof(double) * (iN - i));
+    _mm256_storeu_pd(vdResto, TangenteHiperbolicaRapidaVetorAvx2(_mm256_loadu_pd(vdResto)));
+    memcpy(&pdX[i], vdResto, sizeof(double) * (iN - i));
+  }
+}
+
+
+__attribute__((target("avx2,fma")))
+static double SomaQuadradosDiferencaAvx2(const double *pdA, const double *pdB, int iN)
+{
+  register int i;
+  __m256d vSoma = _mm256_setzero_pd(), vDif;
+  double dSoma;
+
+  for (i = 0; i + 4 <= iN; i += 4) {
+    vDif = _mm256_sub_pd(_mm256_loadu_pd(&pdA[i]), _mm256_loadu_pd(&pdB[i]));
+    vSoma = _mm256_fmadd_pd(vDif, vDif, vSoma);
+  }
+  dSoma = SomaHorizontalAvx2(vSoma);
+  for (; i < iN; i++)
+    dSoma += QUADRADO(pdA[i] - pdB[i]);
+  return dSoma;
+}
+
+
+// O resto do vetor usa o kernel escalar
+__attribute__((target("avx2,fma")))
+static void AjustarMomentoAvx2(double *pdY, double *pdV, double dMomento, double dFatorV, double dFatorG, double dA,
+    const double *pdX, int iN)
+{
+  register int i;
+  __m256d vMomento = _mm256_set1_pd(dMomento), vFatorV = _mm256_set1_pd(dFatorV);
+  __m256d vFatorG = _mm256_set1_pd(dFatorG), vA = _mm256_set1_pd(dA), vG, vV;
+
+  for (i = 0; i + 4 <= iN; i += 4) {
+    vG = _mm256_mul_pd(vA, _mm256_loadu_pd(&pdX[i]));
+    vV = _mm256_fmadd_pd(vMomento, _mm256_loadu_pd(&pdV[i]), vG);
+    _mm256_storeu_pd(&pdV[i], vV);
+    _mm256_storeu_pd(&pdY[i], _mm256_fmadd_pd(vFatorV, vV, _mm256_fmadd_pd(vFatorG, vG,
+        _mm256_loadu_pd(&pdY[i]))));
+  }
+  AjustarMomentoGenerico(&pdY[i], &pdV[i], dMomento, dFatorV, dFatorG, dA, &pdX[i], iN - i);
+}
+
+
+__attribute__((target("avx2,fma")))
+static void AjustarAdamAvx2(double *pdY, double *pdM, double *pdV, double dBeta1, double dBeta2, double dTaxa,
+    double dEpsilon, double dA, const double *pdX, int iN)
+{
+  register int i;
+  __m256d vBeta1 = _mm256_set1_pd(dBeta1), vBeta2 = _mm256_set1_pd(dBeta2), vTaxa = _mm256_set1_pd(dTaxa);
+  __m256d vComplemento1 = _mm256_set1_pd(1.0 - dBeta1), vComplemento2 = _mm256_set1_pd(1.0 - dBeta2);
+  __m256d vEpsilon = _mm256_set1_pd(dEpsilon), vA = _mm256_set1_pd(dA), vG, vM, vV;
+
+  for (i = 0; i + 4 <= iN; i += 4) {
+    vG = _mm256_mul_pd(vA, _mm256_loadu_pd(&pdX[i]));
+    vM = _mm256_fmadd_pd(vBeta1, _mm256_loadu_pd(&pdM[i]), _mm256_mul_pd(vComplemento1, vG));
+    vV = _mm256_fmadd_pd(vBeta2, _mm256_loadu_pd(&pdV[i]), _mm256_mul_pd(_mm256_mul_pd(vComplemento2, vG), vG));
+    _mm256_storeu_pd(&pdM[i], vM);
+    _mm256_storeu_pd(&pdV[i], vV);
+    _mm256_storeu_pd(&pdY[i], _mm256_fmadd_pd(vTaxa, _mm256_div_pd(vM,
+        _mm256_add_pd(_mm256_sqrt_pd(vV), vEpsilon)), _mm256_loadu_pd(&pdY[i])));
+  }
+  AjustarAdamGenerico(&pdY[i], &pdM[i], &pdV[i], dBeta1, dBeta2, dTaxa, dEpsilon, dA, &pdX[i], iN - i);
+}
+#else
+__attribute__((target("avx2,fma")))
+static inline float SomaHorizontalAvx2Simples(__m256 vSoma)
+{
+  __m128 vMetade = _mm_add_ps(_mm256_castps256_ps128(vSoma), _mm256_extractf128_ps(vSoma, 1));
+
+  vMetade = _mm_add_ps(vMetade, _mm_movehl_ps(vMetade, vMetade));
+  return _mm_cvtss_f32(_mm_add_ss(vMetade, _mm_movehdup_ps(vMetade)));
+}
+
+
+__attribute__((target("avx2,fma")))
+static float ProdutoEscalarAvx2(float dInicial, const float *pdA, const float *pdB, int iN)
+{
+  register int i;
+  __m256 vSoma0 = _mm256_setzero_ps(), vSoma1 = _mm256_setzero_ps();
+  float dSoma;
+
+  for (i = 0; i + 16 <= iN; i += 16) {
+    vSoma0 = _mm256_fmadd_ps(_mm256_loadu_ps(&pdA[i]), _mm256_loadu_ps(&pdB[i]), vSoma0);
+    vSoma1 = _mm256_fmadd_ps(_mm256_loadu_ps(&pdA[i + 8]), _mm256_loadu_ps(&pdB[i + 8]), vSoma1);
+  }
+  if (i + 8 <= iN) {
+    vSoma0 = _mm256_fmadd_ps(_mm256_loadu_ps(&pdA[i]), _mm256_loadu_ps(&pdB[i]), vSoma0);
+    i += 8;
+  }
+  dSoma = SomaHorizontalAvx2Simples(_mm256_add_ps(vSoma0, vSoma1));
+  for (; i < iN; i++)
+    dSoma += pdA[i] * pdB[i];
+  return dInicial + dSoma;
+}
+
+
+__attribute__((target("avx2,fma")))
+static void SomarEscaladoAvx2(float *pdY, float dA, const float *pdX, int iN)
+{
+  register int i;
+  __m256 vA = _mm256_set1_ps(dA);
+
+  for (i = 0; i + 8 <= iN; i += 8)
+    _mm256_storeu_ps(&pdY[i], _mm256_fmadd_ps(vA, _mm256_loadu_ps(&pdX[i]), _mm256_loadu_ps(&pdY[i])));
+  for (; i < iN; i++)
+    pdY[i] += dA * pdX[i];
+}
+
+
+__attribute__((target("avx2,fma")))
+static void ProdutoMatrizesAvx2(float *pdC, int iLdC, const float *pdA, int iLdA, const float *pdB, int iLdB,
+    int iM, int iN, int iK)
+{
+  register int k;
+  int i, j;
+  const float *pdLinhaA, *pdLinhaB;
+  float *pdLinhaC;
+  __m256 vA, vB0, vB1, vC00, vC01, vC10, vC11, vC20, vC21, vC30, vC31;
+
+  // Blocos de 4 linhas x 16 colunas de C em 8 acumuladores: cada par de vetores de B e reusado pelas 4 linhas
+  // e cada elemento de A e difundido para as colunas do vetor
+  for (i = 0; i + 4 <= iM; i += 4) {
+    pdLinhaA = &pdA[i * iLdA];
+    pdLinhaC = &pdC[i * iLdC];
+    for (j = 0; j + 16 <= iN; j += 16) {
+      vC00 = _mm256_loadu_ps(&pdLinhaC[j]);
+      vC01 = _mm256_loadu_ps(&pdLinhaC[j + 8]);
+      vC10 = _mm256_loadu_ps(&pdLinhaC[iLdC + j]);
+      vC11 = _mm256_loadu_ps(&pdLinhaC[iLdC + j + 8]);
+      vC20 = _mm256_loadu_ps(&pdLinhaC[2 * iLdC + j]);
+      vC21 = _mm256_loadu_ps(&pdLinhaC[2 * iLdC + j + 8]);
+      vC30 = _mm256_loadu_ps(&pdLinhaC[3 * iLdC + j]);
+      vC31 = _mm256_loadu_ps(&pdLinhaC[3 * iLdC + j + 8]);
+      for (k = 0, pdLinhaB = &pdB[j]; k < iK; k++, pdLinhaB += iLdB) {
+        vB0 = _mm256_loadu_ps(pdLinhaB);
+        vB1 = _mm256_loadu_ps(pdLinhaB + 8);
+        vA = _mm256_set1_ps(pdLinhaA[k]);
+        vC00 = _mm256_fmadd_ps(vA, vB0, vC00);
+        vC01 = _mm256_fmadd_ps(vA, vB1, vC01);
+        vA = _mm256_set1_ps(pdLinhaA[iLdA + k]);
+        vC10 = _mm256_fmadd_ps(vA, vB0, vC10);
+        vC11 = _mm256_fmadd_ps(vA, vB1, vC11);
+        vA = _mm256_set1_ps(pdLinhaA[2 * iLdA + k]);
+        vC20 = _mm256_fmadd_ps(vA, vB0, vC20);
+        vC21 = _mm256_fmadd_ps(vA, vB1, vC21);
+        vA = _mm256_set1_ps(pdLinhaA[3 * iLdA + k]);
+        vC30 = _mm256_fmadd_ps(vA, vB0, vC30);
+        vC31 = _mm256_fmadd_ps(vA, vB1, vC31);
+      }
+      _mm256_storeu_ps(&pdLinhaC[j], vC00);
+      _mm256_storeu_ps(&pdLinhaC[j + 8], vC01);
+      _mm256_storeu_ps(&pdLinhaC[iLdC + j], vC10);
+      _mm256_storeu_ps(&pdLinhaC[iLdC + j + 8], vC11);
+      _mm256_storeu_ps(&pdLinhaC[2 * iLdC + j], vC20);
+      _mm256_storeu_ps(&pdLinhaC[2 * iLdC + j + 8], vC21);
+      _mm256_storeu_ps(&pdLinhaC[3 * iLdC + j], vC30);
+      _mm256_storeu_ps(&pdLinhaC[3 * iLdC + j + 8], vC31);
+    }
+    // Colunas restantes em blocos de 4 linhas x 8 colunas
+    for (; j + 8 <= iN; j += 8) {
+      vC00 = _mm256_loadu_ps(&pdLinhaC[j]);
+      vC10 = _mm256_loadu_ps(&pdLinhaC[iLdC + j]);
+      vC20 = _mm256_loadu_ps(&pdLinhaC[2 * iLdC + j]);
+      vC30 = _mm256_loadu_ps(&pdLinhaC[3 * iLdC + j]);
+      for (k = 0, pdLinhaB = &pdB[j]; k < iK; k++, pdLinhaB += iLdB) {
+        vB0 = _mm256_loadu_ps(pdLinhaB);
+        vC00 = _mm256_fmadd_ps(_mm256_set1_ps(pdLinhaA[k]), vB0, vC00);
+        vC10 = _mm256_fmadd_ps(_mm256_set1_ps(pdLinhaA[iLdA + k]), vB0, vC10);
+        vC20 = _mm256_fmadd_ps(_mm256_set1_ps(pdLinhaA[2 * iLdA + k]), vB0, vC20);
+        vC30 = _mm256_fmadd_ps(_mm256_set1_ps(pdLinhaA[3 * iLdA + k]), vB0, vC30);
+      }
+      _mm256_storeu_ps(&pdLinhaC[j], vC00);
+      _mm256_storeu_ps(&pdLinhaC[iLdC + j], vC10);
+      _mm256_storeu_ps(&pdLinhaC[2 * iLdC + j], vC20);
+      _mm256_storeu_ps(&pdLinhaC[3 * iLdC + j], vC30);
+    }
+    // Colunas finais pelo caminho escalar
+    if (j < iN)
+      ProdutoMatrizesGenerico(&pdLinhaC[j], iLdC, pdLinhaA, iLdA, &pdB[j], iLdB, 4, iN - j, iK);
+  }
+
+  // Linhas restantes, uma a uma
+  for (; i < iM; i++) {
+    pdLinhaA = &pdA[i * iLdA];
+    pdLinhaC = &pdC[i * iLdC];
+    for (j = 0; j + 8 <= iN; j += 8) {
+      vC00 = _mm256_loadu_ps(&pdLinhaC[j]);
+      for (k = 0, pdLinhaB = &pdB[j]; k < iK; k++, pdLinhaB += iLdB)
+        vC00 = _mm256_fmadd_ps(_mm256_set1_ps(pdLinhaA[k]), _mm256_loadu_ps(pdLinhaB), vC00);
+      _mm256_storeu_ps(&pdLinhaC[j], vC00);
+    }
+    if (j < iN)
+      ProdutoMatrizesGenerico(&pdLinhaC[j], iLdC, pdLinhaA, iLdA, &pdB[j], iLdB, 1, iN - j, iK);
+  }
+}
+
+
+// Em float a tanh e avaliada em double (4 elementos por vez) e arredondada no final
+__attribute__((target("avx2,fma")))
+static void TangenteHiperbolicaAvx2(float *pdX, int iN)
+{
+  register int i;
+  float vdResto[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+  for (i = 0; i + 4 <= iN; i += 4)
+    _mm_storeu_ps(&pdX[i], _mm256_cvtpd_ps(TangenteHiperbolicaVetorAvx2(_mm256_cvtps_pd(_mm_loadu_ps(&pdX[i])))));
+  if (i < iN) {
+    memcpy(vdResto, &pdX[i], sizeof(float) * (iN - i));
+    _mm_storeu_ps(vdResto, _mm256_cvtpd_ps(TangenteHiperbolicaVetorAvx2(_mm256_cvtps_pd(_mm_loadu_ps(vdResto)))));
+    memcpy(&pdX[i], vdResto, sizeof(float) * (iN - i));
+  }
+}
+
+
+// A aproximacao rapida e avaliada diretamente em float (8 elementos por vez)
+__attribute__((target("avx2,fma")))
+static inline __m256 TangenteHiperbolicaRapidaVetorAvx2(__m256 vX)
+{
+  __m256 vX2, vP, vQ;
+
+  vX = _mm256_max_ps(_mm256_min_ps(vX, _mm256_set1_ps(TANH_RAPIDA_LIMITE)), _mm256_set1_ps(-TANH_RAPIDA_LIMITE));
+  vX2 = _mm256_mul_ps(vX, vX);
+  vP = _mm256_fmadd_ps(_mm256_set1_ps(TANH_RAPIDA_P13), vX2, _mm256_set1_ps(TANH_RAPIDA_P11));
+  vP = _mm256_fmadd_ps(vP, vX2, _mm256_set1_ps(TANH_RAPIDA_P9));
+  vP = _mm256_fmadd_ps(vP, vX2, _mm256_set1_ps(TANH_RAPIDA_P7));
+  vP = _mm256_fmadd_ps(vP, vX2, _mm256_set1_ps(TANH_RAPIDA_P5));
+  vP = _mm256_fmadd_ps(vP, vX2, _mm256_set1_ps(TANH_RAPIDA_P3));
+  vP = _mm256_fmadd_ps(vP, vX2, _mm256_set1_ps(TANH_RAPIDA_P1));
+  vQ = _mm256_fmadd_ps(_mm256_set1_ps(TANH_RAPIDA_Q6), vX2, _mm256_set1_ps(TANH_RAPIDA_Q4));
+  vQ = _mm256_fmadd_ps(vQ, vX2, _mm256_set1_ps(TANH_RAPIDA_Q2));
+  vQ = _mm256_fmadd_ps(vQ, vX2, _mm256_set1_ps(TANH_RAPIDA_Q0));
+  return _mm256_div_ps(_mm256_mul_ps(vP, vX), vQ);
+}
+
+
+__attribute__((target("avx2,fma")))
+static void TangenteHiperbolicaRapidaAvx2(float *pdX, int iN)
+{
+  register int i;
+  float vdResto[8] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+
+  for (i = 0; i + 8 <= iN; i += 8)
+    _mm256_storeu_ps(&pdX[i], TangenteHiperbolicaRapidaVetorAvx2(_mm256_loadu_ps(&pdX[i])));
+  if (i < iN) {
+    memcpy(vdResto, &pdX[i], sizeof(float) * (iN - i));
+    _mm256_storeu_ps(vdResto, TangenteHiperbolicaRapidaVetorAvx2(_mm256_loadu_ps(vdResto)));
+    memcpy(&pdX[i], vdResto, sizeof(float) * (iN - i));
+  }
+}
+
+
+__attribute__((target("avx2,fma")))
+static double SomaQuadradosDiferencaAvx2(const float *pdA, const float *pdB, int iN)
+{
+  register int i;
+  __m256 vSoma = _mm256_setzero_ps(), vDif;
+  double dSoma;
+
+  for (i = 0; i + 8 <= iN; i += 8) {
+    vDif = _mm256_sub_ps(_mm256_loadu_ps(&pdA[i]), _mm256_loadu_ps(&pdB[i]));
+    vSoma = _mm256_fmadd_ps(vDif, vDif, vSoma);
+  }
+  dSoma = SomaHorizontalAvx2Simples(vSoma);
+  for (; i < iN; i++)
+    dSoma += QUADRADO(pdA[i] - pdB[i]);
+  return dSoma;
+}
+
+
+__attribute__((target("avx2,fma")))
+static void AjustarMomentoAvx2(float *pdY, float *pdV, float dMomento, float dFatorV, float dFatorG, float dA,
+    const float *pdX, int iN)
+{
+  register int i;
+  __m256 vMomento = _mm256_set1_ps(dMomento), vFatorV = _mm256_set1_ps(dFatorV);
+  __m256 vFatorG = _mm256_set1_ps(dFatorG), vA = _mm256_set1_ps(dA), vG, vV;
+
+  for (i = 0; i + 8 <= iN; i += 8) {
+    vG = _mm256_mul_ps(vA, _mm256_loadu_ps(&pdX[i]));
+    vV = _mm256_fmadd_ps(vMomento, _mm256_loadu_ps(&pdV[i]), vG);
+    _mm256_storeu_ps(&pdV[i], vV);
+    _mm256_storeu_ps(&pdY[i], _mm256_fmadd_ps(vFatorV, vV, _mm256_fmadd_ps(vFatorG, vG,
+        _mm256_loadu_ps(&pdY[i]))));
+  }
+  AjustarMomentoGenerico(&pdY[i], &pdV[i], dMomento, dFatorV, dFatorG, dA, &pdX[i], iN - i);
+}
+
+
+__attribute__((target("avx2,fma")))
+static void AjustarAdamAvx2(float *pdY, float *pdM, float *pdV, float dBeta1, float dBeta2, float dTaxa,
+    float dEpsilon, float dA, const float *pdX, int iN)
+{
+  register int i;
+  __m256 vBeta1 = _mm256_set1_ps(dBeta1), vBeta2 = _mm256_set1_ps(dBeta2), vTaxa = _mm256_set1_ps(dTaxa);
+  __m256 vComplemento1 = _mm256_set1_ps(1.0 - dBeta1), vComplemento2 = _mm256_set1_ps(1.0 - dBeta2);
+  __m256 vEpsilon = _mm256_set1_ps(dEpsilon), vA = _mm256_set1_ps(dA), vG, vM, vV;
+
+  for (i = 0; i + 8 <= iN; i += 8) {
+    vG = _mm256_mul_ps(vA, _mm256_loadu_ps(&pdX[i]));
+    vM = _mm256_fmadd_ps(vBeta1, _mm256_loadu_ps(&pdM[i]), _mm256_mul_ps(vComplemento1, vG));
+    vV = _mm256_fmadd_ps(vBeta2, _mm256_loadu_ps(&pdV[i]), _mm256_mul_ps(_mm256_mul_ps(vComplemento2, vG), vG));
+    _mm256_storeu_ps(&pdM[i], vM);
+    _mm256_storeu_ps(&pdV[i], vV);
+    _mm256_storeu_ps(&pdY[i], _mm256_fmadd_ps(vTaxa, _mm256_div_ps(vM,
+        _mm256_add_ps(_mm256_sqrt_ps(vV), vEpsilon)), _mm256_loadu_ps(&pdY[i])));
+  }
+  AjustarAdamGenerico(&pdY[i], &pdM[i], &pdV[i], dBeta1, dBeta2, dTaxa, dEpsilon, dA, &pdX[i], iN - i);
+}
+#endif
+
+
+//************************************ Kernels AVX-512 *******************************************
+// Mesmo algoritmo de TangenteHiperbolicaVetorAvx2 com 8 elementos
+__attribute__((target("avx512f")))
+static inline __m512d TangenteHiperbolicaVetorAvx512(__m512d vX)
+{
+  const __m512i viSinal = _mm512_set1_epi64((long long) 0x8000000000000000ULL);
+  __m512d vY, vK, vR, vQ, vExpm1, vPot;
+  __m512i viAbs, viExpoente;
+
+  viAbs = _mm512_andnot_epi64(viSinal, _mm512_castpd_si512(vX));
+  vY = _mm512_min_pd(_mm512_add_pd(_mm512_castsi512_pd(viAbs), _mm512_castsi512_pd(viAbs)),
+      _mm512_set1_pd(TANH_LIMITE));
+  vK = _mm512_roundscale_pd(_mm512_mul_pd(vY, _mm512_set1_pd(INV_LN2)), _MM_FROUND_TO_NEAREST_INT);
+  vR = _mm512_fnmadd_pd(vK, _mm512_set1_pd(LN2_HI), vY);
+  vR = _mm512_fnmadd_pd(vK, _mm512_set1_pd(LN2_LO), vR);
+
+  vQ = _mm512_set1_pd(1.0 / 6227020800.0);
+  vQ = _mm512_fmadd_pd(vQ, vR, _mm512_set1_pd(1.0 / 479001600.0));
+  vQ = _mm512_fmadd_pd(vQ, vR, _mm512_set1_pd(1.0 / 39916800.0));
+  vQ = _mm512_fmadd_pd(vQ, vR, _mm512_set1_pd(1.0 / 3628800.0));
+  vQ = _mm512_fmadd_pd(vQ, vR, _mm512_set1_pd(1.0 / 362880.0));
+  vQ = _mm512_fmadd_pd(vQ, vR, _mm512_set1_pd(1.0 / 40320.0));
+  vQ = _mm512_fmadd_pd(vQ, vR, _mm512_set1_pd(1.0 / 5040.0));
+  vQ = _mm512_fmadd_pd(vQ, vR, _mm512_set1_pd(1.0 / 720.0));
+  vQ = _mm512_fmadd_pd(vQ, vR, _mm512_set1_pd(1.0 / 120.0));
+  vQ = _mm512_fmadd_pd(vQ, vR, _mm512_set1_pd(1.0 / 24.0));
+  vQ = _mm512_fmadd_pd(vQ, vR, _mm512_set1_pd(1.0 / 6.0));
+  vQ = _mm512_fmadd_pd(vQ, vR, _mm512_set1_pd(0.5));
+  vExpm1 = _mm512_fmadd_pd(_mm512_mul_pd(vR, vR), vQ, vR);
+
+  viExpoente = _mm512_cvtepi32_epi64(_mm512_cvtpd_epi32(vK));
+  vPot = _mm512_castsi512_pd(_mm512_slli_epi64(_mm512_add_epi64(viExpoente, _mm512_set1_epi64(1023)), 52));
+  vExpm1 = _mm512_fmadd_pd(vPot, vExpm1, _mm512_sub_pd(vPot, _mm512_set1_pd(1.0)));
+
+  vY = _mm512_div_pd(vExpm1, _mm512_add_pd(vExpm1, _mm512_set1_pd(2.0)));
+  return _mm512_castsi512_pd(_mm512_or_epi64(_mm512_castpd_si512(vY),
+      _mm512_and_epi64(viSinal, _mm512_castpd_si512(vX))));
+}
+
+
+// Produto int8 com 32 bytes por passo e o resto por mascara (exige AVX512BW e AVX512VL, alem do AVX512F)
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static int ProdutoEscalarInt8Avx512(const signed char *pcA, const signed char *pcB, int iN)
+{
+  register int i;
+  __m512i viSoma = _mm512_setzero_si512();
+  __mmask32 mResto;
+
+  for (i = 0; i + 32 <= iN; i += 32)
+    viSoma = _mm512_add_epi32(viSoma,
+        _mm512_madd_epi16(_mm512_cvtepi8_epi16(_mm256_loadu_si256((const __m256i*) &pcA[i])),
+        _mm512_cvtepi8_epi16(_mm256_loadu_si256((const __m256i*) &pcB[i]))));
+  if (i < iN) {
+    mResto = (__mmask32) ((1ull << (iN - i)) - 1);
+    viSoma = _mm512_add_epi32(viSoma, _mm512_madd_epi16(_mm512_cvtepi8_epi16(_mm256_maskz_loadu_epi8(mResto, &pcA[i])),
+        _mm512_cvtepi8_epi16(_mm256_maskz_loadu_epi8(mResto, &pcB[i]))));
+  }
+  return _mm512_reduce_add_epi32(viSoma);
+}
+
+
+// Linhas largas uma a uma com 32 bytes por passo; as estreitas (caso das redes dos robos) pelo kernel AVX2
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static void ProdutoMatrizInt8Avx512(int *piY, const signed char *pcW, const signed char *pcX, int iNumLinhas,
+    int iStride)
+{
+  register int i;
+
+  if (iStride < 64) {
+    ProdutoMatrizInt8Avx2(piY, pcW, pcX, iNumLinhas, iStride);
+    return;
+  }
+  for (i = 0; i < iNumLinhas; i++)
+    piY[i] = ProdutoEscalarInt8Avx512(&pcW[i * iStride], pcX, iStride);
+}
+
+
+#ifndef PRECISAO_SIMPLES
+__attribute__((target("avx512f")))
+static double ProdutoEscalarAvx512(double dInicial, const double *pdA, const double *pdB, int iN)
+{
+  register int i;
+  __m512d vSoma0 = _mm512_setzero_pd(), vSoma1 = _mm512_setzero_pd();
+  __mmask8 mResto;
+
+  for (i = 0; i + 16 <= iN; i += 16) {
+    vSoma0 = _mm512_fmadd_pd(_mm512_loadu_pd(&pdA[i]), _mm512_loadu_pd(&pdB[i]), vSoma0);
+    vSoma1 = _mm512_fmadd_pd(_mm512_loadu_pd(&pdA[i + 8]), _mm512_loadu_pd(&pdB[i + 8]), vSoma1);
+  }
+  if (i + 8 <= iN) {
+    vSoma0 = _mm512_fmadd_pd(_mm512_loadu_pd(&pdA[i]), _mm512_loadu_pd(&pdB[i]), vSoma0);
+    i += 8;
+  }
+  if (i < iN) {
+    mResto = (__mmask8) ((1u << (iN - i)) - 1);
+    vSoma1 = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(mResto, &pdA[i]), _mm512_maskz_loadu_pd(mResto, &pdB[i]), vSoma1);
+  }
+  return dInicial + _mm512_reduce_add_pd(_mm512_add_pd(vSoma0, vSoma1));
+}
+
+
+__attribute__((target("avx512f")))
+static void SomarEscaladoAvx512(double *pdY, double dA, const double *pdX, int iN)
+{
+  register int i;
+  __m512d vA = _mm512_set1_pd(dA);
+  __mmask8 mResto;
+
+  for (i = 0; i + 8 <= iN; i += 8)
+    _mm512_storeu_pd(&pdY[i], _mm512_fmadd_pd(vA, _mm512_loadu_pd(&pdX[i]), _mm512_loadu_pd(&pdY[i])));
+  if (i < iN) {
+    mResto = (__mmask8) ((1u << (iN - i)) - 1);
+    _mm512_mask_storeu_pd(&pdY[i], mResto, _mm512_fmadd_pd(vA, _mm512_maskz_loadu_pd(mResto, &pdX[i]),
+        _mm512_maskz_loadu_pd(mResto, &pdY[i])));
+  }
+}
+
+
+__attribute__((target("avx512f")))
+static void ProdutoMatrizesAvx512(double *pdC, int iLdC, const double *pdA, int iLdA, const double *pdB, int iLdB,
+    int iM, int iN, int iK)
+{
+  register int k;
+  int i, j, r;
+  const double *pdLinhaA, *pdLinhaB;
+  double *pdLinhaC;
+  __m512d vA, vB0, vB1, vC00, vC01, vC10, vC11, vC20, vC21, vC30, vC31;
+  __mmask8 mResto;
+
+  // Blocos de 4 linhas x 16 colunas de C em 8 acumuladores: cada par de vetores de B e reusado pelas 4 linhas
+  // e cada elemento de A e difundido para as colunas do vetor
+  for (i = 0; i + 4 <= iM; i += 4) {
+    pdLinhaA = &pdA[i * iLdA];
+    pdLinhaC = &pdC[i * iLdC];
+    for (j = 0; j + 16 <= iN; j += 16) {
+      vC00 = _mm512_loadu_pd(&pdLinhaC[j]);
+      vC01 = _mm512_loadu_pd(&pdLinhaC[j + 8]);
+      vC10 = _mm512_loadu_pd(&pdLinhaC[iLdC + j]);
+      vC11 = _mm512_loadu_pd(&pdLinhaC[iLdC + j + 8]);
+      vC20 = _mm512_loadu_pd(&pdLinhaC[2 * iLdC + j]);
+      vC21 = _mm512_loadu_pd(&pdLinhaC[2 * iLdC + j + 8]);
+      vC30 = _mm512_loadu_pd(&pdLinhaC[3 * iLdC + j]);
+      vC31 = _mm512_loadu_pd(&pdLinhaC[3 * iLdC + j + 8]);
+      for (k = 0, pdLinhaB = &pdB[j]; k < iK; k++, pdLinhaB += iLdB) {
+        vB0 = _mm512_loadu_pd(pdLinhaB);
+        vB1 = _mm512_loadu_pd(pdLinhaB + 8);
+        vA = _mm512_set1_pd(pdLinhaA[k]);
+        vC00 = _mm512_fmadd_pd(vA, vB0, vC00);
+        vC01 = _mm512_fmadd_pd(vA, vB1, vC01);
+        vA = _mm512_set1_pd(pdLinhaA[iLdA + k]);
+        vC10 = _mm512_fmadd_pd(vA, vB0, vC10);
+        vC11 = _mm512_fmadd_pd(vA, vB1, vC11);
+        vA = _mm512_set1_pd(pdLinhaA[2 * iLdA + k]);
+        vC20 = _mm512_fmadd_pd(vA, vB0, vC20);
+        vC21 = _mm512_fmadd_pd(vA, vB1, vC21);
+        vA = _mm512_set1_pd(pdLinhaA[3 * iLdA + k]);
+        vC30 = _mm512_fmadd_pd(vA, vB0, vC30);
+        vC31 = _mm512_fmadd_pd(vA, vB1, vC31);
+      }
+      _mm512_storeu_pd(&pdLinhaC[j], vC00);
+      _mm512_storeu_pd(&pdLinhaC[j + 8], vC01);
+      _mm512_storeu_pd(&pdLinhaC[iLdC + j], vC10);
+      _mm512_storeu_pd(&pdLinhaC[iLdC + j + 8], vC11);
+      _mm512_storeu_pd(&pdLinhaC[2 * iLdC + j], vC20);
+      _mm512_storeu_pd(&pdLinhaC[2 * iLdC + j + 8], vC21);
+      _mm512_storeu_pd(&pdLinhaC[3 * iLdC + j], vC30);
+      _mm512_storeu_pd(&pdLinhaC[3 * iLdC + j + 8], vC31);
+    }
+    // Colunas restantes em blocos de 4 linhas x 8 colunas
+    for (; j + 8 <= iN; j += 8) {
+      vC00 = _mm512_loadu_pd(&pdLinhaC[j]);
+      vC10 = _mm512_loadu_pd(&pdLinhaC[iLdC + j]);
+      vC20 = _mm512_loadu_pd(&pdLinhaC[2 * iLdC + j]);
+      vC30 = _mm512_loadu_pd(&pdLinhaC[3 * iLdC + j]);
+      for (k = 0, pdLinhaB = &pdB[j]; k < iK; k++, pdLinhaB += iLdB) {
+        vB0 = _mm512_loadu_pd(pdLinhaB);
+        vC00 = _mm512_fmadd_pd(_mm512_set1_pd(pdLinhaA[k]), vB0, vC00);
+        vC10 = _mm512_fmadd_pd(_mm512_set1_pd(pdLinhaA[iLdA + k]), vB0, vC10);
+        vC20 = _mm512_fmadd_pd(_mm512_set1_pd(pdLinhaA[2 * iLdA + k]), vB0, vC20);
+        vC30 = _mm512_fmadd_pd(_mm512_set1_pd(pdLinhaA[3 * iLdA + k]), vB0, vC30);
+      }
+      _mm512_storeu_pd(&pdLinhaC[j], vC00);
+      _mm512_storeu_pd(&pdLinhaC[iLdC + j], vC10);
+      _mm512_storeu_pd(&pdLinhaC[2 * iLdC + j], vC20);
+      _mm512_storeu_pd(&pdLinhaC[3 * iLdC + j], vC30);
+    }
+    // Colunas finais com mascara
+    if (j < iN) {
+      mResto = (__mmask8) ((1u << (iN - j)) - 1);
+      for (r = 0; r < 4; r++) {
+        vC00 = _mm512_maskz_loadu_pd(mResto, &pdLinhaC[r * iLdC + j]);
+        for (k = 0, pdLinhaB = &pdB[j]; k < iK; k++, pdLinhaB += iLdB)
+          vC00 = _mm512_fmadd_pd(_mm512_set1_pd(pdLinhaA[r * iLdA + k]), _mm512_maskz_loadu_pd(mResto, pdLinhaB), vC00);
+        _mm512_mask_storeu_pd(&pdLinhaC[r * iLdC + j], mResto, vC00);
+      }
+    }
+  }
+
+  // Linhas restantes, uma a uma
+  for (; i < iM; i++) {
+    pdLinhaA = &pdA[i * iLdA];
+    pdLinhaC = &pdC[i * iLdC];
+    for (j = 0; j + 8 <= iN; j += 8) {
+      vC00 = _mm512_loadu_pd(&pdLinhaC[j]);
+      for (k = 0, pdLinhaB = &pdB[j]; k < iK; k++, pdLinhaB += iLdB)
+        vC00 = _mm512_fmadd_pd(_mm512_set1_pd(pdLinhaA[k]), _mm512_loadu_pd(pdLinhaB), vC00);
+      _mm512_storeu_pd(&pdLinhaC[j], vC00);
+    }
+    if (j < iN) {
+      mResto = (__mmask8) ((1u << (iN - j)) - 1);
+      vC00 = _mm512_maskz_loadu_pd(mResto, &pdLinhaC[j]);
+      for (k = 0, pdLinhaB = &pdB[j]; k < iK; k++, pdLinhaB += iLdB)
+        vC00 = _mm512_fmadd_pd(_mm512_set1_pd(pdLinhaA[k]), _mm512_maskz_loadu_pd(mResto, pdLinhaB), vC00);
+      _mm512_mask_storeu_pd(&pdLinhaC[j], mResto, vC00);
+    }
+  }
+}
+
+
+__attribute__((target("avx512f")))
+static void TangenteHiperbolicaAvx512(double *pdX, int iN)
+{
+  register int i;
+  __mmask8 mResto;
+
+  for (i = 0; i + 8 <= iN; i += 8)
+    _mm512_storeu_pd(&pdX[i], TangenteHiperbolicaVetorAvx512(_mm512_loadu_pd(&pdX[i])));
+  if (i < iN) {
+    mResto = (__mmask8) ((1u << (iN - i)) - 1);
+    _mm512_mask_storeu_pd(&pdX[i], mResto, TangenteHiperbolicaVetorAvx512(_mm512_maskz_loadu_pd(mResto, &pdX[i])));
+  }
+}
+
+
+__attribute__((target("avx512f")))
+static inline __m512d TangenteHiperbolicaRapidaVetorAvx512(__m512d vX)
+{
+  __m512d vX2, vP, vQ;
+
+  vX = _mm512_max_pd(_mm512_min_pd(vX, _mm512_set1_pd(TANH_RAPIDA_LIMITE)), _mm512_set1_pd(-TANH_RAPIDA_LIMITE));
+  vX2 = _mm512_mul_pd(vX, vX);
+  vP = _mm512_fmadd_pd(_mm512_set1_pd(TANH_RAPIDA_P13), vX2, _mm512_set1_pd(TANH_RAPIDA_P11));
+  vP = _mm512_fmadd_pd(vP, vX2, _mm512_set1_pd(TANH_RAPIDA_P9));
+  vP = _mm512_fmadd_pd(vP, vX2, _mm512_set1_pd(TANH_RAPIDA_P7));
+  vP = _mm512_fmadd_pd(vP, vX2, _mm512_set1_pd(TANH_RAPIDA_P5));
+  vP = _mm512_fmadd_pd(vP, vX2, _mm512_set1_pd(TANH_RAPIDA_P3));
+  vP = _mm512_fmadd_pd(vP, vX2, _mm512_set1_pd(TANH_RAPIDA_P1));
+  vQ = _mm512_fmadd_pd(_mm512_set1_pd(TANH_RAPIDA_Q6), vX2, _mm512_set1_pd(TANH_RAPIDA_Q4));
+  vQ = _mm512_fmadd_pd(vQ, vX2, _mm512_set1_pd(TANH_RAPIDA_Q2));
+  vQ = _mm512_fmadd_pd(vQ, vX2, _mm512_set1_pd(TANH_RAPIDA_Q0));
+  return _mm512_div_pd(_mm512_mul_pd(vP, vX), vQ);
+}
+
+
+__attribute__((target("avx512f")))
+static void TangenteHiperbolicaRapidaAvx512(double *pdX, int iN)
+{
+  register int i;
+  __mmask8 mResto;
+
+  for (i = 0; i + 8 <= iN; i += 8)
+    _mm512_storeu_pd(&pdX[i], TangenteHiperbolicaRapidaVetorAvx512(_mm512_loadu_pd(&pdX[i])));
+  if (i < iN) {
+    mResto = (__mmask8) ((1u << (iN - i)) - 1);
+    _mm512_mask_storeu_pd(&pdX[i], mResto,
+        TangenteHiperbolicaRapidaVetorAvx512(_mm512_maskz_loadu_pd(mResto, &pdX[i])));
+  }
+}
+
+
+__attribute__((target("avx512f")))
+static double SomaQuadradosDiferencaAvx512(const double *pdA, const double *pdB, int iN)
+{
+  register int i;
+  __m512d vSoma = _mm512_setzero_pd(), vDif;
+  __mmask8 mResto;
+
+  for (i = 0; i + 8 <= iN; i += 8) {
+    vDif = _mm512_sub_pd(_mm512_loadu_pd(&pdA[i]), _mm512_loadu_pd(&pdB[i]));
+    vSoma = _mm512_fmadd_pd(vDif, vDif, vSoma);
+  }
+  if (i < iN) {
+    mResto = (__mmask8) ((1u << (iN - i)) - 1);
+    vDif = _mm512_sub_pd(_mm512_maskz_loadu_pd(mResto, &pdA[i]), _mm512_maskz_loadu_pd(mResto, &pdB[i]));
+    vSoma = _mm512_fmadd_pd(vDif, vDif, vSoma);
+  }
+  return _mm512_reduce_add_pd(vSoma);
+}
+
+
+__attribute__((target("avx512f")))
+static void AjustarMomentoAvx512(double *pdY, double *pdV, double dMomento, double dFatorV, double dFatorG, double dA,
+    const double *pdX, int iN)
+{
+  register int i;
+  __m512d vMomento = _mm512_set1_pd(dMomento), vFatorV = _mm512_set1_pd(dFatorV);
+  __m512d vFatorG = _mm512_set1_pd(dFatorG), vA = _mm512_set1_pd(dA), vG, vV;
+  __mmask8 mResto;
+
+  for (i = 0; i + 8 <= iN; i += 8) {
+    vG = _mm512_mul_pd(vA, _mm512_loadu_pd(&pdX[i]));
+    vV = _mm512_fmadd_pd(vMomento, _mm512_loadu_pd(&pdV[i]), vG);
+    _mm512_storeu_pd(&pdV[i], vV);
+    _mm512_storeu_pd(&pdY[i], _mm512_fmadd_pd(vFatorV, vV, _mm512_fmadd_pd(vFatorG, vG,
+        _mm512_loadu_pd(&pdY[i]))));
+  }
+  if (i < iN) {
+    mResto = (__mmask8) ((1u << (iN - i)) - 1);
+    vG = _mm512_mul_pd(vA, _mm512_maskz_loadu_pd(mResto, &pdX[i]));
+    vV = _mm512_fmadd_pd(vMomento, _mm512_maskz_loadu_pd(mResto, &pdV[i]), vG);
+    _mm512_mask_storeu_pd(&pdV[i], mResto, vV);
+    _mm512_mask_storeu_pd(&pdY[i], mResto, _mm512_fmadd_pd(vFatorV, vV, _mm512_fmadd_pd(vFatorG, vG,
+        _mm512_maskz_loadu_pd(mResto, &pdY[i]))));
+  }
+}
+
+
+// As posicoes fora da mascara podem gerar 0/0, mas nao sao gravadas
+__attribute__((target("avx512f")))
+static void AjustarAdamAvx512(double *pdY, double *pdM, double *pdV, double dBeta1, double dBeta2, double dTaxa,
+    double dEpsilon, double dA, const double *pdX, int iN)
+{
+  register int i;
+  __m512d vBeta1 = _mm512_set1_pd(dBeta1), vBeta2 = _mm512_set1_pd(dBeta2), vTaxa = _mm512_set1_pd(dTaxa);
+  __m512d vComplemento1 = _mm512_set1_pd(1.0 - dBeta1), vComplemento2 = _mm512_set1_pd(1.0 - dBeta2);
+  __m512d vEpsilon = _mm512_set1_pd(dEpsilon), vA = _mm512_set1_pd(dA), vG, vM, vV;
+  __mmask8 mResto;
+
+  for (i = 0; i + 8 <= iN; i += 8) {
+    vG = _mm512_mul_pd(vA, _mm512_loadu_pd(&pdX[i]));
+    vM = _mm512_fmadd_pd(vBeta1, _mm512_loadu_pd(&pdM[i]), _mm512_mul_pd(vComplemento1, vG));
+    vV = _mm512_fmadd_pd(vBeta2, _mm512_loadu_pd(&pdV[i]), _mm512_mul_pd(_mm512_mul_pd(vComplemento2, vG), vG));
+    _mm512_storeu_pd(&pdM[i], vM);
+    _mm512_storeu_pd(&pdV[i], vV);
+    _mm512_storeu_pd(&pdY[i], _mm512_fmadd_pd(vTaxa, _mm512_div_pd(vM,
+        _mm512_add_pd(_mm512_sqrt_pd(vV), vEpsilon)), _mm512_loadu_pd(&pdY[i])));
+  }
+  if (i < iN) {
+    mResto = (__mmask8) ((1u << (iN - i)) - 1);
+    vG = _mm512_mul_pd(vA, _mm512_maskz_loadu_pd(mResto, &pdX[i]));
+    vM = _mm512_fmadd_pd(vBeta1, _mm512_maskz_loadu_pd(mResto, &pdM[i]), _mm512_mul_pd(vComplemento1, vG));
+    vV = _mm512_fmadd_pd(vBeta2, _mm512_maskz_loadu_pd(mResto, &pdV[i]),
+        _mm512_mul_pd(_mm512_mul_pd(vComplemento2, vG), vG));
+    _mm512_mask_storeu_pd(&pdM[i], mResto, vM);
+    _mm512_mask_storeu_pd(&pdV[i], mResto, vV);
+    _mm512_mask_storeu_pd(&pdY[i], mResto, _mm512_fmadd_pd(vTaxa, _mm512_div_pd(vM,
+        _mm512_add_pd(_mm512_sqrt_pd(vV), vEpsilon)), _mm512_maskz_loadu_pd(mResto, &pdY[i])));
+  }
+}
+#else
+__attribute__((target("avx512f")))
+static float ProdutoEscalarAvx512(float dInicial, const float *pdA, const float *pdB, int iN)
+{
+  register int i;
+  __m512 vSoma0 = _mm512_setzero_ps(), vSoma1 = _mm512_setzero_ps();
+  __mmask16 mResto;
+
+  for (i = 0; i + 32 <= iN; i += 32) {
+    vSoma0 = _mm512_fmadd_ps(_mm512_loadu_ps(&pdA[i]), _mm512_loadu_ps(&pdB[i]), vSoma0);
+    vSoma1 = _mm512_fmadd_ps(_mm512_loadu_ps(&pdA[i + 16]), _mm512_loadu_ps(&pdB[i + 16]), vSoma1);
+  }
+  if (i + 16 <= iN) {
+    vSoma0 = _mm512_fmadd_ps(_mm512_loadu_ps(&pdA[i]), _mm512_loadu_ps(&pdB[i]), vSoma0);
+    i += 16;
+  }
+  if (i < iN) {
+    mResto = (__mmask16) ((1u << (iN - i)) - 1);
+    vSoma1 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mResto, &pdA[i]), _mm512_maskz_loadu_ps(mResto, &pdB[i]), vSoma1);
+  }
+  return dInicial + _mm512_reduce_add_ps(_mm512_add_ps(vSoma0, vSoma1));
+}
+
+
+__attribute__((target("avx512f")))
+static void SomarEscaladoAvx512(float *pdY, float dA, const float *pdX, int iN)
+{
+  register int i;
+  __m512 vA = _mm512_set1_ps(dA);
+  __mmask16 mResto;
+
+  for (i = 0; i + 16 <= iN; i += 16)
+    _mm512_storeu_ps(&pdY[i], _mm512_fmadd_ps(vA, _mm512_loadu_ps(&pdX[i]), _mm512_loadu_ps(&pdY[i])));
+  if (i < iN) {
+    mResto = (__mmask16) ((1u << (iN - i)) - 1);
+    _mm512_mask_storeu_ps(&pdY[i], mResto, _mm512_fmadd_ps(vA, _mm512_maskz_loadu_ps(mResto, &pdX[i]),
+        _mm512_maskz_loadu_ps(mResto, &pdY[i])));
+  }
+}
+
+
+__attribute__((target("avx512f")))
+static void ProdutoMatrizesAvx512(float *pdC, int iLdC, const float *pdA, int iLdA, const float *pdB, int iLdB,
+    int iM, int iN, int iK)
+{
+  register int k;
+  int i, j, r;
+  const float *pdLinhaA, *pdLinhaB;
+  float *pdLinhaC;
+  __m512 vA, vB0, vB1, vC00, vC01, vC10, vC11, vC20, vC21, vC30, vC31;
+  __mmask16 mResto;
+
+  // Blocos de 4 linhas x 32 colunas de C em 8 acumuladores: cada par de vetores de B e reusado pelas 4 linhas
+  // e cada elemento de A e difundido para as colunas do vetor
+  for (i = 0; i + 4 <= iM; i += 4) {
+    pdLinhaA = &pdA[i * iLdA];
+    pdLinhaC = &pdC[i * iLdC];
+    for (j = 0; j + 32 <= iN; j += 32) {
+      vC00 = _mm512_loadu_ps(&pdLinhaC[j]);
+      vC01 = _mm512_loadu_ps(&pdLinhaC[j + 16]);
+      vC10 = _mm512_loadu_ps(&pdLinhaC[iLdC + j]);
+      vC11 = _mm512_loadu_ps(&pdLinhaC[iLdC + j + 16]);
+      vC20 = _mm512_loadu_ps(&pdLinhaC[2 * iLdC + j]);
+      vC21 = _mm512_loadu_ps(&pdLinhaC[2 * iLdC + j + 16]);
+      vC30 = _mm512_loadu_ps(&pdLinhaC[3 * iLdC + j]);
+      vC31 = _mm512_loadu_ps(&pdLinhaC[3 * iLdC + j + 16]);
+      for (k = 0, pdLinhaB = &pdB[j]; k < iK; k++, pdLinhaB += iLdB) {
+        vB0 = _mm512_loadu_ps(pdLinhaB);
+        vB1 = _mm512_loadu_ps(pdLinhaB + 16);
+        vA = _mm512_set1_ps(pdLinhaA[k]);
+        vC00 = _mm512_fmadd_ps(vA, vB0, vC00);
+        vC01 = _mm512_fmadd_ps(vA, vB1, vC01);
+        vA = _mm512_set1_ps(pdLinhaA[iLdA + k]);
+        vC10 = _mm512_fmadd_ps(vA, vB0, vC10);
+        vC11 = _mm512_fmadd_ps(vA, vB1, vC11);
+        vA = _mm512_set1_ps(pdLinhaA[2 * iLdA + k]);
+        vC20 = _mm512_fmadd_ps(vA, vB0, vC20);
+        vC21 = _mm512_fmadd_ps(vA, vB1, vC21);
+        vA = _mm512_set1_ps(pdLinhaA[3 * iLdA + k]);
+        vC30 = _mm512_fmadd_ps(vA, vB0, vC30);
+        vC31 = _mm512_fmadd_ps(vA, vB1, vC31);
+      }
+      _mm512_storeu_ps(&pdLinhaC[j], vC00);
+      _mm512_storeu_ps(&pdLinhaC[j + 16], vC01);
+      _mm512_storeu_ps(&pdLinhaC[iLdC + j], vC10);
+      _mm512_storeu_ps(&pdLinhaC[iLdC + j + 16], vC11);
+      _mm512_storeu_ps(&pdLinhaC[2 * iLdC + j], vC20);
+      _mm512_storeu_ps(&pdLinhaC[2 * iLdC + j + 16], vC21);
+      _mm512_storeu_ps(&pdLinhaC[3 * iLdC + j], vC30);
+      _mm512_storeu_ps(&pdLinhaC[3 * iLdC + j + 16], vC31);
+    }
+    // Colunas restantes em blocos de 4 linhas x 16 colunas
+    for (; j + 16 <= iN; j += 16) {
+      vC00 = _mm512_loadu_ps(&pdLinhaC[j]);
+      vC10 = _mm512_loadu_ps(&pdLinhaC[iLdC + j]);
+      vC20 = _mm512_loadu_ps(&pdLinhaC[2 * iLdC + j]);
+      vC30 = _mm512_loadu_ps(&pdLinhaC[3 * iLdC + j]);
+      for (k = 0, pdLinhaB = &pdB[j]; k < iK; k++, pdLinhaB += iLdB) {
+        vB0 = _mm512_loadu_ps(pdLinhaB);
+        vC00 = _mm512_fmadd_ps(_mm512_set1_ps(pdLinhaA[k]), vB0, vC00);
+        vC10 = _mm512_fmadd_ps(_mm512_set1_ps(pdLinhaA[iLdA + k]), vB0, vC10);
+        vC20 = _mm512_fmadd_ps(_mm512_set1_ps(pdLinhaA[2 * iLdA + k]), vB0, vC20);
+        vC30 = _mm512_fmadd_ps(_mm512_set1_ps(pdLinhaA[3 * iLdA + k]), vB0, vC30);
+      }
+      _mm512_storeu_ps(&pdLinhaC[j], vC00);
+      _mm512_storeu_ps(&pdLinhaC[iLdC + j], vC10);
+      _mm512_storeu_ps(&pdLinhaC[2 * iLdC + j], vC20);
+      _mm512_storeu_ps(&pdLinhaC[3 * iLdC + j], vC30);
+    }
+    // Colunas finais com mascara
+    if (j < iN) {
+      mResto = (__mmask16) ((1u << (iN - j)) - 1);
+      for (r = 0; r < 4; r++) {
+        vC00 = _mm512_maskz_loadu_ps(mResto, &pdLinhaC[r * iLdC + j]);
+        for (k = 0, pdLinhaB = &pdB[j]; k < iK; k++, pdLinhaB += iLdB)
+          vC00 = _mm512_fmadd_ps(_mm512_set1_ps(pdLinhaA[r * iLdA + k]), _mm512_maskz_loadu_ps(mResto, pdLinhaB), vC00);
+        _mm512_mask_storeu_ps(&pdLinhaC[r * iLdC + j], mResto, vC00);
+      }
+    }
+  }
+
+  // Linhas restantes, uma a uma
+  for (; i < iM; i++) {
+    pdLinhaA = &pdA[i * iLdA];
+    pdLinhaC = &pdC[i * iLdC];
+    for (j = 0; j + 16 <= iN; j += 16) {
+      vC00 = _mm512_loadu_ps(&pdLinhaC[j]);
+      for (k = 0, pdLinhaB = &pdB[j]; k < iK; k++, pdLinhaB += iLdB)
+        vC00 = _mm512_fmadd_ps(_mm512_set1_ps(pdLinhaA[k]), _mm512_loadu_ps(pdLinhaB), vC00);
+      _mm512_storeu_ps(&pdLinhaC[j], vC00);
+    }
+    if (j < iN) {
+      mResto = (__mmask16) ((1u << (iN - j)) - 1);
+      vC00 = _mm512_maskz_loadu_ps(mResto, &pdLinhaC[j]);
+      for (k = 0, pdLinhaB = &pdB[j]; k < iK; k++, pdLinhaB += iLdB)
+        vC00 = _mm512_fmadd_ps(_mm512_set1_ps(pdLinhaA[k]), _mm512_maskz_loadu_ps(mResto, pdLinhaB), vC00);
+      _mm512_mask_storeu_ps(&pdLinhaC[j], mResto, vC00);
+    }
+  }
+}
+
+
+// Em float a tanh e avaliada em double (duas metades de 8 elementos) e arredondada no final
+__attribute__((target("avx512f")))
+static void TangenteHiperbolicaAvx512(float *pdX, int iN)
+{
+  register int i;
+  __mmask16 mResto;
+  __m512 vX;
+  __m256 vBaixo, vAlto;
+
+  for (i = 0; i < iN; i += 16) {
+    mResto = (__mmask16) (iN - i >= 16 ? 0xffff : (1u << (iN - i)) - 1);
+    vX = _mm512_maskz_loadu_ps(mResto, &pdX[i]);
+    vBaixo = _mm512_cvtpd_ps(TangenteHiperbolicaVetorAvx512(_mm512_cvtps_pd(_mm512_castps512_ps256(vX))));
+    vAlto = _mm512_cvtpd_ps(TangenteHiperbolicaVetorAvx512(_mm512_cvtps_pd(
+        _mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(vX), 1)))));
+    vX = _mm512_castpd_ps(_mm512_insertf64x4(_mm512_castps_pd(_mm512_castps256_ps512(vBaixo)),
+        _mm256_castps_pd(vAlto), 1));
+    _mm512_mask_storeu_ps(&pdX[i], mResto, vX);
+  }
+}
+
+
+__attribute__((target("avx512f")))
+static inline __m512 TangenteHiperbolicaRapidaVetorAvx512(__m512 vX)
+{
+  __m512 vX2, vP, vQ;
+
+  vX = _mm512_max_ps(_mm512_min_ps(vX, _mm512_set1_ps(TANH_RAPIDA_LIMITE)), _mm512_set1_ps(-TANH_RAPIDA_LIMITE));
+  vX2 = _mm512_mul_ps(vX, vX);
+  vP = _mm512_fmadd_ps(_mm512_set1_ps(TANH_RAPIDA_P13), vX2, _mm512_set1_ps(TANH_RAPIDA_P11));
+  vP = _mm512_fmadd_ps(vP, vX2, _mm512_set1_ps(TANH_RAPIDA_P9));
+  vP = _mm512_fmadd_ps(vP, vX2, _mm512_set1_ps(TANH_RAPIDA_P7));
+  vP = _mm512_fmadd_ps(vP, vX2, _mm512_set1_ps(TANH_RAPIDA_P5));
+  vP = _mm512_fmadd_ps(vP, vX2, _mm512_set1_ps(TANH_RAPIDA_P3));
+  vP = _mm512_fmadd_ps(vP, vX2, _mm512_set1_ps(TANH_RAPIDA_P1));
+  vQ = _mm512_fmadd_ps(_mm512_set1_ps(TANH_RAPIDA_Q6), vX2, _mm512_set1_ps(TANH_RAPIDA_Q4));
+  vQ = _mm512_fmadd_ps(vQ, vX2, _mm512_set1_ps(TANH_RAPIDA_Q2));
+  vQ = _mm512_fmadd_ps(vQ, vX2, _mm512_set1_ps(TANH_RAPIDA_Q0));
+  return _mm512_div_ps(_mm512_mul_ps(vP, vX), vQ);
+}
+
+
+__attribute__((target("avx512f")))
+static void TangenteHiperbolicaRapidaAvx512(float *pdX, int iN)
+{
+  register int i;
+  __mmask16 mResto;
+
+  for (i = 0; i + 16 <= iN; i += 16)
+    _mm512_storeu_ps(&pdX[i], TangenteHiperbolicaRapidaVetorAvx512(_mm512_loadu_ps(&pdX[i])));
+  if (i < iN) {
+    mResto = (__mmask16) ((1u << (iN - i)) - 1);
+    _mm512_mask_storeu_ps(&pdX[i], mResto,
+        TangenteHiperbolicaRapidaVetorAvx512(_mm512_maskz_loadu_ps(mResto, &pdX[i])));
+  }
+}
+
+
+__attribute__((target("avx512f")))
+static double SomaQuadradosDiferencaAvx512(const float *pdA, const float *pdB, int iN)
+{
+  register int i;
+  __m512 vSoma = _mm512_setzero_ps(), vDif;
+  __mmask16 mResto;
+
+  for (i = 0; i + 16 <= iN; i += 16) {
+    vDif = _mm512_sub_ps(_mm512_loadu_ps(&pdA[i]), _mm512_loadu_ps(&pdB[i]));
+    vSoma = _mm512_fmadd_ps(vDif, vDif, vSoma);
+  }
+  if (i < iN) {
+    mResto = (__mmask16) ((1u << (iN - i)) - 1);
+    vDif = _mm512_sub_ps(_mm512_maskz_loadu_ps(mResto, &pdA[i]), _mm512_maskz_loadu_ps(mResto, &pdB[i]));
+    vSoma = _mm512_fmadd_ps(vDif, vDif, vSoma);
+  }
+  return _mm512_reduce_add_ps(vSoma);
+}
+
+
+__attribute__((target("avx512f")))
+static void AjustarMomentoAvx512(float *pdY, float *pdV, float dMomento, float dFatorV, float dFatorG, float dA,
+    const float *pdX, int iN)
+{
+  register int i;
+  __m512 vMomento = _mm512_set1_ps(dMomento), vFatorV = _mm512_set1_ps(dFatorV);
+  __m512 vFatorG = _mm512_set1_ps(dFatorG), vA = _mm512_set1_ps(dA), vG, vV;
+  __mmask16 mResto;
+
+  for (i = 0; i + 16 <= iN; i += 16) {
+    vG = _mm512_mul_ps(vA, _mm512_loadu_ps(&pdX[i]));
+    vV = _mm512_fmadd_ps(vMomento, _mm512_loadu_ps(&pdV[i]), vG);
+    _mm512_storeu_ps(&pdV[i], vV);
+    _mm512_storeu_ps(&pdY[i], _mm512_fmadd_ps(vFatorV, vV, _mm512_fmadd_ps(vFatorG, vG,
+        _mm512_loadu_ps(&pdY[i]))));
+  }
+  if (i < iN) {
+    mResto = (__mmask16) ((1u << (iN - i)) - 1);
+    vG = _mm512_mul_ps(vA, _mm512_maskz_loadu_ps(mResto, &pdX[i]));
+    vV = _mm512_fmadd_ps(vMomento, _mm512_maskz_loadu_ps(mResto, &pdV[i]), vG);
+    _mm512_mask_storeu_ps(&pdV[i], mResto, vV);
+    _mm512_mask_storeu_ps(&pdY[i], mResto, _mm512_fmadd_ps(vFatorV, vV, _mm512_fmadd_ps(vFatorG, vG,
+        _mm512_maskz_loadu_ps(mResto, &pdY[i]))));
+  }
+}
+
+
+// As posicoes fora da mascara podem gerar 0/0, mas nao sao gravadas
+__attribute__((target("avx512f")))
+static void AjustarAdamAvx512(float *pdY, float *pdM, float *pdV, float dBeta1, float dBeta2, float dTaxa,
+    float dEpsilon, float dA, const float *pdX, int iN)
+{
+  register int i;
+  __m512 vBeta1 = _mm512_set1_ps(dBeta1), vBeta2 = _mm512_set1_ps(dBeta2), vTaxa = _mm512_set1_ps(dTaxa);
+  __m512 vComplemento1 = _mm512_set1_ps(1.0 - dBeta1), vComplemento2 = _mm512_set1_ps(1.0 - dBeta2);
+  __m512 vEpsilon = _mm512_set1_ps(dEpsilon), vA = _mm512_set1_ps(dA), vG, vM, vV;
+  __mmask16 mResto;
+
+  for (i = 0; i + 16 <= iN; i += 16) {
+    vG = _mm512_mul_ps(vA, _mm512_loadu_ps(&pdX[i]));
+    vM = _mm512_fmadd_ps(vBeta1, _mm512_loadu_ps(&pdM[i]), _mm512_mul_ps(vComplemento1, vG));
+    vV = _mm512_fmadd_ps(vBeta2, _mm512_loadu_ps(&pdV[i]), _mm512_mul_ps(_mm512_mul_ps(vComplemento2, vG), vG));
+    _mm512_storeu_ps(&pdM[i], vM);
+    _mm512_storeu_ps(&pdV[i], vV);
+    _mm512_storeu_ps(&pdY[i], _mm512_fmadd_ps(vTaxa, _mm512_div_ps(vM,
+        _mm512_add_ps(_mm512_sqrt_ps(vV), vEpsilon)), _mm512_loadu_ps(&pdY[i])));
+  }
+  if (i < iN) {
+    mResto = (__mmask16) ((1u << (iN - i)) - 1);
+    vG = _mm512_mul_ps(vA, _mm512_maskz_loadu_ps(mResto, &pdX[i]));
+    vM = _mm512_fmadd_ps(vBeta1, _mm512_maskz_loadu_ps(mResto, &pdM[i]), _mm512_mul_ps(vComplemento1, vG));
+    vV = _mm512_fmadd_ps(vBeta2, _mm512_maskz_loadu_ps(mResto, &pdV[i]),
+        _mm512_mul_ps(_mm512_mul_ps(vComplemento2, vG), vG));
+    _mm512_mask_storeu_ps(&pdM[i], mResto, vM);
+    _mm512_mask_storeu_ps(&pdV[i], mResto, vV);
+    _mm512_mask_storeu_ps(&pdY[i], mResto, _mm512_fmadd_ps(vTaxa, _mm512_div_ps(vM,
+        _mm512_add_ps(_mm512_sqrt_ps(vV), vEpsilon)), _mm512_maskz_loadu_ps(mResto, &pdY[i])));
+  }
+}
+#endif
+#endif
+
+
+//*********************************** Kernels ativos *********************************************
+TReal (*ProdutoEscalar)(TReal dInicial, const TReal *pdA, const TReal *pdB, int iN) = ProdutoEscalarGenerico;
+void (*SomarEscalado)(TReal *pdY, TReal dA, const TReal *pdX, int iN) = SomarEscaladoGenerico;
+void (*ProdutoMatrizes)(TReal *pdC, int iLdC, const TReal *pdA, int iLdA, const TReal *pdB, int iLdB, int iM, int iN,
+    int iK) = ProdutoMatrizesGenerico;
+void (*TangenteHiperbolica)(TReal *pdX, int iN) = TangenteHiperbolicaGenerica;
+void (*TangenteHiperbolicaRapida)(TReal *pdX, int iN) = TangenteHiperbolicaRapidaGenerica;
+double (*SomaQuadradosDiferenca)(const TReal *pdA, const TReal *pdB, int iN) = SomaQuadradosDiferencaGenerica;
+void (*AjustarMomento)(TReal *pdY, TReal *pdV, TReal dMomento, TReal dFatorV, TReal dFatorG, TReal dA, const TReal *pdX,
+    int iN) = AjustarMomentoGenerico;
+void (*AjustarAdam)(TReal *pdY, TReal *pdM, TReal *pdV, TReal dBeta1, TReal dBeta2, TReal dTaxa, TReal dEpsilon,
+    TReal dA, const TReal *pdX, int iN) = AjustarAdamGenerico;
+void (*ProdutoMatrizInt8)(int *piY, const signed char *pcW, const signed char *pcX, int iNumLinhas, int iStride) =
+    ProdutoMatrizInt8Generico;
+void (*QuantizarInt8)(signed char *pcY, const TReal *pdX, const float *pfCentro, const float *pfInverso, int iN) =
+    QuantizarInt8Generico;
+static int iNivelAtivo = VETORIAL_ESCALAR;
+
+
+//*************************************** Funcoes ************************************************
+static int DetectarNivel(int iNivelMaximo)
+{
+#ifdef VETORIAL_X86
+  // Consulta o CPUID (inclui o suporte do sistema operacional aos registradores estendidos)
+  __builtin_cpu_init();
+  if (iNivelMaximo >= VETORIAL_AVX512 && __builtin_cpu_supports("avx512f"))
+    return VETORIAL_AVX512;
+  if (iNivelMaximo >= VETORIAL_AVX2 && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    return VETORIAL_AVX2;
+#endif
+  return VETORIAL_ESCALAR;
+}
+
+
+static void SelecionarKernels(int iNivel)
+{
+  // Caminho escalar (sempre disponivel)
+  ProdutoEscalar = ProdutoEscalarGenerico;
+  SomarEscalado = SomarEscaladoGenerico;
+  ProdutoMatrizes = ProdutoMatrizesGenerico;
+  TangenteHiperbolica = TangenteHiperbolicaGenerica;
+  TangenteHiperbolicaRapida = TangenteHiperbolicaRapidaGenerica;
+  SomaQuadradosDiferenca = SomaQuadradosDiferencaGenerica;
+  AjustarMomento = AjustarMomentoGenerico;
+  AjustarAdam = AjustarAdamGenerico;
+  ProdutoMatrizInt8 = ProdutoMatrizInt8Generico;
+  QuantizarInt8 = QuantizarInt8Generico;
+#ifdef VETORIAL_X86
+  if (iNivel == VETORIAL_AVX2) {
+    ProdutoEscalar = ProdutoEscalarAvx2;
+    SomarEscalado = SomarEscaladoAvx2;
+    ProdutoMatrizes = ProdutoMatrizesAvx2;
+    TangenteHiperbolica = TangenteHiperbolicaAvx2;
+    TangenteHiperbolicaRapida = TangenteHiperbolicaRapidaAvx2;
+    SomaQuadradosDiferenca = SomaQuadradosDiferencaAvx2;
+    AjustarMomento = AjustarMomentoAvx2;
+    AjustarAdam = AjustarAdamAvx2;
+    ProdutoMatrizInt8 = ProdutoMatrizInt8Avx2;
+    QuantizarInt8 = QuantizarInt8Avx2;
+  }
+  else if (iNivel == VETORIAL_AVX512) {
+    ProdutoEscalar = ProdutoEscalarAvx512;
+    SomarEscalado = SomarEscaladoAvx512;
+    ProdutoMatrizes = ProdutoMatrizesAvx512;
+    TangenteHiperbolica = TangenteHiperbolicaAvx512;
+    TangenteHiperbolicaRapida = TangenteHiperbolicaRapidaAvx512;
+    SomaQuadradosDiferenca = SomaQuadradosDiferencaAvx512;
+    AjustarMomento = AjustarMomentoAvx512;
+    AjustarAdam = AjustarAdamAvx512;
+    ProdutoMatrizInt8 = (__builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512vl") ?
+        ProdutoMatrizInt8Avx512 : ProdutoMatrizInt8Avx2);
+    QuantizarInt8 = QuantizarInt8Avx2;
+  }
+#endif
+  iNivelAtivo = iNivel;
+}
+
+
+int InicializarVetorial(int iNivelMaximo)
+{
+  // Seleciona o melhor conjunto de kernels suportado pela CPU, limitado a iNivelMaximo
+  SelecionarKernels(DetectarNivel(iNivelMaximo));
+  return iNivelAtivo;
+}
+
+
+int NivelVetorial()
+{
+  return iNivelAtivo;
+}
+
+
+const char *NomeNivelVetorial(int iNivel)
+{
+  switch (iNivel) {
+    case VETORIAL_AVX2:
+      return "AVX2";
+    case VETORIAL_AVX512:
+      return "AVX-512";
+  }
+  return "escalar";
+}
+
+
+static double Aleatorio(unsigned long *pulEstado, double dAmplitude)
+{
+  // Gerador congruente local, independente dos fluxos do treinamento
+  *pulEstado = (*pulEstado * 1103515245UL + 12345UL) & 0x7fffffffUL;
+  return ((double) *pulEstado / 0x7fffffffUL - 0.5) * 2.0 * dAmplitude;
+}
+
+
+static double ErroTangente(void (*pfTangente)(TReal *pdX, int iN))
+{
+  TReal vdX[TAMANHO_MEDICAO];
+  double dErro = 0.0;
+  int i, j;
+
+  // Erro absoluto maximo em relacao a tanh() da libm em [-12, 12], com passo de 1e-5
+  for (i = 0; i < 2400000; i += TAMANHO_MEDICAO) {
+    for (j = 0; j < TAMANHO_MEDICAO; j++)
+      vdX[j] = (TReal) (-12.0 + (i + j) * 1.0e-5);
+    pfTangente(vdX, TAMANHO_MEDICAO);
+    for (j = 0; j < TAMANHO_MEDICAO; j++) {
+      if (fabs(vdX[j] - tanh((double) (TReal) (-12.0 + (i + j) * 1.0e-5))) > dErro)
+        dErro = fabs(vdX[j] - tanh((double) (TReal) (-12.0 + (i + j) * 1.0e-5)));
+    }
+  }
+  return dErro;
+}
+
+
+static double TempoTangente(void (*pfTangente)(TReal *pdX, int iN), const TReal *pdEntrada)
+{
+  TReal vdX[TAMANHO_MEDICAO];
+  clock_t tInicio;
+  int i;
+
+  // Tempo medio por elemento, em nanossegundos (inclui a copia da entrada)
+  tInicio = clock();
+  for (i = 0; i < REPETICOES_MEDICAO; i++) {
+    memcpy(vdX, pdEntrada, sizeof(TReal) * TAMANHO_MEDICAO);
+    pfTangente(vdX, TAMANHO_MEDICAO);
+  }
+  return (double) (clock() - tInicio) / CLOCKS_PER_SEC * 1.0e9 / ((double) REPETICOES_MEDICAO * TAMANHO_MEDICAO);
+}
+
+
+int VerificarVetorial()
+{
+  TReal vdA[TAMANHO_VERIFICACAO], vdB[TAMANHO_VERIFICACAO], vdRef[TAMANHO_VERIFICACAO], vdVet[TAMANHO_VERIFICACAO];
+  TReal vdMomentoRef[TAMANHO_VERIFICACAO], vdMomentoVet[TAMANHO_VERIFICACAO];
+  TReal vdSegundoRef[TAMANHO_VERIFICACAO], vdSegundoVet[TAMANHO_VERIFICACAO];
+  TReal vdEntrada[TAMANHO_MEDICAO];
+  TReal vdMatrizA[LINHAS_VERIFICACAO * PROFUNDIDADE_VERIFICACAO];
+  TReal vdMatrizB[PROFUNDIDADE_VERIFICACAO * TAMANHO_VERIFICACAO];
+  TReal vdMatrizRef[LINHAS_VERIFICACAO * TAMANHO_VERIFICACAO], vdMatrizVet[LINHAS_VERIFICACAO * TAMANHO_VERIFICACAO];
+  signed char vcA[TAMANHO_VERIFICACAO], vcB[TAMANHO_VERIFICACAO];
+  int viRef[TAMANHO_VERIFICACAO], viVet[TAMANHO_VERIFICACAO], iStride;
+  float vfCentro[TAMANHO_VERIFICACAO], vfInverso[TAMANHO_VERIFICACAO];
+  double dRef, dVet, dEscala, dErroProduto, dErroAjuste, dErroTanh, dErroRapida, dErroQuadrados, dErroRegras;
+  double dErroInt8;
+  double dTempo, dTempoRapida;
+  unsigned long ulEstado = 1;
+  int iNivel, iNivelOriginal = iNivelAtivo, iNivelMaximo = DetectarNivel(VETORIAL_AVX512);
+  int i, j, n, iLinhas, iProfundidade, iOkNivel, iOk = 1;
+
+  // Compara cada nivel suportado com o caminho escalar, para varios tamanhos (inclusive restos);
+  // a tanh rapida e comparada com a tanh() da libm, dentro do erro maximo documentado
+  printf("Nivel      Produto    Ajuste     Tanh       Rapida     Quadrados  Regras     Int8       Resultado\n");
+  for (iNivel = VETORIAL_ESCALAR; iNivel <= iNivelMaximo; iNivel++) {
+    dErroProduto = dErroAjuste = dErroTanh = dErroRapida = dErroQuadrados = dErroRegras = dErroInt8 = 0.0;
+    for (n = 1; n < TAMANHO_VERIFICACAO; n += (n < 40 ? 1 : 37)) {
+      for (i = 0; i < n; i++) {
+        vdA[i] = Aleatorio(&ulEstado, 1.0);
+        vdB[i] = Aleatorio(&ulEstado, 1.0);
+      }
+
+      // Produto escalar (erro relativo a soma dos modulos)
+      SelecionarKernels(VETORIAL_ESCALAR);
+      dRef = ProdutoEscalar(0.5, vdA, vdB, n);
+      SelecionarKernels(iNivel);
+      dVet = ProdutoEscalar(0.5, vdA, vdB, n);
+      for (i = 0, dEscala = 0.5; i < n; i++)
+        dEscala += fabs(vdA[i] * vdB[i]);
+      if (fabs(dRef - dVet) / dEscala > dErroProduto)
+        dErroProduto = fabs(dRef - dVet) / dEscala;
+
+      // Produto de matrizes com 1 a 6 linhas (blocos de 4 e restos) e 1 a 9 termos por elemento, no mesmo
+      // erro do produto escalar (relativo ao numero de termos, com elementos em [-1, 1])
+      iLinhas = 1 + n % LINHAS_VERIFICACAO;
+      iProfundidade = 1 + n % PROFUNDIDADE_VERIFICACAO;
+      for (i = 0; i < iLinhas * iProfundidade; i++)
+        vdMatrizA[i] = Aleatorio(&ulEstado, 1.0);
+      for (i = 0; i < iProfundidade * n; i++)
+        vdMatrizB[i] = Aleatorio(&ulEstado, 1.0);
+      for (i = 0; i < iLinhas * n; i++)
+        vdMatrizRef[i] = vdMatrizVet[i] = Aleatorio(&ulEstado, 1.0);
+      SelecionarKernels(VETORIAL_ESCALAR);
+      ProdutoMatrizes(vdMatrizRef, n, vdMatrizA, iProfundidade, vdMatrizB, n, iLinhas, n, iProfundidade);
+      SelecionarKernels(iNivel);
+      ProdutoMatrizes(vdMatrizVet, n, vdMatrizA, iProfundidade, vdMatrizB, n, iLinhas, n, iProfundidade);
+      for (i = 0; i < iLinhas; i++) {
+        for (j = 0; j < n; j++) {
+          if (fabs(vdMatrizRef[i * n + j] - vdMatrizVet[i * n + j]) / (1.0 + iProfundidade) > dErroProduto)
+            dErroProduto = fabs(vdMatrizRef[i * n + j] - vdMatrizVet[i * n + j]) / (1.0 + iProfundidade);
+        }
+      }
+
+      // Ajuste de posto 1
+      memcpy(vdRef, vdB, sizeof(TReal) * n);
+      memcpy(vdVet, vdB, sizeof(TReal) * n);
+      SelecionarKernels(VETORIAL_ESCALAR);
+      SomarEscalado(vdRef, 0.75, vdA, n);
+      SelecionarKernels(iNivel);
+      SomarEscalado(vdVet, 0.75, vdA, n);
+      for (i = 0; i < n; i++) {
+        dEscala = fabs(vdB[i]) + fabs(0.75 * vdA[i]);
+        if (dEscala > 0.0 && fabs(vdRef[i] - vdVet[i]) / dEscala > dErroAjuste)
+          dErroAjuste = fabs(vdRef[i] - vdVet[i]) / dEscala;
+      }
+
+      // Tangente hiperbolica (erro absoluto, inclusive na regiao saturada)
+      for (i = 0; i < n; i++)
+        vdRef[i] = vdVet[i] = vdA[i] * 25.0;
+      SelecionarKernels(VETORIAL_ESCALAR);
+      TangenteHiperbolica(vdRef, n);
+      SelecionarKernels(iNivel);
+      TangenteHiperbolica(vdVet, n);
+      for (i = 0; i < n; i++) {
+        if (fabs(vdRef[i] - vdVet[i]) > dErroTanh)
+          dErroTanh = fabs(vdRef[i] - vdVet[i]);
+      }
+      for (i = 0; i < n; i++)
+        vdVet[i] = vdA[i] * 25.0;
+      TangenteHiperbolicaRapida(vdVet, n);
+      for (i = 0; i < n; i++) {
+        if (fabs(vdVet[i] - tanh((double) (TReal) (vdA[i] * 25.0))) > dErroRapida)
+          dErroRapida = fabs(vdVet[i] - tanh((double) (TReal) (vdA[i] * 25.0)));
+      }
+
+      // Soma dos quadrados das diferencas
+      SelecionarKernels(VETORIAL_ESCALAR);
+      dRef = SomaQuadradosDiferenca(vdA, vdB, n);
+      SelecionarKernels(iNivel);
+      dVet = SomaQuadradosDiferenca(vdA, vdB, n);
+      if (dRef > 0.0 && fabs(dRef - dVet) / dRef > dErroQuadrados)
+        dErroQuadrados = fabs(dRef - dVet) / dRef;
+
+      // Regras de ajuste (Nesterov e Adam, com estado inicial aleatorio; erro relativo aos pesos)
+      for (i = 0; i < n; i++) {
+        vdRef[i] = vdVet[i] = vdB[i];
+        vdMomentoRef[i] = vdMomentoVet[i] = Aleatorio(&ulEstado, 1.0);
+        vdSegundoRef[i] = vdSegundoVet[i] = fabs(Aleatorio(&ulEstado, 1.0));
+      }
+      SelecionarKernels(VETORIAL_ESCALAR);
+      AjustarMomento(vdRef, vdMomentoRef, 0.9, 0.9, 1.0, 0.75, vdA, n);
+      AjustarAdam(vdRef, vdMomentoRef, vdSegundoRef, 0.9, 0.999, 0.01, 1.0e-8, 0.75, vdA, n);
+      SelecionarKernels(iNivel);
+      AjustarMomento(vdVet, vdMomentoVet, 0.9, 0.9, 1.0, 0.75, vdA, n);
+      AjustarAdam(vdVet, vdMomentoVet, vdSegundoVet, 0.9, 0.999, 0.01, 1.0e-8, 0.75, vdA, n);
+      for (i = 0; i < n; i++) {
+        dEscala = fabs(vdB[i]) + 1.0;
+        if (fabs(vdRef[i] - vdVet[i]) / dEscala > dErroRegras)
+          dErroRegras = fabs(vdRef[i] - vdVet[i]) / dEscala;
+        if (fabs(vdMomentoRef[i] - vdMomentoVet[i]) / dEscala > dErroRegras)
+          dErroRegras = fabs(vdMomentoRef[i] - vdMomentoVet[i]) / dEscala;
+        if (fabs(vdSegundoRef[i] - vdSegundoVet[i]) / dEscala > dErroRegras)
+          dErroRegras = fabs(vdSegundoRef[i] - vdSegundoVet[i]) / dEscala;
+      }
+
+      // Produto int8 de uma matriz com as linhas em vcB (soma inteira, exata nos extremos de [-127, 127]);
+      // a partir de 16 elementos as linhas tem multiplos de 16 bytes, como nas redes quantizadas
+      for (i = 0; i < n; i++) {
+        vcA[i] = (signed char) (i % 7 ? Aleatorio(&ulEstado, 127.0) : 127);
+        vcB[i] = (signed char) (i % 7 ? Aleatorio(&ulEstado, 127.0) : -127);
+      }
+      iStride = (n >= 16 ? 16 * ((n / 16 + 1) / 2) : n);
+      SelecionarKernels(VETORIAL_ESCALAR);
+      ProdutoMatrizInt8(viRef, vcB, vcA, n / iStride, iStride);
+      SelecionarKernels(iNivel);
+      ProdutoMatrizInt8(viVet, vcB, vcA, n / iStride, iStride);
+      for (i = 0; i < n / iStride; i++) {
+        if (abs(viRef[i] - viVet[i]) > dErroInt8)
+          dErroInt8 = abs(viRef[i] - viVet[i]);
+      }
+
+      // Quantizacao int8 (inclusive saturada), identica ao caminho escalar
+      for (i = 0; i < n; i++) {
+        vfCentro[i] = (float) Aleatorio(&ulEstado, 0.5);
+        vfInverso[i] = (float) (100.0 + Aleatorio(&ulEstado, 60.0));
+      }
+      SelecionarKernels(VETORIAL_ESCALAR);
+      QuantizarInt8(vcA, vdA, vfCentro, vfInverso, n);
+      SelecionarKernels(iNivel);
+      QuantizarInt8(vcB, vdA, vfCentro, vfInverso, n);
+      for (i = 0; i < n; i++) {
+        if (abs(vcA[i] - vcB[i]) > dErroInt8)
+          dErroInt8 = abs(vcA[i] - vcB[i]);
+      }
+    }
+    iOkNivel = (dErroProduto <= TOLERANCIA_PRODUTO && dErroAjuste <= TOLERANCIA_PRODUTO &&
+        dErroTanh <= TOLERANCIA_TANH && dErroRapida <= TOLERANCIA_TANH_RAPIDA &&
+        dErroQuadrados <= TOLERANCIA_PRODUTO && dErroRegras <= TOLERANCIA_PRODUTO && dErroInt8 == 0.0);
+    iOk = iOk && iOkNivel;
+    printf("%-10s %.3e  %.3e  %.3e  %.3e  %.3e  %.3e  %.3e  %s\n", NomeNivelVetorial(iNivel), dErroProduto,
+        dErroAjuste, dErroTanh, dErroRapida, dErroQuadrados, dErroRegras, dErroInt8, (iOkNivel ? "OK" : "FALHOU"));
+  }
+
+  // Precisao x desempenho da tanh exata e da rapida (entradas tipicas de camadas ocultas)
+  for (i = 0; i < TAMANHO_MEDICAO; i++)
+    vdEntrada[i] = Aleatorio(&ulEstado, 4.0);
+  printf("\nNivel      Erro tanh  Erro rap.  ns tanh    ns rap.    Ganho\n");
+  for (iNivel = VETORIAL_ESCALAR; iNivel <= iNivelMaximo; iNivel++) {
+    SelecionarKernels(iNivel);
+    dTempo = TempoTangente(TangenteHiperbolica, vdEntrada);
+    dTempoRapida = TempoTangente(TangenteHiperbolicaRapida, vdEntrada);
+    printf("%-10s %.3e  %.3e  %-9.3f  %-9.3f  %.2fx\n", NomeNivelVetorial(iNivel), ErroTangente(TangenteHiperbolica),
+        ErroTangente(TangenteHiperbolicaRapida), dTempo, dTempoRapida, dTempo / dTempoRapida);
+  }
+
+  // Restaura os kernels em uso
+  SelecionarKernels(iNivelOriginal);
+  return iOk;
+}
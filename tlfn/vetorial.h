@@ -0,0 +1,82 @@
+//************************************************************************************************
+//* UNIVERSIDADE FEDERAL DO RIO GRANDE DO SUL (UFRGS) - Campus do Vale                          **
+//* Doutorado em Ciencia da Computacao - PPGC                                                   **
+//* Doutorando: Milton Roberto Heinen - 00145752                                                **
+//* Orientador: Paulo Martins Engel                                                             **
+//* Kernels vetoriais (escalar, AVX2 e AVX-512) com selecao em tempo de execucao                **
+//************************************************************************************************
+#ifndef VETORIAL_H
+#define VETORIAL_H
+
+
+//************************************** Constantes **********************************************
+#define VETORIAL_ESCALAR 0
+#define VETORIAL_AVX2 1
+#define VETORIAL_AVX512 2
+// Reducao do argumento da tanh e coeficientes da tanh rapida (tambem usados pelos controladores gerados com
+// tlfn -d, em RobotNeural/redecompilada.h)
+#define LN2_HI 6.93147180369123816490e-01
+#define LN2_LO 1.90821492927058770002e-10
+#define INV_LN2 1.44269504088896338700e+00
+#define TANH_LIMITE 40.0
+#define TANH_RAPIDA_LIMITE 9.0
+#define TANH_RAPIDA_P1 4.89352455891786e-03
+#define TANH_RAPIDA_P3 6.37261928875436e-04
+#define TANH_RAPIDA_P5 1.48572235717979e-05
+#define TANH_RAPIDA_P7 5.12229709037114e-08
+#define TANH_RAPIDA_P9 -8.60467152213735e-11
+#define TANH_RAPIDA_P11 2.00018790482477e-13
+#define TANH_RAPIDA_P13 -2.76076847742355e-16
+#define TANH_RAPIDA_Q0 4.89352518554385e-03
+#define TANH_RAPIDA_Q2 2.26843463243900e-03
+#define TANH_RAPIDA_Q4 1.18534705686654e-04
+#define TANH_RAPIDA_Q6 1.19825839466702e-06
+
+
+//************************************ Tipos de dados ********************************************
+// Precisao do database, das ativacoes e dos pesos (float com -DPRECISAO_SIMPLES)
+#ifdef PRECISAO_SIMPLES
+typedef float TReal;
+#else
+typedef double TReal;
+#endif
+
+
+//*********************************** Kernels ativos *********************************************
+// Retorna dInicial + soma(pdA[i] * pdB[i]), acumulando na ordem crescente de i no caminho escalar
+extern TReal (*ProdutoEscalar)(TReal dInicial, const TReal *pdA, const TReal *pdB, int iN);
+// pdY[i] += dA * pdX[i] (ajuste de posto 1 de uma linha de pesos)
+extern void (*SomarEscalado)(TReal *pdY, TReal dA, const TReal *pdX, int iN);
+// C(MxN) += A(MxK) * B(KxN) com blocos de 4 linhas de C nos registradores (cada vetor de B e reusado pelas 4
+// linhas e cada elemento de A pelas colunas do vetor); cada elemento acumula os produtos na ordem crescente de K
+extern void (*ProdutoMatrizes)(TReal *pdC, int iLdC, const TReal *pdA, int iLdA, const TReal *pdB, int iLdB, int iM,
+    int iN, int iK);
+// pdX[i] = tanh(pdX[i])
+extern void (*TangenteHiperbolica)(TReal *pdX, int iN);
+// pdX[i] ~ tanh(pdX[i]) por aproximacao racional, com erro absoluto maximo de 2.6e-8 em double
+// (em float o erro e dominado pelo arredondamento, ate 4e-7); usada pela ativacao tanh_rapida
+extern void (*TangenteHiperbolicaRapida)(TReal *pdX, int iN);
+// Retorna a soma de (pdA[i] - pdB[i])^2
+extern double (*SomaQuadradosDiferenca)(const TReal *pdA, const TReal *pdB, int iN);
+// Momentum com g = dA * pdX[i]: pdV[i] = dMomento * pdV[i] + g e pdY[i] += dFatorV * pdV[i] + dFatorG * g
+// (classico com dFatorV = 1 e dFatorG = 0; Nesterov com dFatorV = dMomento e dFatorG = 1)
+extern void (*AjustarMomento)(TReal *pdY, TReal *pdV, TReal dMomento, TReal dFatorV, TReal dFatorG, TReal dA,
+    const TReal *pdX, int iN);
+// Adam com g = dA * pdX[i]: pdM[i] = dBeta1 * pdM[i] + (1 - dBeta1) * g, pdV[i] = dBeta2 * pdV[i] + (1 - dBeta2) * g^2
+// e pdY[i] += dTaxa * pdM[i] / (sqrt(pdV[i]) + dEpsilon) (a correcao de vies fica em dTaxa)
+extern void (*AjustarAdam)(TReal *pdY, TReal *pdM, TReal *pdV, TReal dBeta1, TReal dBeta2, TReal dTaxa, TReal dEpsilon,
+    TReal dA, const TReal *pdX, int iN);
+// piY[i] = soma(pcW[i * iStride + k] * pcX[k]) para k < iStride, em 32 bits (exata para iStride < 2^17 com
+// valores em [-127, 127]); o padding das linhas deve ser zero
+extern void (*ProdutoMatrizInt8)(int *piY, const signed char *pcW, const signed char *pcX, int iNumLinhas, int iStride);
+// pcY[i] = (pdX[i] - pfCentro[i]) * pfInverso[i] saturado em [-127, 127] e arredondado (empates para cima)
+extern void (*QuantizarInt8)(signed char *pcY, const TReal *pdX, const float *pfCentro, const float *pfInverso, int iN);
+
+
+//************************************** Prototipos **********************************************
+int InicializarVetorial(int iNivelMaximo);
+int NivelVetorial();
+const char *NomeNivelVetorial(int iNivel);
+int VerificarVetorial();
+
+#endif